@@ -0,0 +1,857 @@
+/*
+ * Copyright (c) 2013-2016 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Multi-threaded message rate test for RDM endpoints.
+ *
+ * Each thread streams windows of tagged messages to the matching thread of
+ * the peer, then measures ping-pong latency with it.  The mapping of
+ * threads to endpoints and CQs is selectable, to show how a provider scales
+ * with contention on shared objects and with independent objects per
+ * thread.  Completions are credited to the thread that posted the
+ * operation, whichever thread reads them from a shared CQ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_tagged.h>
+
+#include <shared.h>
+#include "benchmark_shared.h"
+
+enum mt_mapping {
+	MT_EP,		/* endpoint and CQs per thread */
+	MT_SHARED_CQ,	/* endpoint per thread, CQs shared by all threads */
+	MT_SHARED_EP,	/* endpoint and CQs shared by all threads */
+	MT_SEP,		/* scalable endpoint, contexts and CQs per thread */
+	MT_MAPPING_MAX
+};
+
+static const char *mt_mapping_str[] = {
+	[MT_EP] = "ep",
+	[MT_SHARED_CQ] = "shared_cq",
+	[MT_SHARED_EP] = "shared_ep",
+	[MT_SEP] = "sep",
+};
+
+#define MT_ACK_TAG	(1ULL << 32)
+#define MT_CQ_BATCH	16
+
+struct mt_ctx {
+	struct fi_context2 context;
+	uint64_t *done;
+};
+
+struct mt_thread {
+	int id;
+	pthread_t thread;
+	struct fid_ep *tx_ep;
+	struct fid_ep *rx_ep;
+	struct fid_cq *txcq;
+	struct fid_cq *rxcq;
+	fi_addr_t peer;
+	char *tx_buf;
+	char *rx_buf;
+	struct fid_mr *tx_mr;
+	struct fid_mr *rx_mr;
+	void *tx_desc;
+	void *rx_desc;
+	struct mt_ctx *tx_ctx;
+	struct mt_ctx *rx_ctx;
+	uint64_t tx_posted;
+	uint64_t rx_posted;
+	uint64_t tx_done;
+	uint64_t rx_done;
+	uint64_t *lat;
+	uint64_t start;
+	uint64_t end;
+	int ret;
+};
+
+static int thread_cnt = 4;
+static enum mt_mapping mapping = MT_EP;
+static struct mt_thread *threads;
+static pthread_barrier_t barrier;
+static struct fid_ep *data_ep;
+static struct fid_av *sep_av;
+static struct fid_cq *shared_txcq, *shared_rxcq;
+static size_t mt_buf_size;
+
+static int mt_progress(struct mt_thread *t)
+{
+	struct fi_cq_entry comp[MT_CQ_BATCH];
+	struct fi_cq_err_entry err_entry;
+	struct fid_cq *cq[2] = { t->txcq, t->rxcq };
+	struct mt_ctx *ctx;
+	ssize_t ret;
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		ret = fi_cq_read(cq[i], comp, MT_CQ_BATCH);
+		if (ret > 0) {
+			for (j = 0; j < ret; j++) {
+				ctx = comp[j].op_context;
+				__atomic_add_fetch(ctx->done, 1,
+						   __ATOMIC_RELEASE);
+			}
+		} else if (ret == -FI_EAVAIL) {
+			memset(&err_entry, 0, sizeof(err_entry));
+			(void) fi_cq_readerr(cq[i], &err_entry, 0);
+			FT_CQ_ERR(cq[i], err_entry, NULL, 0);
+			return -err_entry.err;
+		} else if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return (int) ret;
+		}
+	}
+	return 0;
+}
+
+static int mt_wait(struct mt_thread *t, uint64_t *done, uint64_t target)
+{
+	int ret;
+
+	while (__atomic_load_n(done, __ATOMIC_ACQUIRE) < target) {
+		ret = mt_progress(t);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int mt_post_tx(struct mt_thread *t, size_t len, uint64_t tag,
+		      struct mt_ctx *ctx)
+{
+	ssize_t ret;
+	int inject;
+
+	inject = len <= fi->tx_attr->inject_size;
+	do {
+		if (inject)
+			ret = fi_tinject(t->tx_ep, t->tx_buf, len, t->peer,
+					 tag);
+		else
+			ret = fi_tsend(t->tx_ep, t->tx_buf, len, t->tx_desc,
+				       t->peer, tag, ctx);
+		if (ret == -FI_EAGAIN && mt_progress(t))
+			return -FI_EOTHER;
+	} while (ret == -FI_EAGAIN);
+
+	if (ret) {
+		FT_PRINTERR(inject ? "fi_tinject" : "fi_tsend", ret);
+		return (int) ret;
+	}
+
+	t->tx_posted++;
+	if (inject)
+		__atomic_add_fetch(&t->tx_done, 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int mt_post_rx(struct mt_thread *t, size_t len, uint64_t tag,
+		      struct mt_ctx *ctx)
+{
+	ssize_t ret;
+
+	do {
+		ret = fi_trecv(t->rx_ep, t->rx_buf, len, t->rx_desc,
+			       FI_ADDR_UNSPEC, tag, 0, ctx);
+		if (ret == -FI_EAGAIN && mt_progress(t))
+			return -FI_EOTHER;
+	} while (ret == -FI_EAGAIN);
+
+	if (ret) {
+		FT_PRINTERR("fi_trecv", ret);
+		return (int) ret;
+	}
+
+	t->rx_posted++;
+	return 0;
+}
+
+/* The client streams a window of messages, and the server acks each window */
+static int mt_bandwidth(struct mt_thread *t, int iters)
+{
+	size_t len = opts.transfer_size;
+	int i, j, ret;
+
+	for (i = 0; i < iters; i++) {
+		if (opts.dst_addr) {
+			ret = mt_post_rx(t, 0, MT_ACK_TAG | t->id,
+					 &t->rx_ctx[opts.window_size]);
+			if (ret)
+				return ret;
+
+			for (j = 0; j < opts.window_size; j++) {
+				ret = mt_post_tx(t, len, t->id, &t->tx_ctx[j]);
+				if (ret)
+					return ret;
+			}
+
+			ret = mt_wait(t, &t->tx_done, t->tx_posted);
+			if (ret)
+				return ret;
+
+			ret = mt_wait(t, &t->rx_done, t->rx_posted);
+		} else {
+			for (j = 0; j < opts.window_size; j++) {
+				ret = mt_post_rx(t, len, t->id, &t->rx_ctx[j]);
+				if (ret)
+					return ret;
+			}
+
+			ret = mt_wait(t, &t->rx_done, t->rx_posted);
+			if (ret)
+				return ret;
+
+			ret = mt_post_tx(t, 0, MT_ACK_TAG | t->id,
+					 &t->tx_ctx[opts.window_size]);
+			if (ret)
+				return ret;
+
+			ret = mt_wait(t, &t->tx_done, t->tx_posted);
+		}
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int mt_pingpong(struct mt_thread *t, int iters, uint64_t *lat)
+{
+	size_t len = opts.transfer_size;
+	uint64_t start;
+	int i, ret;
+
+	for (i = 0; i < iters; i++) {
+		start = ft_gettime_ns();
+		ret = mt_post_rx(t, len, t->id, &t->rx_ctx[0]);
+		if (ret)
+			return ret;
+
+		if (opts.dst_addr) {
+			ret = mt_post_tx(t, len, t->id, &t->tx_ctx[0]);
+			if (ret)
+				return ret;
+
+			ret = mt_wait(t, &t->rx_done, t->rx_posted);
+		} else {
+			ret = mt_wait(t, &t->rx_done, t->rx_posted);
+			if (ret)
+				return ret;
+
+			ret = mt_post_tx(t, len, t->id, &t->tx_ctx[0]);
+		}
+		if (ret)
+			return ret;
+
+		ret = mt_wait(t, &t->tx_done, t->tx_posted);
+		if (ret)
+			return ret;
+
+		if (lat)
+			lat[i] = (ft_gettime_ns() - start) / 2;
+	}
+	return 0;
+}
+
+static void *mt_run_thread(void *arg)
+{
+	struct mt_thread *t = arg;
+
+	pthread_barrier_wait(&barrier);
+
+	t->ret = mt_bandwidth(t, opts.warmup_iterations);
+	if (t->ret)
+		return NULL;
+
+	t->start = ft_gettime_ns();
+	t->ret = mt_bandwidth(t, opts.iterations);
+	t->end = ft_gettime_ns();
+	if (t->ret)
+		return NULL;
+
+	t->ret = mt_pingpong(t, opts.warmup_iterations, NULL);
+	if (t->ret)
+		return NULL;
+
+	t->ret = mt_pingpong(t, opts.iterations, t->lat);
+	return NULL;
+}
+
+static int mt_cmp_lat(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double mt_percentile(uint64_t *lat, int cnt, double pct)
+{
+	int i = (int) (pct * cnt / 100.0);
+
+	return lat[MIN(i, cnt - 1)] / 1000.0;
+}
+
+static void mt_show_perf(void)
+{
+	char str[FT_STR_LEN];
+	uint64_t start = UINT64_MAX, end = 0, msgs;
+	double elapsed;
+	static int header = 1;
+	int i;
+
+	for (i = 0; i < thread_cnt; i++) {
+		start = MIN(start, threads[i].start);
+		end = MAX(end, threads[i].end);
+	}
+	elapsed = (end - start) / 1000.0;
+	msgs = (uint64_t) thread_cnt * opts.iterations * opts.window_size;
+
+	if (header) {
+		printf("%-10s%-11s%-8s%-8s%-11s%-10s%-10s%-11s\n",
+		       "bytes", "mapping", "threads", "iters", "total",
+		       "time", "MB/sec", "Mxfers/sec");
+		header = 0;
+	}
+
+	printf("%-10s", size_str(str, opts.transfer_size));
+	printf("%-11s", mt_mapping_str[mapping]);
+	printf("%-8d", thread_cnt);
+	printf("%-8d", opts.iterations);
+	printf("%-11s", size_str(str, msgs * opts.transfer_size));
+	printf("%8.2fs", elapsed / 1000000.0);
+	printf("%10.2f", msgs * opts.transfer_size / elapsed);
+	printf("%11.2f\n", msgs / elapsed);
+
+	for (i = 0; i < thread_cnt; i++) {
+		qsort(threads[i].lat, opts.iterations, sizeof(*threads[i].lat),
+		      mt_cmp_lat);
+		printf("  thread %-3d latency usec: p50 %.2f p99 %.2f "
+		       "p99.9 %.2f max %.2f\n", i,
+		       mt_percentile(threads[i].lat, opts.iterations, 50),
+		       mt_percentile(threads[i].lat, opts.iterations, 99),
+		       mt_percentile(threads[i].lat, opts.iterations, 99.9),
+		       threads[i].lat[opts.iterations - 1] / 1000.0);
+	}
+}
+
+static int mt_run_size(void)
+{
+	int i, ret;
+
+	for (i = 0; i < thread_cnt; i++) {
+		threads[i].lat = calloc(opts.iterations,
+					sizeof(*threads[i].lat));
+		if (!threads[i].lat)
+			return -FI_ENOMEM;
+	}
+
+	ret = pthread_barrier_init(&barrier, NULL, thread_cnt);
+	if (ret)
+		return -ret;
+
+	for (i = 0; i < thread_cnt; i++) {
+		ret = pthread_create(&threads[i].thread, NULL, mt_run_thread,
+				     &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", -ret);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (threads[i].ret && !ret)
+			ret = threads[i].ret;
+	}
+	pthread_barrier_destroy(&barrier);
+
+	if (!ret)
+		mt_show_perf();
+
+	for (i = 0; i < thread_cnt; i++) {
+		free(threads[i].lat);
+		threads[i].lat = NULL;
+	}
+	return ret;
+}
+
+static int mt_open_cq(struct fid_cq **cq)
+{
+	struct fi_cq_attr attr = {
+		.format = FI_CQ_FORMAT_CONTEXT,
+		.wait_obj = FI_WAIT_NONE,
+	};
+	int ret;
+
+	ret = fi_cq_open(domain, &attr, cq, NULL);
+	if (ret)
+		FT_PRINTERR("fi_cq_open", ret);
+	return ret;
+}
+
+/*
+ * The endpoint opened by ft_init_fabric() is bound to fi->src_addr, which
+ * carries the well-known server address.  Every other endpoint needs its
+ * own: socket addresses keep the interface with the port cleared, other
+ * formats get the provider's default local address.
+ */
+static int mt_get_ep_info(struct fi_info **ep_info)
+{
+	struct fi_info *ep_hints;
+	struct sockaddr *sa;
+	int ret;
+
+	ep_hints = fi_dupinfo(fi);
+	if (!ep_hints)
+		return -FI_ENOMEM;
+
+	sa = (ep_hints->addr_format == FI_SOCKADDR ||
+	      ep_hints->addr_format == FI_SOCKADDR_IN ||
+	      ep_hints->addr_format == FI_SOCKADDR_IN6) ?
+	     ep_hints->src_addr : NULL;
+	if (sa && ep_hints->src_addrlen >= sizeof(struct sockaddr_in) &&
+	    sa->sa_family == AF_INET) {
+		((struct sockaddr_in *) sa)->sin_port = 0;
+		*ep_info = ep_hints;
+		return 0;
+	}
+
+	if (sa && ep_hints->src_addrlen >= sizeof(struct sockaddr_in6) &&
+	    sa->sa_family == AF_INET6) {
+		((struct sockaddr_in6 *) sa)->sin6_port = 0;
+		*ep_info = ep_hints;
+		return 0;
+	}
+
+	free(ep_hints->src_addr);
+	ep_hints->src_addr = NULL;
+	ep_hints->src_addrlen = 0;
+	free(ep_hints->dest_addr);
+	ep_hints->dest_addr = NULL;
+	ep_hints->dest_addrlen = 0;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, ep_hints, ep_info);
+	fi_freeinfo(ep_hints);
+	if (ret)
+		FT_PRINTERR("fi_getinfo", ret);
+	return ret;
+}
+
+static int mt_open_ep(struct fid_ep **ep_ptr, struct fid_cq *ep_txcq,
+		      struct fid_cq *ep_rxcq)
+{
+	struct fi_info *ep_info;
+	int ret;
+
+	ret = mt_get_ep_info(&ep_info);
+	if (ret)
+		return ret;
+
+	ret = fi_endpoint(domain, ep_info, ep_ptr, NULL);
+	fi_freeinfo(ep_info);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	FT_EP_BIND(*ep_ptr, av, 0);
+	FT_EP_BIND(*ep_ptr, ep_txcq, FI_TRANSMIT);
+	FT_EP_BIND(*ep_ptr, ep_rxcq, FI_RECV);
+
+	ret = fi_enable(*ep_ptr);
+	if (ret)
+		FT_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+static int mt_setup_eps(void)
+{
+	fi_addr_t peer;
+	int i, ret;
+
+	if (mapping != MT_EP) {
+		ret = mt_open_cq(&shared_txcq);
+		if (ret)
+			return ret;
+
+		ret = mt_open_cq(&shared_rxcq);
+		if (ret)
+			return ret;
+	}
+
+	if (mapping == MT_SHARED_EP) {
+		ret = mt_open_ep(&data_ep, shared_txcq, shared_rxcq);
+		if (ret)
+			return ret;
+
+		ret = ft_init_av_addr(av, data_ep, &peer);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		if (mapping == MT_EP) {
+			ret = mt_open_cq(&threads[i].txcq);
+			if (ret)
+				return ret;
+
+			ret = mt_open_cq(&threads[i].rxcq);
+			if (ret)
+				return ret;
+		} else {
+			threads[i].txcq = shared_txcq;
+			threads[i].rxcq = shared_rxcq;
+		}
+
+		if (mapping == MT_SHARED_EP) {
+			threads[i].tx_ep = data_ep;
+			threads[i].peer = peer;
+		} else {
+			ret = mt_open_ep(&threads[i].tx_ep, threads[i].txcq,
+					 threads[i].rxcq);
+			if (ret)
+				return ret;
+
+			ret = ft_init_av_addr(av, threads[i].tx_ep,
+					      &threads[i].peer);
+			if (ret)
+				return ret;
+		}
+		threads[i].rx_ep = threads[i].tx_ep;
+	}
+	return 0;
+}
+
+static int mt_setup_sep(void)
+{
+	struct fi_av_attr sep_av_attr = {0};
+	struct fi_info *sep_info;
+	fi_addr_t peer;
+	int i, ret, rx_ctx_bits = 0;
+
+	if (fi->domain_attr->max_ep_tx_ctx < thread_cnt ||
+	    fi->domain_attr->max_ep_rx_ctx < thread_cnt) {
+		fprintf(stderr, "Provider supports %zu tx and %zu rx contexts "
+			"per endpoint\n", fi->domain_attr->max_ep_tx_ctx,
+			fi->domain_attr->max_ep_rx_ctx);
+		return -FI_ENODATA;
+	}
+
+	while (thread_cnt >> ++rx_ctx_bits)
+		;
+
+	sep_info = fi_dupinfo(fi);
+	if (!sep_info)
+		return -FI_ENOMEM;
+
+	sep_info->ep_attr->tx_ctx_cnt = thread_cnt;
+	sep_info->ep_attr->rx_ctx_cnt = thread_cnt;
+	ret = fi_scalable_ep(domain, sep_info, &data_ep, NULL);
+	fi_freeinfo(sep_info);
+	if (ret) {
+		FT_PRINTERR("fi_scalable_ep", ret);
+		return ret;
+	}
+
+	sep_av_attr.type = fi->domain_attr->av_type;
+	sep_av_attr.rx_ctx_bits = rx_ctx_bits;
+	ret = fi_av_open(domain, &sep_av_attr, &sep_av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = fi_scalable_ep_bind(data_ep, &sep_av->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_scalable_ep_bind", ret);
+		return ret;
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		ret = mt_open_cq(&threads[i].txcq);
+		if (ret)
+			return ret;
+
+		ret = mt_open_cq(&threads[i].rxcq);
+		if (ret)
+			return ret;
+
+		ret = fi_tx_context(data_ep, i, NULL, &threads[i].tx_ep, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_tx_context", ret);
+			return ret;
+		}
+
+		ret = fi_rx_context(data_ep, i, NULL, &threads[i].rx_ep, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_rx_context", ret);
+			return ret;
+		}
+
+		FT_EP_BIND(threads[i].tx_ep, threads[i].txcq, FI_TRANSMIT);
+		FT_EP_BIND(threads[i].rx_ep, threads[i].rxcq, FI_RECV);
+
+		ret = fi_enable(threads[i].tx_ep);
+		if (ret) {
+			FT_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+
+		ret = fi_enable(threads[i].rx_ep);
+		if (ret) {
+			FT_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+	}
+
+	ret = fi_enable(data_ep);
+	if (ret) {
+		FT_PRINTERR("fi_enable", ret);
+		return ret;
+	}
+
+	ret = ft_init_av_addr(sep_av, data_ep, &peer);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < thread_cnt; i++)
+		threads[i].peer = fi_rx_addr(peer, i, rx_ctx_bits);
+	return 0;
+}
+
+static int mt_alloc_bufs(struct mt_thread *t)
+{
+	int ret;
+
+	t->tx_buf = malloc(mt_buf_size);
+	t->rx_buf = malloc(mt_buf_size);
+	t->tx_ctx = calloc(opts.window_size + 1, sizeof(*t->tx_ctx));
+	t->rx_ctx = calloc(opts.window_size + 1, sizeof(*t->rx_ctx));
+	if (!t->tx_buf || !t->rx_buf || !t->tx_ctx || !t->rx_ctx)
+		return -FI_ENOMEM;
+
+	memset(t->tx_buf, 'a' + t->id % 26, mt_buf_size);
+
+	ret = ft_reg_mr(fi, t->tx_buf, mt_buf_size, ft_info_to_mr_access(fi),
+			FT_MR_KEY + 1 + 2 * t->id, FI_HMEM_SYSTEM, 0,
+			&t->tx_mr, &t->tx_desc);
+	if (ret)
+		return ret;
+
+	ret = ft_reg_mr(fi, t->rx_buf, mt_buf_size, ft_info_to_mr_access(fi),
+			FT_MR_KEY + 2 + 2 * t->id, FI_HMEM_SYSTEM, 0,
+			&t->rx_mr, &t->rx_desc);
+	if (ret)
+		return ret;
+
+	for (ret = 0; ret <= opts.window_size; ret++) {
+		t->tx_ctx[ret].done = &t->tx_done;
+		t->rx_ctx[ret].done = &t->rx_done;
+	}
+	return 0;
+}
+
+static void mt_free_res(void)
+{
+	int i;
+
+	if (!threads)
+		return;
+
+	for (i = 0; i < thread_cnt; i++) {
+		FT_CLOSE_FID(threads[i].tx_mr);
+		FT_CLOSE_FID(threads[i].rx_mr);
+		if (mapping == MT_SEP) {
+			FT_CLOSE_FID(threads[i].tx_ep);
+			FT_CLOSE_FID(threads[i].rx_ep);
+		} else if (mapping != MT_SHARED_EP) {
+			FT_CLOSE_FID(threads[i].tx_ep);
+		}
+	}
+	FT_CLOSE_FID(data_ep);
+
+	for (i = 0; i < thread_cnt; i++) {
+		if (threads[i].txcq != shared_txcq)
+			FT_CLOSE_FID(threads[i].txcq);
+		if (threads[i].rxcq != shared_rxcq)
+			FT_CLOSE_FID(threads[i].rxcq);
+		free(threads[i].tx_buf);
+		free(threads[i].rx_buf);
+		free(threads[i].tx_ctx);
+		free(threads[i].rx_ctx);
+	}
+	FT_CLOSE_FID(shared_txcq);
+	FT_CLOSE_FID(shared_rxcq);
+	FT_CLOSE_FID(sep_av);
+	free(threads);
+	threads = NULL;
+}
+
+static int run(void)
+{
+	int i, ret = 0;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	threads = calloc(thread_cnt, sizeof(*threads));
+	if (!threads)
+		return -FI_ENOMEM;
+
+	if (opts.options & FT_OPT_SIZE) {
+		mt_buf_size = opts.transfer_size;
+	} else {
+		for (i = 0; i < TEST_CNT; i++) {
+			if (ft_use_size(i, opts.sizes_enabled))
+				mt_buf_size = MAX(mt_buf_size, test_size[i].size);
+		}
+	}
+	mt_buf_size = MAX(mt_buf_size, 1);
+
+	for (i = 0; i < thread_cnt; i++)
+		threads[i].id = i;
+
+	ret = (mapping == MT_SEP) ? mt_setup_sep() : mt_setup_eps();
+	if (ret)
+		goto out;
+
+	for (i = 0; i < thread_cnt; i++) {
+		ret = mt_alloc_bufs(&threads[i]);
+		if (ret)
+			goto out;
+	}
+
+	if (!(opts.options & FT_OPT_SIZE)) {
+		for (i = 0; i < TEST_CNT; i++) {
+			if (!ft_use_size(i, opts.sizes_enabled))
+				continue;
+			opts.transfer_size = test_size[i].size;
+			init_test(&opts, test_name, sizeof(test_name));
+			ret = mt_run_size();
+			if (ret)
+				goto out;
+		}
+	} else {
+		init_test(&opts, test_name, sizeof(test_name));
+		ret = mt_run_size();
+		if (ret)
+			goto out;
+	}
+
+	ret = ft_finalize();
+out:
+	mt_free_res();
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_BW;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "T:x:h" CS_OPTS INFO_OPTS
+				 BENCHMARK_OPTS, long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			thread_cnt = atoi(optarg);
+			if (thread_cnt < 1) {
+				fprintf(stderr, "Invalid thread count\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'x':
+			for (mapping = 0; mapping < MT_MAPPING_MAX; mapping++) {
+				if (!strcasecmp(optarg, mt_mapping_str[mapping]))
+					break;
+			}
+			if (mapping == MT_MAPPING_MAX) {
+				fprintf(stderr, "Invalid mapping: %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Multi-threaded message rate test "
+				   "for RDM endpoints using tagged messages.");
+			FT_PRINT_OPTS_USAGE("-T <threads>",
+				"number of threads (default: 4)");
+			FT_PRINT_OPTS_USAGE("-x <mapping>",
+				"mapping of threads to endpoints and CQs: ep "
+				"(endpoint and CQs per thread, default), "
+				"shared_cq (endpoint per thread, shared CQs), "
+				"shared_ep (shared endpoint and CQs), or sep "
+				"(scalable endpoint with contexts per thread)");
+			ft_benchmark_usage();
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	opts.threading = (mapping == MT_SHARED_CQ || mapping == MT_SHARED_EP) ?
+			 FI_THREAD_SAFE : FI_THREAD_COMPLETION;
+	hints->caps = FI_TAGGED;
+	if (mapping == MT_SEP)
+		hints->caps |= FI_NAMED_RX_CTX;
+	hints->mode |= FI_CONTEXT | FI_CONTEXT2;
+	hints->domain_attr->mr_mode = opts.mr_mode & ~FI_MR_ENDPOINT;
+	hints->tx_attr->tclass = FI_TC_BULK_DATA;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -276,6 +276,70 @@ static int sum_all_reduce_test_run(enum fi_collective_op coll_op, enum fi_op op,
 	return -FI_ENOEQ;
 }
 
+static int sum_all_reduce_vector_test_run(enum fi_collective_op coll_op,
+		enum fi_op op, enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t *data, *result;
+	uint64_t expect_result, nranks = 0, rank_sum = 0;
+	const size_t count = 1 << 17; /* large enough for the ring algorithm */
+	uint64_t i;
+	int err;
+
+	assert(coll_op == FI_ALLREDUCE);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	if (!is_my_rank_participating())
+		return FI_SUCCESS;
+
+	data = malloc(count * sizeof(*data));
+	result = malloc(count * sizeof(*result));
+	if (!data || !result) {
+		err = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++)
+		data[i] = pm_job.my_rank + i;
+
+	for (i = av_set_attr.start_addr;
+	     i <= av_set_attr.end_addr;
+	     i += av_set_attr.stride) {
+		rank_sum += i;
+		nranks++;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_allreduce(ep, data, count, NULL, result, NULL, coll_addr,
+			   FI_UINT64, FI_SUM, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective allreduce failed - fi_allreduce", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		expect_result = rank_sum + nranks * i;
+		if (result[i] != expect_result) {
+			FT_DEBUG("allreduce failed; expect[%ld]: %ld, "
+				 "actual[%ld]: %ld\n", i, expect_result,
+				 i, result[i]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+	}
+	err = FI_SUCCESS;
+
+out:
+	free(data);
+	free(result);
+	return err;
+}
+
 static int all_gather_test_run(enum fi_collective_op coll_op, enum fi_op op,
 		enum fi_datatype datatype)
 {
@@ -333,6 +397,189 @@ out:
 	return ret;
 }
 
+static int sum_reduce_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t result = 0;
+	uint64_t expect_result = 0;
+	uint64_t data;
+	const uint64_t base_data_value = 1234; /* any arbitrary value != 0 */
+	fi_addr_t root = pm_job.num_ranks - 1;
+	uint64_t i;
+	int err;
+
+	assert(coll_op == FI_REDUCE);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	data = base_data_value + pm_job.my_rank;
+	for (i = 0; i < pm_job.num_ranks; i++)
+		expect_result += base_data_value + i;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_reduce(ep, &data, 1, NULL, &result, NULL, coll_addr, root,
+			FI_UINT64, FI_SUM, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective reduce failed - fi_reduce", err);
+		return err;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		return err;
+
+	if (pm_job.my_rank != root || result == expect_result)
+		return FI_SUCCESS;
+
+	FT_DEBUG("reduce failed; expect: %ld, actual: %ld",
+		 expect_result, result);
+	return -FI_ENOEQ;
+}
+
+static int sum_reduce_scatter_test_run(enum fi_collective_op coll_op,
+		enum fi_op op, enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t result = 0;
+	uint64_t expect_result = 0;
+	uint64_t *data;
+	uint64_t i;
+	int err;
+
+	assert(coll_op == FI_REDUCE_SCATTER);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	data = malloc(pm_job.num_ranks * sizeof(*data));
+	if (!data)
+		return -FI_ENOMEM;
+
+	/* block j of rank r holds r + j, so rank j receives the sum over r */
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		data[i] = pm_job.my_rank + i;
+		expect_result += i + pm_job.my_rank;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_reduce_scatter(ep, data, 1, NULL, &result, NULL, coll_addr,
+				FI_UINT64, FI_SUM, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective reduce scatter failed - "
+			    "fi_reduce_scatter", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		goto out;
+
+	if (result != expect_result) {
+		FT_DEBUG("reduce scatter failed; expect: %ld, actual: %ld",
+			 expect_result, result);
+		err = -FI_ENOEQ;
+	}
+
+out:
+	free(data);
+	return err;
+}
+
+static int all_to_all_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t *data, *result;
+	uint64_t expect_result;
+	uint64_t i;
+	int err;
+
+	assert(coll_op == FI_ALLTOALL);
+	assert(datatype == FI_UINT64);
+
+	data = malloc(pm_job.num_ranks * sizeof(*data));
+	result = malloc(pm_job.num_ranks * sizeof(*result));
+	if (!data || !result) {
+		err = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < pm_job.num_ranks; i++)
+		data[i] = pm_job.my_rank * pm_job.num_ranks + i;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_alltoall(ep, data, 1, NULL, result, NULL, coll_addr,
+			  FI_UINT64, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective alltoall failed - fi_alltoall", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		goto out;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		expect_result = i * pm_job.num_ranks + pm_job.my_rank;
+		if (result[i] != expect_result) {
+			FT_DEBUG("alltoall failed; expect[%ld]: %ld, "
+				 "actual[%ld]: %ld\n", i, expect_result,
+				 i, result[i]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+	}
+
+out:
+	free(data);
+	free(result);
+	return err;
+}
+
+static int gather_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t *result;
+	uint64_t data = pm_job.my_rank;
+	fi_addr_t root = pm_job.num_ranks - 1;
+	uint64_t i;
+	int err;
+
+	assert(coll_op == FI_GATHER);
+	assert(datatype == FI_UINT64);
+
+	result = malloc(pm_job.num_ranks * sizeof(*result));
+	if (!result)
+		return -FI_ENOMEM;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_gather(ep, &data, 1, NULL,
+			pm_job.my_rank == root ? result : NULL, NULL,
+			coll_addr, root, FI_UINT64, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective gather failed - fi_gather", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err || pm_job.my_rank != root)
+		goto out;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		if (result[i] != i) {
+			FT_DEBUG("gather failed; expect[%ld]: %ld, "
+				 "actual[%ld]: %ld\n", i, i, i, result[i]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+	}
+
+out:
+	free(result);
+	return err;
+}
+
 static int scatter_test_run(enum fi_collective_op coll_op, enum fi_op op,
 		enum fi_datatype datatype)
 {
@@ -487,6 +734,15 @@ struct coll_test tests[] = {
 		.op = FI_SUM,
 		.datatype = FI_UINT64,
 	},
+	{
+		.name = "sum_all_reduce_vector_test",
+		.setup = coll_setup,
+		.run = sum_all_reduce_vector_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLREDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
 	{
 		.name = "all_gather_test",
 		.setup = coll_setup,
@@ -514,6 +770,42 @@ struct coll_test tests[] = {
 		.op = FI_NOOP,
 		.datatype = FI_UINT64
 	},
+	{
+		.name = "sum_reduce_test",
+		.setup = coll_setup,
+		.run = sum_reduce_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_REDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
+	{
+		.name = "sum_reduce_scatter_test",
+		.setup = coll_setup,
+		.run = sum_reduce_scatter_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_REDUCE_SCATTER,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
+	{
+		.name = "all_to_all_test",
+		.setup = coll_setup,
+		.run = all_to_all_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLTOALL,
+		.op = FI_NOOP,
+		.datatype = FI_UINT64
+	},
+	{
+		.name = "gather_test",
+		.setup = coll_setup,
+		.run = gather_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_GATHER,
+		.op = FI_NOOP,
+		.datatype = FI_UINT64
+	},
 	{
 		.name = "empty_test_to_stop_the_sequence_of_execution",
 		.run = NULL,
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2025 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This test checks that a striped rendezvous transfer completes when one
+ * of the extra connections (lanes) to the peer is lost in the middle of
+ * it.  The receiver shuts down its lane sockets after it has answered the
+ * sender's request to send, while the sender is not progressing.  Both
+ * sides must then get a completion or an error for the transfer, and a
+ * later transfer between the peers must succeed.
+ */
+
+#include <dirent.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <rdma/fi_tagged.h>
+#include <shared.h>
+
+#define LANE_TAG	0x5a5a000000000000ULL
+#define LANE_WARMUP	8
+
+static int lane_wait(struct fid_cq *cq, int *err)
+{
+	struct fi_cq_tagged_entry comp;
+	struct fi_cq_err_entry comp_err = {0};
+	uint64_t end;
+	int ret;
+
+	end = ft_gettime_ms() + timeout * 1000;
+	do {
+		ret = fi_cq_read(cq, &comp, 1);
+		if (ret == 1) {
+			*err = 0;
+			return 0;
+		}
+		if (ret == -FI_EAVAIL) {
+			ret = fi_cq_readerr(cq, &comp_err, 0);
+			if (ret == 1) {
+				*err = comp_err.err;
+				return 0;
+			}
+		}
+		if (ret < 0 && ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return ret;
+		}
+	} while (ft_gettime_ms() < end);
+
+	fprintf(stderr, "%ds timeout expired\n", timeout);
+	return -FI_ETIMEDOUT;
+}
+
+static void lane_progress(int ms)
+{
+	uint64_t end = ft_gettime_ms() + ms;
+
+	while (ft_gettime_ms() < end) {
+		(void) fi_cq_read(rxcq, NULL, 0);
+		(void) fi_cq_read(txcq, NULL, 0);
+	}
+}
+
+static bool lane_is_tcp_conn(int fd)
+{
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	int val;
+
+	if (fd == oob_sock || fd == sock || fd == listen_sock)
+		return false;
+
+	if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &val,
+		       &(socklen_t) {sizeof(val)}) || val != SOCK_STREAM)
+		return false;
+
+	if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &val,
+		       &(socklen_t) {sizeof(val)}) || val)
+		return false;
+
+	if (getpeername(fd, (struct sockaddr *) &addr, &len))
+		return false;
+
+	return addr.ss_family == AF_INET || addr.ss_family == AF_INET6;
+}
+
+/* The lanes are connected after the primary connection, so every
+ * provider socket but the lowest numbered one is a lane.
+ */
+static int lane_shutdown(void)
+{
+	struct dirent *entry;
+	int fd, primary = -1, cnt = 0;
+	DIR *dir;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir) {
+		FT_PRINTERR("opendir", -errno);
+		return -errno;
+	}
+
+	while ((entry = readdir(dir))) {
+		fd = atoi(entry->d_name);
+		if (fd != dirfd(dir) && lane_is_tcp_conn(fd) &&
+		    (primary < 0 || fd < primary))
+			primary = fd;
+	}
+
+	rewinddir(dir);
+	while ((entry = readdir(dir))) {
+		fd = atoi(entry->d_name);
+		if (fd == primary || fd == dirfd(dir) || !lane_is_tcp_conn(fd))
+			continue;
+		(void) shutdown(fd, SHUT_RDWR);
+		cnt++;
+	}
+	closedir(dir);
+
+	printf("shut down %d lane(s)\n", cnt);
+	return cnt ? 0 : -FI_ENODATA;
+}
+
+static int lane_xfer(uint64_t tag, int *err)
+{
+	int ret;
+
+	if (opts.dst_addr) {
+		do {
+			ret = fi_tsend(ep, tx_buf, opts.transfer_size, mr_desc,
+				       remote_fi_addr, tag, &tx_ctx);
+			if (ret == -FI_EAGAIN)
+				(void) fi_cq_read(txcq, NULL, 0);
+		} while (ret == -FI_EAGAIN);
+		if (ret) {
+			FT_PRINTERR("fi_tsend", ret);
+			return ret;
+		}
+		return lane_wait(txcq, err);
+	}
+
+	ret = fi_trecv(ep, rx_buf, opts.transfer_size, mr_desc,
+		       FI_ADDR_UNSPEC, tag, 0, &rx_ctx);
+	if (ret) {
+		FT_PRINTERR("fi_trecv", ret);
+		return ret;
+	}
+	return lane_wait(rxcq, err);
+}
+
+static int run(void)
+{
+	int i, ret, err;
+
+	ret = ft_init_fabric();
+	if (ret) {
+		FT_PRINTERR("ft_init_fabric", -ret);
+		return ret;
+	}
+
+	/* Give the lanes time to connect and be used */
+	for (i = 0; i < LANE_WARMUP; i++) {
+		ret = lane_xfer(LANE_TAG + i, &err);
+		if (ret)
+			goto out;
+		if (err) {
+			fprintf(stderr, "warmup transfer failed: %s\n",
+				fi_strerror(err));
+			ret = -err;
+			goto out;
+		}
+	}
+
+	if (opts.dst_addr) {
+		ret = fi_tsend(ep, tx_buf, opts.transfer_size, mr_desc,
+			       remote_fi_addr, LANE_TAG + i, &tx_ctx);
+		if (ret) {
+			FT_PRINTERR("fi_tsend", ret);
+			goto out;
+		}
+		/* Let the receiver lose its lanes before the data is sent */
+		sleep(2);
+		ret = lane_wait(txcq, &err);
+	} else {
+		ret = fi_trecv(ep, rx_buf, opts.transfer_size, mr_desc,
+			       FI_ADDR_UNSPEC, LANE_TAG + i, 0, &rx_ctx);
+		if (ret) {
+			FT_PRINTERR("fi_trecv", ret);
+			goto out;
+		}
+		lane_progress(500);
+		ret = lane_shutdown();
+		if (ret)
+			goto out;
+		ret = lane_wait(rxcq, &err);
+	}
+	if (ret)
+		goto out;
+	printf("faulted transfer completed: %s\n",
+	       err ? fi_strerror(err) : "success");
+
+	/* The connection is re-established if it was torn down */
+	ret = lane_xfer(LANE_TAG + i + 1, &err);
+	if (!ret && err) {
+		fprintf(stderr, "transfer after fault failed: %s\n",
+			fi_strerror(err));
+		ret = -err;
+	}
+
+out:
+	ft_free_res();
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SIZE;
+	opts.transfer_size = 4 * 1024 * 1024;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	timeout = 10;
+	while ((op = getopt(argc, argv, "h" ADDR_OPTS INFO_OPTS CS_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_addr_opts(op, optarg, &opts);
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case '?':
+		case 'h':
+			ft_usage(argv[0], "tcp rdm striping lane fault test");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	/* Send large messages with rendezvous, and stripe the data over a
+	 * second connection
+	 */
+	setenv("FI_TCP_MAX_SAVED_SIZE", "65536", 0);
+	setenv("FI_TCP_RDM_STRIPES", "2", 0);
+
+	if (!hints->fabric_attr->prov_name)
+		hints->fabric_attr->prov_name = strdup("tcp");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_TAGGED;
+	/* The sender must not move data while it sleeps */
+	hints->domain_attr->data_progress = FI_PROGRESS_MANUAL;
+	hints->domain_attr->control_progress = FI_PROGRESS_MANUAL;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+	if (ret)
+		FT_PRINTERR("Test failed", -ret);
+
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2025 Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * This test allocates and frees transfer entries from several threads at
+ * once.  With FI_THREAD_COMPLETION, every rdm endpoint of a tcp domain
+ * gets its own progress engine, and all of them draw their transfer
+ * entries from one pool shared by the domain.  Each thread posts a burst
+ * of receives on its own endpoint, larger than the pool grows at a time,
+ * and then cancels them.  Every receive must be reported as canceled
+ * exactly once.  The test does not talk to a peer, so the client and the
+ * server run the same steps independently.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <rdma/fi_tagged.h>
+#include <shared.h>
+
+#define XFER_BURST	2048
+
+struct xfer_thread {
+	pthread_t		thread;
+	int			id;
+	int			ret;
+	struct fid_av		*av;
+	struct fid_cq		*cq;
+	struct fid_ep		*ep;
+	struct fi_context	ctx[XFER_BURST];
+	bool			done[XFER_BURST];
+};
+
+static struct xfer_thread *threads;
+static int thread_cnt = 4;
+
+static int xfer_open(struct xfer_thread *xt)
+{
+	struct fi_av_attr av_attr = {
+		.type = FI_AV_TABLE,
+	};
+	struct fi_cq_attr cq_attr = {
+		.format = FI_CQ_FORMAT_TAGGED,
+		.size = XFER_BURST,
+		.wait_obj = FI_WAIT_NONE,
+	};
+	int ret;
+
+	ret = fi_av_open(domain, &av_attr, &xt->av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = fi_cq_open(domain, &cq_attr, &xt->cq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	ret = fi_endpoint(domain, fi, &xt->ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(xt->ep, &xt->av->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(xt->ep, &xt->cq->fid, FI_TRANSMIT | FI_RECV);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_enable(xt->ep);
+	if (ret)
+		FT_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+static void xfer_close(struct xfer_thread *xt)
+{
+	FT_CLOSE_FID(xt->ep);
+	FT_CLOSE_FID(xt->cq);
+	FT_CLOSE_FID(xt->av);
+}
+
+static int xfer_reap(struct xfer_thread *xt)
+{
+	struct fi_cq_err_entry comp_err = {0};
+	struct fi_cq_tagged_entry comp;
+	uint64_t end;
+	int i, cnt = 0, ret;
+
+	memset(xt->done, 0, sizeof(xt->done));
+	end = ft_gettime_ms() + timeout * 1000;
+	while (cnt < XFER_BURST) {
+		ret = fi_cq_read(xt->cq, &comp, 1);
+		if (ret == 1) {
+			fprintf(stderr, "thread %d: receive completed without "
+				"a message\n", xt->id);
+			return -FI_EOTHER;
+		}
+		if (ret == -FI_EAGAIN) {
+			if (ft_gettime_ms() > end) {
+				fprintf(stderr, "thread %d: %d of %d receives "
+					"canceled after %ds\n", xt->id, cnt,
+					XFER_BURST, timeout);
+				return -FI_ETIMEDOUT;
+			}
+			continue;
+		}
+		if (ret != -FI_EAVAIL) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return ret;
+		}
+
+		ret = fi_cq_readerr(xt->cq, &comp_err, 0);
+		if (ret != 1) {
+			FT_PRINTERR("fi_cq_readerr", ret);
+			return ret ? ret : -FI_EOTHER;
+		}
+
+		i = (int) (((uintptr_t) comp_err.op_context -
+			    (uintptr_t) xt->ctx) / sizeof(*xt->ctx));
+		if (comp_err.err != FI_ECANCELED ||
+		    (uintptr_t) comp_err.op_context < (uintptr_t) xt->ctx ||
+		    i >= XFER_BURST || comp_err.op_context != &xt->ctx[i] ||
+		    xt->done[i]) {
+			fprintf(stderr, "thread %d: unexpected completion "
+				"(context %p, error %d)\n", xt->id,
+				comp_err.op_context, comp_err.err);
+			return -FI_EOTHER;
+		}
+		xt->done[i] = true;
+		cnt++;
+	}
+	return 0;
+}
+
+static int xfer_round(struct xfer_thread *xt, int round)
+{
+	int i, ret;
+
+	for (i = 0; i < XFER_BURST; i++) {
+		ret = fi_trecv(xt->ep, NULL, 0, NULL, FI_ADDR_UNSPEC,
+			       ((uint64_t) round << 32) | i, 0, &xt->ctx[i]);
+		if (ret) {
+			FT_PRINTERR("fi_trecv", ret);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < XFER_BURST; i++) {
+		ret = fi_cancel(&xt->ep->fid, &xt->ctx[i]);
+		if (ret) {
+			FT_PRINTERR("fi_cancel", ret);
+			return ret;
+		}
+	}
+
+	return xfer_reap(xt);
+}
+
+static void *xfer_thread_main(void *arg)
+{
+	struct xfer_thread *xt = arg;
+	int i;
+
+	xt->ret = xfer_open(xt);
+	for (i = 0; !xt->ret && i < opts.iterations; i++)
+		xt->ret = xfer_round(xt, i);
+	xfer_close(xt);
+	return NULL;
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	threads = calloc(thread_cnt, sizeof(*threads));
+	if (!threads)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < thread_cnt; i++) {
+		threads[i].id = i;
+		ret = pthread_create(&threads[i].thread, NULL,
+				     xfer_thread_main, &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", -ret);
+			thread_cnt = i;
+			ret = -ret;
+			break;
+		}
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (!ret && threads[i].ret)
+			ret = threads[i].ret;
+	}
+	free(threads);
+
+	if (!ret)
+		printf("%d threads canceled %d receives each\n", thread_cnt,
+		       opts.iterations * XFER_BURST);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.iterations = 20;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	timeout = 10;
+	while ((op = getopt(argc, argv, "T:h" ADDR_OPTS INFO_OPTS CS_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_addr_opts(op, optarg, &opts);
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			thread_cnt = atoi(optarg);
+			if (thread_cnt < 1) {
+				fprintf(stderr, "Invalid thread count\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_usage(argv[0], "tcp rdm multi-threaded transfer "
+				 "entry allocation test");
+			FT_PRINT_OPTS_USAGE("-T <threads>",
+				"number of threads (default: 4)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!hints->fabric_attr->prov_name)
+		hints->fabric_attr->prov_name = strdup("tcp");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_TAGGED;
+	/* Give every endpoint its own progress engine */
+	hints->domain_attr->threading = FI_THREAD_COMPLETION;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+	if (ret)
+		FT_PRINTERR("Test failed", -ret);
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -232,6 +232,8 @@ standard_tests=(
 	"fi_rdm_tagged_bw -U"
 	"fi_rdm_tagged_bw -v"
 	"fi_rdm_tagged_bw -v -U"
+	"fi_rdm_mt_bw -I 20"
+	"fi_rdm_mt_bw -x shared_ep -I 20"
 	"fi_dgram_pingpong"
 	"fi_dgram_pingpong -k"
 )
@@ -292,6 +294,11 @@ prov_efa_tests=( \
 	"fi_efa_rnr_queue_resend -c 1 -A write -U -S 4"
 )
 
+prov_tcp_tests=( \
+	"fi_tcp_rdm_lane_fault"
+	"fi_tcp_rdm_xfer_cache"
+)
+
 function errcho {
 	>&2 echo $*
 }
@@ -763,6 +770,12 @@ function prov_efa_test {
 	done
 }
 
+function prov_tcp_test {
+	for test in "${prov_tcp_tests[@]}"; do
+		cs_test "$test"
+	done
+}
+
 function set_core_util {
 	prov_arr=$(echo $PROV | tr ";" " ")
 	CORE=""
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures fi_mr_reg()/fi_close() throughput on a single domain while the
+ * number of registering threads is doubled from 1 up to the requested count.
+ * Each thread repeatedly registers its own buffer, which is kept registered
+ * once up front so that every measured registration is a cache hit.  With a
+ * provider MR cache whose hit path does not serialize, the aggregate rate
+ * should grow with the number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include <rdma/fi_domain.h>
+#include <rdma/fi_errno.h>
+
+#include "unit_common.h"
+#include "shared.h"
+
+static char err_buf[512];
+static size_t mr_buf_size = 16384;
+static int max_threads = 4;
+static int iterations = 100000;
+
+struct mr_thread {
+	pthread_t	thread;
+	int		id;
+	void		*buf;
+	struct fid_mr	*prime_mr;
+	pthread_barrier_t *barrier;
+	uint64_t	elapsed_ns;
+	int		ret;
+};
+
+static void *mr_reg_thread(void *arg)
+{
+	struct mr_thread *ctx = arg;
+	struct fid_mr *mr;
+	uint64_t access, start_ns;
+	int i, ret;
+
+	access = ft_info_to_mr_access(fi);
+	pthread_barrier_wait(ctx->barrier);
+
+	start_ns = ft_gettime_ns();
+	for (i = 0; i < iterations; i++) {
+		ret = fi_mr_reg(domain, ctx->buf, mr_buf_size, access, 0,
+				FT_MR_KEY + max_threads + ctx->id, 0, &mr,
+				NULL);
+		if (ret)
+			goto out;
+
+		ret = fi_close(&mr->fid);
+		if (ret)
+			goto out;
+	}
+	ctx->elapsed_ns = ft_gettime_ns() - start_ns;
+out:
+	ctx->ret = ret;
+	return NULL;
+}
+
+static int mr_cache_run(struct mr_thread *threads, int nthreads)
+{
+	pthread_barrier_t barrier;
+	uint64_t max_ns = 0;
+	int i, ret;
+
+	ret = pthread_barrier_init(&barrier, NULL, nthreads);
+	if (ret)
+		return -ret;
+
+	for (i = 0; i < nthreads; i++) {
+		threads[i].barrier = &barrier;
+		threads[i].elapsed_ns = 0;
+		threads[i].ret = 0;
+		ret = pthread_create(&threads[i].thread, NULL, mr_reg_thread,
+				     &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", ret);
+			/* threads already started are blocked in the barrier */
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (threads[i].ret && !ret)
+			ret = threads[i].ret;
+		max_ns = MAX(max_ns, threads[i].elapsed_ns);
+	}
+	pthread_barrier_destroy(&barrier);
+
+	if (ret)
+		return ret;
+
+	printf("%-10d %-12d %-14.2f %-12.1f\n", nthreads, iterations,
+	       (double) iterations * nthreads * 1000.0 / max_ns,
+	       (double) max_ns / iterations);
+	return 0;
+}
+
+static int mr_cache_mt_test(void)
+{
+	struct mr_thread *threads;
+	uint64_t access;
+	int i, nthreads, ret = 0;
+	int testret = FAIL;
+
+	threads = calloc(max_threads, sizeof(*threads));
+	if (!threads) {
+		ret = -FI_ENOMEM;
+		FT_UNIT_STRERR(err_buf, "calloc failed", ret);
+		goto out;
+	}
+
+	access = ft_info_to_mr_access(fi);
+	for (i = 0; i < max_threads; i++) {
+		threads[i].id = i;
+		threads[i].buf = malloc(mr_buf_size);
+		if (!threads[i].buf) {
+			ret = -FI_ENOMEM;
+			FT_UNIT_STRERR(err_buf, "malloc failed", ret);
+			goto free;
+		}
+
+		/* Keep an MR open so that the timed registrations hit. */
+		ret = fi_mr_reg(domain, threads[i].buf, mr_buf_size, access, 0,
+				FT_MR_KEY + i, 0, &threads[i].prime_mr, NULL);
+		if (ret) {
+			FT_UNIT_STRERR(err_buf, "fi_mr_reg failed", ret);
+			goto free;
+		}
+	}
+
+	printf("\n%-10s %-12s %-14s %-12s\n", "threads", "iters/thread",
+	       "Mregs/sec", "nsec/reg");
+	for (nthreads = 1; ; nthreads = MIN(nthreads * 2, max_threads)) {
+		ret = mr_cache_run(threads, nthreads);
+		if (ret) {
+			FT_UNIT_STRERR(err_buf, "MR registration failed", ret);
+			goto free;
+		}
+		if (nthreads == max_threads)
+			break;
+	}
+	testret = PASS;
+
+free:
+	for (i = 0; i < max_threads; i++) {
+		if (threads[i].prime_mr)
+			FT_CLOSE_FID(threads[i].prime_mr);
+		free(threads[i].buf);
+	}
+	free(threads);
+out:
+	return TEST_RET_VAL(ret, testret);
+}
+
+struct test_entry test_array[] = {
+	TEST_ENTRY(mr_cache_mt_test, "MR cache multi-threaded hit rate"),
+	{ NULL, "" }
+};
+
+static void usage(char *name)
+{
+	ft_unit_usage(name,
+		"Measure multi-threaded MR registration throughput.\n"
+		"Each thread registers and closes its own buffer in a loop\n"
+		"while a priming registration keeps it cached. The thread\n"
+		"count is doubled from 1 up to the requested maximum.");
+	FT_PRINT_OPTS_USAGE("-s <bytes>", "Memory region size to be tested.");
+	FT_PRINT_OPTS_USAGE("-t <threads>", "Maximum number of threads.");
+	FT_PRINT_OPTS_USAGE("-n <iters>", "Registrations per thread.");
+}
+
+int main(int argc, char **argv)
+{
+	int failed = 0;
+	int ret = 0;
+	int op;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, FAB_OPTS "h" "s:t:n:")) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case 's':
+			mr_buf_size = strtoul(optarg, NULL, 10);
+			if (!mr_buf_size || mr_buf_size == ULONG_MAX) {
+				ret = -EINVAL;
+				FT_PRINTERR("Invalid memory region size", ret);
+				goto out;
+			}
+			break;
+		case 't':
+			max_threads = atoi(optarg);
+			if (max_threads <= 0) {
+				ret = -EINVAL;
+				FT_PRINTERR("Invalid thread count", ret);
+				goto out;
+			}
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			if (iterations <= 0) {
+				ret = -EINVAL;
+				FT_PRINTERR("Invalid iteration count", ret);
+				goto out;
+			}
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	hints->mode = ~0;
+	hints->domain_attr->mode = ~0;
+	hints->domain_attr->mr_mode = ~OFI_MR_DEPRECATED;
+	hints->domain_attr->threading = FI_THREAD_SAFE;
+	hints->caps |= FI_MSG | FI_RMA;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, hints, &fi);
+	if (ret) {
+		hints->caps &= ~FI_RMA;
+		ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, hints, &fi);
+		if (ret) {
+			FT_PRINTERR("fi_getinfo", ret);
+			goto out;
+		}
+	}
+
+	if (!ft_info_to_mr_access(fi))
+		goto out;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	printf("Testing MR cache on fabric %s domain %s\n",
+	       fi->fabric_attr->name, fi->domain_attr->name);
+
+	failed = run_tests(test_array, err_buf);
+	if (failed > 0)
+		printf("Summary: %d tests failed\n", failed);
+	else
+		printf("Summary: all tests passed\n");
+
+out:
+	ft_free_res();
+	return ret ? ft_exit_code(ret) : (failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
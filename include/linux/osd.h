@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 
 #include <linux/errqueue.h>
+#include <linux/futex.h>
 #include <ifaddrs.h>
 #include "unix/osd.h"
 #include "rdma/fi_errno.h"
@@ -70,6 +71,8 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB);
 }
 
+int ofi_mbind_local(void *addr, size_t len);
+
 static inline int ofi_hugepage_enabled(void)
 {
 	size_t len;
@@ -140,6 +143,47 @@ static inline int ofi_pidfd_getfd(int pidfd, int targetfd, unsigned int flags)
 	return syscall(__NR_pidfd_getfd, pidfd, targetfd, flags);
 }
 
+static inline int
+ofi_futex_wait_op(uint32_t *addr, uint32_t val, int timeout, int op)
+{
+	struct timespec ts, *tsp = NULL;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		tsp = &ts;
+	}
+
+	if (!syscall(SYS_futex, addr, op, val, tsp, NULL, 0) ||
+	    errno == EAGAIN || errno == EINTR)
+		return 0;
+
+	return errno == ETIMEDOUT ? -FI_ETIMEDOUT : -errno;
+}
+
+/* Returns 0 if woken, or if *addr no longer holds val */
+static inline int ofi_futex_wait(uint32_t *addr, uint32_t val, int timeout)
+{
+	return ofi_futex_wait_op(addr, val, timeout, FUTEX_WAIT_PRIVATE);
+}
+
+static inline void ofi_futex_wake(uint32_t *addr, int count)
+{
+	(void) syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/* Variants for words in memory shared between processes */
+static inline int
+ofi_futex_wait_shared(uint32_t *addr, uint32_t val, int timeout)
+{
+	return ofi_futex_wait_op(addr, val, timeout, FUTEX_WAIT);
+}
+
+static inline void ofi_futex_wake_shared(uint32_t *addr, int count)
+{
+	(void) syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
 static inline ssize_t ofi_read_socket(SOCKET fd, void *buf, size_t count)
 {
 	return read(fd, buf, count);
@@ -287,8 +287,22 @@ enum {
 	OFI_CLFLUSHOPT_BIT	= (1 << 23),
 	OFI_CLFLUSH_REG		= 3,
 	OFI_CLFLUSH_BIT		= (1 << 19),
+	OFI_OSXSAVE_REG		= 2,
+	OFI_OSXSAVE_BIT		= (1 << 27),
+	OFI_AVX2_REG		= 1,
+	OFI_AVX2_BIT		= (1 << 5),
+	OFI_AVX512F_REG		= 1,
+	OFI_AVX512F_BIT		= (1 << 16),
+	OFI_AVX512DQ_REG	= 1,
+	OFI_AVX512DQ_BIT	= (1 << 17),
+	OFI_AVX512BW_REG	= 1,
+	OFI_AVX512BW_BIT	= (1 << 30),
 };
 
+/* XCR0 state components enabled by the OS */
+#define OFI_XCR0_AVX		0x6
+#define OFI_XCR0_AVX512		0xe6
+
 int ofi_cpu_supports(unsigned func, unsigned reg, unsigned bit);
 
 
@@ -305,6 +319,7 @@ struct ofi_prov_context {
 	enum ofi_prov_type type;
 	bool disable_logging;
 	bool disable_layering;	/* applies to core providers only */
+	bool disable_info_cache;
 };
 
 static inline struct ofi_prov_context *
@@ -337,6 +352,16 @@ void fi_param_undefine(const struct fi_provider *provider);
 void ofi_remove_comma(char *buffer);
 void ofi_dump_sysconfig(void);
 
+void ofi_load_lazy_provs(void);
+
+void ofi_getinfo_cache_init(uint64_t seed);
+int ofi_getinfo_cache_get(uint32_t version, const char *node,
+			  const char *service, uint64_t flags,
+			  const struct fi_info *hints, struct fi_info **info);
+void ofi_getinfo_cache_put(uint32_t version, const char *node,
+			   const char *service, uint64_t flags,
+			   const struct fi_info *hints, const struct fi_info *info);
+
 const char *ofi_hex_str(const uint8_t *data, size_t len);
 
 #define MAX_MR_HANDLE_SIZE	64
@@ -434,6 +459,7 @@ uint8_t ofi_lsb(uint64_t num);
 
 extern size_t ofi_universe_size;
 extern int ofi_av_remove_cleanup;
+extern size_t ofi_cq_lockfree_size;
 extern char *ofi_offload_coll_prov_name;
 extern int ofi_prefer_sysconfig;
 
@@ -72,6 +72,8 @@ typedef atomic_int	ofi_atomic_int32_t;
 typedef atomic_long	ofi_atomic_int64_t;
 #endif
 
+#define ofi_atomic_ptr(atomic) (&((atomic)->val))
+
 #define OFI_ATOMIC_DEFINE(radix)									\
 	typedef struct {										\
 		ofi_atomic_int##radix##_t val;								\
@@ -292,6 +294,8 @@ typedef atomic_long	ofi_atomic_int64_t;
 
 #else /* HAVE_ATOMICS */
 
+#define ofi_atomic_ptr(atomic) (&((atomic)->val))
+
 #define OFI_ATOMIC_DEFINE(radix)								\
 	typedef	struct {									\
 		ofi_spin_t lock;								\
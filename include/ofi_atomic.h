@@ -89,6 +89,20 @@ extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_CNT][OFI_DATATYPE_CNT])
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags);
 
+/*
+ * Non-atomic versions of the write handlers, for use on buffers that are
+ * not accessed concurrently, such as the local buffers of a reduction.
+ * Common datatype and operation pairs use SIMD instructions, selected by
+ * ofi_atomic_reduce_init().
+ */
+extern void (*ofi_atomic_reduce_handlers[OFI_WRITE_OP_CNT][OFI_DATATYPE_CNT])
+			(void *dst, const void *src, size_t cnt);
+
+#define ofi_atomic_reduce_handler(op, datatype, dst, src, cnt) \
+	ofi_atomic_reduce_handlers[op][datatype](dst, src, cnt)
+
+void ofi_atomic_reduce_init(void);
+
 
 #ifdef __cplusplus
 }
@@ -62,6 +62,7 @@
 #define OFI_ATOMIC_QUEUE_H
 
 #include <ofi_atom.h>
+#include <ofi_osd.h>
 
 /*
  * This is an atomic queue, meaning no need for locking. One example usage
@@ -86,6 +87,11 @@
  *     . if the entry is a no-op it will be released and another entry
  *       will be fetched off the queue.
  *  . Call _release() after reader is done with the entry
+ *
+ * Producers may also reserve several consecutive entries at once:
+ *  . call _next_n() to reserve n entries starting at the returned position
+ *  . call _buf() to access each reserved entry
+ *  . call _commit_n() to post all of them for the reader
  */
 
 #ifdef __cplusplus
@@ -135,17 +141,18 @@ static inline void name ## _init(struct name *aq, size_t size)	\
 static inline struct name * name ## _create(size_t size)	\
 {								\
 	struct name *aq;					\
-	aq = (struct name*) calloc(1, sizeof(*aq) +		\
-		sizeof(struct name ## _entry) *			\
-		(roundup_power_of_two(size)));			\
-	if (aq)							\
-		name ##_init(aq, roundup_power_of_two(size));	\
+	size_t len = sizeof(*aq) + sizeof(struct name ## _entry) * \
+		     roundup_power_of_two(size);		\
+	if (ofi_memalign((void **) &aq, OFI_CACHE_LINE_SIZE, len)) \
+		return NULL;					\
+	memset(aq, 0, len);					\
+	name ##_init(aq, roundup_power_of_two(size));		\
 	return aq;						\
 }								\
 								\
 static inline void name ## _free(struct name *aq)		\
 {								\
-	free(aq);						\
+	ofi_freealign(aq);					\
 }								\
 static inline int name ## _next(struct name *aq,		\
 		entrytype **buf, int64_t *pos)			\
@@ -236,6 +243,68 @@ static inline void name ## _discard(entrytype *buf,		\
 	ofi_atomic_store_explicit64(&ce->seq, pos + 1,		\
 			      memory_order_release);		\
 }								\
+static inline int name ## _next_n(struct name *aq,		\
+		size_t n, int64_t *pos)				\
+{								\
+	struct name ## _entry *ce;				\
+	int64_t diff, seq;					\
+	size_t i;						\
+	assert(n && n <= (size_t) aq->size);			\
+	*pos = ofi_atomic_load_explicit64(&aq->write_pos,	\
+				    memory_order_relaxed);	\
+	for (;;) {						\
+		for (i = 0, diff = 0; i < n && !diff; i++) {	\
+			ce = &aq->entry[(*pos + i) &		\
+					aq->size_mask];		\
+			seq = ofi_atomic_load_explicit64(	\
+				&(ce->seq),			\
+				memory_order_acquire);		\
+			diff = seq - (int64_t) (*pos + i);	\
+		}						\
+		if (diff == 0) {				\
+			if (ofi_atomic_compare_exchange_weak64(	\
+				&aq->write_pos, pos,		\
+				*pos + n))			\
+				break;				\
+		} else if (diff < 0) {				\
+			return -FI_ENOENT;			\
+		} else {					\
+			*pos = ofi_atomic_load_explicit64(	\
+				&aq->write_pos,			\
+				memory_order_relaxed);		\
+		}						\
+	}							\
+	return FI_SUCCESS;					\
+}								\
+static inline entrytype *name ## _buf(struct name *aq,		\
+				int64_t pos)			\
+{								\
+	return &aq->entry[pos & aq->size_mask].buf;		\
+}								\
+static inline void name ## _commit_n(struct name *aq,		\
+				int64_t pos, size_t n)		\
+{								\
+	size_t i;						\
+	/* publish the first entry last so that the reader	\
+	 * sees the whole batch at once */			\
+	for (i = n; i > 0; i--)					\
+		name ## _commit(name ## _buf(aq, pos + i - 1),	\
+				pos + i - 1);			\
+}								\
+static inline bool name ## _isempty(struct name *aq)		\
+{								\
+	return ofi_atomic_load_explicit64(&aq->read_pos,	\
+			memory_order_relaxed) ==		\
+	       ofi_atomic_load_explicit64(&aq->write_pos,	\
+			memory_order_relaxed);			\
+}								\
+static inline size_t name ## _usedcnt(struct name *aq)		\
+{								\
+	return (size_t) (ofi_atomic_load_explicit64(&aq->write_pos, \
+			memory_order_relaxed) -			\
+		ofi_atomic_load_explicit64(&aq->read_pos,	\
+			memory_order_relaxed));			\
+}								\
 void dummy ## name (void) /* work-around global ; scope */
 
 #ifdef __cplusplus
@@ -327,6 +327,7 @@ enum {
 	OFI_BUFPOOL_NO_TRACK		= 1 << 2,
 	OFI_BUFPOOL_HUGEPAGES		= 1 << 3,
 	OFI_BUFPOOL_NONSHARED		= 1 << 4,
+	OFI_BUFPOOL_NUMA_LOCAL		= 1 << 5,
 };
 
 struct ofi_bufpool_region;
@@ -357,6 +358,9 @@ struct ofi_bufpool {
 	size_t				alloc_size;
 	size_t				region_size;
 	struct ofi_bufpool_attr		attr;
+
+	/* serializes caches refilling from and flushing to the pool */
+	ofi_mutex_t			lock;
 };
 
 struct ofi_bufpool_region {
@@ -602,6 +606,62 @@ static inline void *ofi_ibuf_alloc_at(struct ofi_bufpool *pool, size_t index)
 	return buf;
 }
 
+/*
+ * Buffer pool cache
+ *
+ * A cache holds free buffers taken from a pool for use by a single thread or
+ * progress context, so that allocations and frees don't need the caller's
+ * lock.  A cache exchanges buffers with its pool in batches of half its size
+ * under the pool lock.  A buffer may be freed to any cache of the pool it
+ * was allocated from.  Once caches are used with a pool, the pool must only
+ * be accessed through caches.  Indexed pools are not supported.
+ */
+struct ofi_bufpool_cache {
+	struct ofi_bufpool		*pool;
+	size_t				cnt;
+	size_t				size;
+	void				*bufs[];
+};
+
+int ofi_bufpool_cache_create(struct ofi_bufpool *pool, size_t size,
+			     struct ofi_bufpool_cache **cache);
+void ofi_bufpool_cache_destroy(struct ofi_bufpool_cache *cache);
+int ofi_bufpool_cache_refill(struct ofi_bufpool_cache *cache);
+void ofi_bufpool_cache_flush(struct ofi_bufpool_cache *cache, size_t cnt);
+
+static inline void *ofi_buf_cache_alloc(struct ofi_bufpool_cache *cache)
+{
+	struct ofi_bufpool_hdr *buf_hdr;
+	void *buf;
+
+	if (!cache->cnt && ofi_bufpool_cache_refill(cache))
+		return NULL;
+
+	buf = cache->bufs[--cache->cnt];
+	buf_hdr = ofi_buf_hdr(buf);
+	assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
+	assert(!ofi_buf_is_valid(buf));
+
+	buf_hdr->entry.slist.next = &buf_hdr->entry.slist;
+	return buf;
+}
+
+static inline void ofi_buf_cache_free(struct ofi_bufpool_cache *cache,
+				      void *buf)
+{
+	assert(ofi_atomic_dec32(&ofi_buf_region(buf)->use_cnt) >= 0);
+	assert(ofi_buf_pool(buf) == cache->pool);
+	assert(ofi_buf_hdr(buf)->magic == OFI_MAGIC_SIZE_T);
+	assert(ofi_buf_hdr(buf)->ftr->magic == OFI_MAGIC_SIZE_T);
+	assert(ofi_buf_is_valid(buf));
+
+	if (cache->cnt == cache->size)
+		ofi_bufpool_cache_flush(cache, cache->size / 2);
+
+	ofi_buf_hdr(buf)->entry.slist.next = NULL;
+	cache->bufs[cache->cnt++] = buf;
+}
+
 /*
  * Persistent memory support
  */
@@ -407,6 +407,10 @@ struct ofi_mr_cache {
 	struct dlist_entry		lru_list;
 	struct dlist_entry		dead_region_list;
 	pthread_mutex_t			lock;
+	/* The tree is only modified holding mm_lock and tree_lock for write.
+	 * Searches that hit an in-use entry hold only tree_lock for read.
+	 */
+	pthread_rwlock_t		tree_lock;
 
 	size_t				cached_cnt;
 	size_t				cached_size;
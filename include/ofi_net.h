@@ -152,6 +152,8 @@ typedef struct {
 struct ofi_sockctx {
 	void *context;
 	bool uring_sqe_inuse;
+	/* index into the io_uring registered file table, or -1 */
+	int uring_fixed_file;
 };
 
 struct ofi_sockapi_uring {
@@ -187,6 +189,7 @@ ofi_sockctx_init(struct ofi_sockctx *sockctx, void *context)
 {
 	sockctx->context = context;
 	sockctx->uring_sqe_inuse = false;
+	sockctx->uring_fixed_file = -1;
 }
 
 static inline int
@@ -362,7 +365,9 @@ static inline void ofi_uring_cq_advance(ofi_io_uring_t *io_uring, unsigned int c
 	io_uring_cq_advance(io_uring, count);
 }
 #else
+#define IORING_CQE_F_BUFFER	(1U << 0)
 #define IORING_CQE_F_MORE	(1U << 1)
+#define IORING_CQE_BUFFER_SHIFT	16
 
 static inline int
 ofi_sockapi_connect_uring(struct ofi_sockapi *sockapi, SOCKET sock,
@@ -438,6 +443,53 @@ ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 #define ofi_uring_cq_advance(io_uring, count) do {} while(0)
 #endif
 
+/*
+ * Provided buffer ring, used by multishot receives.  The kernel selects a
+ * buffer from the ring for each completion and reports its id in the cqe.
+ */
+struct ofi_uring_bufs {
+	ofi_io_uring_t *io_uring;
+	struct io_uring_buf_ring *ring;
+	char *data;
+	size_t size;
+	unsigned int cnt;
+	int bgid;
+};
+
+static inline void *ofi_uring_buf(struct ofi_uring_bufs *bufs, unsigned int bid)
+{
+	assert(bid < bufs->cnt);
+	return bufs->data + bid * bufs->size;
+}
+
+#ifdef HAVE_LIBURING_MSHOT
+int ofi_uring_files_init(ofi_io_uring_t *io_uring, unsigned int cnt);
+int ofi_uring_file_set(ofi_io_uring_t *io_uring, unsigned int index, int fd);
+
+int ofi_uring_bufs_init(struct ofi_uring_bufs *bufs, ofi_io_uring_t *io_uring,
+			unsigned int cnt, size_t size, int bgid);
+void ofi_uring_bufs_free(struct ofi_uring_bufs *bufs);
+void ofi_uring_buf_put(struct ofi_uring_bufs *bufs, unsigned int bid);
+
+int ofi_sockapi_recv_mshot_uring(struct ofi_sockapi_uring *uring, SOCKET sock,
+				 struct ofi_uring_bufs *bufs,
+				 struct ofi_sockctx *ctx);
+#else
+#define ofi_uring_files_init(io_uring, cnt) -FI_ENOSYS
+#define ofi_uring_file_set(io_uring, index, fd) -FI_ENOSYS
+#define ofi_uring_bufs_init(bufs, io_uring, cnt, size, bgid) -FI_ENOSYS
+#define ofi_uring_bufs_free(bufs) do {} while(0)
+#define ofi_uring_buf_put(bufs, bid) do {} while(0)
+
+static inline int
+ofi_sockapi_recv_mshot_uring(struct ofi_sockapi_uring *uring, SOCKET sock,
+			     struct ofi_uring_bufs *bufs,
+			     struct ofi_sockctx *ctx)
+{
+	return -FI_ENOSYS;
+}
+#endif
+
 /*
  * Byte queue - streaming socket staging buffer
  */
@@ -542,6 +594,8 @@ struct ofi_bsock {
 	uint32_t async_index;
 	uint32_t done_index;
 	bool async_prefetch;
+	/* rq is filled by the owner from a multishot receive */
+	bool mshot;
 };
 
 static inline void
@@ -557,6 +611,7 @@ ofi_bsock_init(struct ofi_bsock *bsock, struct ofi_sockapi *sockapi,
 	ofi_byteq_init(&bsock->rq, rbuf_size);
 	bsock->zerocopy_size = SIZE_MAX;
 	bsock->async_prefetch = false;
+	bsock->mshot = false;
 
 	/* first async op will wrap back to 0 as the starting index */
 	bsock->async_index = UINT32_MAX;
@@ -67,6 +67,7 @@
 #include <ofi_epoll.h>
 #include <ofi_proto.h>
 #include <ofi_bitmask.h>
+#include <ofi_atomic_queue.h>
 
 #include "rbtree.h"
 #include "uthash.h"
@@ -418,12 +419,23 @@ struct util_wait {
 
 	struct dlist_entry	fid_list;
 	ofi_mutex_t		lock;
+
+	/* Incremented on every signal.  See ofi_wait_seq_wait(). */
+	ofi_atomic32_t		seq;
+	ofi_atomic32_t		sleepers;
 };
 
 int ofi_wait_init(struct util_fabric *fabric, struct fi_wait_attr *attr,
 		  struct util_wait *wait);
 int fi_wait_cleanup(struct util_wait *wait);
 
+static inline uint32_t ofi_wait_seq(struct util_wait *wait)
+{
+	return (uint32_t) ofi_atomic_get32(&wait->seq);
+}
+
+int ofi_wait_seq_wait(struct util_wait *wait, uint32_t seq, int timeout);
+
 struct util_wait_fd {
 	struct util_wait	util_wait;
 	struct fd_signal	signal;
@@ -497,6 +509,13 @@ struct util_cq_aux_entry {
 
 OFI_DECLARE_CIRQUE(struct fi_cq_tagged_entry, util_comp_cirq);
 
+struct util_cq_lf_entry {
+	struct fi_cq_tagged_entry	comp;
+	fi_addr_t			src;
+};
+
+OFI_DECLARE_ATOMIC_Q(struct util_cq_lf_entry, util_cq_lfq);
+
 typedef void (*ofi_cq_progress_func)(struct util_cq *cq);
 
 struct util_cq {
@@ -524,7 +543,13 @@ struct util_cq {
 	struct util_comp_cirq	*cirq;
 	fi_addr_t		*src;
 	struct slist		aux_queue;
+	struct ofi_bufpool	*aux_pool;
 	fi_cq_read_func		read_entry;
+
+	/* Completions written without taking cq_lock, moved to the cirq
+	 * by readers.  Only set if enabled and the CQ is shared by threads.
+	 */
+	struct util_cq_lfq	*lfq;
 };
 
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
@@ -552,6 +577,35 @@ const char *ofi_cq_strerror(struct fid_cq *cq, int prov_errno,
 int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 			  size_t len, void *buf, uint64_t data, uint64_t tag,
 			  fi_addr_t src);
+int ofi_cq_write_batch(struct util_cq *cq,
+		       const struct fi_cq_tagged_entry *comp,
+		       const fi_addr_t *src, size_t count);
+int ofi_cq_drain_lfq(struct util_cq *cq);
+
+static inline bool ofi_cq_isempty(struct util_cq *cq)
+{
+	return ofi_cirque_isempty(cq->cirq) &&
+	       (!cq->lfq || util_cq_lfq_isempty(cq->lfq));
+}
+
+/* Number of completions the CQ takes before writes spill to the overflow
+ * list.  Completions still in the lock-free ring count against the cirq,
+ * and its last slot is kept for error and overflow entries.  Providers
+ * that throttle on a full CQ must check it here rather than on the cirq.
+ */
+static inline size_t ofi_cq_freecnt(struct util_cq *cq)
+{
+	size_t freecnt, used;
+
+	freecnt = ofi_cirque_freecnt(cq->cirq);
+	used = cq->lfq ? util_cq_lfq_usedcnt(cq->lfq) : 0;
+	return freecnt > used + 1 ? freecnt - used - 1 : 0;
+}
+
+static inline bool ofi_cq_isfull(struct util_cq *cq)
+{
+	return !ofi_cq_freecnt(cq);
+}
 
 static inline
 ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
@@ -568,6 +622,9 @@ ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
 		cq->err_data = NULL;
 	}
 
+	if (cq->lfq)
+		ofi_cq_drain_lfq(cq);
+
 	if (ofi_cirque_isempty(cq->cirq)) {
 		i = -FI_EAGAIN;
 		goto out;
@@ -599,7 +656,7 @@ ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
 				src_addr[i] = aux_entry->src;
 			cq->read_entry(&buf, &aux_entry->comp);
 			slist_remove_head(&cq->aux_queue);
-			free(aux_entry);
+			ofi_buf_free(aux_entry);
 
 			if (slist_empty(&cq->aux_queue)) {
 				ofi_cirque_discard(cq->cirq);
@@ -640,12 +697,32 @@ ofi_cq_write_src_entry(struct util_cq *cq, void *context, uint64_t flags,
 	ofi_cq_write_entry(cq, context, flags, len, buf, data, tag);
 }
 
+static inline int
+ofi_cq_write_lf(struct util_cq *cq, void *context, uint64_t flags, size_t len,
+		void *buf, uint64_t data, uint64_t tag, fi_addr_t src)
+{
+	struct fi_cq_tagged_entry comp = {
+		.op_context	= context,
+		.flags		= flags,
+		.len		= len,
+		.buf		= buf,
+		.data		= data,
+		.tag		= tag,
+	};
+
+	return ofi_cq_write_batch(cq, &comp, &src, 1);
+}
+
 static inline int
 ofi_cq_write(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 	     void *buf, uint64_t data, uint64_t tag)
 {
 	int ret;
 
+	if (cq->lfq)
+		return ofi_cq_write_lf(cq, context, flags, len, buf, data,
+				       tag, FI_ADDR_NOTAVAIL);
+
 	ofi_genlock_lock(&cq->cq_lock);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_entry(cq, context, flags, len, buf, data, tag);
@@ -664,6 +741,10 @@ ofi_cq_write_src(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 {
 	int ret;
 
+	if (cq->lfq)
+		return ofi_cq_write_lf(cq, context, flags, len, buf, data,
+				       tag, src);
+
 	ofi_genlock_lock(&cq->cq_lock);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_src_entry(cq, context, flags, len, buf, data,
@@ -1286,6 +1367,8 @@ struct ofi_ops_flow_ctrl {
 
 struct util_rx_entry {
 	struct fi_peer_rx_entry	peer_entry;
+	/* links unexpected tagged entries into util_srx_ctx::unexp_tag_hash */
+	struct dlist_entry	hash_entry;
 	uint64_t		seq_no;
 	uint64_t		ignore;
 	int			multi_recv_ref;
@@ -1305,7 +1388,7 @@ typedef void(*ofi_update_func_t)(struct util_srx_ctx *srx,
 struct util_unexp_peer {
 	struct dlist_entry	entry;
 	struct slist		msg_queue;
-	struct slist		tag_queue;
+	struct dlist_entry	tag_queue;
 	int			cnt;
 };
 
@@ -1322,12 +1405,23 @@ struct util_srx_ctx {
 
 	uint64_t		rx_seq_no;
 	struct slist		msg_queue;
-	struct slist		tag_queue;
 	struct ofi_dyn_arr	src_recv_queues;
+
+	/* Posted tagged receives.  Receives without ignore bits are hashed
+	 * by (addr, tag) into tag_hash.  Receives with ignore bits stay on
+	 * the ordered wildcard lists (tag_queue for FI_ADDR_UNSPEC,
+	 * src_trecv_queues per source).  seq_no picks the oldest candidate
+	 * across all of them to preserve ordering.
+	 */
+	struct dlist_entry	tag_queue;
 	struct ofi_dyn_arr	src_trecv_queues;
+	struct dlist_entry	*tag_hash;
+	size_t			tag_hash_mask;
 
 	struct dlist_entry	unspec_unexp_msg_queue;
 	struct dlist_entry	unspec_unexp_tag_queue;
+	/* unexpected tagged entries hashed by tag, in arrival order */
+	struct dlist_entry	*unexp_tag_hash;
 
 	struct dlist_entry	unexp_peers;
 	struct ofi_dyn_arr	src_unexp_peers;
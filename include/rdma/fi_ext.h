@@ -65,6 +65,7 @@ extern "C" {
 
 #define FI_PROV_SPECIFIC_EFA   (0xefa << 16)
 #define FI_PROV_SPECIFIC_TCP   (0x7cb << 16)
+#define FI_PROV_SPECIFIC_RXM   (0x3e3 << 16)
 
 
 /* negative options are provider specific */
@@ -78,6 +79,18 @@ enum {
 	FI_OPT_EFA_WRITE_IN_ORDER_ALIGNED_128_BYTES, /* bool */
 };
 
+enum {
+	FI_OPT_RXM_EAGER_LIMIT = -FI_PROV_SPECIFIC_RXM, /* size_t */
+	FI_OPT_RXM_SAR_LIMIT,		/* size_t */
+	FI_OPT_RXM_PEER_SAR_LIMIT,	/* struct fi_rxm_peer_limit */
+};
+
+/* FI_OPT_RXM_PEER_SAR_LIMIT: addr is input, sar_limit is output */
+struct fi_rxm_peer_limit {
+	fi_addr_t addr;
+	size_t sar_limit;
+};
+
 struct fi_fid_export {
 	struct fid **fid;
 	uint64_t flags;
@@ -761,6 +761,25 @@ ofi_send_socket(SOCKET fd, const void *buf, size_t count, int flags)
 	return (ssize_t) send(fd, (const char*) buf, len, flags);
 }
 
+static inline int ofi_futex_wait(uint32_t *addr, uint32_t val, int timeout)
+{
+	return -FI_ENOSYS;
+}
+
+static inline void ofi_futex_wake(uint32_t *addr, int count)
+{
+}
+
+static inline int
+ofi_futex_wait_shared(uint32_t *addr, uint32_t val, int timeout)
+{
+	return -FI_ENOSYS;
+}
+
+static inline void ofi_futex_wake_shared(uint32_t *addr, int count)
+{
+}
+
 static inline ssize_t ofi_process_vm_readv(pid_t pid,
 			const struct iovec *local_iov,
 			unsigned long liovcnt,
@@ -980,6 +999,11 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+static inline int ofi_mbind_local(void *addr, size_t len)
+{
+	return -FI_ENOSYS;
+}
+
 static inline int ofi_hugepage_enabled(void)
 {
 	return 0;
@@ -115,6 +115,11 @@ coll_mr_desc_to_hmem_iface_dev(void **desc, size_t count, uint64_t *device)
 	return ((struct coll_mr *) desc[0])->iface;
 }
 
+extern size_t coll_allreduce_rsag_size;
+extern size_t coll_allreduce_ring_size;
+extern size_t coll_pipeline_chunk_size;
+extern size_t coll_alltoall_bruck_size;
+
 extern struct fi_provider coll_prov;
 extern struct util_prov coll_util_prov;
 extern struct fi_fabric_attr coll_fabric_attr;
@@ -175,5 +180,28 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 			  void *desc, fi_addr_t coll_addr, fi_addr_t root_addr,
 			  enum fi_datatype datatype, uint64_t flags,
 			  void *context);
+
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context);
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context);
 #endif /* _COLL_H_ */
 
@@ -342,16 +342,66 @@ static int coll_sched_comp(struct util_coll_operation *coll_op)
 }
 
 /*
- * TODO:
- * when this fails, clean up the already scheduled work in this function
+ * For a rank count that isn't a power of two, the first 2 * rem ranks fold
+ * pairwise so that pof2 ranks take part in the exchange.  Returns the rank
+ * within the folded group, or -1 if this rank sits out.
  */
-static int coll_do_allreduce(struct util_coll_operation *coll_op,
-			     const void *send_buf, void *result,
-			     void* tmp_buf, uint64_t count,
-			     enum fi_datatype datatype, enum fi_op op)
+static int coll_sched_fold(struct util_coll_operation *coll_op, void *result,
+			   void *tmp_buf, uint64_t count,
+			   enum fi_datatype datatype, enum fi_op op,
+			   uint64_t rem, uint64_t *new_id)
+{
+	uint64_t local = coll_op->mc->local_rank;
+	int ret;
+
+	if (local >= 2 * rem) {
+		*new_id = local - rem;
+		return FI_SUCCESS;
+	}
+
+	if (local % 2 == 0) {
+		*new_id = (uint64_t) -1;
+		return coll_sched_send(coll_op, local + 1, result, count,
+				       datatype, 1);
+	}
+
+	*new_id = local / 2;
+	ret = coll_sched_recv(coll_op, local - 1, tmp_buf, count, datatype, 1);
+	if (ret)
+		return ret;
+
+	return coll_sched_reduce(coll_op, tmp_buf, result, count, datatype,
+				 op, 1);
+}
+
+static int coll_sched_unfold(struct util_coll_operation *coll_op,
+			     void *result, uint64_t count,
+			     enum fi_datatype datatype, uint64_t rem)
+{
+	uint64_t local = coll_op->mc->local_rank;
+
+	if (local >= 2 * rem)
+		return FI_SUCCESS;
+
+	if (local % 2)
+		return coll_sched_send(coll_op, local - 1, result, count,
+				       datatype, 1);
+
+	return coll_sched_recv(coll_op, local + 1, result, count, datatype, 1);
+}
+
+static uint64_t coll_folded_rank(uint64_t new_id, uint64_t rem)
+{
+	return (new_id < rem) ? new_id * 2 + 1 : new_id + rem;
+}
+
+/* recursive doubling, exchanging the full buffer at each step */
+static int coll_do_allreduce_rd(struct util_coll_operation *coll_op,
+				void *result, void *tmp_buf, uint64_t count,
+				enum fi_datatype datatype, enum fi_op op)
 {
 	uint64_t rem, pof2, my_new_id;
-	uint64_t local, remote, next_remote;
+	uint64_t local, remote;
 	int ret;
 	uint64_t mask = 1;
 
@@ -359,39 +409,14 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 	rem = coll_op->mc->av_set->fi_addr_count - pof2;
 	local = coll_op->mc->local_rank;
 
-	/* copy initial send data to result */
-	memcpy(result, send_buf, count * ofi_datatype_size(datatype));
-
-	if (local < 2 * rem) {
-		if (local % 2 == 0) {
-			ret = coll_sched_send(coll_op, local + 1, result,
-					      count, datatype, 1);
-			if (ret)
-				return ret;
-
-			my_new_id = (uint64_t)-1;
-		} else {
-			ret = coll_sched_recv(coll_op, local - 1,
-					      tmp_buf, count, datatype, 1);
-			if (ret)
-				return ret;
-
-			my_new_id = local / 2;
-
-			ret = coll_sched_reduce(coll_op, tmp_buf, result,
-						count, datatype, op, 1);
-			if (ret)
-				return ret;
-		}
-	} else {
-		my_new_id = local - rem;
-	}
+	ret = coll_sched_fold(coll_op, result, tmp_buf, count, datatype, op,
+			      rem, &my_new_id);
+	if (ret)
+		return ret;
 
 	if (my_new_id != -1) {
 		while (mask < pof2) {
-			next_remote = my_new_id ^ mask;
-			remote = (next_remote < rem) ? next_remote * 2 + 1 :
-				next_remote + rem;
+			remote = coll_folded_rank(my_new_id ^ mask, rem);
 
 			/* receive remote data into tmp buf */
 			ret = coll_sched_recv(coll_op, remote, tmp_buf,
@@ -431,22 +456,360 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 		}
 	}
 
-	if (local < 2 * rem) {
-		if (local % 2) {
-			ret = coll_sched_send(coll_op, local - 1, result,
-					      count, datatype, 1);
+	return coll_sched_unfold(coll_op, result, count, datatype, rem);
+}
+
+/* element offset of block idx when count is split into nblocks */
+static uint64_t coll_block_offset(uint64_t count, uint64_t nblocks,
+				  uint64_t idx)
+{
+	return idx * (count / nblocks) + MIN(idx, count % nblocks);
+}
+
+/*
+ * Rabenseifner's algorithm: reduce-scatter by recursive halving followed
+ * by an allgather using recursive doubling.  Each rank moves about twice
+ * the buffer size in total, instead of the full buffer log2(P) times.
+ */
+static int coll_do_allreduce_rsag(struct util_coll_operation *coll_op,
+				  void *result, void *tmp_buf, uint64_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t rem, pof2, my_new_id, new_remote, remote;
+	uint64_t send_idx = 0, recv_idx = 0, last_idx, send_off, recv_off;
+	uint64_t mask = 1;
+	size_t dsize = ofi_datatype_size(datatype);
+	int ret;
+
+	pof2 = rounddown_power_of_two(coll_op->mc->av_set->fi_addr_count);
+	rem = coll_op->mc->av_set->fi_addr_count - pof2;
+
+	ret = coll_sched_fold(coll_op, result, tmp_buf, count, datatype, op,
+			      rem, &my_new_id);
+	if (ret)
+		return ret;
+
+	if (my_new_id == -1)
+		goto unfold;
+
+	last_idx = pof2;
+	while (mask < pof2) {
+		new_remote = my_new_id ^ mask;
+		remote = coll_folded_rank(new_remote, rem);
+
+		if (my_new_id < new_remote) {
+			send_idx = recv_idx + pof2 / (mask * 2);
+			send_off = coll_block_offset(count, pof2, send_idx);
+			recv_off = coll_block_offset(count, pof2, recv_idx);
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) tmp_buf + recv_off * dsize,
+					      send_off - recv_off, datatype, 0);
 			if (ret)
 				return ret;
+
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      coll_block_offset(count, pof2,
+							last_idx) - send_off,
+					      datatype, 1);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_reduce(coll_op,
+					(char *) tmp_buf + recv_off * dsize,
+					(char *) result + recv_off * dsize,
+					send_off - recv_off, datatype, op, 1);
 		} else {
-			ret = coll_sched_recv(coll_op, local + 1, result,
-					      count, datatype, 1);
+			recv_idx = send_idx + pof2 / (mask * 2);
+			send_off = coll_block_offset(count, pof2, send_idx);
+			recv_off = coll_block_offset(count, pof2, recv_idx);
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) tmp_buf + recv_off * dsize,
+					      coll_block_offset(count, pof2,
+							last_idx) - recv_off,
+					      datatype, 0);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      recv_off - send_off, datatype, 1);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_reduce(coll_op,
+					(char *) tmp_buf + recv_off * dsize,
+					(char *) result + recv_off * dsize,
+					coll_block_offset(count, pof2,
+							  last_idx) - recv_off,
+					datatype, op, 1);
+		}
+		if (ret)
+			return ret;
+
+		send_idx = recv_idx;
+		mask <<= 1;
+		if (mask < pof2)
+			last_idx = recv_idx + pof2 / mask;
+	}
+
+	/* this rank now holds the reduced blocks [send_idx, last_idx) */
+	mask >>= 1;
+	while (mask > 0) {
+		new_remote = my_new_id ^ mask;
+		remote = coll_folded_rank(new_remote, rem);
+
+		if (my_new_id < new_remote) {
+			if (mask != pof2 / 2)
+				last_idx = last_idx + pof2 / (mask * 2);
+
+			recv_idx = send_idx + pof2 / (mask * 2);
+			send_off = coll_block_offset(count, pof2, send_idx);
+			recv_off = coll_block_offset(count, pof2, recv_idx);
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) result + recv_off * dsize,
+					      coll_block_offset(count, pof2,
+							last_idx) - recv_off,
+					      datatype, 0);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      recv_off - send_off, datatype, 1);
+		} else {
+			recv_idx = send_idx - pof2 / (mask * 2);
+			send_off = coll_block_offset(count, pof2, send_idx);
+			recv_off = coll_block_offset(count, pof2, recv_idx);
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) result + recv_off * dsize,
+					      send_off - recv_off, datatype, 0);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      coll_block_offset(count, pof2,
+							last_idx) - send_off,
+					      datatype, 1);
+		}
+		if (ret)
+			return ret;
+
+		if (my_new_id > new_remote)
+			send_idx = recv_idx;
+		mask >>= 1;
+	}
+
+unfold:
+	return coll_sched_unfold(coll_op, result, count, datatype, rem);
+}
+
+struct coll_ring_piece {
+	uint64_t offset;
+	uint64_t count;
+};
+
+/* piece chunk of block blk, with every block split into nchunks pieces */
+static struct coll_ring_piece
+coll_ring_piece(uint64_t count, uint64_t numranks, uint64_t blk,
+		uint64_t nchunks, uint64_t chunk)
+{
+	struct coll_ring_piece piece;
+	uint64_t start, len;
+
+	start = coll_block_offset(count, numranks, blk);
+	len = coll_block_offset(count, numranks, blk + 1) - start;
+
+	piece.offset = start + len * chunk / nchunks;
+	piece.count = start + len * (chunk + 1) / nchunks - piece.offset;
+	return piece;
+}
+
+/* chunks alternate between two halves of tmp_buf when pipelined */
+static void *coll_ring_slot(void *tmp_buf, uint64_t nchunks, uint64_t unit,
+			    size_t slot_cnt, size_t dsize)
+{
+	if (nchunks == 1)
+		return tmp_buf;
+
+	return (char *) tmp_buf + (unit % 2) * slot_cnt * dsize;
+}
+
+static int coll_sched_ring_xfer(struct util_coll_operation *coll_op,
+				void *result, void *tmp_buf, uint64_t count,
+				enum fi_datatype datatype, uint64_t nchunks,
+				uint64_t unit, size_t slot_cnt, int fence)
+{
+	struct coll_ring_piece piece;
+	uint64_t local, numranks, step, chunk;
+	size_t dsize = ofi_datatype_size(datatype);
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	step = unit / nchunks;
+	chunk = unit % nchunks;
+
+	piece = coll_ring_piece(count, numranks,
+				(numranks + local - step - 1) % numranks,
+				nchunks, chunk);
+	ret = coll_sched_recv(coll_op, (numranks + local - 1) % numranks,
+			      coll_ring_slot(tmp_buf, nchunks, unit, slot_cnt,
+					     dsize),
+			      piece.count, datatype, 0);
+	if (ret)
+		return ret;
+
+	piece = coll_ring_piece(count, numranks,
+				(numranks + local - step) % numranks,
+				nchunks, chunk);
+	return coll_sched_send(coll_op, (local + 1) % numranks,
+			       (char *) result + piece.offset * dsize,
+			       piece.count, datatype, fence);
+}
+
+/*
+ * Ring reduce-scatter.  Each block is split into chunks, and the transfer
+ * of the next chunk is overlapped with the reduction of the current one.
+ * On return, rank i holds the reduced block i + 1.
+ */
+static int coll_sched_ring_reduce_scatter(struct util_coll_operation *coll_op,
+					  void *result, void *tmp_buf,
+					  uint64_t count,
+					  enum fi_datatype datatype,
+					  enum fi_op op)
+{
+	struct coll_ring_piece piece;
+	uint64_t local, numranks, nchunks, unit, nunits, step;
+	size_t dsize = ofi_datatype_size(datatype);
+	size_t slot_cnt;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+
+	/* the smallest block decides the chunk count, so no piece is empty */
+	nchunks = MAX((count / numranks) * dsize / coll_pipeline_chunk_size, 1);
+	slot_cnt = (size_t) ((count + numranks - 1) / numranks + nchunks - 1) /
+		   nchunks;
+	nunits = (numranks - 1) * nchunks;
+
+	ret = coll_sched_ring_xfer(coll_op, result, tmp_buf, count, datatype,
+				   nchunks, 0, slot_cnt, 1);
+	if (ret)
+		return ret;
+
+	for (unit = 0; unit < nunits; unit++) {
+		if (nchunks > 1 && unit + 1 < nunits) {
+			ret = coll_sched_ring_xfer(coll_op, result, tmp_buf,
+						   count, datatype, nchunks,
+						   unit + 1, slot_cnt, 0);
+			if (ret)
+				return ret;
+		}
+
+		step = unit / nchunks;
+		piece = coll_ring_piece(count, numranks,
+					(numranks + local - step - 1) % numranks,
+					nchunks, unit % nchunks);
+		ret = coll_sched_reduce(coll_op,
+				coll_ring_slot(tmp_buf, nchunks, unit,
+					       slot_cnt, dsize),
+				(char *) result + piece.offset * dsize,
+				piece.count, datatype, op, 1);
+		if (ret)
+			return ret;
+
+		if (nchunks == 1 && unit + 1 < nunits) {
+			ret = coll_sched_ring_xfer(coll_op, result, tmp_buf,
+						   count, datatype, nchunks,
+						   unit + 1, slot_cnt, 1);
 			if (ret)
 				return ret;
 		}
 	}
+
+	return FI_SUCCESS;
+}
+
+/* Ring reduce-scatter followed by a ring allgather */
+static int coll_do_allreduce_ring(struct util_coll_operation *coll_op,
+				  void *result, void *tmp_buf, uint64_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	struct coll_ring_piece piece;
+	uint64_t local, numranks, step, blk;
+	size_t dsize = ofi_datatype_size(datatype);
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+
+	ret = coll_sched_ring_reduce_scatter(coll_op, result, tmp_buf, count,
+					     datatype, op);
+	if (ret)
+		return ret;
+
+	/* rank i now holds the reduced block i + 1 */
+	for (step = 0; step < numranks - 1; step++) {
+		blk = (local + 1 + numranks - step) % numranks;
+		piece.offset = coll_block_offset(count, numranks, blk);
+		piece.count = coll_block_offset(count, numranks, blk + 1) -
+			      piece.offset;
+		ret = coll_sched_send(coll_op, (local + 1) % numranks,
+				      (char *) result + piece.offset * dsize,
+				      piece.count, datatype, 0);
+		if (ret)
+			return ret;
+
+		blk = (local + numranks - step) % numranks;
+		piece.offset = coll_block_offset(count, numranks, blk);
+		piece.count = coll_block_offset(count, numranks, blk + 1) -
+			      piece.offset;
+		ret = coll_sched_recv(coll_op, (numranks + local - 1) % numranks,
+				      (char *) result + piece.offset * dsize,
+				      piece.count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
 	return FI_SUCCESS;
 }
 
+/*
+ * TODO:
+ * when this fails, clean up the already scheduled work in this function
+ */
+static int coll_do_allreduce(struct util_coll_operation *coll_op,
+			     const void *send_buf, void *result,
+			     void* tmp_buf, uint64_t count,
+			     enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t numranks, pof2;
+	size_t size;
+
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	pof2 = rounddown_power_of_two(numranks);
+	size = count * ofi_datatype_size(datatype);
+
+	/* copy initial send data to result */
+	memcpy(result, send_buf, size);
+
+	if (numranks > 1 && count >= numranks &&
+	    size >= coll_allreduce_ring_size)
+		return coll_do_allreduce_ring(coll_op, result, tmp_buf, count,
+					      datatype, op);
+
+	if (numranks > 1 && count >= pof2 &&
+	    size >= coll_allreduce_rsag_size)
+		return coll_do_allreduce_rsag(coll_op, result, tmp_buf, count,
+					      datatype, op);
+
+	return coll_do_allreduce_rd(coll_op, result, tmp_buf, count,
+				    datatype, op);
+}
+
 /* allgather implemented using ring algorithm */
 static int coll_do_allgather(struct util_coll_operation *coll_op,
 			     const void *send_buf, void *result, size_t count,
@@ -645,6 +1008,360 @@ static int coll_do_scatter(struct util_coll_operation *coll_op,
 	return FI_SUCCESS;
 }
 
+/* Gather implemented with binomial tree algorithm */
+static int coll_do_gather(struct util_coll_operation *coll_op,
+			  const void *data, void *result, void **temp,
+			  size_t count, uint64_t root,
+			  enum fi_datatype datatype)
+{
+	uint64_t local_rank, relative_rank, remote_rank, mask, parent;
+	size_t nbytes, numranks, nvalues;
+	void *gather_buf;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank >= root) ?
+			local_rank - root : local_rank - root + numranks;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	/*
+	 * Each rank collects the values of its subtree, in relative rank
+	 * order.  Only rank 0 as root can gather straight into the result.
+	 */
+	nvalues = relative_rank ?
+		  util_binomial_tree_values_to_recv(relative_rank, numranks) :
+		  numranks;
+	if (local_rank == root && root == 0) {
+		gather_buf = result;
+	} else {
+		*temp = malloc(nvalues * nbytes);
+		if (!*temp)
+			return -FI_ENOMEM;
+		gather_buf = *temp;
+	}
+	memcpy(gather_buf, data, nbytes);
+
+	/* distance to the parent, or past the last rank for the root */
+	for (parent = 1; parent < numranks && !(relative_rank & parent);
+	     parent <<= 1)
+		;
+
+	/*
+	 * Receive from the largest subtree first.  The last receive fences
+	 * the forwarding of the collected values.
+	 */
+	for (mask = parent >> 1; mask > 0; mask >>= 1) {
+		if (relative_rank + mask >= numranks)
+			continue;
+
+		remote_rank = (local_rank + mask) % numranks;
+		ret = coll_sched_recv(coll_op, remote_rank,
+				      (char *) gather_buf + nbytes * mask,
+				      count * MIN(mask, numranks -
+						  relative_rank - mask),
+				      datatype, mask == 1);
+		if (ret)
+			return ret;
+	}
+
+	if (relative_rank) {
+		remote_rank = (local_rank + numranks - parent) % numranks;
+		return coll_sched_send(coll_op, remote_rank, gather_buf,
+				       nvalues * count, datatype, 1);
+	}
+
+	if (root == 0)
+		return FI_SUCCESS;
+
+	/* undo the rotation by root */
+	ret = coll_sched_copy(coll_op, gather_buf,
+			      (char *) result + nbytes * root,
+			      (numranks - root) * count, datatype, 1);
+	if (ret)
+		return ret;
+
+	return coll_sched_copy(coll_op,
+			       (char *) gather_buf + (numranks - root) * nbytes,
+			       result, root * count, datatype, 1);
+}
+
+/* Reduce implemented with binomial tree algorithm */
+static int coll_do_reduce(struct util_coll_operation *coll_op,
+			  const void *data, void *result, void **temp,
+			  size_t count, uint64_t root,
+			  enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t local_rank, relative_rank, remote_rank, mask;
+	size_t nbytes, numranks;
+	void *reduce_buf, *tmp_buf;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank >= root) ?
+			local_rank - root : local_rank - root + numranks;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	/* non-root ranks accumulate their subtree in a temp buffer */
+	*temp = malloc((local_rank == root ? 1 : 2) * nbytes);
+	if (!*temp)
+		return -FI_ENOMEM;
+
+	if (local_rank == root) {
+		reduce_buf = result;
+		tmp_buf = *temp;
+	} else {
+		reduce_buf = *temp;
+		tmp_buf = (char *) *temp + nbytes;
+	}
+	memcpy(reduce_buf, data, nbytes);
+
+	for (mask = 1; mask < numranks; mask <<= 1) {
+		if (relative_rank & mask) {
+			remote_rank = (local_rank + numranks - mask) % numranks;
+			return coll_sched_send(coll_op, remote_rank, reduce_buf,
+					       count, datatype, 1);
+		}
+
+		if (relative_rank + mask >= numranks)
+			continue;
+
+		remote_rank = (local_rank + mask) % numranks;
+		ret = coll_sched_recv(coll_op, remote_rank, tmp_buf, count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp_buf, reduce_buf, count,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Reduce-scatter, with count values of the result going to each rank.
+ * Input block j is staged at block j + 1, so that the ring reduce-scatter
+ * leaves rank i with the reduction of block i.
+ */
+static int coll_do_reduce_scatter(struct util_coll_operation *coll_op,
+				  const void *data, void *result, void **temp,
+				  size_t count, enum fi_datatype datatype,
+				  enum fi_op op)
+{
+	uint64_t local_rank;
+	size_t nbytes, numranks;
+	void *reduce_buf, *tmp_buf;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	if (numranks == 1)
+		return coll_sched_copy(coll_op, (void *) data, result, count,
+				       datatype, 1);
+
+	/* a pipelined ring uses at most two blocks of temp space */
+	*temp = malloc((numranks + 2) * nbytes);
+	if (!*temp)
+		return -FI_ENOMEM;
+
+	reduce_buf = *temp;
+	tmp_buf = (char *) *temp + numranks * nbytes;
+	memcpy((char *) reduce_buf + nbytes, data, (numranks - 1) * nbytes);
+	memcpy(reduce_buf, (char *) data + (numranks - 1) * nbytes, nbytes);
+
+	ret = coll_sched_ring_reduce_scatter(coll_op, reduce_buf, tmp_buf,
+					     numranks * count, datatype, op);
+	if (ret)
+		return ret;
+
+	return coll_sched_copy(coll_op,
+			       (char *) reduce_buf +
+			       ((local_rank + 1) % numranks) * nbytes,
+			       result, count, datatype, 1);
+}
+
+/* pairwise exchange, trading one block with a single peer per step */
+static int coll_do_alltoall_pairwise(struct util_coll_operation *coll_op,
+				     const void *data, void *result,
+				     size_t count, enum fi_datatype datatype)
+{
+	uint64_t local_rank, src, dst, i;
+	size_t nbytes, numranks;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	ret = coll_sched_copy(coll_op, (char *) data + local_rank * nbytes,
+			      (char *) result + local_rank * nbytes, count,
+			      datatype, 1);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < numranks; i++) {
+		if (!(numranks & (numranks - 1))) {
+			src = local_rank ^ i;
+			dst = src;
+		} else {
+			src = (numranks + local_rank - i) % numranks;
+			dst = (local_rank + i) % numranks;
+		}
+
+		ret = coll_sched_recv(coll_op, src,
+				      (char *) result + src * nbytes,
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_send(coll_op, dst,
+				      (char *) data + dst * nbytes,
+				      count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* copy the runs of blocks whose index has bit k set to or from packed */
+static int coll_sched_bruck_pack(struct util_coll_operation *coll_op,
+				 void *blocks, void *packed, uint64_t k,
+				 int unpack, size_t count,
+				 enum fi_datatype datatype, size_t *npacked)
+{
+	size_t nbytes, numranks, run;
+	uint64_t i;
+	int ret;
+
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	*npacked = 0;
+	for (i = k; i < numranks; i += 2 * k) {
+		run = MIN(k, numranks - i);
+		if (unpack)
+			ret = coll_sched_copy(coll_op,
+					      (char *) packed + *npacked * nbytes,
+					      (char *) blocks + i * nbytes,
+					      run * count, datatype, 0);
+		else
+			ret = coll_sched_copy(coll_op,
+					      (char *) blocks + i * nbytes,
+					      (char *) packed + *npacked * nbytes,
+					      run * count, datatype, 0);
+		if (ret)
+			return ret;
+
+		*npacked += run;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Bruck's algorithm: log2(P) steps, where step k forwards every block
+ * whose distance to its destination has bit k set.  Used for small blocks,
+ * where the number of messages dominates.
+ */
+static int coll_do_alltoall_bruck(struct util_coll_operation *coll_op,
+				  const void *data, void *result,
+				  void *tmp_buf, size_t count,
+				  enum fi_datatype datatype)
+{
+	uint64_t local_rank, i, k;
+	size_t nbytes, numranks, npacked;
+	void *pack_buf, *recv_buf;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+	pack_buf = (char *) tmp_buf + numranks * nbytes;
+	recv_buf = (char *) pack_buf + (numranks + 1) / 2 * nbytes;
+
+	/* rotate so that block i is destined to rank local + i */
+	memcpy(tmp_buf, (char *) data + local_rank * nbytes,
+	       (numranks - local_rank) * nbytes);
+	memcpy((char *) tmp_buf + (numranks - local_rank) * nbytes, data,
+	       local_rank * nbytes);
+
+	for (k = 1; k < numranks; k <<= 1) {
+		ret = coll_sched_bruck_pack(coll_op, tmp_buf, pack_buf, k, 0,
+					    count, datatype, &npacked);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op,
+				      (numranks + local_rank - k) % numranks,
+				      recv_buf, npacked * count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_send(coll_op, (local_rank + k) % numranks,
+				      pack_buf, npacked * count, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_bruck_pack(coll_op, tmp_buf, recv_buf, k, 1,
+					    count, datatype, &npacked);
+		if (ret)
+			return ret;
+	}
+
+	/* block i now holds the data sent by rank local - i */
+	for (i = 0; i < numranks; i++) {
+		ret = coll_sched_copy(coll_op, (char *) tmp_buf + i * nbytes,
+				      (char *) result +
+				      ((numranks + local_rank - i) % numranks) *
+				      nbytes, count, datatype, 0);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+static int coll_do_alltoall(struct util_coll_operation *coll_op,
+			    const void *data, void *result, void **temp,
+			    size_t count, enum fi_datatype datatype)
+{
+	size_t nbytes, numranks;
+
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	if (numranks <= 2 || nbytes > coll_alltoall_bruck_size)
+		return coll_do_alltoall_pairwise(coll_op, data, result, count,
+						 datatype);
+
+	/* rotated blocks, followed by the send and receive pack buffers */
+	*temp = malloc((numranks + 2 * ((numranks + 1) / 2)) * nbytes);
+	if (!*temp)
+		return -FI_ENOMEM;
+
+	return coll_do_alltoall_bruck(coll_op, data, result, *temp, count,
+				      datatype);
+}
+
 static int coll_close(struct fid *fid)
 {
 	struct util_coll_mc *coll_mc;
@@ -745,6 +1462,22 @@ void coll_collective_comp(struct util_coll_operation *coll_op)
 		free(coll_op->data.broadcast.scatter);
 		break;
 
+	case UTIL_COLL_REDUCE_OP:
+		free(coll_op->data.reduce);
+		break;
+
+	case UTIL_COLL_REDUCE_SCATTER_OP:
+		free(coll_op->data.reduce_scatter);
+		break;
+
+	case UTIL_COLL_ALLTOALL_OP:
+		free(coll_op->data.alltoall);
+		break;
+
+	case UTIL_COLL_GATHER_OP:
+		free(coll_op->data.gather);
+		break;
+
 	case UTIL_COLL_JOIN_OP:
 	case UTIL_COLL_BARRIER_OP:
 	case UTIL_COLL_ALLGATHER_OP:
@@ -759,10 +1492,10 @@ static ssize_t coll_process_reduce_item(struct util_coll_reduce_item *reduce_ite
 	if (reduce_item->op < FI_MIN || reduce_item->op > FI_BXOR)
 		return -FI_ENOSYS;
 
-	ofi_atomic_write_handler(reduce_item->op, reduce_item->datatype,
-				 reduce_item->inout_buf,
-				 reduce_item->in_buf,
-				 reduce_item->count);
+	ofi_atomic_reduce_handler(reduce_item->op, reduce_item->datatype,
+				  reduce_item->inout_buf,
+				  reduce_item->in_buf,
+				  reduce_item->count);
 	return FI_SUCCESS;
 }
 
@@ -1214,6 +1947,155 @@ err1:
 	return ret;
 }
 
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *alltoall_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	alltoall_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLTOALL_OP,
+				     flags, context,
+				     coll_collective_comp);
+	if (!alltoall_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_alltoall(alltoall_op, buf, result,
+			       &alltoall_op->data.alltoall, count, datatype);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(alltoall_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, alltoall_op);
+
+	return FI_SUCCESS;
+err:
+	free(alltoall_op->data.alltoall);
+	free(alltoall_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_scatter_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	reduce_scatter_op = coll_create_op(ep, coll_mc,
+					   UTIL_COLL_REDUCE_SCATTER_OP,
+					   flags, context,
+					   coll_collective_comp);
+	if (!reduce_scatter_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_reduce_scatter(reduce_scatter_op, buf, result,
+				     &reduce_scatter_op->data.reduce_scatter,
+				     count, datatype, op);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(reduce_scatter_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, reduce_scatter_op);
+
+	return FI_SUCCESS;
+err:
+	free(reduce_scatter_op->data.reduce_scatter);
+	free(reduce_scatter_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	reduce_op = coll_create_op(ep, coll_mc, UTIL_COLL_REDUCE_OP,
+				   flags, context,
+				   coll_collective_comp);
+	if (!reduce_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_reduce(reduce_op, buf, result, &reduce_op->data.reduce,
+			     count, root_addr, datatype, op);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(reduce_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, reduce_op);
+
+	return FI_SUCCESS;
+err:
+	free(reduce_op->data.reduce);
+	free(reduce_op);
+	return ret;
+}
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *gather_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	gather_op = coll_create_op(ep, coll_mc, UTIL_COLL_GATHER_OP,
+				   flags, context,
+				   coll_collective_comp);
+	if (!gather_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_gather(gather_op, buf, result, &gather_op->data.gather,
+			     count, root_addr, datatype);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(gather_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, gather_op);
+
+	return FI_SUCCESS;
+err:
+	free(gather_op->data.gather);
+	free(gather_op);
+	return ret;
+}
+
 ssize_t coll_peer_xfer_complete(struct fid_ep *ep,
 				struct fi_cq_tagged_entry *cqe,
 				fi_addr_t src_addr)
@@ -1280,9 +2162,13 @@ int coll_query_collective(struct fid_domain *dom_fid,
 	case FI_ALLGATHER:
 	case FI_SCATTER:
 	case FI_BROADCAST:
+	case FI_ALLTOALL:
+	case FI_GATHER:
 		ret = FI_SUCCESS;
 		break;
 	case FI_ALLREDUCE:
+	case FI_REDUCE_SCATTER:
+	case FI_REDUCE:
 		if (FI_MIN <= attr->op && FI_BXOR >= attr->op)
 			ret = fi_query_atomic(peer_domain, attr->datatype,
 					      attr->op, &attr->datatype_attr,
@@ -1290,10 +2176,6 @@ int coll_query_collective(struct fid_domain *dom_fid,
 		else
 			return -FI_ENOSYS;
 		break;
-	case FI_ALLTOALL:
-	case FI_REDUCE_SCATTER:
-	case FI_REDUCE:
-	case FI_GATHER:
 	default:
 		return -FI_ENOSYS;
 	}
@@ -32,6 +32,11 @@
 
 #include "coll.h"
 
+size_t coll_allreduce_rsag_size = 16384;
+size_t coll_allreduce_ring_size = 1048576;
+size_t coll_pipeline_chunk_size = 65536;
+size_t coll_alltoall_bruck_size = 256;
+
 static int coll_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
@@ -58,7 +63,39 @@ struct fi_provider coll_prov = {
 	.cleanup = coll_fini,
 };
 
+static void coll_init_env(void)
+{
+	size_t size;
+
+	if (!fi_param_get_size_t(&coll_prov, "allreduce_rsag_size", &size))
+		coll_allreduce_rsag_size = size;
+	if (!fi_param_get_size_t(&coll_prov, "allreduce_ring_size", &size))
+		coll_allreduce_ring_size = size;
+	if (!fi_param_get_size_t(&coll_prov, "pipeline_chunk_size", &size) &&
+	    size)
+		coll_pipeline_chunk_size = size;
+	if (!fi_param_get_size_t(&coll_prov, "alltoall_bruck_size", &size))
+		coll_alltoall_bruck_size = size;
+}
+
 COLL_INI
 {
+	fi_param_define(&coll_prov, "allreduce_rsag_size", FI_PARAM_SIZE_T,
+			"Allreduce size in bytes from which the reduce-scatter "
+			"plus allgather (Rabenseifner) algorithm is used instead "
+			"of recursive doubling (default: 16384)");
+	fi_param_define(&coll_prov, "allreduce_ring_size", FI_PARAM_SIZE_T,
+			"Allreduce size in bytes from which the pipelined ring "
+			"algorithm is used (default: 1048576)");
+	fi_param_define(&coll_prov, "pipeline_chunk_size", FI_PARAM_SIZE_T,
+			"Size in bytes of the pieces a ring allreduce block is "
+			"split into, to overlap transfers with reductions "
+			"(default: 65536)");
+	fi_param_define(&coll_prov, "alltoall_bruck_size", FI_PARAM_SIZE_T,
+			"Alltoall per peer size in bytes up to which Bruck's "
+			"algorithm is used instead of pairwise exchange "
+			"(default: 256)");
+
+	coll_init_env();
 	return &coll_prov;
 }
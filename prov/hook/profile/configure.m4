@@ -12,5 +12,19 @@ AC_DEFUN([FI_PROFILE_CONFIGURE],[
     # Determine if we can support the profile hooking provider
     profile_happy=0
     AS_IF([test x"$enable_profile" != x"no"], [profile_happy=1])
+
+    # shm_open is used to export latency histograms
+    AS_IF([test $profile_happy -eq 1],
+          [AC_CHECK_FUNC([shm_open], [],
+                         [FI_CHECK_PACKAGE([profilehook_shm],
+                                           [sys/mman.h],
+                                           [rt],
+                                           [shm_open],
+                                           [],
+                                           [],
+                                           [],
+                                           [],
+                                           [profile_happy=0])])])
+    AC_SUBST(profilehook_shm_LIBS)
     AS_IF([test $profile_happy -eq 1], [$1], [$2])
 ])
@@ -118,9 +118,98 @@ struct profile_data {
 	uint64_t sum[PROF_SIZE_MAX];
 };
 
+/*
+ * Latency histograms
+ *
+ * Operations that carry a context are timestamped when posted and matched
+ * with their completion by context.  Two latencies are recorded per
+ * operation type and size bucket: the time from posting the operation to
+ * reading its completion, and the time between the previous read of the
+ * CQ and the read that returned the completion, which bounds how long the
+ * completion waited in the CQ.
+ *
+ * Histograms are log-linear: values below PROF_LAT_SUB_CNT ns have their
+ * own bucket, and every power of two above that is split into
+ * PROF_LAT_SUB_CNT linear buckets, giving a relative error of at most
+ * 1 / PROF_LAT_SUB_CNT.  Values above 2^PROF_LAT_MAX_BITS ns are counted
+ * in the last bucket.
+ */
+#define PROF_LAT_SUB_BITS	3
+#define PROF_LAT_SUB_CNT	(1 << PROF_LAT_SUB_BITS)
+#define PROF_LAT_MAX_BITS	40
+#define PROF_LAT_BUCKETS	((PROF_LAT_MAX_BITS - PROF_LAT_SUB_BITS + 2) * \
+				 PROF_LAT_SUB_CNT)
+
+enum prof_lat_op {
+	PROF_LAT_OP_SEND,
+	PROF_LAT_OP_TSEND,
+	PROF_LAT_OP_RECV,
+	PROF_LAT_OP_TRECV,
+	PROF_LAT_OP_READ,
+	PROF_LAT_OP_WRITE,
+	PROF_LAT_OP_MAX
+};
+
+enum prof_lat_type {
+	PROF_LAT_POST_TO_COMP,
+	PROF_LAT_COMP_TO_READ,
+	PROF_LAT_TYPE_MAX
+};
+
+struct prof_lat_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t bucket[PROF_LAT_BUCKETS];
+};
+
+/*
+ * Layout of the shared memory segment used to export the histograms.  The
+ * segment is named /ofi_profile.<pid>.<n>, where n counts the fabrics
+ * opened by the process.  Counters are updated in place without
+ * synchronizing with readers, so a live snapshot may be slightly
+ * inconsistent across histograms.  magic is written last, once the
+ * header is valid.
+ */
+#define PROF_LAT_MAGIC		0x4f464950524f464cULL	/* "OFIPROFL" */
+#define PROF_LAT_VERSION	1
+
+struct prof_lat_export {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t pid;
+	uint32_t type_cnt;
+	uint32_t op_cnt;
+	uint32_t size_cnt;
+	uint32_t bucket_cnt;
+	uint32_t sub_bits;
+	uint32_t resv;
+	uint64_t dropped;
+	struct prof_lat_hist hist[PROF_LAT_TYPE_MAX][PROF_LAT_OP_MAX]
+				 [PROF_SIZE_MAX];
+};
+
+#define PROF_LAT_PENDING	(1 << 16)
+#define PROF_LAT_PROBE		4
+
+struct prof_lat_pending {
+	void *context;
+	uint64_t start;
+	uint8_t op;
+	uint8_t size;
+};
+
+struct prof_lat {
+	ofi_spin_t lock;
+	struct prof_lat_export *exp;
+	char name[64];
+	struct prof_lat_pending pending[PROF_LAT_PENDING];
+};
+
 struct profile_context {
 	const struct fi_provider *hprov;
 	struct profile_data data[prof_api_size];
+	struct prof_lat *lat;
 };
 
 struct profile_fabric {
@@ -128,6 +217,78 @@ struct profile_fabric {
 	struct profile_context prof_ctx;
 };
 
+struct profile_cq {
+	struct hook_cq hook_cq;
+	uint64_t last_read;
+};
+
 void prof_report(const struct fi_provider *hprov,  struct profile_data *data);
+void prof_report_lat(const struct fi_provider *hprov, struct prof_lat *lat);
+
+extern struct hook_prov_ctx hook_profile_ctx;
+
+void prof_lat_init(void);
+int prof_lat_open(struct profile_context *ctx, bool export);
+void prof_lat_close(struct profile_context *ctx);
+void prof_lat_post(struct profile_context *ctx, void *context,
+		   enum prof_lat_op op, size_t len, uint64_t start);
+void prof_lat_comp(struct profile_context *ctx, struct profile_cq *cq,
+		   void *buf, size_t count, uint64_t now);
+void prof_lat_drop(struct profile_context *ctx, void *context);
+
+static inline int prof_size_bucket(size_t len)
+{
+	if (len <= 64)
+		return PROF_SIZE_0_64;
+	if (len <= 512)
+		return PROF_SIZE_64_512;
+	if (len <= 1024)
+		return PROF_SIZE_512_1K;
+	if (len <= 4096)
+		return PROF_SIZE_1K_4K;
+	if (len <= 65536)      // 64K
+		return PROF_SIZE_4K_64K;
+	if (len <= 0x40000)    // 256K
+		return PROF_SIZE_64K_256K;
+	if (len <= 0x100000)   // 1M
+		return PROF_SIZE_256K_1M;
+	if (len <= 0x400000)   // 4M
+		return PROF_SIZE_1M_4M;
+	else
+		return PROF_SIZE_4M_UP;
+}
+
+static inline uint64_t prof_lat_start(struct profile_context *ctx)
+{
+	return ctx->lat ? ofi_gettime_ns() : 0;
+}
+
+static inline int prof_lat_bucket(uint64_t ns)
+{
+	int shift;
+
+	if (ns < PROF_LAT_SUB_CNT)
+		return (int) ns;
+
+	shift = 63 - __builtin_clzll(ns) - PROF_LAT_SUB_BITS;
+	if (shift > PROF_LAT_MAX_BITS - PROF_LAT_SUB_BITS)
+		return PROF_LAT_BUCKETS - 1;
+
+	return (shift + 1) * PROF_LAT_SUB_CNT +
+	       (int) ((ns >> shift) & (PROF_LAT_SUB_CNT - 1));
+}
+
+/* Largest value counted in a bucket */
+static inline uint64_t prof_lat_bucket_max(int bucket)
+{
+	int shift;
+
+	if (bucket < PROF_LAT_SUB_CNT)
+		return bucket;
+
+	shift = bucket / PROF_LAT_SUB_CNT - 1;
+	return (((uint64_t) (PROF_LAT_SUB_CNT + bucket % PROF_LAT_SUB_CNT + 1))
+		<< shift) - 1;
+}
 
 #endif /* _HOOK_PROFILE_H_ */
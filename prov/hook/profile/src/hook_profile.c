@@ -55,28 +55,6 @@ static inline struct profile_context *profile_ctx_domain(struct hook_domain *dom
 	                     fabric_hook)->prof_ctx;
 }
 
-static inline int prof_size_bucket(size_t len)
-{
-	if (len <= 64)
-		return PROF_SIZE_0_64;
-	if (len <= 512)
-		return PROF_SIZE_64_512;
-	if (len <= 1024)
-		return PROF_SIZE_512_1K;
-	if (len <= 4096)
-		return PROF_SIZE_1K_4K;
-	if (len <= 65536)      // 64K
-		return PROF_SIZE_4K_64K;
-	if (len <= 0x40000)    // 256K
-		return PROF_SIZE_64K_256K;
-	if (len <= 0x100000)   // 1M
-		return PROF_SIZE_256K_1M;
-	if (len <= 0x400000)   // 4M
-		return PROF_SIZE_1M_4M;
-	else
-		return PROF_SIZE_4M_UP;
-}
-
 static bool
 get_cq_unknown_entry(void *buf, int idx, int *group, uint64_t *len)
 {
@@ -178,11 +156,15 @@ profile_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
              fi_addr_t src_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_recv(myep->hep, buf, len, desc, src_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recv, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_RECV,
+		              len, start);
 	}
 	return ret;
 }
@@ -192,11 +174,15 @@ profile_recvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
                size_t count, fi_addr_t src_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_recvv(myep->hep, iov, desc, count, src_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recvv, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_RECV,
+		              ofi_total_iov_len(iov, count), start);
 	}
 	return ret;
 }
@@ -205,11 +191,16 @@ static ssize_t
 profile_recvmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_recvmsg(myep->hep, msg, flags);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recvmsg, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_RECV,
+		              ofi_total_iov_len(msg->msg_iov, msg->iov_count),
+		              start);
 	}
 
 	return ret;
@@ -220,12 +211,16 @@ profile_send(struct fid_ep *ep, const void *buf, size_t len, void *desc,
               fi_addr_t dest_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_send(myep->hep, buf, len, desc, dest_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_send,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_SEND,
+		              len, start);
 	}
 
 	return ret;
@@ -236,14 +231,18 @@ profile_sendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
                size_t count, fi_addr_t dest_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_sendv(myep->hep, iov, desc, count, dest_addr, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
 		prof_add_cntr(profile_ctx(myep), prof_sendv,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_SEND,
+		              len, start);
 	}
 
 	return ret;
@@ -253,14 +252,18 @@ static ssize_t
 profile_sendmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_sendmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 		prof_add_cntr(profile_ctx(myep), prof_sendmsg,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_SEND,
+		              len, start);
 	}
 
 	return ret;
@@ -287,13 +290,16 @@ profile_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
                   uint64_t data, fi_addr_t dest_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_senddata(myep->hep, buf, len, desc, data, dest_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_senddata,
 		              prof_size_bucket(len), len);
-
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_SEND,
+		              len, start);
 	}
 
 	return ret;
@@ -334,12 +340,16 @@ profile_read(struct fid_ep *ep, void *buf, size_t len, void *desc,
               fi_addr_t src_addr, uint64_t addr, uint64_t key, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_read(myep->hep, buf, len, desc, src_addr, addr, key, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_read,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_READ,
+		              len, start);
 	}
 
 	return ret;
@@ -351,15 +361,19 @@ profile_readv(struct fid_ep *ep, const struct iovec *iov, void **desc,
                uint64_t key, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_readv(myep->hep, iov, desc, count, src_addr,
 	               addr, key, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
 		prof_add_cntr(profile_ctx(myep), prof_readv,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_READ,
+		              len, start);
 	}
 
 	return ret;
@@ -370,14 +384,18 @@ profile_readmsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
                  uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_readmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 		prof_add_cntr(profile_ctx(myep), prof_readmsg,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_READ,
+		              len, start);
 	}
 
 	return ret;
@@ -388,12 +406,16 @@ profile_write(struct fid_ep *ep, const void *buf, size_t len, void *desc,
                fi_addr_t dest_addr, uint64_t addr, uint64_t key, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_write(myep->hep, buf, len, desc, dest_addr, addr, key, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_write,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_WRITE,
+		              len, start);
 	}
 
 	return ret;
@@ -405,15 +427,19 @@ profile_writev(struct fid_ep *ep, const struct iovec *iov, void **desc,
                 uint64_t key, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_writev(myep->hep, iov, desc, count, dest_addr,
 	                addr, key, context);
 	if (!ret) {
 		len =  ofi_total_iov_len(iov, count);
 		prof_add_cntr(profile_ctx(myep), prof_writev,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_WRITE,
+		              len, start);
 	}
 
 	return ret;
@@ -424,14 +450,18 @@ profile_writemsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
                   uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_writemsg(myep->hep, msg, flags);
 	if (!ret) {
 		len =  ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 		prof_add_cntr(profile_ctx(myep), prof_writemsg,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_WRITE,
+		              len, start);
 	}
 	return ret;
 }
@@ -458,13 +488,17 @@ profile_writedata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 		   uint64_t key, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_writedata(myep->hep, buf, len, desc, data,
 	                   dest_addr, addr, key, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_writedata,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_WRITE,
+		              len, start);
 	}
 
 	return ret;
@@ -508,11 +542,15 @@ profile_trecv(struct fid_ep *ep, void *buf, size_t len, void *desc,
                void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_trecv(myep->hep, buf, len, desc, src_addr, tag, ignore, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecv, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_TRECV,
+		              len, start);
 	}
 
 	return ret;
@@ -524,12 +562,16 @@ profile_trecvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
                 uint64_t ignore, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_trecvv(myep->hep, iov, desc, count, src_addr,
 	                tag, ignore, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecvv, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_TRECV,
+		              ofi_total_iov_len(iov, count), start);
 	}
 
 	return ret;
@@ -540,11 +582,16 @@ profile_trecvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
                   uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_trecvmsg(myep->hep, msg, flags);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecvmsg, 0, PROF_IGNORE_SIZE);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_TRECV,
+		              ofi_total_iov_len(msg->msg_iov, msg->iov_count),
+		              start);
 	}
 
 	return ret;
@@ -555,12 +602,16 @@ profile_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
                fi_addr_t dest_addr, uint64_t tag, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_tsend(myep->hep, buf, len, desc, dest_addr, tag, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_tsend,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_TSEND,
+		              len, start);
 	}
 
 	return ret;
@@ -572,14 +623,18 @@ profile_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
                 void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_tsendv(myep->hep, iov, desc, count, dest_addr, tag, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
 		prof_add_cntr(profile_ctx(myep), prof_tsendv,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_TSEND,
+		              len, start);
 	}
 
 	return ret;
@@ -590,14 +645,18 @@ profile_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
                   uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	size_t len;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_tsendmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 		prof_add_cntr(profile_ctx(myep), prof_tsendmsg,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), msg->context, PROF_LAT_OP_TSEND,
+		              len, start);
 	}
 
 	return ret;
@@ -625,13 +684,17 @@ profile_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
                    void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	uint64_t start;
 	ssize_t ret;
 
+	start = prof_lat_start(profile_ctx(myep));
 	ret = fi_tsenddata(myep->hep, buf, len, desc, data,
 	                   dest_addr, tag, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_tsenddata,
 		              prof_size_bucket(len), len);
+		prof_lat_post(profile_ctx(myep), context, PROF_LAT_OP_TSEND,
+		              len, start);
 	}
 
 	return ret;
@@ -666,6 +729,28 @@ static struct fi_ops_tagged profile_tagged_ops = {
 	.injectdata = profile_tinjectdata,
 };
 
+/*
+ * The time of each read is kept to bound how long completions wait in the
+ * CQ.  Blocking reads wait for the completion itself, so the bound is only
+ * recorded for completions returned by non-blocking reads.
+ */
+static inline void
+prof_cq_lat(struct profile_cq *cq, void *buf, ssize_t ret, bool blocking)
+{
+	struct profile_context *ctx = profile_ctx_cq(&cq->hook_cq);
+	uint64_t now;
+
+	if (!ctx->lat)
+		return;
+
+	now = ofi_gettime_ns();
+	if (blocking)
+		cq->last_read = 0;
+	if (ret > 0)
+		prof_lat_comp(ctx, cq, buf, ret, now);
+	cq->last_read = now;
+}
+
 static ssize_t profile_cq_read(struct fid_cq *cq, void *buf, size_t count)
 {
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
@@ -676,6 +761,8 @@ static ssize_t profile_cq_read(struct fid_cq *cq, void *buf, size_t count)
 		prof_add_cq_cntr(profile_ctx_cq(mycq), prof_cq_read,
 		                 mycq->format, buf, ret);
 	}
+	prof_cq_lat(container_of(mycq, struct profile_cq, hook_cq), buf, ret,
+		    false);
 	return ret;
 }
 
@@ -690,6 +777,8 @@ profile_cq_readfrom(struct fid_cq *cq, void *buf, size_t count, fi_addr_t *src_a
 		prof_add_cq_cntr(profile_ctx_cq(mycq), prof_cq_readfrom,
 		                 mycq->format, buf, ret);
 	}
+	prof_cq_lat(container_of(mycq, struct profile_cq, hook_cq), buf, ret,
+		    false);
 
 	return ret;
 }
@@ -700,6 +789,8 @@ profile_cq_readerr(struct fid_cq *cq, struct fi_cq_err_entry *buf, uint64_t flag
 	ssize_t ret;
 
 	ret = fi_cq_readerr(mycq->hcq, buf, flags);
+	if (ret > 0)
+		prof_lat_drop(profile_ctx_cq(mycq), buf->op_context);
 
 	return ret;
 }
@@ -716,6 +807,8 @@ profile_cq_sread(struct fid_cq *cq, void *buf, size_t count,
 		prof_add_cq_cntr(profile_ctx_cq(mycq), prof_cq_sread,
 		                 mycq->format, buf, ret);
 	}
+	prof_cq_lat(container_of(mycq, struct profile_cq, hook_cq), buf, ret,
+		    true);
 	return ret;
 }
 
@@ -731,6 +824,8 @@ profile_cq_sreadfrom(struct fid_cq *cq, void *buf, size_t count,
 		prof_add_cq_cntr(profile_ctx_cq(mycq), prof_cq_sreadfrom,
 		                 mycq->format, buf, ret);
 	}
+	prof_cq_lat(container_of(mycq, struct profile_cq, hook_cq), buf, ret,
+		    true);
 	return ret;
 }
 
@@ -814,10 +909,34 @@ static struct fi_ops_mr profile_mr_ops = {
 	.regattr = profile_mr_regattr,
 };
 
+static int
+profile_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
+		struct fid_cq **cq, void *context)
+{
+	struct profile_cq *mycq;
+	int ret;
+
+	mycq = calloc(1, sizeof(*mycq));
+	if (!mycq)
+		return -FI_ENOMEM;
+
+	ret = hook_cq_init(domain, attr, cq, context, &mycq->hook_cq);
+	if (ret) {
+		free(mycq);
+		return ret;
+	}
+
+	mycq->hook_cq.cq.ops = &profile_cq_ops;
+	return 0;
+}
+
+static struct fi_ops_domain profile_domain_ops;
+
 static int profile_domain_init(struct fid *fid)
 {
 	struct fid_domain *domain = container_of(fid, struct fid_domain, fid);
 	domain->mr = &profile_mr_ops;
+	domain->ops = &profile_domain_ops;
 
 	return 0;
 }
@@ -828,6 +947,10 @@ static int hook_profile_close(struct fid *fid)
 		&(container_of(fid, struct profile_fabric, fabric_hook)->prof_ctx);
 
 	prof_report(ctx->hprov, ctx->data);
+	if (ctx->lat) {
+		prof_report_lat(ctx->hprov, ctx->lat);
+		prof_lat_close(ctx);
+	}
 
 	hook_close(fid);
 	return FI_SUCCESS;
@@ -843,12 +966,16 @@ static struct fi_ops profile_fabric_fid_ops = {
 
 struct hook_prov_ctx hook_profile_ctx;
 
+static int prof_latency;
+static int prof_export;
+
 static int 
 hook_profile_fabric(struct fi_fabric_attr *attr,
                      struct fid_fabric **fabric, void *context)
 {
 	struct fi_provider *hprov = context;
 	struct profile_fabric *fab;
+	int ret;
 
 	FI_TRACE(hprov, FI_LOG_FABRIC, "Installing profile hook\n");
 	fab = calloc(1, sizeof *fab);
@@ -857,6 +984,13 @@ hook_profile_fabric(struct fi_fabric_attr *attr,
 
 	fab->prof_ctx.hprov = hprov;
 	memset(&fab->prof_ctx.data, 0, sizeof (fab->prof_ctx.data));
+	if (prof_latency || prof_export) {
+		ret = prof_lat_open(&fab->prof_ctx, prof_export);
+		if (ret) {
+			free(fab);
+			return ret;
+		}
+	}
 	hook_fabric_init(&fab->fabric_hook, HOOK_PROFILE, attr->fabric, hprov,
 	                 &profile_fabric_fid_ops, &hook_profile_ctx);
 	*fabric = &fab->fabric_hook.fabric;
@@ -876,13 +1010,6 @@ struct hook_prov_ctx hook_profile_ctx = {
 };
 
 
-static int profile_cq_init(struct fid *fid)
-{
-	struct fid_cq *cq = container_of(fid, struct fid_cq, fid);
-	cq->ops = &profile_cq_ops;
-	return 0;
-}
-
 static int profile_ep_init(struct fid *fid)
 {
 	struct fid_ep *ep = container_of(fid, struct fid_ep, fid);
@@ -895,8 +1022,22 @@ static int profile_ep_init(struct fid *fid)
 
 HOOK_PROFILE_INI
 {
+	fi_param_define(&hook_profile_ctx.prov, "latency", FI_PARAM_BOOL,
+			"Record histograms of the latency of operations, from "
+			"posting to reading the completion. (default: false)");
+	fi_param_define(&hook_profile_ctx.prov, "export", FI_PARAM_BOOL,
+			"Export latency histograms through a shared memory "
+			"segment named /ofi_profile.<pid>.<n>, which may be "
+			"read while the application runs. Implies latency. "
+			"(default: false)");
+	fi_param_get_bool(&hook_profile_ctx.prov, "latency", &prof_latency);
+	fi_param_get_bool(&hook_profile_ctx.prov, "export", &prof_export);
+	prof_lat_init();
+
+	profile_domain_ops = hook_domain_ops;
+	profile_domain_ops.cq_open = profile_cq_open;
+
 	hook_profile_ctx.ini_fid[FI_CLASS_DOMAIN] = profile_domain_init;
-	hook_profile_ctx.ini_fid[FI_CLASS_CQ] = profile_cq_init;
 	hook_profile_ctx.ini_fid[FI_CLASS_EP] = profile_ep_init;
 
 	return &hook_profile_ctx.prov;
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2018-2023 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ofi_mb.h"
+#include "hook_profile.h"
+
+static ofi_atomic32_t prof_lat_index;
+
+static inline size_t prof_lat_hash(void *context)
+{
+	return (size_t) ((((uintptr_t) context >> 3) * 0x9e3779b97f4a7c15ULL)
+			 >> 48) & (PROF_LAT_PENDING - 1);
+}
+
+static int prof_lat_export(struct prof_lat *lat)
+{
+	int fd, ret;
+
+	snprintf(lat->name, sizeof(lat->name), "/ofi_profile.%d.%d",
+		 getpid(), ofi_atomic_inc32(&prof_lat_index));
+
+	fd = shm_open(lat->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		FI_WARN(&hook_profile_ctx.prov, FI_LOG_FABRIC,
+			"unable to create %s: %s\n", lat->name,
+			strerror(errno));
+		return -errno;
+	}
+
+	if (ftruncate(fd, sizeof(*lat->exp))) {
+		ret = -errno;
+		goto err;
+	}
+
+	lat->exp = mmap(NULL, sizeof(*lat->exp), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (lat->exp == MAP_FAILED) {
+		ret = -errno;
+		lat->exp = NULL;
+		goto err;
+	}
+
+	close(fd);
+	FI_INFO(&hook_profile_ctx.prov, FI_LOG_FABRIC,
+		"exporting latency histograms to %s\n", lat->name);
+	return 0;
+err:
+	FI_WARN(&hook_profile_ctx.prov, FI_LOG_FABRIC,
+		"unable to map %s: %s\n", lat->name, fi_strerror(-ret));
+	close(fd);
+	shm_unlink(lat->name);
+	lat->name[0] = '\0';
+	return ret;
+}
+
+void prof_lat_init(void)
+{
+	ofi_atomic_initialize32(&prof_lat_index, 0);
+}
+
+int prof_lat_open(struct profile_context *ctx, bool export)
+{
+	struct prof_lat *lat;
+	int ret;
+
+	lat = calloc(1, sizeof(*lat));
+	if (!lat)
+		return -FI_ENOMEM;
+
+	ret = ofi_spin_init(&lat->lock);
+	if (ret)
+		goto err1;
+
+	if (!export || prof_lat_export(lat)) {
+		lat->exp = calloc(1, sizeof(*lat->exp));
+		if (!lat->exp) {
+			ret = -FI_ENOMEM;
+			goto err2;
+		}
+	}
+
+	lat->exp->version = PROF_LAT_VERSION;
+	lat->exp->pid = getpid();
+	lat->exp->type_cnt = PROF_LAT_TYPE_MAX;
+	lat->exp->op_cnt = PROF_LAT_OP_MAX;
+	lat->exp->size_cnt = PROF_SIZE_MAX;
+	lat->exp->bucket_cnt = PROF_LAT_BUCKETS;
+	lat->exp->sub_bits = PROF_LAT_SUB_BITS;
+	ofi_wmb();
+	lat->exp->magic = PROF_LAT_MAGIC;
+
+	ctx->lat = lat;
+	return 0;
+err2:
+	ofi_spin_destroy(&lat->lock);
+err1:
+	free(lat);
+	return ret;
+}
+
+void prof_lat_close(struct profile_context *ctx)
+{
+	struct prof_lat *lat = ctx->lat;
+
+	if (!lat)
+		return;
+
+	if (lat->name[0]) {
+		munmap(lat->exp, sizeof(*lat->exp));
+		shm_unlink(lat->name);
+	} else {
+		free(lat->exp);
+	}
+	ofi_spin_destroy(&lat->lock);
+	free(lat);
+	ctx->lat = NULL;
+}
+
+/*
+ * Operations whose completion is never read, such as those posted without
+ * FI_COMPLETION to an endpoint using selective completions, are left in the
+ * table until their slot is needed.  When all slots of a probe sequence are
+ * in use, the oldest operation is dropped from measurement.
+ */
+void prof_lat_post(struct profile_context *ctx, void *context,
+		   enum prof_lat_op op, size_t len, uint64_t start)
+{
+	struct prof_lat *lat = ctx->lat;
+	struct prof_lat_pending *entry, *oldest = NULL;
+	size_t i, idx;
+
+	if (!lat || !context)
+		return;
+
+	idx = prof_lat_hash(context);
+	ofi_spin_lock(&lat->lock);
+	for (i = 0; i < PROF_LAT_PROBE; i++) {
+		entry = &lat->pending[(idx + i) & (PROF_LAT_PENDING - 1)];
+		if (!entry->context || entry->context == context)
+			goto found;
+		if (!oldest || entry->start < oldest->start)
+			oldest = entry;
+	}
+	entry = oldest;
+	lat->exp->dropped++;
+found:
+	entry->context = context;
+	entry->start = start;
+	entry->op = op;
+	entry->size = prof_size_bucket(len);
+	ofi_spin_unlock(&lat->lock);
+}
+
+static struct prof_lat_pending *
+prof_lat_find(struct prof_lat *lat, void *context)
+{
+	struct prof_lat_pending *entry;
+	size_t i, idx;
+
+	idx = prof_lat_hash(context);
+	for (i = 0; i < PROF_LAT_PROBE; i++) {
+		entry = &lat->pending[(idx + i) & (PROF_LAT_PENDING - 1)];
+		if (entry->context == context)
+			return entry;
+	}
+	return NULL;
+}
+
+static inline void prof_lat_record(struct prof_lat_hist *hist, uint64_t ns)
+{
+	hist->bucket[prof_lat_bucket(ns)]++;
+	hist->count++;
+	hist->sum += ns;
+	if (ns > hist->max)
+		hist->max = ns;
+}
+
+static size_t prof_lat_entry_size[] = {
+	[FI_CQ_FORMAT_UNSPEC] = 0,
+	[FI_CQ_FORMAT_CONTEXT] = sizeof(struct fi_cq_entry),
+	[FI_CQ_FORMAT_MSG] = sizeof(struct fi_cq_msg_entry),
+	[FI_CQ_FORMAT_DATA] = sizeof(struct fi_cq_data_entry),
+	[FI_CQ_FORMAT_TAGGED] = sizeof(struct fi_cq_tagged_entry),
+};
+
+void prof_lat_comp(struct profile_context *ctx, struct profile_cq *cq,
+		   void *buf, size_t count, uint64_t now)
+{
+	struct prof_lat *lat = ctx->lat;
+	enum fi_cq_format format = cq->hook_cq.format;
+	struct prof_lat_pending *entry;
+	struct fi_cq_msg_entry *comp;
+	uint64_t wait;
+	size_t i, size;
+
+	if (!lat || format <= FI_CQ_FORMAT_UNSPEC ||
+	    format > FI_CQ_FORMAT_TAGGED)
+		return;
+
+	wait = cq->last_read ? now - cq->last_read : 0;
+	ofi_spin_lock(&lat->lock);
+	for (i = 0; i < count; i++) {
+		comp = (struct fi_cq_msg_entry *)
+			((char *) buf + i * prof_lat_entry_size[format]);
+		if (!comp->op_context)
+			continue;
+
+		entry = prof_lat_find(lat, comp->op_context);
+		if (!entry)
+			continue;
+
+		/* Receives are bucketed by the size actually received */
+		size = entry->size;
+		if (format >= FI_CQ_FORMAT_MSG && (comp->flags & FI_RECV))
+			size = prof_size_bucket(comp->len);
+
+		prof_lat_record(&lat->exp->hist[PROF_LAT_POST_TO_COMP]
+					       [entry->op][size],
+				now - entry->start);
+		if (cq->last_read)
+			prof_lat_record(&lat->exp->hist[PROF_LAT_COMP_TO_READ]
+						       [entry->op][size],
+					wait);
+		entry->context = NULL;
+	}
+	ofi_spin_unlock(&lat->lock);
+}
+
+void prof_lat_drop(struct profile_context *ctx, void *context)
+{
+	struct prof_lat *lat = ctx->lat;
+	struct prof_lat_pending *entry;
+
+	if (!lat || !context)
+		return;
+
+	ofi_spin_lock(&lat->lock);
+	entry = prof_lat_find(lat, context);
+	if (entry)
+		entry->context = NULL;
+	ofi_spin_unlock(&lat->lock);
+}
@@ -29,6 +29,7 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -238,3 +239,90 @@ void prof_report(const struct fi_provider *prov,  struct profile_data *data)
 	prof_log_apis(prov, "MR REG", "Iface", "mr reg", PROF_HMEM_IFACE_MAX,
 	                data, PROF_MR_API_START, PROF_MR_API_END, &with_title);
 }
+
+#define PROF_LAT_OUTPUT_FORMAT \
+	" \t%-10s%-12s%-12s%-12s%-12s%-12s%-12s%-12s\n"
+
+static const char *prof_lat_op_str[] = {
+	[PROF_LAT_OP_SEND] = "send",
+	[PROF_LAT_OP_TSEND] = "tsend",
+	[PROF_LAT_OP_RECV] = "recv",
+	[PROF_LAT_OP_TRECV] = "trecv",
+	[PROF_LAT_OP_READ] = "read",
+	[PROF_LAT_OP_WRITE] = "write",
+};
+
+static const char *prof_lat_type_str[] = {
+	[PROF_LAT_POST_TO_COMP] = "post to completion read (ns)",
+	[PROF_LAT_COMP_TO_READ] = "completion wait in CQ, upper bound (ns)",
+};
+
+static uint64_t prof_lat_percentile(struct prof_lat_hist *hist, double pct)
+{
+	uint64_t target, total = 0;
+	int i;
+
+	target = (uint64_t) (pct * hist->count / 100.0);
+	if (!target)
+		target = 1;
+
+	for (i = 0; i < PROF_LAT_BUCKETS; i++) {
+		total += hist->bucket[i];
+		if (total >= target)
+			return MIN(prof_lat_bucket_max(i), hist->max);
+	}
+	return hist->max;
+}
+
+void prof_report_lat(const struct fi_provider *prov, struct prof_lat *lat)
+{
+	char count[PROF_STR_LEN], size[PROF_STR_LEN];
+	struct prof_lat_hist *hist;
+	int type, op, i;
+	bool title;
+
+	for (type = 0; type < PROF_LAT_TYPE_MAX; type++) {
+		title = true;
+		for (op = 0; op < PROF_LAT_OP_MAX; op++) {
+			for (i = 0; i < PROF_SIZE_MAX; i++) {
+				hist = &lat->exp->hist[type][op][i];
+				if (!hist->count)
+					continue;
+
+				if (title) {
+					FI_TRACE(prov, FI_LOG_CORE,
+						 "  \tlatency: %s\n",
+						 prof_lat_type_str[type]);
+					FI_TRACE(prov, FI_LOG_CORE,
+						 PROF_LAT_OUTPUT_FORMAT, "Op",
+						 "Size", "Count", "Avg", "p50",
+						 "p99", "p99.9", "Max");
+					title = false;
+				}
+
+				size[0] = '\0';
+				count[0] = '\0';
+				prof_size_bucket_tostr(size, sizeof(size), i);
+				FI_TRACE(prov, FI_LOG_CORE,
+					 " \t%-10s%-12s%-12s%-12" PRIu64
+					 "%-12" PRIu64 "%-12" PRIu64
+					 "%-12" PRIu64 "%-12" PRIu64 "\n",
+					 prof_lat_op_str[op], size,
+					 ofi_tostr_count(count, sizeof(count),
+							 hist->count),
+					 hist->sum / hist->count,
+					 prof_lat_percentile(hist, 50),
+					 prof_lat_percentile(hist, 99),
+					 prof_lat_percentile(hist, 99.9),
+					 hist->max);
+			}
+		}
+		if (!title)
+			FI_TRACE(prov, FI_LOG_CORE, "\n");
+	}
+
+	if (lat->exp->dropped)
+		FI_TRACE(prov, FI_LOG_CORE,
+			 "  \tlatency: %" PRIu64 " operations not measured\n",
+			 lat->exp->dropped);
+}
@@ -38,6 +38,12 @@
 
 #define lnx_ep_rx_flags(lnx_ep) ((lnx_ep)->le_ep.rx_op_flags)
 
+enum lnx_rail_policy {
+	LNX_RAIL_SINGLE,
+	LNX_RAIL_ROUND_ROBIN,
+	LNX_RAIL_LEAST_PENDING,
+};
+
 struct local_prov_ep;
 
 struct lnx_match_attr {
@@ -87,6 +93,14 @@ struct local_prov_ep {
 	struct ofi_bufpool *lpe_recv_bp;
 	ofi_spin_t lpe_bplock;
 	struct local_prov *lpe_parent;
+	/* index of this endpoint within its provider. It's also the rail
+	 * number used when reaching a peer through this endpoint
+	 */
+	int lpe_idx;
+	/* send operations posted on this endpoint which are still waiting
+	 * for a completion. Only tracked for the least pending rail policy
+	 */
+	ofi_atomic32_t lpe_tx_pending;
 };
 
 struct lnx_rx_entry {
@@ -174,6 +188,15 @@ struct lnx_peer_prov {
 	 * relationship
 	 */
 	struct dlist_entry lpp_map;
+
+	/* the maps above indexed by the local endpoint index. Each one is
+	 * a rail we can use to reach this peer. Rail 0 is the primary rail
+	 * which RMA and atomic operations are always sent on, since the
+	 * keys we exchange belong to the first endpoint of each provider
+	 */
+	struct lnx_local2peer_map *lpp_rails[LNX_MAX_LOCAL_EPS];
+	int lpp_rail_count;
+	uint32_t lpp_next_rail;
 };
 
 struct lnx_peer {
@@ -220,6 +243,10 @@ struct lnx_ep {
 	size_t le_fclass;
 	struct lnx_peer_table *le_peer_tbl;
 	struct lnx_peer_srq le_srq;
+	/* send after send ordering was requested, so all tagged messages
+	 * to a peer need to go over the same rail
+	 */
+	bool le_tx_ordered;
 };
 
 struct lnx_srx_context {
@@ -229,7 +256,10 @@ struct lnx_srx_context {
 
 struct lnx_mem_desc_prov {
 	struct local_prov *prov;
+	/* registration against the first endpoint of the provider */
 	struct fid_mr *core_mr;
+	/* registrations against each endpoint, indexed by lpe_idx */
+	struct fid_mr *rail_mr[LNX_MAX_LOCAL_EPS];
 };
 
 struct lnx_mem_desc {
@@ -270,6 +300,7 @@ extern struct util_prov lnx_util_prov;
 extern struct fi_provider lnx_prov;
 extern struct ofi_bufpool *global_recv_bp;
 extern ofi_spin_t global_bplock;
+extern enum lnx_rail_policy lnx_rail_policy;
 
 struct fi_info *lnx_get_link_by_dom(char *domain_name);
 
@@ -379,50 +410,134 @@ out:
 	return FI_SUCCESS;
 }
 
+static inline struct lnx_peer_prov *
+lnx_get_peer_prov(struct lnx_peer *lp, int *idx)
+{
+	if (lp->lp_local) {
+		*idx = 0;
+		return lp->lp_shm_prov;
+	}
+
+	/* TODO multi-rail across different providers. For now the
+	 * assumption is that local peers can be reached on shm and remote
+	 * peers on the first remote provider, hence indexing on 0 and 1
+	 */
+	*idx = 1;
+	return dlist_first_entry_or_null(&lp->lp_provs,
+					 struct lnx_peer_prov, entry);
+}
+
+static inline struct lnx_local2peer_map *
+lnx_select_rail(struct lnx_ep *lep, struct lnx_peer *lp,
+		struct lnx_peer_prov *prov)
+{
+	struct lnx_local2peer_map *lpm, *best;
+	int32_t pending, min;
+	uint32_t start;
+	int i;
+
+	/* without the shared receive queue receives are posted on the
+	 * primary rail only, so that's where the messages need to land
+	 */
+	if (prov->lpp_rail_count <= 1 || lnx_rail_policy == LNX_RAIL_SINGLE ||
+	    !lep->le_domain->ld_srx_supported)
+		return prov->lpp_rails[0];
+
+	/* The core providers only order messages sent over the same
+	 * endpoint. Keep each peer on one rail and spread the peers
+	 * across the rails instead.
+	 */
+	if (lep->le_tx_ordered)
+		return prov->lpp_rails[lp->lp_fi_addr % prov->lpp_rail_count];
+
+	if (lnx_rail_policy == LNX_RAIL_ROUND_ROBIN)
+		return prov->lpp_rails[prov->lpp_next_rail++ %
+				       prov->lpp_rail_count];
+
+	/* start the scan at the next rail so ties are spread around */
+	start = prov->lpp_next_rail++;
+	best = NULL;
+	min = 0;
+	for (i = 0; i < prov->lpp_rail_count; i++) {
+		lpm = prov->lpp_rails[(start + i) % prov->lpp_rail_count];
+		pending = ofi_atomic_get32(&lpm->local_ep->lpe_tx_pending);
+		if (!best || pending < min) {
+			best = lpm;
+			min = pending;
+			if (min <= 0)
+				break;
+		}
+	}
+
+	return best;
+}
+
+static inline bool lnx_track_tx(struct local_prov_ep *cep)
+{
+	return lnx_rail_policy == LNX_RAIL_LEAST_PENDING &&
+	       cep->lpe_parent->lpv_ep_count > 1;
+}
+
+/* called after a send was posted on a core endpoint. flags are the
+ * operation flags, which tell us whether a completion will be written
+ * for it, and therefore whether lnx_peer_cq_write() will see it finish
+ */
+static inline void
+lnx_tx_posted(struct local_prov_ep *cep, uint64_t flags)
+{
+	if ((flags & FI_COMPLETION) && lnx_track_tx(cep))
+		ofi_atomic_inc32(&cep->lpe_tx_pending);
+}
+
+/* The count is only a load hint. Error completions don't always carry
+ * FI_SEND, so they may be counted against it without being a send; never
+ * let the count drop below zero.
+ */
+static inline void lnx_tx_done(struct local_prov_ep *cep)
+{
+	int32_t pending;
+
+	if (!lnx_track_tx(cep))
+		return;
+
+	do {
+		pending = ofi_atomic_get32(&cep->lpe_tx_pending);
+		if (pending <= 0)
+			return;
+	} while (!ofi_atomic_cas_bool32(&cep->lpe_tx_pending, pending,
+					pending - 1));
+}
+
 static inline
-int lnx_select_send_pathway(struct lnx_peer *lp, struct lnx_domain *lnx_dom,
+int lnx_select_rail_pathway(struct lnx_peer *lp, struct lnx_local2peer_map *lpm,
+			    int idx, struct lnx_domain *lnx_dom,
 			    struct lnx_mem_desc *desc, struct local_prov_ep **cep,
 			    fi_addr_t *addr, const struct iovec *iov, size_t iov_count,
 			    struct ofi_mr_entry **mre, void **mem_desc, uint64_t *rkey)
 {
-	int idx = 0;
 	int rc;
-	struct lnx_peer_prov *prov;
-	struct lnx_local2peer_map *lpm;
+	struct local_prov_ep *lpe = lpm->local_ep;
 	struct ofi_mr *mr = NULL;
 
-	if (lp->lp_local) {
-		prov = lp->lp_shm_prov;
-	} else {
-		prov = dlist_first_entry_or_null(
-			&lp->lp_provs, struct lnx_peer_prov, entry);
-		idx = 1;
-	}
-
-	/* TODO when we support multi-rail we can have multiple maps */
-	lpm = dlist_first_entry_or_null(&prov->lpp_map,
-					struct lnx_local2peer_map, entry);
-	*addr = lpm->peer_addrs[0];
+	/* local endpoint N talks to the peer's endpoint N. If the peer has
+	 * less endpoints than we do, then wrap around
+	 */
+	*addr = lpm->peer_addrs[lpm->addr_count > 1 ?
+				lpe->lpe_idx % lpm->addr_count : 0];
+	*cep = lpe;
 
-	/* TODO this will need to be expanded to handle Multi-Rail. For now
-	 * the assumption is that local peers can be reached on shm and remote
-	 * peers have only one interface, hence indexing on 0 and 1
-	 *
-	 * If we did memory registration, then we've already figured out the
-	 * pathway
+	/* If we did memory registration, then we've already got the
+	 * registration for each of the rails
 	 */
 	if (desc && desc->desc[idx].core_mr) {
-		*cep = dlist_first_entry_or_null(
-				&desc->desc[idx].prov->lpv_prov_eps,
-				struct local_prov_ep, entry);
 		if (mem_desc)
-			*mem_desc = fi_mr_desc(desc->desc[idx].core_mr);
+			*mem_desc = fi_mr_desc(
+				desc->desc[idx].rail_mr[lpe->lpe_idx]);
 		if (rkey)
 			*rkey = fi_mr_key(desc->desc[idx].core_mr);
 		return 0;
 	}
 
-	*cep = lpm->local_ep;
 	if (mem_desc)
 		*mem_desc = NULL;
 
@@ -445,6 +560,42 @@ int lnx_select_send_pathway(struct lnx_peer *lp, struct lnx_domain *lnx_dom,
 	return rc;
 }
 
+/* select the primary rail to the peer */
+static inline
+int lnx_select_send_pathway(struct lnx_peer *lp, struct lnx_domain *lnx_dom,
+			    struct lnx_mem_desc *desc, struct local_prov_ep **cep,
+			    fi_addr_t *addr, const struct iovec *iov, size_t iov_count,
+			    struct ofi_mr_entry **mre, void **mem_desc, uint64_t *rkey)
+{
+	int idx;
+	struct lnx_peer_prov *prov;
+
+	prov = lnx_get_peer_prov(lp, &idx);
+
+	return lnx_select_rail_pathway(lp, prov->lpp_rails[0], idx, lnx_dom,
+				       desc, cep, addr, iov, iov_count, mre,
+				       mem_desc, rkey);
+}
+
+/* select the rail to send a tagged message over according to the rail
+ * policy. On-node peers are always reached over shm
+ */
+static inline
+int lnx_select_tx_pathway(struct lnx_ep *lep, struct lnx_peer *lp,
+			  struct lnx_mem_desc *desc, struct local_prov_ep **cep,
+			  fi_addr_t *addr, const struct iovec *iov, size_t iov_count,
+			  struct ofi_mr_entry **mre, void **mem_desc)
+{
+	int idx;
+	struct lnx_peer_prov *prov;
+
+	prov = lnx_get_peer_prov(lp, &idx);
+
+	return lnx_select_rail_pathway(lp, lnx_select_rail(lep, lp, prov),
+				       idx, lep->le_domain, desc, cep, addr,
+				       iov, iov_count, mre, mem_desc, NULL);
+}
+
 static inline
 int lnx_select_recv_pathway(struct lnx_peer *lp, struct lnx_domain *lnx_dom,
 			    struct lnx_mem_desc *desc, struct local_prov_ep **cep,
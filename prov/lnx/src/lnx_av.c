@@ -396,6 +396,7 @@ static int lnx_peer_map_addrs(struct dlist_entry *prov_table,
 
 			dlist_init(&lpm->entry);
 			dlist_insert_tail(&lpm->entry, &lpp->lpp_map);
+			lpp->lpp_rails[lpp->lpp_rail_count++] = lpm;
 
 			lpm->local_ep = lpe;
 			lpm->addr_count = lap->lap_addr_count;
@@ -58,6 +58,9 @@ ssize_t lnx_peer_cq_write(struct fid_peer_cq *cq, void *context, uint64_t flags,
 
 	lnx_cq = container_of(cq, struct lnx_peer_cq, lpc_cq);
 
+	if (flags & FI_SEND)
+		lnx_tx_done(container_of(lnx_cq, struct local_prov_ep, lpe_cq));
+
 	rc = ofi_cq_write(&lnx_cq->lpc_shared_cq->util_cq, context,
 			  flags, len, buf, data, tag);
 
@@ -72,6 +75,12 @@ ssize_t lnx_peer_cq_writeerr(struct fid_peer_cq *cq,
 
 	lnx_cq = container_of(cq, struct lnx_peer_cq, lpc_cq);
 
+	/* not every core provider sets the op flags on an error, so
+	 * anything which isn't known to be a receive ends a send
+	 */
+	if (!(err_entry->flags & (FI_RECV | FI_REMOTE_READ | FI_REMOTE_WRITE)))
+		lnx_tx_done(container_of(lnx_cq, struct local_prov_ep, lpe_cq));
+
 	rc = ofi_cq_write_error(&lnx_cq->lpc_shared_cq->util_cq, err_entry);
 
 	return rc;
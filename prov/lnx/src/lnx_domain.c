@@ -126,8 +126,9 @@ lnx_mr_regattrs_all(struct local_prov *prov, const struct fi_mr_attr *attr,
 	 */
 	dlist_foreach_container(&prov->lpv_prov_eps,
 				struct local_prov_ep, ep, entry) {
+		desc->rail_mr[ep->lpe_idx] = NULL;
 		rc = fi_mr_regattr(ep->lpe_domain, attr,
-				flags, &desc->core_mr);
+				flags, &desc->rail_mr[ep->lpe_idx]);
 
 		/* TODO: SHM provider returns FI_ENOKEY if requested_key is the
 		 * same as the previous call. Application, like OMPI, might not
@@ -143,10 +144,15 @@ lnx_mr_regattrs_all(struct local_prov *prov, const struct fi_mr_attr *attr,
 		if (rc) {
 			FI_WARN(&lnx_prov, FI_LOG_CORE, "%s mr_regattr() failed: %d\n",
 				ep->lpe_fabric_name, rc);
+			/* rails registered so far are closed by the caller */
+			desc->rail_mr[ep->lpe_idx] = NULL;
 			return rc;
 		}
 	}
 
+	/* the key we hand out is the one of the primary rail */
+	desc->core_mr = desc->rail_mr[0];
+
 	return rc;
 }
 
@@ -154,18 +160,32 @@ static int
 lnx_mr_close_all(struct lnx_mem_desc *mem_desc)
 {
 	int i, rc, frc = 0;
+	struct local_prov_ep *ep;
+	struct lnx_mem_desc_prov *desc;
 	struct fid_mr *mr;
 
+	/* Keyed on the rail registrations rather than core_mr, so that this
+	 * also cleans up after a partially failed registration.
+	 */
 	for (i = 0; i < mem_desc->desc_count; i++) {
-		mr = mem_desc->desc[i].core_mr;
-		if (!mr)
+		desc = &mem_desc->desc[i];
+		if (!desc->prov)
 			continue;
-		rc = fi_close(&mr->fid);
-		if (rc) {
-			FI_WARN(&lnx_prov, FI_LOG_CORE, "%s mr_close() failed: %d\n",
-					mem_desc->desc[i].prov->lpv_prov_name, rc);
-			frc = rc;
+		dlist_foreach_container(&desc->prov->lpv_prov_eps,
+					struct local_prov_ep, ep, entry) {
+			mr = desc->rail_mr[ep->lpe_idx];
+			if (!mr)
+				continue;
+			rc = fi_close(&mr->fid);
+			if (rc) {
+				FI_WARN(&lnx_prov, FI_LOG_CORE,
+					"%s mr_close() failed: %d\n",
+					desc->prov->lpv_prov_name, rc);
+				frc = rc;
+			}
+			desc->rail_mr[ep->lpe_idx] = NULL;
 		}
+		desc->core_mr = NULL;
 	}
 
 	return frc;
@@ -215,6 +235,7 @@ static int lnx_mr_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 			continue;
 		dlist_foreach_container(&desc->prov->lpv_prov_eps,
 					struct local_prov_ep, ep, entry) {
+			cmr = desc->rail_mr[ep->lpe_idx];
 			rc = fi_mr_bind(cmr, &ep->lpe_ep->fid, flags);
 			if (rc) {
 				FI_WARN(&lnx_prov, FI_LOG_CORE,
@@ -231,6 +252,7 @@ static int lnx_mr_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 static int lnx_mr_control(struct fid *fid, int command, void *arg)
 {
 	int i, rc, frc = 0;
+	struct local_prov_ep *ep;
 	struct fid_mr *mr, *cmr;
 	struct lnx_mem_desc *mem_desc;
 	struct lnx_mem_desc_prov *desc;
@@ -247,14 +269,18 @@ static int lnx_mr_control(struct fid *fid, int command, void *arg)
 	 */
 	for (i = 0; i < mem_desc->desc_count; i++) {
 		desc = &mem_desc->desc[i];
-		cmr = desc->core_mr;
-		if (!cmr)
+		if (!desc->core_mr)
 			continue;
-		rc = fi_mr_enable(cmr);
-		if (rc) {
-			FI_WARN(&lnx_prov, FI_LOG_CORE, "%s lnx_mr_control() failed: %d\n",
-				mem_desc->desc[i].prov->lpv_prov_name, rc);
-			frc = rc;
+		dlist_foreach_container(&desc->prov->lpv_prov_eps,
+					struct local_prov_ep, ep, entry) {
+			cmr = desc->rail_mr[ep->lpe_idx];
+			rc = fi_mr_enable(cmr);
+			if (rc) {
+				FI_WARN(&lnx_prov, FI_LOG_CORE,
+					"%s lnx_mr_control() failed: %d\n",
+					mem_desc->desc[i].prov->lpv_prov_name, rc);
+				frc = rc;
+			}
 		}
 	}
 
@@ -318,6 +344,7 @@ lnx_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
 
 	mr = &lnx_mr->mr;
 	mem_desc = &lnx_mr->desc;
+	memset(mem_desc, 0, sizeof(*mem_desc));
 
 	mr->mr_fid.fid.fclass = FI_CLASS_MR;
 	mr->mr_fid.fid.context = attr->context;
@@ -371,8 +398,11 @@ lnx_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
 	return 0;
 
 fail:
-	if (lnx_mr)
+	if (lnx_mr) {
+		mem_desc->desc_count = LNX_MAX_LOCAL_EPS;
+		(void) lnx_mr_close_all(mem_desc);
 		ofi_buf_free(lnx_mr);
+	}
 	return rc;
 }
 
@@ -330,11 +330,13 @@ int lnx_getname(fid_t fid, void *addr, size_t *addrlen)
 		memcpy(lap->lap_prov, entry->lpv_prov_name, FI_NAME_MAX - 1);
 		lap->lap_addr_count = entry->lpv_ep_count;
 		lap->lap_addr_size = addrlen_list[j];
+		tmp = (char*)lap + sizeof(*lap);
 
+		/* the addresses are in the same order as the endpoints,
+		 * which is what the peer uses to pair up the rails
+		 */
 		dlist_foreach_container(&entry->lpv_prov_eps,
 			struct local_prov_ep, ep, entry) {
-			tmp = (char*)lap + sizeof(*lap);
-
 			rc = fi_getname(&ep->lpe_ep->fid, (void*)tmp, &addrlen_list[j]);
 			if (rc)
 				return rc;
@@ -574,12 +576,15 @@ static int lnx_open_eps(struct local_prov *prov, struct fi_info *info,
 	struct ofi_bufpool_attr bp_attrs = {};
 	struct lnx_srx_context *ctxt;
 
-	ctxt = calloc(1, sizeof(*ctxt));
-	if (!ctxt)
-		return -FI_ENOMEM;
-
 	dlist_foreach_container_safe(&prov->lpv_prov_eps,
 		struct local_prov_ep, ep, entry, tmp) {
+		/* each core endpoint needs its own context, since it tells
+		 * us which endpoint a message arrived on
+		 */
+		ctxt = calloc(1, sizeof(*ctxt));
+		if (!ctxt)
+			return -FI_ENOMEM;
+
 		if (fclass == FI_CLASS_EP) {
 			rc = fi_endpoint(ep->lpe_domain, ep->lpe_fi_info,
 					 &ep->lpe_ep, context);
@@ -604,8 +609,10 @@ static int lnx_open_eps(struct local_prov *prov, struct fi_info *info,
 			rc = fi_scalable_ep(ep->lpe_domain, ep->lpe_fi_info,
 					    &ep->lpe_ep, context);
 		}
-		if (rc)
+		if (rc) {
+			free(ctxt);
 			return rc;
+		}
 
 		ctxt->srx_lep = lep;
 		ctxt->srx_cep = ep;
@@ -649,7 +656,8 @@ lnx_addr_match(fi_addr_t addr1, fi_addr_t addr2)
 }
 
 static inline bool
-lnx_search_addr_match(fi_addr_t cep_addr, struct lnx_peer_prov *lpp)
+lnx_search_addr_match(fi_addr_t cep_addr, struct lnx_peer_prov *lpp,
+		      struct local_prov_ep *cep)
 {
 	struct lnx_local2peer_map *lpm;
 	fi_addr_t peer_addr;
@@ -658,6 +666,11 @@ lnx_search_addr_match(fi_addr_t cep_addr, struct lnx_peer_prov *lpp)
 	dlist_foreach_container(&lpp->lpp_map,
 				struct lnx_local2peer_map,
 				lpm, entry) {
+		/* cep_addr is only meaningful in the AV of the endpoint
+		 * the message arrived on
+		 */
+		if (lpm->local_ep != cep)
+			continue;
 		for (i = 0; i < LNX_MAX_LOCAL_EPS; i++) {
 			peer_addr = lpm->peer_addrs[i];
 			if (peer_addr == FI_ADDR_NOTAVAIL)
@@ -712,7 +725,7 @@ static int lnx_match_common(uint64_t tag1, uint64_t tag2, uint64_t ignore,
 	 * shm provider
 	 */
 	if (cep->lpe_local)
-		return lnx_search_addr_match(cep_addr, peer->lp_shm_prov);
+		return lnx_search_addr_match(cep_addr, peer->lp_shm_prov, cep);
 
 	/* check if we already have a peer provider.
 	 * A peer can receive messages from multiple providers, we need to
@@ -734,7 +747,7 @@ static int lnx_match_common(uint64_t tag1, uint64_t tag2, uint64_t ignore,
 	dlist_foreach_container(&peer->lp_provs,
 			struct lnx_peer_prov, lpp, entry) {
 		if (lpp->lpp_prov == lp)
-			return lnx_search_addr_match(cep_addr, lpp);
+			return lnx_search_addr_match(cep_addr, lpp, cep);
 	}
 
 	return false;
@@ -1111,6 +1124,8 @@ lnx_alloc_endpoint(struct fid_domain *domain, struct fi_info *info,
 	ep->le_ep.ep_fid.atomic = &lnx_atomic_ops;
 	ep->le_domain = container_of(domain, struct lnx_domain,
 				     ld_domain.domain_fid);
+	ep->le_tx_ordered = !info || !info->tx_attr ||
+			    (info->tx_attr->msg_order & FI_ORDER_SAS);
 	lnx_init_srq(&ep->le_srq);
 
 	dlist_init(&ep->le_rx_ctx);
@@ -59,6 +59,7 @@
 
 ofi_spin_t global_bplock;
 struct ofi_bufpool *global_recv_bp = NULL;
+enum lnx_rail_policy lnx_rail_policy = LNX_RAIL_LEAST_PENDING;
 
 struct util_fabric lnx_fabric_info;
 
@@ -549,6 +550,26 @@ int lnx_getinfo_helper(uint32_t version, char *prov, struct fi_info *lnx_hints)
 	return rc;
 }
 
+/* Only report the message ordering that the application asked for. Send
+ * after send ordering keeps all the messages to a peer on one rail, so it
+ * shouldn't be forced on applications which don't need it.
+ */
+static void lnx_trim_msg_order(struct fi_info *info,
+			       const struct fi_info *hints)
+{
+	struct fi_info *itr;
+
+	if (!hints || lnx_rail_policy == LNX_RAIL_SINGLE)
+		return;
+
+	for (itr = info; itr; itr = itr->next) {
+		if (itr->tx_attr && hints->tx_attr)
+			itr->tx_attr->msg_order &= hints->tx_attr->msg_order;
+		if (itr->rx_attr && hints->rx_attr)
+			itr->rx_attr->msg_order &= hints->rx_attr->msg_order;
+	}
+}
+
 int lnx_getinfo(uint32_t version, const char *node, const char *service,
 		uint64_t flags, const struct fi_info *hints,
 		struct fi_info **info)
@@ -609,6 +630,8 @@ int lnx_getinfo(uint32_t version, const char *node, const char *service,
 	 * of domains which are to be linked.
 	 */
 	rc = lnx_generate_info(info);
+	if (!rc)
+		lnx_trim_msg_order(*info, hints);
 
 free_hints:
 	free(exclude);
@@ -634,8 +657,13 @@ lnx_get_local_prov(struct dlist_entry *prov_table, char *prov_name)
 static int
 lnx_add_ep_to_prov(struct local_prov *prov, struct local_prov_ep *ep)
 {
+	if (prov->lpv_ep_count >= LNX_MAX_LOCAL_EPS)
+		return -FI_ENOSPC;
+
 	dlist_insert_tail(&ep->entry, &prov->lpv_prov_eps);
 	ep->lpe_parent = prov;
+	ep->lpe_idx = prov->lpv_ep_count;
+	ofi_atomic_initialize32(&ep->lpe_tx_pending, 0);
 	prov->lpv_ep_count++;
 
 	return FI_SUCCESS;
@@ -648,6 +676,7 @@ lnx_setup_core_prov(struct fi_info *info, struct dlist_entry *prov_table,
 	int rc = -FI_EINVAL;
 	struct local_prov_ep *ep = NULL;
 	struct local_prov *lprov, *new_lprov = NULL;
+	bool new_prov = false;
 
 	ep = calloc(sizeof(*ep), 1);
 	if (!ep)
@@ -671,6 +700,7 @@ lnx_setup_core_prov(struct fi_info *info, struct dlist_entry *prov_table,
 	if (!lprov) {
 		lprov = new_lprov;
 		new_lprov = NULL;
+		new_prov = true;
 		strncpy(lprov->lpv_prov_name, info->fabric_attr->prov_name,
 				FI_NAME_MAX - 1);
 	} else {
@@ -688,7 +718,9 @@ lnx_setup_core_prov(struct fi_info *info, struct dlist_entry *prov_table,
 	if (rc)
 		goto free_all;
 
-	dlist_insert_after(&lprov->lpv_entry, prov_table);
+	/* a provider linked multiple times is only in the table once */
+	if (new_prov)
+		dlist_insert_after(&lprov->lpv_entry, prov_table);
 
 	return 0;
 
@@ -845,6 +877,25 @@ void ofi_link_fini(void)
 	lnx_prov.cleanup();
 }
 
+static void lnx_init_rail_policy(void)
+{
+	char *policy = NULL;
+
+	fi_param_get_str(&lnx_prov, "rail_policy", &policy);
+	if (!policy)
+		return;
+
+	if (!strcasecmp(policy, "single"))
+		lnx_rail_policy = LNX_RAIL_SINGLE;
+	else if (!strcasecmp(policy, "round_robin"))
+		lnx_rail_policy = LNX_RAIL_ROUND_ROBIN;
+	else if (!strcasecmp(policy, "least_pending"))
+		lnx_rail_policy = LNX_RAIL_LEAST_PENDING;
+	else
+		FI_WARN(&lnx_prov, FI_LOG_CORE,
+			"Unknown rail policy %s, using the default\n", policy);
+}
+
 LNX_INI
 {
 	struct ofi_bufpool_attr bp_attrs = {};
@@ -862,6 +913,14 @@ LNX_INI
 			"When SRQ is turned on some Hardware offload capability will not "
 			"work. EX: Hardware Tag matching");
 
+	fi_param_define(&lnx_prov, "rail_policy", FI_PARAM_STRING,
+			"Specify how tagged messages to a remote peer are spread "
+			"across the endpoints of a provider which is linked "
+			"multiple times. Options: single, round_robin, "
+			"least_pending. Default: least_pending");
+
+	lnx_init_rail_policy();
+
 	dlist_init(&lnx_fi_info_cache);
 	dlist_init(&lnx_links);
 	dlist_init(&lnx_links_meta);
@@ -564,8 +564,8 @@ ssize_t lnx_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, dest_addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain, desc, &cep,
-				     &core_addr, &iov, 1, &mre, &mem_desc, NULL);
+	rc = lnx_select_tx_pathway(lep, lp, desc, &cep,
+				     &core_addr, &iov, 1, &mre, &mem_desc);
 	if (rc)
 		return rc;
 
@@ -574,6 +574,8 @@ ssize_t lnx_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	       core_addr, tag, buf, len);
 
 	rc = fi_tsend(cep->lpe_ep, buf, len, mem_desc, core_addr, tag, context);
+	if (!rc)
+		lnx_tx_posted(cep, lep->le_ep.tx_op_flags);
 
 	if (mre)
 		ofi_mr_cache_delete(&lep->le_domain->ld_mr_cache, mre);
@@ -600,8 +602,8 @@ ssize_t lnx_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, dest_addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain, (desc) ? *desc : NULL, &cep,
-				&core_addr, iov, count, &mre, &mem_desc, NULL);
+	rc = lnx_select_tx_pathway(lep, lp, (desc) ? *desc : NULL, &cep,
+				&core_addr, iov, count, &mre, &mem_desc);
 	if (rc)
 		return rc;
 
@@ -609,6 +611,8 @@ ssize_t lnx_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	       "sending to %lx tag %lx\n", core_addr, tag);
 
 	rc = fi_tsendv(cep->lpe_ep, iov, &mem_desc, count, core_addr, tag, context);
+	if (!rc)
+		lnx_tx_posted(cep, lep->le_ep.tx_op_flags);
 
 	if (mre)
 		ofi_mr_cache_delete(&lep->le_domain->ld_mr_cache, mre);
@@ -636,10 +640,9 @@ ssize_t lnx_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, msg->addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain,
-				(msg->desc) ? *msg->desc : NULL, &cep,
+	rc = lnx_select_tx_pathway(lep, lp, (msg->desc) ? *msg->desc : NULL, &cep,
 				&core_addr, msg->msg_iov,
-				msg->iov_count, &mre, &mem_desc, NULL);
+				msg->iov_count, &mre, &mem_desc);
 	if (rc)
 		return rc;
 
@@ -652,6 +655,8 @@ ssize_t lnx_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	       "sending to %lx tag %lx\n", core_msg.addr, core_msg.tag);
 
 	rc = fi_tsendmsg(cep->lpe_ep, &core_msg, flags);
+	if (!rc)
+		lnx_tx_posted(cep, flags | lep->le_ep.tx_msg_flags);
 
 	if (mre)
 		ofi_mr_cache_delete(&lep->le_domain->ld_mr_cache, mre);
@@ -677,8 +682,8 @@ ssize_t lnx_tinject(struct fid_ep *ep, const void *buf, size_t len,
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, dest_addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain, NULL, &cep,
-				&core_addr, NULL, 0, &mre, NULL, NULL);
+	rc = lnx_select_tx_pathway(lep, lp, NULL, &cep,
+				&core_addr, NULL, 0, &mre, NULL);
 	if (rc)
 		return rc;
 
@@ -714,8 +719,8 @@ ssize_t lnx_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, dest_addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain, desc, &cep,
-				&core_addr, &iov, 1, &mre, &mem_desc, NULL);
+	rc = lnx_select_tx_pathway(lep, lp, desc, &cep,
+				&core_addr, &iov, 1, &mre, &mem_desc);
 	if (rc)
 		return rc;
 
@@ -725,6 +730,8 @@ ssize_t lnx_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc
 
 	rc = fi_tsenddata(cep->lpe_ep, buf, len, mem_desc,
 			  data, core_addr, tag, context);
+	if (!rc)
+		lnx_tx_posted(cep, lep->le_ep.tx_op_flags);
 
 	if (mre)
 		ofi_mr_cache_delete(&lep->le_domain->ld_mr_cache, mre);
@@ -750,8 +757,8 @@ ssize_t lnx_tinjectdata(struct fid_ep *ep, const void *buf, size_t len,
 	peer_tbl = lep->le_peer_tbl;
 
 	lp = lnx_av_lookup_addr(peer_tbl, dest_addr);
-	rc = lnx_select_send_pathway(lp, lep->le_domain, NULL, &cep,
-				     &core_addr, NULL, 0, &mre, NULL, NULL);
+	rc = lnx_select_tx_pathway(lep, lp, NULL, &cep,
+				     &core_addr, NULL, 0, &mre, NULL);
 	if (rc)
 		return rc;
 
@@ -79,9 +79,14 @@ extern size_t mrail_num_info;
 enum {
 	MRAIL_POLICY_FIXED,
 	MRAIL_POLICY_ROUND_ROBIN,
-	MRAIL_POLICY_STRIPING
+	MRAIL_POLICY_STRIPING,
+	MRAIL_POLICY_ADAPTIVE
 };
 
+/* Transfers at least this large are used to measure rail bandwidth.
+ * Smaller ones are dominated by latency. */
+#define MRAIL_BW_SAMPLE_MIN		(64 * 1024)
+
 #define MRAIL_MAX_CONFIG		8
 
 struct mrail_config {
@@ -178,6 +183,9 @@ struct mrail_tx_buf {
 	struct mrail_rndv_hdr	rndv_hdr;
 	struct mrail_rndv_req	*rndv_req;
 	fid_t			rndv_mr_fid;
+	uint32_t		rail;
+	size_t			len;
+	uint64_t		start;
 };
 
 struct mrail_pkt {
@@ -270,6 +278,12 @@ struct mrail_ep {
 	struct {
 		struct fid_ep 		*ep;
 		struct fi_info		*info;
+		/* bytes posted on the rail which haven't completed yet */
+		ofi_atomic64_t		pending;
+		/* bytes per usec measured from the completion latency of
+		 * large transfers, 0 until the first sample */
+		uint64_t		bw;
+		uint64_t		last_done;
 	}			*rails;
 	size_t			num_eps;
 	ofi_atomic32_t		tx_rail;
@@ -377,17 +391,92 @@ static inline int mrail_get_policy(size_t size)
 	return mrail_config[i].policy;
 }
 
-static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy)
+static inline bool mrail_rails_measured(struct mrail_ep *mrail_ep)
+{
+	size_t i;
+
+	for (i = 0; i < mrail_ep->num_eps; i++)
+		if (!mrail_ep->rails[i].bw)
+			return false;
+	return true;
+}
+
+/* Pick the rail which is expected to drain len more bytes first, based
+ * on the bytes already queued on each rail and its measured bandwidth.
+ * Until every rail has been measured, the rails are treated as equal. */
+static inline size_t
+mrail_get_tx_rail_adaptive(struct mrail_ep *mrail_ep, size_t len)
+{
+	bool measured = mrail_rails_measured(mrail_ep);
+	uint64_t load, best_load = 0, bw, best_bw = 1;
+	size_t i, rail, best;
+
+	/* rotate the starting rail so that ties are spread */
+	best = rail = mrail_get_tx_rail_rr(mrail_ep);
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		rail = (best + i) % mrail_ep->num_eps;
+		load = MAX(ofi_atomic_get64(&mrail_ep->rails[rail].pending), 0) +
+		       len;
+		bw = measured ? mrail_ep->rails[rail].bw : 1;
+		if (!i || load * best_bw < best_load * bw) {
+			best_load = load;
+			best_bw = bw;
+			best = rail;
+		}
+	}
+	return best;
+}
+
+static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy,
+				       size_t len)
+{
+	switch (policy) {
+	case MRAIL_POLICY_FIXED:
+		return mrail_ep->default_tx_rail;
+	case MRAIL_POLICY_ADAPTIVE:
+		return mrail_get_tx_rail_adaptive(mrail_ep, len);
+	default:
+		return mrail_get_tx_rail_rr(mrail_ep);
+	}
+}
+
+/* Account for len bytes posted on a rail. Returns the time stamp to pass
+ * to mrail_rail_done() if the transfer is large enough to be used as a
+ * bandwidth sample, 0 otherwise. */
+static inline uint64_t
+mrail_rail_posted(struct mrail_ep *mrail_ep, uint32_t rail, size_t len)
 {
-	return policy == MRAIL_POLICY_FIXED ?
-				mrail_ep->default_tx_rail :
-				mrail_get_tx_rail_rr(mrail_ep);
+	ofi_atomic_add64(&mrail_ep->rails[rail].pending, len);
+	return len >= MRAIL_BW_SAMPLE_MIN ? ofi_gettime_ns() : 0;
+}
+
+static inline void
+mrail_rail_done(struct mrail_ep *mrail_ep, uint32_t rail, size_t len,
+		uint64_t start)
+{
+	uint64_t now, sample, bw;
+
+	ofi_atomic_sub64(&mrail_ep->rails[rail].pending, len);
+	if (!start)
+		return;
+
+	/* Only count the time the transfer wasn't queued behind the
+	 * previous one on the same rail */
+	now = ofi_gettime_ns();
+	start = MAX(start, mrail_ep->rails[rail].last_done);
+	mrail_ep->rails[rail].last_done = now;
 
+	sample = len * 1000 / MAX(now - start, 1);
+	bw = mrail_ep->rails[rail].bw;
+	mrail_ep->rails[rail].bw = bw ? (bw * 7 + sample) / 8 : MAX(sample, 1);
 }
 
 struct mrail_subreq {
 	struct fi_context context;
 	struct mrail_req *parent;
+	uint32_t rail;
+	size_t len;
+	uint64_t start;
 	void *descs[MRAIL_IOV_LIMIT];
 	struct iovec iov[MRAIL_IOV_LIMIT];
 	struct fi_rma_iov rma_iov[MRAIL_IOV_LIMIT];
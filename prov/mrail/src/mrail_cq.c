@@ -518,6 +518,9 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 	subreq = comp->op_context;
 	req = subreq->parent;
 
+	mrail_rail_done(req->mrail_ep, subreq->rail, subreq->len,
+			subreq->start);
+
 	if (ofi_atomic_dec32(&req->expected_subcomps) == 0) {
 		if (req->comp.flags & MRAIL_RNDV_FLAG) {
 			mrail_finish_rndv_recv(cq, req, comp);
@@ -578,6 +581,8 @@ void mrail_poll_cq(struct util_cq *cq)
 			mrail_handle_rma_completion(cq, &comp);
 		} else if (comp.flags & FI_SEND) {
 			tx_buf = comp.op_context;
+			mrail_rail_done(tx_buf->ep, tx_buf->rail, tx_buf->len,
+					tx_buf->start);
 			if (tx_buf->hdr.protocol == MRAIL_PROTO_RNDV) {
 				if (tx_buf->hdr.protocol_cmd == MRAIL_RNDV_REQ) {
 					/* buf will be freed when ACK comes */
@@ -350,7 +350,7 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 	struct mrail_tx_buf *tx_buf;
 	size_t rndv_pkt_size = sizeof(tx_buf->hdr) + sizeof(tx_buf->rndv_hdr);
 	int policy = mrail_get_policy(rndv_pkt_size);
-	uint32_t i = mrail_get_tx_rail(mrail_ep, policy);
+	uint32_t i = mrail_get_tx_rail(mrail_ep, policy, rndv_pkt_size);
 	struct fi_msg msg;
 	ssize_t ret;
 	uint64_t flags = FI_COMPLETION;
@@ -380,6 +380,10 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting rdnv ack "
 	       " dest_addr: 0x%" PRIx64 " on rail: %d\n", dest_addr, i);
 
+	tx_buf->rail = i;
+	tx_buf->len = rndv_pkt_size;
+	tx_buf->start = mrail_rail_posted(mrail_ep, i, rndv_pkt_size);
+
 	do {
 		ret = fi_sendmsg(mrail_ep->rails[i].ep, &msg, flags);
 		if (ret == -FI_EAGAIN) {
@@ -393,6 +397,7 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 	if (ret) {
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", i);
+		ofi_atomic_sub64(&mrail_ep->rails[i].pending, rndv_pkt_size);
 		ofi_buf_free(tx_buf);
 	}
 
@@ -488,7 +493,7 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	struct iovec *iov_dest = alloca(sizeof(*iov_dest) * (count + 1));
 	struct mrail_tx_buf *tx_buf;
 	int policy = mrail_get_policy(len);
-	uint32_t rail = mrail_get_tx_rail(mrail_ep, policy);
+	uint32_t rail = mrail_get_tx_rail(mrail_ep, policy, len);
 	struct fi_msg msg;
 	ssize_t ret;
 	size_t total_len;
@@ -538,10 +543,15 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	       " dest_addr: 0x%" PRIx64 " tag: 0x%" PRIx64 " seq: %d"
 	       " on rail: %d\n", len, dest_addr, tag, peer_info->seq_no - 1, rail);
 
+	tx_buf->rail = rail;
+	tx_buf->len = total_len;
+	tx_buf->start = mrail_rail_posted(mrail_ep, rail, total_len);
+
 	ret = fi_sendmsg(mrail_ep->rails[rail].ep, &msg, flags | FI_COMPLETION);
 	if (ret) {
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", rail);
+		ofi_atomic_sub64(&mrail_ep->rails[rail].pending, total_len);
 		goto err2;
 	} else if (!(flags & FI_COMPLETION)) {
 		ofi_ep_cntr_inc(&mrail_ep->util_ep, CNTR_TX);
@@ -1047,6 +1057,9 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 				      mrail_get_unexp_msg_entry);
 	}
 
+	for (i = 0; i < mrail_ep->num_eps; i++)
+		ofi_atomic_initialize64(&mrail_ep->rails[i].pending, 0);
+
 	ofi_atomic_initialize32(&mrail_ep->tx_rail, 0);
 	ofi_atomic_initialize32(&mrail_ep->rx_rail, 0);
 	mrail_ep->default_tx_rail = mrail_local_rank % mrail_ep->num_eps;
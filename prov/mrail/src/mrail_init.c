@@ -68,7 +68,7 @@ static int mrail_parse_env_vars(void)
 	fi_param_define(&mrail_prov, "config", FI_PARAM_STRING,
 			"Comma separated list of '<max_size>:<policy>' pairs, "
 			"with <max_size> in ascending order and <policy> being "
-			"fixed, round-robin, or striping");
+			"fixed, round-robin, adaptive, or striping");
 	ret = fi_param_get_str(&mrail_prov, "config", &str);
 	if (!ret) {
 		for (i = 0; i < MRAIL_MAX_CONFIG; i++) {
@@ -90,6 +90,8 @@ static int mrail_parse_env_vars(void)
 				/* use the default */
 			} else if (!strcasecmp(alg, "round-robin")) {
 				mrail_config[i].policy = MRAIL_POLICY_ROUND_ROBIN;
+			} else if (!strcasecmp(alg, "adaptive")) {
+				mrail_config[i].policy = MRAIL_POLICY_ADAPTIVE;
 			} else if (!strcasecmp(alg, "striping")) {
 				mrail_config[i].policy = MRAIL_POLICY_STRIPING;
 			} else {
@@ -103,27 +103,41 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 
 static ssize_t mrail_post_req(struct mrail_req *req)
 {
+	struct mrail_ep *mrail_ep = req->mrail_ep;
+	struct mrail_subreq *subreq;
 	size_t i;
-	uint32_t rail;
+	uint32_t rail, home;
 	ssize_t ret = 0;
 
 	while (req->pending_subreq >= 0) {
-		/* Try all rails before giving up */
-		for (i = 0; i < req->mrail_ep->num_eps; ++i) {
-			rail = mrail_get_tx_rail_rr(req->mrail_ep);
+		subreq = &req->subreqs[req->pending_subreq];
+		home = subreq->rail;
+
+		/* Start with the rail the chunk was sized for and try all
+		 * rails before giving up */
+		for (i = 0; i < mrail_ep->num_eps; ++i) {
+			rail = (home + i) % mrail_ep->num_eps;
+
+			subreq->rail = rail;
+			subreq->start = mrail_rail_posted(mrail_ep, rail,
+							  subreq->len);
+			ret = mrail_post_subreq(rail, subreq);
+			if (!ret)
+				break;
 
-			ret = mrail_post_subreq(rail,
-					&req->subreqs[req->pending_subreq]);
+			ofi_atomic_sub64(&mrail_ep->rails[rail].pending,
+					 subreq->len);
 			if (ret != -FI_EAGAIN) {
 				break;
 			} else {
 				/* One of the rails is busy. Try progressing. */
-				mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+				mrail_poll_cq(mrail_ep->util_ep.tx_cq);
 			}
 		}
 
 		if (ret != 0) {
 			if (ret == -FI_EAGAIN) {
+				subreq->rail = home;
 				break;
 			}
 			/* TODO: Handle errors besides FI_EAGAIN */
@@ -180,6 +194,83 @@ void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep)
 	}
 }
 
+/* Size the chunk of each rail so that all rails are expected to finish at
+ * the same time, given the bytes already queued on them and their measured
+ * bandwidth:
+ *
+ *   (pending[r] + len[r]) / bw[r] = T  for every rail that gets a chunk
+ *
+ * Rails whose queue alone takes longer than T get nothing. Until every rail
+ * has been measured the rails are assumed to be equally fast. A slow rail
+ * is weighted no less than 1/8th of the fastest one so that it keeps being
+ * sampled.
+ */
+static void mrail_get_stripe_lens(struct mrail_ep *mrail_ep, size_t total_len,
+				  size_t *lens)
+{
+	bool measured = mrail_rails_measured(mrail_ep);
+	uint64_t *bw = alloca(sizeof(*bw) * mrail_ep->num_eps);
+	int64_t *pending = alloca(sizeof(*pending) * mrail_ep->num_eps);
+	bool *active = alloca(sizeof(*active) * mrail_ep->num_eps);
+	uint64_t max_bw = 1, sum_bw;
+	size_t i, assigned, longest;
+	double load, t;
+	bool changed;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		bw[i] = measured ? mrail_ep->rails[i].bw : 1;
+		max_bw = MAX(max_bw, bw[i]);
+	}
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		bw[i] = MAX(bw[i], MAX(max_bw / 8, 1));
+		pending[i] = MAX(ofi_atomic_get64(&mrail_ep->rails[i].pending),
+				 0);
+		active[i] = true;
+		lens[i] = 0;
+	}
+
+	if (!total_len)
+		return;
+
+	/* At least one rail always remains active since the chunks of the
+	 * active rails add up to total_len */
+	do {
+		load = (double) total_len;
+		sum_bw = 0;
+		for (i = 0; i < mrail_ep->num_eps; i++) {
+			if (!active[i])
+				continue;
+			load += pending[i];
+			sum_bw += bw[i];
+		}
+		t = load / sum_bw;
+
+		changed = false;
+		for (i = 0; i < mrail_ep->num_eps; i++) {
+			if (active[i] && pending[i] >= t * bw[i]) {
+				active[i] = false;
+				changed = true;
+			}
+		}
+	} while (changed);
+
+	assigned = 0;
+	longest = 0;
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (!active[i])
+			continue;
+		lens[i] = MIN((size_t) (t * bw[i] - pending[i]),
+			      total_len - assigned);
+		assigned += lens[i];
+		if (lens[i] > lens[longest])
+			longest = i;
+	}
+
+	/* Rounding leftovers go to the longest chunk */
+	lens[longest] += total_len - assigned;
+}
+
 static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		const struct fi_msg_rma *msg, struct mrail_req *req)
 {
@@ -187,24 +278,27 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 	struct mrail_subreq *subreq;
 	size_t subreq_count;
 	size_t total_len;
-	size_t chunk_len;
-	size_t subreq_len;
+	size_t *subreq_lens;
 	size_t iov_index;
 	size_t iov_offset;
 	size_t rma_iov_index;
 	size_t rma_iov_offset;
+	size_t rail;
 	int i;
 
-	/* For now, stripe across all rails.
-	 * This could be determined by a dynamic scheduler instead.
-	 */
-	subreq_count = mrail_ep->num_eps;
+	subreq_lens = alloca(sizeof(*subreq_lens) * mrail_ep->num_eps);
 
-	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count); 
-	chunk_len = total_len / subreq_count;
+	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+	mrail_get_stripe_lens(mrail_ep, total_len, subreq_lens);
+
+	/* Rails that got no data are skipped. A zero-length transfer still
+	 * needs one subreq to generate the completion. */
+	for (subreq_count = 0, rail = 0; rail < mrail_ep->num_eps; rail++) {
+		if (subreq_lens[rail])
+			subreq_count++;
+	}
+	subreq_count = MAX(subreq_count, 1);
 
-	/* The first chunk is the longest */
-	subreq_len =  chunk_len + (total_len % subreq_count);
 	iov_index = 0;
 	iov_offset = 0;
 	rma_iov_index = 0;
@@ -218,16 +312,20 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 	 * track of which subreq to post next, starting at the end of the
 	 * array.
 	 */
-	for (i = (subreq_count - 1); i >= 0; --i) {
+	for (i = (subreq_count - 1), rail = 0; i >= 0; --i, ++rail) {
+		while (total_len && !subreq_lens[rail])
+			rail++;
 		subreq = &req->subreqs[i];
 
 		subreq->parent = req;
+		subreq->rail = rail;
+		subreq->len = subreq_lens[rail];
 
 		ret = ofi_copy_iov_desc(subreq->iov, subreq->descs,
 				&subreq->iov_count,
 				(struct iovec *)msg->msg_iov, msg->desc,
 				msg->iov_count, &iov_index, &iov_offset,
-				subreq_len);
+				subreq->len);
 		if (ret) {
 			goto out;
 		}
@@ -235,13 +333,10 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		ret = ofi_copy_rma_iov(subreq->rma_iov, &subreq->rma_iov_count,
 				(struct fi_rma_iov *)msg->rma_iov,
 				msg->rma_iov_count, &rma_iov_index,
-				&rma_iov_offset, subreq_len);
+				&rma_iov_offset, subreq->len);
 		if (ret) {
 			goto out;
 		}
-
-		/* All the other chunks have the same length */
-		subreq_len = chunk_len;
 	}
 
 	ofi_atomic_initialize32(&req->expected_subcomps, subreq_count);
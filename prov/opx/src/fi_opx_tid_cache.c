@@ -371,6 +371,7 @@ int opx_tid_cache_init(struct util_domain *domain, struct ofi_mem_monitor **moni
 	}
 
 	pthread_mutex_init(&cache->lock, NULL);
+	pthread_rwlock_init(&cache->tree_lock, NULL);
 	dlist_init(&cache->lru_list);
 	dlist_init(&cache->dead_region_list);
 	cache->cached_cnt    = 0;
@@ -406,6 +407,7 @@ del:
 destroy:
 	ofi_rbmap_cleanup(&cache->tree);
 	ofi_atomic_dec32(&cache->domain->ref);
+	pthread_rwlock_destroy(&cache->tree_lock);
 	pthread_mutex_destroy(&cache->lock);
 	cache->domain = NULL;
 	return ret;
@@ -1776,6 +1778,7 @@ void opx_tid_cache_cleanup(struct ofi_mr_cache *cache)
 	/* Try forcing it (fini abnormal exit) for all eps (NULL) */
 	opx_tid_cache_purge_ep(cache, NULL);
 
+	pthread_rwlock_destroy(&cache->tree_lock);
 	pthread_mutex_destroy(&cache->lock);
 	ofi_monitors_del_cache(cache);
 	ofi_rbmap_cleanup(&cache->tree);
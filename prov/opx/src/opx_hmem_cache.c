@@ -209,6 +209,7 @@ int opx_hmem_cache_init(struct util_domain *domain, struct ofi_mem_monitor **mon
 	}
 
 	pthread_mutex_init(&cache->lock, NULL);
+	pthread_rwlock_init(&cache->tree_lock, NULL);
 	dlist_init(&cache->lru_list);
 	dlist_init(&cache->dead_region_list);
 	cache->cached_cnt      = 0;
@@ -248,6 +249,7 @@ destroy:
 	OPX_TRACER_TRACE(OPX_TRACER_END_ERROR, "GDRCOPY-CACHE-INIT");
 	ofi_rbmap_cleanup(&cache->tree);
 	ofi_atomic_dec32(&cache->domain->ref);
+	pthread_rwlock_destroy(&cache->tree_lock);
 	pthread_mutex_destroy(&cache->lock);
 	cache->domain = NULL;
 	cache->prov   = NULL;
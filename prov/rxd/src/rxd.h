@@ -60,7 +60,7 @@
 #ifndef _RXD_H_
 #define _RXD_H_
 
-#define RXD_PROTOCOL_VERSION 	(2)
+#define RXD_PROTOCOL_VERSION 	(3)
 
 #define RXD_MAX_MTU_SIZE	4096
 
@@ -76,6 +76,17 @@
 
 #define RXD_PKT_IN_USE		(1 << 0)
 #define RXD_PKT_ACKED		(1 << 1)
+#define RXD_PKT_SACKED		(1 << 2)
+#define RXD_PKT_RETRANS		(1 << 3)
+
+/*
+ * Retransmit timeout bounds in usec.  The RTO is derived from the measured
+ * round trip time (RFC 6298) and doubled on each unanswered retry.
+ */
+#define RXD_INIT_RTO		1000
+#define RXD_MIN_RTO		200
+#define RXD_MAX_RTO		4000000
+#define RXD_DUP_ACK_THRESH	3
 
 #define RXD_REMOTE_CQ_DATA	(1 << 0)
 #define RXD_NO_TX_COMP		(1 << 1)
@@ -132,6 +143,11 @@ struct rxd_peer {
 	uint16_t tx_window;
 	int retry_cnt;
 
+	uint32_t srtt;
+	uint32_t rttvar;
+	uint32_t rto;
+	uint8_t dup_acks;
+
 	uint16_t unacked_cnt;
 	uint8_t active;
 
@@ -193,7 +209,7 @@ struct rxd_ep {
 	size_t rx_prefix_size;
 	size_t min_multi_recv_size;
 	int do_local_mr;
-	int next_retry;
+	int next_retry;	/* msec until the next retransmit check */
 	int dg_cq_fd;
 	uint32_t tx_flags;
 	uint32_t rx_flags;
@@ -474,8 +490,8 @@ struct rxd_x_entry *rxd_rx_entry_init(struct rxd_ep *ep,
 			uint32_t op, uint32_t flags);
 void rxd_tx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *tx_entry);
 void rxd_rx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *rx_entry);
-int rxd_get_timeout(int retry_cnt);
-uint64_t rxd_get_retry_time(uint64_t start, int retry_cnt);
+void rxd_update_rtt(struct rxd_peer *peer, uint64_t sample);
+uint64_t rxd_get_rto(struct rxd_peer *peer);
 
 /* Generic message functions */
 ssize_t rxd_ep_generic_recvmsg(struct rxd_ep *rxd_ep, const struct iovec *iov,
@@ -897,6 +897,50 @@ static struct rxd_x_entry *rxd_get_data_x_entry(struct rxd_ep *ep,
 	return ofi_bufpool_get_ibuf(ep->tx_entry_pool.pool, data_pkt->ext_hdr.tx_id);
 }
 
+/*
+ * Hold an out of order packet until the gap before it is filled.  Only
+ * packets that can be reported in a selective ack are kept.
+ */
+static int rxd_buffer_pkt(struct rxd_peer *peer,
+			  struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_pkt_entry *buf_entry;
+	uint64_t seq_no = rxd_get_base_hdr(pkt_entry)->seq_no;
+	uint64_t buf_seq_no;
+
+	if (!ofi_before(peer->rx_seq_no, seq_no) ||
+	    !ofi_before(seq_no, peer->rx_seq_no + 1 + RXD_SACK_BITS))
+		return 0;
+
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				buf_entry, d_entry) {
+		buf_seq_no = rxd_get_base_hdr(buf_entry)->seq_no;
+		if (buf_seq_no == seq_no)
+			return 0;
+		if (ofi_before(seq_no, buf_seq_no)) {
+			dlist_insert_before(&pkt_entry->d_entry,
+					    &buf_entry->d_entry);
+			return 1;
+		}
+	}
+	dlist_insert_tail(&pkt_entry->d_entry, &peer->buf_pkts);
+	return 1;
+}
+
+static void rxd_add_unexp_data(struct rxd_ep *ep, struct rxd_peer *peer,
+			       struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
+	struct rxd_unexp_msg *unexp_msg = peer->curr_unexp;
+
+	peer->rx_seq_no++;
+	dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
+	if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
+		peer->curr_unexp = NULL;
+		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+	}
+}
+
 static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 {
 	struct fi_cq_err_entry err_entry;
@@ -919,8 +963,17 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 		pkt_entry = container_of(bufpkts->next, struct rxd_pkt_entry,
 					 d_entry);
 		base_hdr = rxd_get_base_hdr(pkt_entry);
+		if (ofi_before(base_hdr->seq_no, rxd_peer(ep, peer)->rx_seq_no)) {
+			rxd_remove_free_pkt_entry(pkt_entry);
+			continue;
+		}
 		if (base_hdr->seq_no != rxd_peer(ep, peer)->rx_seq_no)
 			return;
+		if (base_hdr->type == RXD_DATA && rxd_peer(ep, peer)->curr_unexp) {
+			dlist_remove(&pkt_entry->d_entry);
+			rxd_add_unexp_data(ep, rxd_peer(ep, peer), pkt_entry);
+			continue;
+		}
 		if (base_hdr->type == RXD_DATA || base_hdr->type == RXD_DATA_READ) {
 			data_pkt = (struct rxd_data_pkt *) pkt_entry->pkt;
 			rx_entry = rxd_get_data_x_entry(ep, data_pkt);
@@ -945,7 +998,15 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 			if (!rx_entry) {
 				if (base_hdr->type == RXD_MSG ||
 				    base_hdr->type == RXD_TAGGED) {
+					if (!rxd_peer(ep, peer)->curr_unexp) {
+						rxd_remove_free_pkt_entry(pkt_entry);
+						break;
+					}
+					/* now owned by the unexpected message */
+					dlist_remove(&pkt_entry->d_entry);
 					rxd_peer(ep, base_hdr->peer)->rx_seq_no++;
+					if (!sar_hdr)
+						rxd_peer(ep, peer)->curr_unexp = NULL;
 					continue;
 				}
 				break;
@@ -965,7 +1026,9 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
 	struct rxd_x_entry *x_entry;
-	struct rxd_unexp_msg *unexp_msg;
+	struct rxd_peer *peer;
+	fi_addr_t addr;
+	int ret;
 
 	if (pkt_entry->pkt_size < sizeof(*pkt) + ep->rx_prefix_size) {
 		FI_WARN(&rxd_prov, FI_LOG_CQ,
@@ -973,32 +1036,32 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 		goto free;
 	}
 
-	if (pkt->base_hdr.seq_no == rxd_peer(ep,
-				    pkt->base_hdr.peer)->rx_seq_no) {
-		rxd_peer(ep, pkt->base_hdr.peer)->rx_seq_no++;
-		if (pkt->base_hdr.type == RXD_DATA &&
-		    rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp) {
-			unexp_msg = rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp;
-			dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
-			if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
-				rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp = NULL;
-				rxd_ep_send_ack(ep, pkt->base_hdr.peer);
-			}
-			return;
+	addr = pkt->base_hdr.peer;
+	peer = rxd_peer(ep, addr);
+	if (pkt->base_hdr.seq_no == peer->rx_seq_no) {
+		if (pkt->base_hdr.type == RXD_DATA && peer->curr_unexp) {
+			rxd_add_unexp_data(ep, peer, pkt_entry);
+		} else {
+			peer->rx_seq_no++;
+			x_entry = rxd_get_data_x_entry(ep, pkt);
+			rxd_ep_recv_data(ep, x_entry, pkt, pkt_entry->pkt_size);
+			ofi_buf_free(pkt_entry);
 		}
-		x_entry = rxd_get_data_x_entry(ep, pkt);
-		rxd_ep_recv_data(ep, x_entry, pkt, pkt_entry->pkt_size);
-		if (!dlist_empty(&(rxd_peer(ep,
-				   pkt->base_hdr.peer)->buf_pkts)))
-			rxd_progress_buf_pkts(ep, pkt->base_hdr.peer);
+		if (!dlist_empty(&peer->buf_pkts)) {
+			rxd_progress_buf_pkts(ep, addr);
+			if (rxd_env.retry)
+				rxd_ep_send_ack(ep, addr);
+		}
+		return;
 	} else if (!rxd_env.retry) {
-		dlist_insert_order(&(rxd_peer(ep,
-				     pkt->base_hdr.peer)->buf_pkts),
-				   &rxd_comp_pkt_seq_no, &pkt_entry->d_entry);
+		dlist_insert_order(&peer->buf_pkts, &rxd_comp_pkt_seq_no,
+				   &pkt_entry->d_entry);
 		return;
-	} else if (rxd_peer(ep, pkt->base_hdr.peer)->peer_addr !=
-		   RXD_ADDR_INVALID) {
-		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+	} else if (peer->peer_addr != RXD_ADDR_INVALID) {
+		ret = rxd_buffer_pkt(peer, pkt_entry);
+		rxd_ep_send_ack(ep, addr);
+		if (ret)
+			return;
 	}
 free:
 	ofi_buf_free(pkt_entry);
@@ -1024,9 +1087,14 @@ static void rxd_handle_op(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 			return;
 		}
 
-		if (rxd_peer(ep, base_hdr->peer)->peer_addr != RXD_ADDR_INVALID)
-			goto ack;
-		goto release;
+		if (rxd_peer(ep, base_hdr->peer)->peer_addr == RXD_ADDR_INVALID)
+			goto release;
+
+		if (rxd_buffer_pkt(rxd_peer(ep, base_hdr->peer), pkt_entry)) {
+			rxd_ep_send_ack(ep, base_hdr->peer);
+			return;
+		}
+		goto ack;
 	}
 
 	if (rxd_peer(ep, base_hdr->peer)->peer_addr == RXD_ADDR_INVALID)
@@ -1048,6 +1116,9 @@ static void rxd_handle_op(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 			if (!sar_hdr)
 				rxd_peer(ep, base_hdr->peer)->curr_unexp = NULL;
 
+			if (!dlist_empty(&(rxd_peer(ep, base_hdr->peer)->buf_pkts)))
+				rxd_progress_buf_pkts(ep, base_hdr->peer);
+
 			rxd_ep_send_ack(ep, base_hdr->peer);
 			return;
 		}
@@ -1082,19 +1153,65 @@ static void rxd_handle_cts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 	rxd_update_peer(ep, cts->rts_addr, cts->cts_addr);
 }
 
+/*
+ * Mark packets reported in a selective ack.  After RXD_DUP_ACK_THRESH
+ * duplicate acks, resend the holes below the highest selectively acked
+ * packet without waiting for the RTO to expire.
+ */
+static void rxd_handle_sack(struct rxd_ep *ep, struct rxd_peer *peer,
+			    struct rxd_ack_pkt *ack, int dup)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t seq_no, high;
+	int fast;
+
+	if (!ack->sack)
+		return;
+
+	high = ack->base_hdr.seq_no + ofi_msb(ack->sack);
+	fast = dup && ++peer->dup_acks == RXD_DUP_ACK_THRESH;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (pkt_entry->flags & (RXD_PKT_ACKED | RXD_PKT_SACKED))
+			continue;
+
+		seq_no = rxd_get_base_hdr(pkt_entry)->seq_no;
+		if (ofi_before(high, seq_no))
+			break;
+
+		if (seq_no != ack->base_hdr.seq_no &&
+		    ack->sack & (1ULL << (seq_no - ack->base_hdr.seq_no - 1))) {
+			pkt_entry->flags |= RXD_PKT_SACKED;
+			continue;
+		}
+
+		if (fast && !(pkt_entry->flags & RXD_PKT_IN_USE)) {
+			pkt_entry->flags |= RXD_PKT_RETRANS;
+			if (rxd_ep_send_pkt(ep, pkt_entry))
+				break;
+		}
+	}
+}
+
 static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 {
 	struct rxd_ack_pkt *ack = (struct rxd_ack_pkt *) (ack_entry->pkt);
 	struct rxd_pkt_entry *pkt_entry;
 	fi_addr_t peer = ack->base_hdr.peer;
 	struct rxd_base_hdr *hdr;
+	uint64_t sent = 0;
+	int valid = 1;
 
 	rxd_peer(ep, peer)->tx_window = (uint16_t) ack->ext_hdr.rx_id;
 
-	if (rxd_peer(ep, peer)->last_rx_ack == ack->base_hdr.seq_no)
+	if (rxd_peer(ep, peer)->last_rx_ack == ack->base_hdr.seq_no) {
+		rxd_handle_sack(ep, rxd_peer(ep, peer), ack, 1);
 		return;
+	}
 
 	rxd_peer(ep, peer)->last_rx_ack = ack->base_hdr.seq_no;
+	rxd_peer(ep, peer)->dup_acks = 0;
 
 	if (dlist_empty(&(rxd_peer(ep, peer)->unacked)))
 		return;
@@ -1109,6 +1226,13 @@ static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 		if (ofi_after_eq(hdr->seq_no, ack->base_hdr.seq_no))
 			break;
 
+		/* Karn's rule: no RTT sample once a retransmit is involved,
+		 * the ack may have been held back by the hole it filled */
+		if (pkt_entry->flags & (RXD_PKT_RETRANS | RXD_PKT_SACKED))
+			valid = 0;
+		else if (!(pkt_entry->flags & RXD_PKT_ACKED))
+			sent = pkt_entry->timestamp;
+
 		if (pkt_entry->flags & RXD_PKT_IN_USE) {
 			pkt_entry->flags |= RXD_PKT_ACKED;
 			pkt_entry = container_of((&pkt_entry->d_entry)->next,
@@ -1123,6 +1247,10 @@ static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 					struct rxd_pkt_entry, d_entry);
 	}
 
+	if (valid && sent)
+		rxd_update_rtt(rxd_peer(ep, peer), ofi_gettime_us() - sent);
+
+	rxd_handle_sack(ep, rxd_peer(ep, peer), ack, 0);
 	rxd_progress_tx_list(ep, rxd_peer(ep, ack->base_hdr.peer));
 }
 
@@ -1270,7 +1398,7 @@ ssize_t rxd_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 		ofi_genlock_unlock(&cq->ep_list_lock);
 
 		ret = ofi_wait(&cq->wait->wait_fid, ep_retry == -1 ?
-			       timeout : rxd_get_timeout(ep_retry));
+			       timeout : ep_retry);
 
 		if (ep_retry != -1 && ret == -FI_ETIMEDOUT)
 			ret = 0;
@@ -273,16 +273,33 @@ static int rxd_ep_enable(struct rxd_ep *ep)
 }
 
 /*
- * Exponential back-off starting at 1ms, max 4s.
+ * RFC 6298 smoothed round trip time estimator, in usec.
  */
-int rxd_get_timeout(int retry_cnt)
+void rxd_update_rtt(struct rxd_peer *peer, uint64_t sample)
 {
-	return MIN(1 << retry_cnt, 4000);
+	uint32_t rtt = (uint32_t) MIN(MAX(sample, 1), RXD_MAX_RTO);
+	uint32_t delta;
+
+	if (!peer->srtt) {
+		peer->srtt = rtt;
+		peer->rttvar = rtt / 2;
+	} else {
+		delta = peer->srtt > rtt ? peer->srtt - rtt : rtt - peer->srtt;
+		peer->rttvar = (3 * peer->rttvar + delta) / 4;
+		peer->srtt = (7 * peer->srtt + rtt) / 8;
+	}
+
+	peer->rto = MIN(MAX(peer->srtt + 4 * peer->rttvar, RXD_MIN_RTO),
+			RXD_MAX_RTO);
 }
 
-uint64_t rxd_get_retry_time(uint64_t start, int retry_cnt)
+/*
+ * Exponential back-off from the current RTO, max 4s.
+ */
+uint64_t rxd_get_rto(struct rxd_peer *peer)
 {
-	return start + rxd_get_timeout(retry_cnt);
+	return MIN((uint64_t) peer->rto << MIN(peer->retry_cnt, 12),
+		   RXD_MAX_RTO);
 }
 
 void rxd_init_data_pkt(struct rxd_ep *ep, struct rxd_x_entry *tx_entry,
@@ -413,7 +430,7 @@ ssize_t rxd_ep_send_pkt(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	ssize_t ret;
 	fi_addr_t dg_addr;
-	pkt_entry->timestamp = ofi_gettime_ms();
+	pkt_entry->timestamp = ofi_gettime_us();
 
 	dg_addr = (intptr_t) ofi_idx_lookup(&(rxd_ep_av(ep)->rxdaddr_dg_idx),
 					    (int)pkt_entry->peer);
@@ -557,6 +574,25 @@ size_t rxd_init_msg(void **ptr, const struct iovec *iov, size_t iov_count,
 	return done;
 }
 
+static uint64_t rxd_get_sack(struct rxd_peer *peer)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t sack = 0, seq_no, bit;
+
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		seq_no = rxd_get_base_hdr(pkt_entry)->seq_no;
+		if (!ofi_before(peer->rx_seq_no, seq_no))
+			continue;
+		bit = seq_no - peer->rx_seq_no - 1;
+		if (bit >= RXD_SACK_BITS)
+			break;
+		sack |= 1ULL << bit;
+	}
+
+	return sack;
+}
+
 void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
 {
 	struct rxd_pkt_entry *pkt_entry;
@@ -577,6 +613,7 @@ void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
 	ack->base_hdr.peer = (uint32_t) rxd_peer(rxd_ep, peer)->peer_addr;
 	ack->base_hdr.seq_no = rxd_peer(rxd_ep, peer)->rx_seq_no;
 	ack->ext_hdr.rx_id = rxd_peer(rxd_ep, peer)->rx_window;
+	ack->sack = rxd_get_sack(rxd_peer(rxd_ep, peer));
 	rxd_peer(rxd_ep, peer)->last_tx_ack = ack->base_hdr.seq_no;
 
 	dlist_insert_tail(&pkt_entry->d_entry, &rxd_ep->ctrl_pkts);
@@ -629,6 +666,12 @@ static void rxd_close_peer(struct rxd_ep *ep, struct rxd_peer *peer)
 		rxd_tx_entry_free(ep, x_entry);
 	}
 
+	while (!dlist_empty(&peer->buf_pkts)) {
+		dlist_pop_front(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry);
+		ofi_buf_free(pkt_entry);
+	}
+
 	dlist_remove(&peer->entry);
 	peer->active = 0;
 }
@@ -914,26 +957,37 @@ static void rxd_peer_timeout(struct rxd_ep *rxd_ep, struct rxd_peer *peer)
 	dlist_remove(&peer->entry);
 }
 
+/*
+ * Retransmit packets whose RTO expired.  Packets the peer reported through
+ * selective acks are skipped; only the holes are resent.
+ */
 static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 {
 	struct rxd_pkt_entry *pkt_entry;
-	uint64_t current;
+	uint64_t current, rto;
 	ssize_t ret;
-	int retry = 0;
+	int retry = 0, timeout;
 
-	current = ofi_gettime_ms();
+	current = ofi_gettime_us();
 	if (peer->retry_cnt > RXD_MAX_PKT_RETRY) {
 		rxd_peer_timeout(ep, peer);
 		return;
 	}
 
+	rto = rxd_get_rto(peer);
 	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
 				pkt_entry, d_entry) {
-		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED) ||
-		    current < rxd_get_retry_time(pkt_entry->timestamp,
-						 (uint8_t) peer->retry_cnt))
+		if (pkt_entry->flags & RXD_PKT_ACKED)
+			continue;
+		/* the oldest packet is resent even if sacked, in case the
+		 * peer could not process it */
+		if (retry && pkt_entry->flags & RXD_PKT_SACKED)
+			continue;
+		if (pkt_entry->flags & RXD_PKT_IN_USE ||
+		    current < pkt_entry->timestamp + rto)
 			break;
 		retry = 1;
+		pkt_entry->flags |= RXD_PKT_RETRANS;
 		ret = rxd_ep_send_pkt(ep, pkt_entry);
 		if (ret)
 			break;
@@ -941,9 +995,11 @@ static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 	if (retry)
 		peer->retry_cnt++;
 
-	if (!dlist_empty(&peer->unacked))
-		ep->next_retry = ep->next_retry == -1 ? peer->retry_cnt :
-				 MIN(ep->next_retry, peer->retry_cnt);
+	if (!dlist_empty(&peer->unacked)) {
+		timeout = (int) ((rxd_get_rto(peer) + 999) / 1000);
+		ep->next_retry = ep->next_retry == -1 ? timeout :
+				 MIN(ep->next_retry, timeout);
+	}
 }
 
 void rxd_ep_progress(struct util_ep *util_ep)
@@ -1164,6 +1220,7 @@ int rxd_create_peer(struct rxd_ep *ep, uint64_t rxd_addr)
 	peer->tx_window = (uint16_t) rxd_env.max_unacked;
 	peer->unacked_cnt = 0;
 	peer->retry_cnt = 0;
+	peer->rto = RXD_INIT_RTO;
 	peer->active = 0;
 	dlist_init(&(peer->unacked));
 	dlist_init(&(peer->tx_list));
@@ -77,6 +77,14 @@ enum {
 	RXM_CM_FLOW_CTRL_PEER_OFF,
 };
 
+/* Optional protocol features, exchanged in the cm data.  Older peers
+ * zero these bits.
+ */
+enum {
+	RXM_CM_CAP_CLOSE = BIT(0),
+	RXM_CM_CAP_SAR_ACK = BIT(1),
+};
+
 union rxm_cm_data {
 	struct _connect {
 		uint8_t version;
@@ -85,7 +93,7 @@ union rxm_cm_data {
 		uint8_t op_version;
 		uint16_t port;
 		uint8_t flow_ctrl;
-		uint8_t padding;
+		uint8_t caps;
 		uint32_t eager_limit;
 		uint32_t rx_size; /* used? */
 		uint64_t client_conn_id;
@@ -95,7 +103,8 @@ union rxm_cm_data {
 		uint64_t server_conn_id;
 		uint32_t rx_size; /* used? */
 		uint8_t flow_ctrl;
-		uint8_t align_pad[3];
+		uint8_t caps;
+		uint8_t align_pad[2];
 	} accept;
 
 	struct _reject {
@@ -202,9 +211,12 @@ extern size_t rxm_msg_tx_size;
 extern size_t rxm_msg_rx_size;
 extern size_t rxm_cm_progress_interval;
 extern size_t rxm_cq_eq_fairness;
+extern size_t rxm_max_conns;
+extern int rxm_conn_idle_timeout;
 extern int rxm_passthru;
 extern int force_auto_progress;
 extern int rxm_use_write_rndv;
+extern int rxm_proto_tune;
 extern int rxm_detect_hmem_iface;
 extern enum fi_wait_obj def_wait_obj, def_tcp_wait_obj;
 
@@ -221,12 +233,72 @@ enum rxm_cm_state {
 
 enum {
 	RXM_CONN_INDEXED = BIT(0),
+	RXM_CONN_CLOSE = BIT(1),	/* peer supports rxm_ctrl_close */
+	RXM_CONN_CLOSING = BIT(2),
+	RXM_CONN_EVICTED = BIT(3),
+	RXM_CONN_REFERENCED = BIT(4),
+	RXM_CONN_SAR_ACK = BIT(5),	/* peer supports rxm_ctrl_sar_ack */
+};
+
+/* Values of ctrl_data for rxm_ctrl_close */
+enum {
+	RXM_CLOSE_REQ = 1,
+	RXM_CLOSE_ACK,
+	RXM_CLOSE_NACK,
+};
+
+struct rxm_conn_stats {
+	uint64_t open;
+	uint64_t connect;
+	uint64_t accept;
+	uint64_t evict;
+	uint64_t reconnect;
 };
 
 /* Each local rxm ep will have at most 1 connection to a single
  * remote rxm ep.  A local rxm ep may not be connected to all
  * remote rxm ep's.
  */
+/* Messages near the SAR/rendezvous switch point are timed from post until
+ * the data has reached the peer: the read-done ack (or write completion)
+ * for rendezvous, and an rxm_ctrl_sar_ack for SAR.  Only one SAR message
+ * per connection is sampled at a time; a sample that is not acked within
+ * RXM_TUNE_SAR_ACK_NS is abandoned.  Every RXM_TUNE_PROBE_RATE message
+ * inside the band is sent with the other protocol, so that both protocols
+ * are sampled on each side of the switch point.  The switch point moves by
+ * a factor of two once one protocol is consistently cheaper on the wrong
+ * side of it.
+ */
+#define RXM_TUNE_PROBE_RATE	16
+#define RXM_TUNE_MIN_SAMPLES	4
+#define RXM_TUNE_MAX_SEGS	64
+#define RXM_TUNE_SAR_ACK_NS	1000000000ULL
+
+enum {
+	RXM_TUNE_SAR,
+	RXM_TUNE_RNDV,
+};
+
+enum {
+	RXM_TUNE_BELOW,
+	RXM_TUNE_ABOVE,
+};
+
+struct rxm_proto_tune {
+	size_t sar_limit;
+	/* EWMA of ns per KiB, indexed by [side][protocol] */
+	uint64_t cost[2][2];
+	uint32_t cnt[2][2];
+	uint32_t probe;
+
+	/* Outstanding SAR sample, waiting for the receiver's ack */
+	bool sar_pending;
+	uint64_t sar_msg_id;
+	uint64_t sar_start;
+	size_t sar_limit_start;
+	size_t sar_len;
+};
+
 struct rxm_conn {
 	enum rxm_cm_state state;
 	struct util_peer_addr *peer;
@@ -249,6 +321,8 @@ struct rxm_conn {
 	struct dlist_entry deferred_sar_msgs;
 	struct dlist_entry deferred_sar_segments;
 	struct dlist_entry loopback_entry;
+	struct dlist_entry lru_entry;
+	struct rxm_proto_tune tune;
 };
 
 void rxm_freeall_conns(struct rxm_ep *ep);
@@ -393,7 +467,9 @@ struct rxm_atomic_resp_hdr {
 	FUNC(RXM_RNDV_WRITE_DONE_RECVD),\
 	FUNC(RXM_RNDV_FINISH), /* not needed */	\
 	FUNC(RXM_ATOMIC_RESP_WAIT),	\
-	FUNC(RXM_ATOMIC_RESP_SENT)
+	FUNC(RXM_ATOMIC_RESP_SENT),	\
+	FUNC(RXM_CLOSE_TX),		\
+	FUNC(RXM_SAR_ACK_TX)
 
 enum rxm_proto_state {
 	RXM_PROTO_STATES(OFI_ENUM_VAL)
@@ -410,7 +486,9 @@ enum {
 	rxm_ctrl_atomic_resp,
 	rxm_ctrl_credit,
 	rxm_ctrl_rndv_wr_data,
-	rxm_ctrl_rndv_wr_done
+	rxm_ctrl_rndv_wr_done,
+	rxm_ctrl_close,
+	rxm_ctrl_sar_ack
 };
 
 struct rxm_pkt {
@@ -428,6 +506,8 @@ enum rxm_sar_seg_type {
 union rxm_sar_ctrl_data {
 	struct {
 		enum rxm_sar_seg_type seg_type : 2;
+		/* Set on the first segment, ignored by older receivers */
+		uint8_t ack_req : 1;
 		uint32_t offset;
 	};
 	uint64_t align;
@@ -445,6 +525,16 @@ rxm_sar_set_seg_type(struct ofi_ctrl_hdr *ctrl_hdr, enum rxm_sar_seg_type seg_ty
 	((union rxm_sar_ctrl_data *)&(ctrl_hdr->ctrl_data))->seg_type = seg_type;
 }
 
+static inline bool rxm_sar_get_ack_req(struct ofi_ctrl_hdr *ctrl_hdr)
+{
+	return ((union rxm_sar_ctrl_data *)&(ctrl_hdr->ctrl_data))->ack_req;
+}
+
+static inline void rxm_sar_set_ack_req(struct ofi_ctrl_hdr *ctrl_hdr)
+{
+	((union rxm_sar_ctrl_data *)&(ctrl_hdr->ctrl_data))->ack_req = 1;
+}
+
 struct rxm_iov {
 	struct iovec iov[RXM_IOV_LIMIT];
 	void *desc[RXM_IOV_LIMIT];
@@ -460,6 +550,7 @@ struct rxm_proto_info {
                 size_t total_recv_len;
                 struct rxm_conn *conn;
                 uint64_t msg_id;
+                bool ack;
         } sar;
         /* Used for Rendezvous protocol */
         struct {
@@ -497,6 +588,7 @@ struct rxm_rx_buf {
 	struct dlist_entry rndv_wait_entry;
 	struct rxm_rndv_hdr *remote_rndv_hdr;
 	size_t rndv_rma_index;
+	int rndv_err;
 	struct fid_mr *mr[RXM_IOV_LIMIT];
 
 	/* Only differs from pkt.data for unexpected messages */
@@ -513,6 +605,11 @@ struct rxm_tx_buf {
 	void *app_context;
 	uint64_t flags;
 
+	/* Protocol tuning sample, valid if tune_conn is set */
+	struct rxm_conn *tune_conn;
+	uint64_t tune_start;
+	size_t tune_limit;
+
 	union {
 		struct {
 			struct fid_mr *mr[RXM_IOV_LIMIT];
@@ -560,6 +657,7 @@ enum rxm_deferred_tx_entry_type {
 	RXM_DEFERRED_TX_SAR_SEG,
 	RXM_DEFERRED_TX_ATOMIC_RESP,
 	RXM_DEFERRED_TX_CREDIT_SEND,
+	RXM_DEFERRED_TX_CTRL,
 };
 
 struct rxm_deferred_tx_entry {
@@ -613,6 +711,9 @@ struct rxm_deferred_tx_entry {
 		struct {
 			struct rxm_tx_buf *tx_buf;
 		} credit_msg;
+		struct {
+			struct rxm_tx_buf *tx_buf;
+		} ctrl_msg;
 	};
 };
 
@@ -643,6 +744,9 @@ struct rxm_ep {
 	int			connecting_cnt;
 	struct index_map	conn_idx_map;
 	struct dlist_entry	loopback_list;
+	struct dlist_entry	conn_lru;
+	uint64_t		reap_time;
+	struct rxm_conn_stats	conn_stats;
 	union ofi_sock_ip	addr;
 
 	pthread_t		cm_thread;
@@ -669,6 +773,7 @@ struct rxm_ep {
 	bool			rdm_mr_local;
 	bool			do_progress;
 	bool			enable_direct_send;
+	bool			proto_tune;
 
 	size_t			buffered_min;
 	size_t			buffered_limit;
@@ -676,7 +781,10 @@ struct rxm_ep {
 
 	size_t			eager_limit;
 	size_t			sar_limit;
+	size_t			sar_tune_max;
 	size_t			tx_credit;
+	/* rx buffers removed from the msg ep and not yet released */
+	size_t			rx_held;
 	size_t			min_multi_recv_size;
 
 	struct ofi_bufpool	*rx_pool;
@@ -696,6 +804,9 @@ struct rxm_ep {
 int rxm_start_listen(struct rxm_ep *ep);
 void rxm_stop_listen(struct rxm_ep *ep);
 void rxm_conn_progress(struct rxm_ep *ep);
+ssize_t rxm_handle_close(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf);
+ssize_t rxm_send_ctrl(struct rxm_conn *conn, enum rxm_proto_state state,
+		      uint8_t type, uint64_t ctrl_data);
 
 
 extern struct fi_provider rxm_prov;
@@ -803,6 +914,65 @@ rxm_atomic_send_respmsg(struct rxm_ep *rxm_ep, struct rxm_conn *conn,
 	return fi_sendmsg(conn->msg_ep, &msg, FI_COMPLETION);
 }
 
+static inline bool
+rxm_tune_band(struct rxm_ep *ep, struct rxm_conn *conn, size_t len)
+{
+	return ep->proto_tune && len > conn->tune.sar_limit / 2 &&
+	       len <= conn->tune.sar_limit * 2;
+}
+
+/* Only called for messages above the eager limit. */
+static inline bool
+rxm_use_sar(struct rxm_ep *ep, struct rxm_conn *conn, size_t len)
+{
+	bool sar = len <= conn->tune.sar_limit;
+
+	if (rxm_tune_band(ep, conn, len) &&
+	    !(++conn->tune.probe % RXM_TUNE_PROBE_RATE))
+		return !sar;
+	return sar;
+}
+
+static inline void
+rxm_tune_start(struct rxm_ep *ep, struct rxm_conn *conn,
+	       struct rxm_tx_buf *tx_buf, size_t len, uint64_t start)
+{
+	if (start && rxm_tune_band(ep, conn, len)) {
+		tx_buf->tune_conn = conn;
+		tx_buf->tune_start = start;
+		tx_buf->tune_limit = conn->tune.sar_limit;
+	} else {
+		tx_buf->tune_conn = NULL;
+	}
+}
+
+/* SAR samples need a peer that acks them */
+static inline void
+rxm_tune_start_sar(struct rxm_ep *ep, struct rxm_conn *conn,
+		   struct rxm_tx_buf *tx_buf, size_t len, uint64_t start)
+{
+	struct rxm_proto_tune *tune = &conn->tune;
+
+	if (!start || !(conn->flags & RXM_CONN_SAR_ACK) ||
+	    !rxm_tune_band(ep, conn, len))
+		return;
+
+	if (tune->sar_pending && start - tune->sar_start < RXM_TUNE_SAR_ACK_NS)
+		return;
+
+	tune->sar_pending = true;
+	tune->sar_msg_id = tx_buf->pkt.ctrl_hdr.msg_id;
+	tune->sar_start = start;
+	tune->sar_limit_start = tune->sar_limit;
+	tune->sar_len = len;
+	rxm_sar_set_ack_req(&tx_buf->pkt.ctrl_hdr);
+}
+
+void rxm_tune_init(struct rxm_ep *ep, struct rxm_conn *conn);
+void rxm_tune_record(struct rxm_ep *ep, struct rxm_tx_buf *tx_buf, int proto);
+void rxm_tune_sar_ack(struct rxm_ep *ep, struct rxm_conn *conn,
+		      uint64_t msg_id);
+
 void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 				    struct rxm_conn *rxm_conn);
 
@@ -899,6 +1069,9 @@ rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
 		rx_buf->data = &rx_buf->pkt.data;
 	}
 
+	assert(rx_buf->ep->rx_held);
+	rx_buf->ep->rx_held--;
+
 	/* Discard rx buffer if its msg_ep was closed */
 	if (rx_buf->repost && (rx_buf->ep->msg_srx || rx_buf->conn->msg_ep)) {
 		rxm_post_recv(rx_buf);
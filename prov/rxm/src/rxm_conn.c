@@ -64,11 +64,21 @@ static void rxm_close_conn(struct rxm_conn *conn)
 	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 
 	assert(ofi_genlock_held(&conn->ep->util_ep.lock));
+	/* Ignore close messages that are flushed from the msg ep */
+	conn->flags &= ~(RXM_CONN_CLOSE | RXM_CONN_REFERENCED);
+	if (conn->flags & RXM_CONN_CLOSING) {
+		conn->flags &= ~RXM_CONN_CLOSING;
+		conn->flags |= RXM_CONN_EVICTED;
+		conn->ep->conn_stats.evict++;
+	}
+
 	/* All deferred transfers are internally generated */
 	while (!dlist_empty(&conn->deferred_tx_queue)) {
 		tx_entry = container_of(conn->deferred_tx_queue.next,
 				     struct rxm_deferred_tx_entry, entry);
 		rxm_dequeue_deferred_tx(tx_entry);
+		if (tx_entry->type == RXM_DEFERRED_TX_CTRL)
+			ofi_buf_free(tx_entry->ctrl_msg.tx_buf);
 		free(tx_entry);
 	}
 
@@ -85,6 +95,8 @@ static void rxm_close_conn(struct rxm_conn *conn)
 	fi_close(&conn->msg_ep->fid);
 	rxm_flush_msg_cq(conn->ep);
 	dlist_remove_init(&conn->loopback_entry);
+	dlist_remove_init(&conn->lru_entry);
+	conn->ep->conn_stats.open--;
 	conn->msg_ep = NULL;
 
 	if (conn->state == RXM_CM_CONNECTING || conn->state == RXM_CM_ACCEPTING)
@@ -222,12 +234,229 @@ static int rxm_open_conn(struct rxm_conn *conn, struct fi_info *msg_info)
 	}
 
 	conn->msg_ep = msg_ep;
+	conn->flags |= RXM_CONN_REFERENCED;
+	dlist_insert_tail(&conn->lru_entry, &ep->conn_lru);
+	ep->conn_stats.open++;
+	if (conn->flags & RXM_CONN_EVICTED) {
+		conn->flags &= ~RXM_CONN_EVICTED;
+		ep->conn_stats.reconnect++;
+	}
 	return 0;
 err:
 	fi_close(&msg_ep->fid);
 	return ret;
 }
 
+static uint8_t rxm_conn_caps(struct rxm_ep *ep)
+{
+	return rxm_passthru_info(ep->rxm_info) ? 0 :
+	       RXM_CM_CAP_CLOSE | RXM_CM_CAP_SAR_ACK;
+}
+
+static void rxm_set_peer_caps(struct rxm_conn *conn, uint8_t caps)
+{
+	caps &= rxm_conn_caps(conn->ep);
+	conn->flags &= ~(RXM_CONN_CLOSE | RXM_CONN_SAR_ACK);
+	if (caps & RXM_CM_CAP_CLOSE)
+		conn->flags |= RXM_CONN_CLOSE;
+	if (caps & RXM_CM_CAP_SAR_ACK)
+		conn->flags |= RXM_CONN_SAR_ACK;
+}
+
+/* Send a header-only control message.  It is queued behind any deferred
+ * transfers if the msg ep is out of resources.
+ */
+ssize_t rxm_send_ctrl(struct rxm_conn *conn, enum rxm_proto_state state,
+		      uint8_t type, uint64_t ctrl_data)
+{
+	struct rxm_deferred_tx_entry *def_tx_entry;
+	struct rxm_tx_buf *tx_buf;
+	struct iovec iov;
+	struct fi_msg msg;
+	ssize_t ret;
+
+	tx_buf = ofi_buf_alloc(conn->ep->tx_pool);
+	if (!tx_buf)
+		return -FI_ENOMEM;
+
+	tx_buf->hdr.state = state;
+	rxm_ep_format_tx_buf_pkt(conn, 0, type, 0, 0, 0, &tx_buf->pkt);
+	tx_buf->pkt.ctrl_hdr.type = type;
+	tx_buf->pkt.ctrl_hdr.msg_id = ofi_buf_index(tx_buf);
+	tx_buf->pkt.ctrl_hdr.ctrl_data = ctrl_data;
+
+	iov.iov_base = &tx_buf->pkt;
+	iov.iov_len = sizeof(struct rxm_pkt);
+	msg.msg_iov = &iov;
+	msg.iov_count = 1;
+	msg.addr = 0;
+	msg.context = tx_buf;
+	msg.desc = &tx_buf->hdr.desc;
+	msg.data = 0;
+
+	/* Must be ordered behind any queued data */
+	ret = fi_sendmsg(conn->msg_ep, &msg, 0);
+	if (ret != -FI_EAGAIN) {
+		if (ret)
+			ofi_buf_free(tx_buf);
+		return ret;
+	}
+
+	def_tx_entry = rxm_ep_alloc_deferred_tx_entry(conn->ep, conn,
+						      RXM_DEFERRED_TX_CTRL);
+	if (!def_tx_entry) {
+		ofi_buf_free(tx_buf);
+		return -FI_ENOMEM;
+	}
+
+	def_tx_entry->ctrl_msg.tx_buf = tx_buf;
+	rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
+	return 0;
+}
+
+/* Checked at the ep level, which is conservative.  Received buffers may
+ * hold unexpected or rendezvous messages from any peer.
+ */
+static bool rxm_conn_idle(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	return ep->tx_credit == ep->rxm_info->tx_attr->size &&
+	       !ep->rx_held && dlist_empty(&ep->deferred_queue) &&
+	       dlist_empty(&ep->rndv_wait_list) &&
+	       dlist_empty(&conn->deferred_tx_queue) &&
+	       dlist_empty(&conn->deferred_sar_msgs) &&
+	       dlist_empty(&conn->deferred_sar_segments);
+}
+
+static bool rxm_can_evict(struct rxm_conn *conn)
+{
+	return conn->state == RXM_CM_CONNECTED &&
+	       (conn->flags & RXM_CONN_CLOSE) &&
+	       !(conn->flags & RXM_CONN_CLOSING) &&
+	       dlist_empty(&conn->loopback_entry) &&
+	       ofi_addr_cmp(&rxm_prov, &conn->peer->addr.sa,
+			    &conn->ep->addr.sa);
+}
+
+/* Ask the peer to close an idle connection.  The connection is shutdown
+ * once the peer acks, which guarantees that it has nothing in flight.
+ */
+static int rxm_start_evict(struct rxm_conn *conn)
+{
+	ssize_t ret;
+
+	if (!rxm_conn_idle(conn))
+		return -FI_EBUSY;
+
+	ret = rxm_send_ctrl(conn, RXM_CLOSE_TX, rxm_ctrl_close, RXM_CLOSE_REQ);
+	if (ret)
+		return (int) ret;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "evicting conn %p\n", conn);
+	conn->flags |= RXM_CONN_CLOSING;
+	return 0;
+}
+
+/* Second chance replacement.  Recently used connections are skipped once,
+ * so that two passes over the list will find an idle connection if any.
+ */
+static void rxm_evict_lru(struct rxm_ep *ep)
+{
+	struct rxm_conn *conn;
+	uint64_t cnt;
+
+	for (cnt = ep->conn_stats.open * 2; cnt; cnt--) {
+		conn = container_of(ep->conn_lru.next, struct rxm_conn,
+				    lru_entry);
+		dlist_remove(&conn->lru_entry);
+		dlist_insert_tail(&conn->lru_entry, &ep->conn_lru);
+
+		if (!rxm_can_evict(conn))
+			continue;
+
+		if (conn->flags & RXM_CONN_REFERENCED)
+			conn->flags &= ~RXM_CONN_REFERENCED;
+		else if (!rxm_start_evict(conn))
+			return;
+	}
+}
+
+static void rxm_limit_conns(struct rxm_ep *ep)
+{
+	if (rxm_max_conns && ep->conn_stats.open >= rxm_max_conns)
+		rxm_evict_lru(ep);
+}
+
+/* Connections not used since the last pass are closed. */
+static void rxm_reap_conns(struct rxm_ep *ep)
+{
+	struct rxm_conn *conn;
+	uint64_t now;
+
+	now = ofi_gettime_ms();
+	if (now < ep->reap_time)
+		return;
+
+	ep->reap_time = now + rxm_conn_idle_timeout;
+	dlist_foreach_container(&ep->conn_lru, struct rxm_conn,
+				conn, lru_entry) {
+		if (!rxm_can_evict(conn))
+			continue;
+
+		if (conn->flags & RXM_CONN_REFERENCED)
+			conn->flags &= ~RXM_CONN_REFERENCED;
+		else
+			(void) rxm_start_evict(conn);
+	}
+}
+
+ssize_t rxm_handle_close(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+	uint64_t type;
+
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	conn = rx_buf->conn;
+	if (!conn)
+		conn = ofi_idm_at(&ep->conn_idx_map,
+				  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	type = rx_buf->pkt.ctrl_hdr.ctrl_data;
+
+	/* Release the buffer first, so it is not counted as busy */
+	rxm_free_rx_buf(rx_buf);
+	if (!conn || !(conn->flags & RXM_CONN_CLOSE))
+		return 0;
+
+	switch (type) {
+	case RXM_CLOSE_REQ:
+		/* If both sides requested a close, both back off.  An ack
+		 * is only sent by a side that has no request outstanding,
+		 * so it can never receive a nack afterwards.
+		 */
+		if ((conn->flags & RXM_CONN_CLOSING) || !rxm_conn_idle(conn))
+			return rxm_send_ctrl(conn, RXM_CLOSE_TX,
+					     rxm_ctrl_close, RXM_CLOSE_NACK);
+
+		/* Wait for the peer to shutdown the connection */
+		conn->flags |= RXM_CONN_CLOSING;
+		return rxm_send_ctrl(conn, RXM_CLOSE_TX, rxm_ctrl_close,
+				     RXM_CLOSE_ACK);
+	case RXM_CLOSE_ACK:
+		if (!(conn->flags & RXM_CONN_CLOSING))
+			return -FI_EOPBADSTATE;
+
+		/* The peer will not send anything else */
+		return fi_shutdown(conn->msg_ep, 0);
+	case RXM_CLOSE_NACK:
+		conn->flags &= ~RXM_CONN_CLOSING;
+		conn->flags |= RXM_CONN_REFERENCED;
+		return 0;
+	default:
+		return -FI_EOPBADSTATE;
+	}
+}
+
 /* We send passive endpoint's port to the server as connection request
  * would be from a different one.
  */
@@ -248,6 +477,7 @@ static int rxm_init_connect_data(struct rxm_conn *conn,
 	cm_data->connect.flow_ctrl = conn->flow_ctrl ?
 						RXM_CM_FLOW_CTRL_PEER_ON :
 						RXM_CM_FLOW_CTRL_PEER_OFF;
+	cm_data->connect.caps = rxm_conn_caps(conn->ep);
 
 	ret = fi_getopt(&conn->ep->msg_pep->fid, FI_OPT_ENDPOINT,
 			FI_OPT_CM_DATA_SIZE, &cm_data_size, &opt_size);
@@ -283,6 +513,7 @@ static int rxm_send_connect(struct rxm_conn *conn)
 	if (!info->dest_addr)
 		return -FI_ENOMEM;
 
+	rxm_limit_conns(conn->ep);
 	ret = rxm_open_conn(conn, info);
 	if (ret)
 		return ret;
@@ -299,10 +530,13 @@ static int rxm_send_connect(struct rxm_conn *conn)
 	}
 	conn->state = RXM_CM_CONNECTING;
 	conn->ep->connecting_cnt++;
+	conn->ep->conn_stats.connect++;
 	return 0;
 
 err:
 	fi_close(&conn->msg_ep->fid);
+	dlist_remove_init(&conn->lru_entry);
+	conn->ep->conn_stats.open--;
 	conn->msg_ep = NULL;
 	return ret;
 }
@@ -407,6 +641,8 @@ rxm_alloc_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 	dlist_init(&conn->deferred_sar_msgs);
 	dlist_init(&conn->deferred_sar_segments);
 	dlist_init(&conn->loopback_entry);
+	dlist_init(&conn->lru_entry);
+	rxm_tune_init(ep, conn);
 
 	conn->peer = peer;
 	rxm_ref_peer(peer);
@@ -457,6 +693,11 @@ ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 			if (!dlist_empty(&(*conn)->deferred_tx_queue))
 				return -FI_EAGAIN;
 		}
+		if ((*conn)->flags & RXM_CONN_CLOSING) {
+			rxm_ep_do_progress(&ep->util_ep);
+			return -FI_EAGAIN;
+		}
+		(*conn)->flags |= RXM_CONN_REFERENCED;
 		return 0;
 	}
 
@@ -509,6 +750,7 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 		conn->remote_pid = rxm_peer_pid(cm_entry->data.accept.
 						server_conn_id);
 		rxm_set_peer_flow_ctrl(conn, cm_entry->data.accept.flow_ctrl);
+		rxm_set_peer_caps(conn, cm_entry->data.accept.caps);
 	}
 
 	if (conn->flow_ctrl & conn->peer_flow_ctrl) {
@@ -628,9 +870,9 @@ rxm_accept_connreq(struct rxm_conn *conn, struct rxm_eq_cm_entry *cm_entry)
 	cm_data.accept.rx_size = (uint32_t) cm_entry->info->rx_attr->size;
 	cm_data.accept.flow_ctrl = conn->flow_ctrl ? RXM_CM_FLOW_CTRL_PEER_ON :
 						     RXM_CM_FLOW_CTRL_PEER_OFF;
+	cm_data.accept.caps = rxm_conn_caps(conn->ep);
 	cm_data.accept.align_pad[0] = 0;
 	cm_data.accept.align_pad[1] = 0;
-	cm_data.accept.align_pad[2] = 0;
 
 	ret = fi_accept(conn->msg_ep, &cm_data.accept, sizeof(cm_data.accept));
 	if (ret)
@@ -700,7 +942,8 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 		break;
 	case RXM_CM_ACCEPTING:
 	case RXM_CM_CONNECTED:
-		if (conn->remote_pid &&
+		/* A conn being closed is replaced by the peer's request */
+		if (!(conn->flags & RXM_CONN_CLOSING) && conn->remote_pid &&
 		    (conn->remote_pid == rxm_peer_pid(cm_entry->data.connect.
 		    				      client_conn_id))) {
 			FI_INFO(&rxm_prov, FI_LOG_EP_CTRL,
@@ -721,11 +964,13 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 
 	conn->remote_pid = rxm_peer_pid(cm_entry->data.connect.client_conn_id);
 	conn->remote_index = rxm_peer_index(cm_entry->data.connect.client_conn_id);
+	rxm_limit_conns(ep);
 	ret = rxm_open_conn(conn, cm_entry->info);
 	if (ret)
 		goto free;
 
 	rxm_set_peer_flow_ctrl(conn, cm_entry->data.connect.flow_ctrl);
+	rxm_set_peer_caps(conn, cm_entry->data.connect.caps);
 
 	ret = rxm_accept_connreq(conn, cm_entry);
 	if (ret)
@@ -733,6 +978,7 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 
 	conn->state = RXM_CM_ACCEPTING;
 	conn->ep->connecting_cnt++;
+	conn->ep->conn_stats.accept++;
 put:
 	util_put_peer(peer);
 	fi_freeinfo(cm_entry->info);
@@ -762,6 +1008,11 @@ void rxm_process_shutdown(struct rxm_conn *conn)
 	case RXM_CM_CONNECTING:
 	case RXM_CM_ACCEPTING:
 	case RXM_CM_CONNECTED:
+		if (conn->flags & RXM_CONN_CLOSING) {
+			/* Keep evicted conns to track reconnects */
+			rxm_close_conn(conn);
+			break;
+		}
 		rxm_close_conn(conn);
 		rxm_free_conn(conn);
 		break;
@@ -840,6 +1091,9 @@ void rxm_conn_progress(struct rxm_ep *ep)
 	ssize_t ret;
 
 	assert(ofi_genlock_held(&ep->util_ep.lock));
+	if (rxm_conn_idle_timeout)
+		rxm_reap_conns(ep);
+
 	do {
 		ret = fi_eq_read(ep->msg_eq, &event, &cm_entry,
 				 sizeof(cm_entry), 0);
@@ -1058,7 +1312,8 @@ void rxm_av_remove_handler(struct util_ep *util_ep, struct util_peer_addr *peer)
 	ofi_genlock_lock(&ep->util_ep.lock);
 	conn = ofi_idm_lookup(&ep->conn_idx_map, peer->index);
 	if (conn) {
-		rxm_close_conn(conn);
+		if (conn->state != RXM_CM_IDLE)
+			rxm_close_conn(conn);
 		rxm_free_conn(conn);
 	}
 	ofi_genlock_unlock(&ep->util_ep.lock);
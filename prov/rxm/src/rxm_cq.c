@@ -218,6 +218,24 @@ rxm_cq_write_tx_comp(struct rxm_ep *rxm_ep, uint64_t comp_flags,
 	}
 }
 
+/* Sends posted by util_coll on behalf of a collective report back to it */
+static void rxm_finish_msg_send(struct rxm_ep *rxm_ep, uint64_t comp_flags,
+				void *app_context, uint64_t flags, uint64_t tag)
+{
+	if (rxm_ep->util_coll_ep && (tag & RXM_PEER_XFER_TAG_FLAG)) {
+		struct fi_cq_tagged_entry cqe = {
+			.tag = tag,
+			.op_context = app_context,
+		};
+		rxm_ep->util_coll_peer_xfer_ops->
+			complete(rxm_ep->util_coll_ep, &cqe, 0);
+		return;
+	}
+
+	rxm_cq_write_tx_comp(rxm_ep, comp_flags, app_context, flags);
+	ofi_ep_peer_tx_cntr_inc(&rxm_ep->util_ep, ofi_op_msg);
+}
+
 static void rxm_finish_rma(struct rxm_ep *rxm_ep, struct rxm_tx_buf *rma_buf,
 			  uint64_t comp_flags)
 {
@@ -276,17 +294,17 @@ static void rxm_handle_sar_comp(struct rxm_ep *rxm_ep,
 				struct rxm_tx_buf *tx_buf)
 {
 	void *app_context;
-	uint64_t comp_flags, tx_flags;
+	uint64_t comp_flags, tx_flags, tag;
 
 	app_context = tx_buf->app_context;
 	comp_flags = ofi_tx_cq_flags(tx_buf->pkt.hdr.op);
 	tx_flags = tx_buf->flags;
+	tag = tx_buf->pkt.hdr.tag;
 
 	if (!rxm_complete_sar(rxm_ep, tx_buf))
 		return;
 
-	rxm_cq_write_tx_comp(rxm_ep, comp_flags, app_context, tx_flags);
-	ofi_ep_peer_tx_cntr_inc(&rxm_ep->util_ep, ofi_op_msg);
+	rxm_finish_msg_send(rxm_ep, comp_flags, app_context, tx_flags, tag);
 }
 
 static void rxm_rndv_rx_finish(struct rxm_rx_buf *rx_buf)
@@ -307,24 +325,62 @@ static void rxm_rndv_rx_finish(struct rxm_rx_buf *rx_buf)
 	rxm_finish_recv(rx_buf, rx_buf->peer_entry->msg_size);
 }
 
+/* Report a failed rendezvous receive and release its rx buffer */
+static void rxm_rndv_rx_fail(struct rxm_rx_buf *rx_buf,
+			     struct fi_cq_err_entry *err_entry)
+{
+	struct rxm_proto_info *proto_info;
+	struct util_cntr *cntr;
+	int ret;
+
+	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_FINISH);
+
+	err_entry->op_context = rx_buf->peer_entry->context;
+	err_entry->flags = rx_buf->peer_entry->flags;
+
+	cntr = rx_buf->ep->util_ep.cntrs[CNTR_RX];
+	if (cntr)
+		cntr->peer_cntr->owner_ops->incerr(cntr->peer_cntr);
+
+	ret = ofi_peer_cq_write_error(rx_buf->ep->util_ep.rx_cq, err_entry);
+	if (ret) {
+		FI_WARN(&rxm_prov, FI_LOG_CQ,
+			"Unable to ofi_peer_cq_write_error\n");
+		assert(0);
+	}
+
+	proto_info = rx_buf->proto_info;
+	if (proto_info && proto_info->rndv.tx_buf) {
+		ofi_buf_free(proto_info->rndv.tx_buf);
+		ofi_buf_free(proto_info);
+	}
+
+	if (!rx_buf->ep->rdm_mr_local)
+		rxm_msg_mr_closev(rx_buf->mr, rx_buf->peer_entry->count);
+
+	rx_buf->ep->srx->owner_ops->free_entry(rx_buf->peer_entry);
+	rxm_free_rx_buf(rx_buf);
+}
+
 static void rxm_rndv_tx_finish(struct rxm_ep *rxm_ep,
 			       struct rxm_tx_buf *tx_buf)
 {
 	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
 
 	RXM_UPDATE_STATE(FI_LOG_CQ, tx_buf, RXM_RNDV_FINISH);
+	rxm_tune_record(rxm_ep, tx_buf, RXM_TUNE_RNDV);
 	if (!rxm_ep->rdm_mr_local)
 		rxm_msg_mr_closev(tx_buf->rma.mr, tx_buf->rma.count);
 
-	rxm_cq_write_tx_comp(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
-			     tx_buf->app_context, tx_buf->flags);
+	rxm_finish_msg_send(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
+			    tx_buf->app_context, tx_buf->flags,
+			    tx_buf->pkt.hdr.tag);
 
 	if (rxm_ep->rndv_ops == &rxm_rndv_ops_write &&
 	    tx_buf->write_rndv.done_buf) {
 		ofi_buf_free(tx_buf->write_rndv.done_buf);
 		tx_buf->write_rndv.done_buf = NULL;
 	}
-	ofi_ep_peer_tx_cntr_inc(&rxm_ep->util_ep, ofi_op_msg);
 	rxm_free_tx_buf(rxm_ep, tx_buf);
 }
 
@@ -420,6 +476,7 @@ static void rxm_init_sar_proto(struct rxm_rx_buf *rx_buf)
 	proto_info->sar.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
 	proto_info->sar.total_recv_len = 0;
 	proto_info->sar.rx_entry = rx_buf->peer_entry;
+	proto_info->sar.ack = rxm_sar_get_ack_req(&rx_buf->pkt.ctrl_hdr);
 
 	dlist_insert_tail(&proto_info->sar.entry,
 			  &rx_buf->conn->deferred_sar_msgs);
@@ -463,6 +520,10 @@ int rxm_process_seg_data(struct rxm_rx_buf *rx_buf)
 			dlist_remove(&proto_info->sar.entry);
 		done_len = proto_info->sar.total_recv_len;
 		done = 1;
+		if (proto_info->sar.ack)
+			(void) rxm_send_ctrl(proto_info->sar.conn, RXM_SAR_ACK_TX,
+					     rxm_ctrl_sar_ack,
+					     proto_info->sar.msg_id);
 		ofi_buf_free(rx_buf->proto_info);
 		rxm_finish_recv(rx_buf, done_len);
 	} else {
@@ -658,6 +719,7 @@ static ssize_t rxm_handle_rndv(struct rxm_rx_buf *rx_buf)
 
 	rx_buf->remote_rndv_hdr = (struct rxm_rndv_hdr *) rx_buf->pkt.data;
 	rx_buf->rndv_rma_index = 0;
+	rx_buf->rndv_err = 0;
 
 	if (!rx_buf->ep->rdm_mr_local) {
 		total_recv_len = MIN(rx_buf->peer_entry->msg_size,
@@ -1047,8 +1109,10 @@ static void rxm_handle_remote_write(struct rxm_ep *rxm_ep,
 	ofi_peer_cq_write(rxm_ep->util_ep.rx_cq, NULL, comp->flags, comp->len,
 			  NULL, comp->data, 0, FI_ADDR_NOTAVAIL);
 	ofi_ep_peer_rx_cntr_inc(&rxm_ep->util_ep, ofi_op_write);
-	if (comp->op_context)
+	if (comp->op_context) {
+		rxm_ep->rx_held++;
 		rxm_free_rx_buf(comp->op_context);
+	}
 }
 
 static void rxm_format_atomic_resp_pkt_hdr(struct rxm_conn *rxm_conn,
@@ -1365,6 +1429,21 @@ static ssize_t rxm_handle_credit(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_bu
 	return FI_SUCCESS;
 }
 
+static ssize_t rxm_handle_sar_ack(struct rxm_ep *rxm_ep,
+				  struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	conn = rx_buf->conn;
+	if (!conn)
+		conn = ofi_idm_at(&rxm_ep->conn_idx_map,
+				  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	if (conn)
+		rxm_tune_sar_ack(rxm_ep, conn, rx_buf->pkt.ctrl_hdr.ctrl_data);
+	rxm_free_rx_buf(rx_buf);
+	return FI_SUCCESS;
+}
+
 void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 			        struct rxm_tx_buf *tx_eager_buf)
 {
@@ -1381,6 +1460,18 @@ void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 	}
 }
 
+/* With a shared rx context, the conn is only known from the header */
+static void rxm_ref_rx_conn(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	conn = rx_buf->conn ? rx_buf->conn :
+	       ofi_idm_lookup(&rxm_ep->conn_idx_map,
+			      (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	if (conn)
+		conn->flags |= RXM_CONN_REFERENCED;
+}
+
 ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 {
 	struct rxm_rx_buf *rx_buf;
@@ -1401,6 +1492,8 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		rxm_free_tx_buf(rxm_ep, tx_buf);
 		return 0;
 	case RXM_CREDIT_TX:
+	case RXM_CLOSE_TX:
+	case RXM_SAR_ACK_TX:
 		tx_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
 		ofi_buf_free(tx_buf);
@@ -1416,6 +1509,9 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		assert(!(comp->flags & FI_REMOTE_READ));
 		assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
 		       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
+		rxm_ep->rx_held++;
+		if (rxm_conn_idle_timeout || rxm_max_conns)
+			rxm_ref_rx_conn(rxm_ep, rx_buf);
 
 		switch (rx_buf->pkt.ctrl_hdr.type) {
 		case rxm_ctrl_eager:
@@ -1436,6 +1532,10 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 			return rxm_handle_atomic_resp(rxm_ep, rx_buf);
 		case rxm_ctrl_credit:
 			return rxm_handle_credit(rxm_ep, rx_buf);
+		case rxm_ctrl_close:
+			return rxm_handle_close(rxm_ep, rx_buf);
+		case rxm_ctrl_sar_ack:
+			return rxm_handle_sar_ack(rxm_ep, rx_buf);
 		default:
 			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
 			assert(0);
@@ -1466,6 +1566,16 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		if (++rx_buf->rndv_rma_index < rx_buf->remote_rndv_hdr->count)
 			return 0;
 
+		if (rx_buf->rndv_err) {
+			struct fi_cq_err_entry err_entry = {
+				.err = rx_buf->rndv_err,
+				.prov_errno = rx_buf->rndv_err,
+			};
+
+			rxm_rndv_rx_fail(rx_buf, &err_entry);
+			return 0;
+		}
+
 		rxm_rndv_send_rd_done(rx_buf);
 		return 0;
 	case RXM_RNDV_WRITE:
@@ -1631,6 +1741,8 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 			cntr->peer_cntr->owner_ops->incerr(cntr->peer_cntr);
 		return;
 	case RXM_CREDIT_TX:
+	case RXM_CLOSE_TX:
+	case RXM_SAR_ACK_TX:
 	case RXM_ATOMIC_RESP_SENT: /* BUG: should have consumed tx credit */
 		tx_buf = err_entry.op_context;
 		ofi_buf_free(tx_buf);
@@ -1671,18 +1783,26 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 			ofi_buf_free((struct rxm_rx_buf *)err_entry.op_context);
 			return;
 		}
-		/* fall through */
-	case RXM_RNDV_READ_DONE_SENT:
-	case RXM_RNDV_WRITE_DATA_SENT: /* BUG: should fail initial send */
-	case RXM_RNDV_READ:
-		rx_buf = (struct rxm_rx_buf *) err_entry.op_context;
-		assert(rx_buf->peer_entry);
 		err_entry.op_context = rx_buf->peer_entry->context;
 		err_entry.flags = rx_buf->peer_entry->flags;
 
 		cq = rx_buf->ep->util_ep.rx_cq;
 		cntr = rx_buf->ep->util_ep.cntrs[CNTR_RX];
 		break;
+	case RXM_RNDV_READ:
+		/* Wait for the remaining reads before releasing the buffer */
+		rx_buf = (struct rxm_rx_buf *) err_entry.op_context;
+		if (!rx_buf->rndv_err)
+			rx_buf->rndv_err = err_entry.err;
+		if (++rx_buf->rndv_rma_index < rx_buf->remote_rndv_hdr->count)
+			return;
+
+		rxm_rndv_rx_fail(rx_buf, &err_entry);
+		return;
+	case RXM_RNDV_READ_DONE_SENT:
+	case RXM_RNDV_WRITE_DATA_SENT: /* BUG: should fail initial send */
+		rxm_rndv_rx_fail(err_entry.op_context, &err_entry);
+		return;
 	default:
 		FI_WARN(&rxm_prov, FI_LOG_CQ, "Invalid state!\nmsg cq error info: %s\n",
 			fi_cq_strerror(rxm_ep->msg_cq, err_entry.prov_errno,
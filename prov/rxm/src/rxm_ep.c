@@ -259,6 +259,34 @@ static ssize_t rxm_ep_cancel(fid_t fid_ep, void *context)
 	return ep->srx->ep_fid.ops->cancel(&ep->srx->ep_fid.fid, context);
 }
 
+/* Peers without a connection report the endpoint's starting value. */
+static int rxm_ep_get_peer_limit(struct rxm_ep *ep,
+				 struct fi_rxm_peer_limit *limit,
+				 size_t *optlen)
+{
+	struct util_peer_addr **peer;
+	struct rxm_conn *conn = NULL;
+
+	if (!ep->util_ep.av)
+		return -FI_EOPBADSTATE;
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	if (!ofi_bufpool_ibuf_is_valid(ep->util_ep.av->av_entry_pool,
+				       limit->addr)) {
+		ofi_genlock_unlock(&ep->util_ep.lock);
+		return -FI_EINVAL;
+	}
+
+	peer = ofi_av_addr_context(ep->util_ep.av, limit->addr);
+	if (*peer)
+		conn = ofi_idm_lookup(&ep->conn_idx_map, (*peer)->index);
+	limit->sar_limit = conn ? conn->tune.sar_limit : ep->sar_limit;
+	ofi_genlock_unlock(&ep->util_ep.lock);
+
+	*optlen = sizeof(*limit);
+	return FI_SUCCESS;
+}
+
 static int rxm_ep_getopt(fid_t fid, int level, int optname, void *optval,
 			 size_t *optlen)
 {
@@ -286,6 +314,18 @@ static int rxm_ep_getopt(fid_t fid, int level, int optname, void *optval,
 		*(size_t *)optval = rxm_ep->buffered_min;
 		*optlen = sizeof(size_t);
 		break;
+	case FI_OPT_RXM_EAGER_LIMIT:
+		*(size_t *)optval = rxm_ep->eager_limit;
+		*optlen = sizeof(size_t);
+		break;
+	case FI_OPT_RXM_SAR_LIMIT:
+		*(size_t *)optval = rxm_ep->sar_limit;
+		*optlen = sizeof(size_t);
+		break;
+	case FI_OPT_RXM_PEER_SAR_LIMIT:
+		if (*optlen < sizeof(struct fi_rxm_peer_limit))
+			return -FI_ETOOSMALL;
+		return rxm_ep_get_peer_limit(rxm_ep, optval, optlen);
 	default:
 		return -FI_ENOPROTOOPT;
 	}
@@ -650,6 +690,26 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 				return;
 			}
 			break;
+		case RXM_DEFERRED_TX_CTRL:
+			iov.iov_base = &def_tx_entry->ctrl_msg.tx_buf->pkt;
+			iov.iov_len = sizeof(def_tx_entry->ctrl_msg.tx_buf->pkt);
+
+			msg.addr = 0;
+			msg.context = def_tx_entry->ctrl_msg.tx_buf;
+			msg.data = 0;
+			msg.desc = &def_tx_entry->ctrl_msg.tx_buf->hdr.desc;
+			msg.iov_count = 1;
+			msg.msg_iov = &iov;
+
+			ret = fi_sendmsg(def_tx_entry->rxm_conn->msg_ep, &msg, 0);
+			if (ret) {
+				if (ret != -FI_EAGAIN) {
+					ofi_buf_free(def_tx_entry->ctrl_msg.tx_buf);
+					break;
+				}
+				return;
+			}
+			break;
 		}
 
 		rxm_dequeue_deferred_tx(def_tx_entry);
@@ -828,18 +888,128 @@ ssize_t rxm_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	return ret;
 }
 
+ssize_t rxm_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			void *desc, void *result, void *result_desc,
+			fi_addr_t coll_addr, enum fi_datatype datatype,
+			uint64_t flags, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_ALLTOALL, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_alltoall(coll_ep, buf, count, desc, result, result_desc,
+			  coll_addr, datatype, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_reduce_scatter(struct fid_ep *ep, const void *buf, size_t count,
+			      void *desc, void *result, void *result_desc,
+			      fi_addr_t coll_addr, enum fi_datatype datatype,
+			      enum fi_op op, uint64_t flags, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_REDUCE_SCATTER, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_reduce_scatter(coll_ep, buf, count, desc, result, result_desc,
+				coll_addr, datatype, op, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, enum fi_op op, uint64_t flags,
+		      void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_REDUCE, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_reduce(coll_ep, buf, count, desc, result, result_desc,
+			coll_addr, root_addr, datatype, op, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, uint64_t flags,
+		      void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_GATHER, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_gather(coll_ep, buf, count, desc, result, result_desc,
+			coll_addr, root_addr, datatype, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
 static struct fi_ops_collective rxm_ops_collective = {
 	.size = sizeof(struct fi_ops_collective),
 	.barrier = rxm_ep_barrier,
 	.barrier2 = rxm_ep_barrier2,
 	.broadcast = rxm_ep_broadcast,
-	.alltoall = fi_coll_no_alltoall,
+	.alltoall = rxm_ep_alltoall,
 	.allreduce = rxm_ep_allreduce,
 	.allgather = rxm_ep_allgather,
-	.reduce_scatter = fi_coll_no_reduce_scatter,
-	.reduce = fi_coll_no_reduce,
+	.reduce_scatter = rxm_ep_reduce_scatter,
+	.reduce = rxm_ep_reduce,
 	.scatter = rxm_ep_scatter,
-	.gather = fi_coll_no_gather,
+	.gather = rxm_ep_gather,
 	.msg = fi_coll_no_msg,
 };
 
@@ -896,6 +1066,10 @@ static int rxm_ep_close(struct fid *fid)
 	 */
 	rxm_stop_listen(ep);
 	rxm_freeall_conns(ep);
+	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "conns: connect %" PRIu64
+		" accept %" PRIu64 " evict %" PRIu64 " reconnect %" PRIu64 "\n",
+		ep->conn_stats.connect, ep->conn_stats.accept,
+		ep->conn_stats.evict, ep->conn_stats.reconnect);
 	ret = rxm_listener_close(ep);
 	if (ret)
 		return ret;
@@ -1094,6 +1268,7 @@ static void rxm_ep_init_proto(struct rxm_ep *ep)
 	/* SAR segment size is capped at 64k. */
 	if (ep->eager_limit > UINT16_MAX) {
 		ep->sar_limit = ep->eager_limit;
+		ep->proto_tune = false;
 		return;
 	}
 
@@ -1105,6 +1280,92 @@ static void rxm_ep_init_proto(struct rxm_ep *ep)
 	} else {
 		ep->sar_limit = ep->eager_limit * 8;
 	}
+
+	ep->proto_tune = rxm_proto_tune;
+	ep->sar_tune_max = MAX(ep->sar_limit,
+			       ep->eager_limit * RXM_TUNE_MAX_SEGS);
+}
+
+void rxm_tune_init(struct rxm_ep *ep, struct rxm_conn *conn)
+{
+	memset(&conn->tune, 0, sizeof(conn->tune));
+	conn->tune.sar_limit = ep->sar_limit;
+}
+
+/* Transfers are charged from the time they are posted until the data has
+ * been delivered, which includes any time spent waiting for tx resources.
+ * Samples taken before the switch point last moved are dropped.
+ */
+static void rxm_tune_sample(struct rxm_ep *ep, struct rxm_conn *conn,
+			    uint64_t start, size_t start_limit, size_t len,
+			    int proto)
+{
+	struct rxm_proto_tune *tune = &conn->tune;
+	uint64_t cost;
+	size_t limit;
+	int side;
+
+	if (start_limit != tune->sar_limit)
+		return;
+
+	side = (len <= tune->sar_limit) ? RXM_TUNE_BELOW : RXM_TUNE_ABOVE;
+	cost = (ofi_gettime_ns() - start) * 1024 / len;
+	if (tune->cnt[side][proto]++)
+		cost = (tune->cost[side][proto] * 7 + cost) / 8;
+	tune->cost[side][proto] = cost;
+
+	if (tune->cnt[side][RXM_TUNE_SAR] < RXM_TUNE_MIN_SAMPLES ||
+	    tune->cnt[side][RXM_TUNE_RNDV] < RXM_TUNE_MIN_SAMPLES)
+		return;
+
+	/* Require a 10% advantage before moving the switch point */
+	if (side == RXM_TUNE_BELOW &&
+	    tune->cost[side][RXM_TUNE_RNDV] * 10 <
+	    tune->cost[side][RXM_TUNE_SAR] * 9)
+		limit = MAX(tune->sar_limit / 2, ep->eager_limit);
+	else if (side == RXM_TUNE_ABOVE &&
+		 tune->cost[side][RXM_TUNE_SAR] * 10 <
+		 tune->cost[side][RXM_TUNE_RNDV] * 9)
+		limit = MIN(tune->sar_limit * 2, ep->sar_tune_max);
+	else
+		return;
+
+	if (limit == tune->sar_limit)
+		return;
+
+	FI_INFO(&rxm_prov, FI_LOG_EP_DATA,
+		"conn %p: SAR limit %zu -> %zu (SAR %" PRIu64 " ns/KiB, "
+		"rendezvous %" PRIu64 " ns/KiB)\n", conn, tune->sar_limit,
+		limit, tune->cost[side][RXM_TUNE_SAR],
+		tune->cost[side][RXM_TUNE_RNDV]);
+	memset(tune->cost, 0, sizeof(tune->cost));
+	memset(tune->cnt, 0, sizeof(tune->cnt));
+	tune->sar_limit = limit;
+}
+
+void rxm_tune_record(struct rxm_ep *ep, struct rxm_tx_buf *tx_buf, int proto)
+{
+	struct rxm_conn *conn = tx_buf->tune_conn;
+
+	if (!conn)
+		return;
+
+	tx_buf->tune_conn = NULL;
+	rxm_tune_sample(ep, conn, tx_buf->tune_start, tx_buf->tune_limit,
+			tx_buf->pkt.hdr.size, proto);
+}
+
+void rxm_tune_sar_ack(struct rxm_ep *ep, struct rxm_conn *conn,
+		      uint64_t msg_id)
+{
+	struct rxm_proto_tune *tune = &conn->tune;
+
+	if (!tune->sar_pending || tune->sar_msg_id != msg_id)
+		return;
+
+	tune->sar_pending = false;
+	rxm_tune_sample(ep, conn, tune->sar_start, tune->sar_limit_start,
+			tune->sar_len, RXM_TUNE_SAR);
 }
 
 /* Direct send works with verbs, provided that msg_mr_local == rdm_mr_local.
@@ -1164,10 +1425,11 @@ static void rxm_ep_settings_init(struct rxm_ep *rxm_ep)
 		"\t\t Completions per progress: MSG - %zu\n"
 	        "\t\t Buffered min: %zu\n"
 	        "\t\t inject size: %zu\n"
-		"\t\t Protocol limits: Eager: %zu, SAR: %zu\n",
+		"\t\t Protocol limits: Eager: %zu, SAR: %zu%s\n",
 		rxm_ep->msg_mr_local, rxm_ep->rdm_mr_local,
 		rxm_ep->comp_per_progress, rxm_ep->buffered_min,
-		rxm_ep->inject_limit, rxm_ep->eager_limit, rxm_ep->sar_limit);
+		rxm_ep->inject_limit, rxm_ep->eager_limit, rxm_ep->sar_limit,
+		rxm_ep->proto_tune ? " (tuned per connection)" : "");
 }
 
 static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
@@ -1781,6 +2043,7 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 		(*ep_fid)->atomic = &rxm_ops_atomic;
 
 	dlist_init(&rxm_ep->loopback_list);
+	dlist_init(&rxm_ep->conn_lru);
 
 	return 0;
 err2:
@@ -58,7 +58,10 @@ size_t rxm_packet_size;
 int rxm_passthru = 0; /* disable by default, need to analyze performance */
 int force_auto_progress;
 int rxm_use_write_rndv;
+int rxm_proto_tune;
 int rxm_detect_hmem_iface;
+size_t rxm_max_conns;
+int rxm_conn_idle_timeout;
 enum fi_wait_obj def_wait_obj = FI_WAIT_FD, def_tcp_wait_obj = FI_WAIT_UNSPEC;
 
 char *rxm_proto_state_str[] = {
@@ -682,6 +685,13 @@ RXM_INI
 			"RMA writes rather than RMA reads during Rendezvous "
 			"transactions. (default: false/no).");
 
+	fi_param_define(&rxm_prov, "proto_tune", FI_PARAM_BOOL,
+			"Calibrate the switch point between the SAR and "
+			"Rendezvous protocols separately for each connection, "
+			"based on observed send completion times.  The "
+			"sar_limit value is used as the starting point. "
+			"(default: false/no).");
+
 	fi_param_define(&rxm_prov, "enable_direct_send", FI_PARAM_BOOL,
 			"Enable support to pass application buffers directly "
 			"to the core provider when possible.  This avoids "
@@ -698,6 +708,18 @@ RXM_INI
 			"to the tcp provider, depending on the capabilities "
 			"requested by the application.");
 
+	fi_param_define(&rxm_prov, "max_conns", FI_PARAM_SIZE_T,
+			"Soft limit on the number of connections opened by "
+			"an endpoint.  When reached, the least recently used "
+			"idle connection is closed before a new one is opened. "
+			"Closed connections are re-established on their next "
+			"use.  Requires peer support. (default: 0, unlimited)");
+
+	fi_param_define(&rxm_prov, "conn_idle_timeout", FI_PARAM_INT,
+			"Close connections that have not been used for the "
+			"given number of milliseconds.  Requires peer support. "
+			"(default: 0, disabled)");
+
 	fi_param_define(&rxm_prov, "detect_hmem_iface", FI_PARAM_BOOL,
 			"Detect iface for user buffers with NULL desc passed "
 			"in. This allows such buffers be copied or registered "
@@ -720,6 +742,11 @@ RXM_INI
 		rxm_cq_eq_fairness = 128;
 	fi_param_get_bool(&rxm_prov, "data_auto_progress", &force_auto_progress);
 	fi_param_get_bool(&rxm_prov, "use_rndv_write", &rxm_use_write_rndv);
+	fi_param_get_bool(&rxm_prov, "proto_tune", &rxm_proto_tune);
+	fi_param_get_size_t(&rxm_prov, "max_conns", &rxm_max_conns);
+	fi_param_get_int(&rxm_prov, "conn_idle_timeout", &rxm_conn_idle_timeout);
+	if (rxm_conn_idle_timeout < 0)
+		rxm_conn_idle_timeout = 0;
 
 	rxm_get_def_wait();
 
@@ -266,7 +266,7 @@ static ssize_t
 rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	     const struct iovec *iov, void **desc, uint8_t count,
 	     void *context, uint64_t data, uint64_t flags, uint64_t tag,
-	     uint8_t op, size_t data_len, size_t segs_cnt)
+	     uint8_t op, size_t data_len, size_t segs_cnt, uint64_t start)
 {
 	struct rxm_tx_buf *tx_buf, *first_tx_buf;
 	size_t i, iov_offset = 0, remain_len = data_len;
@@ -286,6 +286,7 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	if (!first_tx_buf)
 		return -FI_EAGAIN;
 
+	rxm_tune_start_sar(rxm_ep, rxm_conn, first_tx_buf, data_len, start);
 	ret = ofi_copy_from_hmem_iov(first_tx_buf->pkt.data, rxm_buffer_size,
 				     iface, device, iov, count, iov_offset);
 	assert((size_t) ret == rxm_buffer_size);
@@ -298,8 +299,7 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	if (ret) {
 		if (ret == -FI_EAGAIN)
 			rxm_ep_do_progress(&rxm_ep->util_ep);
-		rxm_free_tx_buf(rxm_ep, first_tx_buf);
-		return ret;
+		goto free;
 	}
 
 	remain_len -= rxm_buffer_size;
@@ -321,6 +321,8 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	return 0;
 
 free:
+	if (rxm_sar_get_ack_req(&first_tx_buf->pkt.ctrl_hdr))
+		rxm_conn->tune.sar_pending = false;
 	rxm_free_tx_buf(rxm_ep, first_tx_buf);
 	return ret;
 defer:
@@ -497,7 +499,7 @@ rxm_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	struct rxm_tx_buf *rndv_buf;
 	size_t data_len, total_len;
 	enum fi_hmem_iface iface;
-	uint64_t device;
+	uint64_t device, start = 0;
 	ssize_t ret;
 
 	if (flags & FI_PEER_TRANSFER)
@@ -519,18 +521,28 @@ rxm_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		ret = rxm_send_eager(rxm_ep, rxm_conn, iov, desc, count,
 				     context, data, flags, tag, op,
 				     data_len, total_len);
-	} else if (data_len <= rxm_ep->sar_limit) {
+		return ret;
+	}
+
+	if (rxm_tune_band(rxm_ep, rxm_conn, data_len))
+		start = ofi_gettime_ns();
+
+	if (rxm_use_sar(rxm_ep, rxm_conn, data_len)) {
 		ret = rxm_send_sar(rxm_ep, rxm_conn, iov, desc, (uint8_t) count,
 				   context, data, flags, tag, op, data_len,
-				   rxm_ep_sar_calc_segs_cnt(rxm_ep, data_len));
+				   rxm_ep_sar_calc_segs_cnt(rxm_ep, data_len),
+				   start);
 	} else {
 rndv_send:
 		ret = rxm_alloc_rndv_buf(rxm_ep, rxm_conn, context,
 					 (uint8_t) count, iov, desc,
 					 data_len, data, flags, tag, op,
 					 iface, device, &rndv_buf);
-		if (ret >= 0)
+		if (ret >= 0) {
+			rxm_tune_start(rxm_ep, rxm_conn, rndv_buf, data_len,
+				       start);
 			ret = rxm_send_rndv(rxm_ep, rxm_conn, rndv_buf, ret);
+		}
 	}
 
 	return ret;
@@ -78,6 +78,9 @@ struct smr_env {
 	int use_dsa_sar;
 	size_t max_gdrcopy_size;
 	int use_xpmem;
+	size_t async_copy_threads;
+	int cq_doorbell;
+	size_t max_mapped_peers;
 };
 
 extern struct smr_env smr_env;
@@ -214,6 +217,26 @@ struct smr_unexp_buf {
 	char buf[SMR_SAR_SIZE];
 };
 
+/*
+ * Command slots reserved in a peer's command queue for sends posted with
+ * FI_MORE.  The commands are published together when the batch is flushed.
+ */
+#define SMR_CMD_BATCH_SIZE	8
+
+struct smr_cmd_batch {
+	struct smr_region	*peer_smr;
+	int64_t			pos;
+	/* written under the ep lock, read without it by smr_ep_flush_cmds() */
+	ofi_atomic64_t		cnt;
+	size_t			used;
+};
+
+static inline size_t smr_cmd_batch_cnt(struct smr_cmd_batch *batch)
+{
+	return (size_t) ofi_atomic_load_explicit64(&batch->cnt,
+						   memory_order_relaxed);
+}
+
 struct smr_ep {
 	struct util_ep		util_ep;
 	size_t			tx_size;
@@ -230,11 +253,13 @@ struct smr_ep {
 	struct dlist_entry	sar_list;
 	struct dlist_entry	ipc_cpy_pend_list;
 	size_t			min_multi_recv_size;
+	struct smr_cmd_batch	cmd_batch;
 
 	int			ep_idx;
 	enum ofi_shm_p2p_type	p2p_type;
 	struct smr_sock_info	*sock_info;
 	void			*dsa_context;
+	void			*async_context;
 	void 			(*smr_progress_ipc_list)(struct smr_ep *ep);
 };
 
@@ -250,14 +275,73 @@ static inline int smr_mmap_name(char *shm_name, const char *ep_name,
 
 int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 		  struct fid_ep **ep, void *context);
+
+int smr_get_cmd(struct smr_ep *ep, struct smr_region *peer_smr,
+		uint64_t op_flags, struct smr_cmd_entry **ce, int64_t *pos);
+void smr_put_cmd(struct smr_ep *ep, struct smr_region *peer_smr,
+		 struct smr_cmd_entry *ce, int64_t pos, uint64_t op_flags,
+		 bool success);
+void smr_flush_cmd_batch(struct smr_ep *ep);
+
+/* Publishes any batched commands ahead of an operation that bypasses the
+ * batch, to keep commands to a peer in order.  The unlocked check always
+ * sees a batch opened by the calling thread; one opened concurrently by
+ * another thread has no ordering to preserve.
+ */
+static inline void smr_ep_flush_cmds(struct smr_ep *ep)
+{
+	if (!smr_cmd_batch_cnt(&ep->cmd_batch))
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	smr_flush_cmd_batch(ep);
+	ofi_genlock_unlock(&ep->util_ep.lock);
+}
 void smr_ep_exchange_fds(struct smr_ep *ep, int64_t id);
 
 int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		struct fid_cq **cq_fid, void *context);
+bool smr_cq_has_doorbell(struct util_cq *cq);
 int smr_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 		  struct fid_cntr **cntr_fid, void *context);
 
 int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr);
+void smr_map_evict(struct smr_ep *ep);
+
+/* Unexpected commands other than inline and inject ones are completed
+ * through the sender's region, which must stay mapped until then.
+ */
+static inline bool smr_cmd_refs_peer(struct smr_cmd *cmd)
+{
+	return cmd->msg.hdr.op_src != smr_src_inline &&
+	       cmd->msg.hdr.op_src != smr_src_inject;
+}
+
+/* Marks the peer as recently used and maps its region back in if it was
+ * evicted by smr_map_evict().
+ */
+static inline int smr_use_peer(struct smr_ep *ep, int64_t id)
+{
+	struct smr_peer *peer = smr_map_peer(ep->region->map, id);
+	int ret;
+
+	peer->referenced = true;
+	if (OFI_LIKELY(peer->region != NULL))
+		return FI_SUCCESS;
+
+	ofi_spin_lock(&ep->region->map->lock);
+	ret = smr_map_to_region(&smr_prov, ep->region->map, id);
+	ofi_spin_unlock(&ep->region->map->lock);
+	return ret;
+}
+
+/* The SAR pool holds SMR_MAX_PEERS buffers.  Past that many peers each
+ * one still gets a buffer and contends for the pool.
+ */
+static inline uint32_t smr_sar_bufs_per_peer(int num_peers)
+{
+	return MAX(SMR_MAX_PEERS / num_peers, 1);
+}
 
 void smr_format_pend_resp(struct smr_tx_entry *pend, struct smr_cmd *cmd,
 			  void *context, struct ofi_mr **mr,
@@ -314,7 +398,7 @@ static inline bool smr_vma_enabled(struct smr_ep *ep,
 static inline void smr_set_ipc_valid(struct smr_region *region, uint64_t id)
 {
 	if (ofi_hmem_is_initialized(FI_HMEM_ZE) &&
-	    region->map->peers[id].pid_fd == -1)
+	    smr_map_peer(region->map, id)->pid_fd == -1)
 		smr_peer_data(region)[id].ipc_valid = 0;
         else
         	smr_peer_data(region)[id].ipc_valid = 1;
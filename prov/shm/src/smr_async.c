@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Software engine for asynchronous SAR copies.
+ *
+ * This offloads the copies into and out of SAR buffers to a pool of copy
+ * threads shared by all endpoints in the process, following the same model
+ * as the DSA engine: a copy request is split into chunks of at most one SAR
+ * buffer, the response is marked busy, and smr_async_progress() completes
+ * the request once all chunks have been copied.  Chunks are spread across
+ * the threads, so a batch of SAR buffers is filled or drained in parallel,
+ * while the progress thread is free to handle other transfers.  The copy
+ * threads are bound to the cpus of the NUMA node of the thread that opens
+ * the first endpoint.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ofi_mb.h"
+#include "smr.h"
+#include "smr_async.h"
+
+#define SMR_ASYNC_CMD_COUNT	32
+#define SMR_ASYNC_MAX_CHUNKS	(SMR_BUF_BATCH_MAX + SMR_IOV_LIMIT)
+#define SMR_ASYNC_QUEUE_SIZE	8192
+#define SMR_ASYNC_SPIN_COUNT	10000
+#define SMR_ASYNC_MAX_CPUS	1024
+
+struct smr_async_cmd;
+
+struct smr_async_chunk {
+	void			*dst;
+	const void		*src;
+	size_t			len;
+	struct smr_async_cmd	*cmd;
+};
+
+struct smr_async_cmd {
+	struct smr_async_chunk	chunk[SMR_ASYNC_MAX_CHUNKS];
+	ofi_atomic32_t		pending;
+	size_t			bytes_in_progress;
+	int			dir;
+	uint32_t		op;
+	void			*entry_ptr;
+	bool			in_use;
+};
+
+struct smr_async_context {
+	struct smr_async_cmd	cmd[SMR_ASYNC_CMD_COUNT];
+	int			in_use;
+	unsigned long		copy_type_stats[2];
+};
+
+static struct {
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct smr_async_chunk	*queue[SMR_ASYNC_QUEUE_SIZE];
+	uint64_t		head;
+	uint64_t		tail;
+	ofi_atomic32_t		queued;
+	int			sleepers;
+	bool			running;
+	bool			started;
+	pthread_t		*threads;
+	size_t			thread_cnt;
+} smr_async = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *smr_async_worker(void *arg)
+{
+	struct smr_async_chunk *chunk;
+	int spin = 0;
+
+	pthread_mutex_lock(&smr_async.lock);
+	while (smr_async.running) {
+		if (smr_async.head == smr_async.tail) {
+			if (spin < SMR_ASYNC_SPIN_COUNT) {
+				pthread_mutex_unlock(&smr_async.lock);
+				while (!ofi_atomic_get32(&smr_async.queued) &&
+				       spin++ < SMR_ASYNC_SPIN_COUNT)
+					;
+				pthread_mutex_lock(&smr_async.lock);
+				continue;
+			}
+
+			smr_async.sleepers++;
+			pthread_cond_wait(&smr_async.cond, &smr_async.lock);
+			smr_async.sleepers--;
+			spin = 0;
+			continue;
+		}
+
+		chunk = smr_async.queue[smr_async.tail++ %
+					SMR_ASYNC_QUEUE_SIZE];
+		ofi_atomic_dec32(&smr_async.queued);
+		pthread_mutex_unlock(&smr_async.lock);
+
+		memcpy(chunk->dst, chunk->src, chunk->len);
+		ofi_atomic_dec32(&chunk->cmd->pending);
+		spin = 0;
+
+		pthread_mutex_lock(&smr_async.lock);
+	}
+	pthread_mutex_unlock(&smr_async.lock);
+	return NULL;
+}
+
+static int smr_async_submit(struct smr_async_cmd *cmd, int chunk_cnt)
+{
+	int i;
+
+	pthread_mutex_lock(&smr_async.lock);
+	if (smr_async.head - smr_async.tail + chunk_cnt >
+	    SMR_ASYNC_QUEUE_SIZE) {
+		pthread_mutex_unlock(&smr_async.lock);
+		return -FI_EAGAIN;
+	}
+
+	ofi_atomic_set32(&cmd->pending, chunk_cnt);
+	for (i = 0; i < chunk_cnt; i++)
+		smr_async.queue[smr_async.head++ % SMR_ASYNC_QUEUE_SIZE] =
+			&cmd->chunk[i];
+	ofi_atomic_add32(&smr_async.queued, chunk_cnt);
+
+	if (smr_async.sleepers)
+		pthread_cond_broadcast(&smr_async.cond);
+	pthread_mutex_unlock(&smr_async.lock);
+	return 0;
+}
+
+/* Parse a sysfs cpu list, such as 0-3,8-11. */
+static int smr_async_parse_cpulist(const char *str, int *cpus, int max)
+{
+	char *end;
+	long start, stop;
+	int cnt = 0;
+
+	while (*str && cnt < max) {
+		start = strtol(str, &end, 10);
+		if (end == str)
+			break;
+		stop = start;
+		if (*end == '-')
+			stop = strtol(end + 1, &end, 10);
+		for (; start <= stop && cnt < max; start++)
+			cpus[cnt++] = (int) start;
+		str = (*end == ',') ? end + 1 : end;
+		if (*str == '\n')
+			break;
+	}
+	return cnt;
+}
+
+static int smr_async_node_cpus(int cpu, int *cpus, int max)
+{
+	char path[PATH_MAX], buf[4096];
+	struct dirent *entry;
+	int node = -1, cnt = 0;
+	FILE *file;
+	DIR *dir;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	dir = opendir(path);
+	if (!dir)
+		return 0;
+
+	while ((entry = readdir(dir))) {
+		if (sscanf(entry->d_name, "node%d", &node) == 1)
+			break;
+	}
+	closedir(dir);
+	if (node < 0)
+		return 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+		 node);
+	file = fopen(path, "r");
+	if (!file)
+		return 0;
+
+	if (fgets(buf, sizeof(buf), file))
+		cnt = smr_async_parse_cpulist(buf, cpus, max);
+	fclose(file);
+
+	FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+		"binding async copy threads to NUMA node %d\n", node);
+	return cnt;
+}
+
+/*
+ * Bind each thread to one cpu of the local NUMA node, starting with the
+ * cpu after the one running the caller, which is likely the application
+ * thread driving progress.
+ */
+static void smr_async_bind_threads(void)
+{
+	int *cpus, cnt, cpu, pos, i;
+	cpu_set_t set;
+
+	cpu = sched_getcpu();
+	if (cpu < 0)
+		return;
+
+	cpus = calloc(SMR_ASYNC_MAX_CPUS, sizeof(*cpus));
+	if (!cpus)
+		return;
+
+	cnt = smr_async_node_cpus(cpu, cpus, SMR_ASYNC_MAX_CPUS);
+	for (pos = 0; pos < cnt && cpus[pos] != cpu; pos++)
+		;
+
+	for (i = 0; cnt && i < smr_async.thread_cnt; i++) {
+		CPU_ZERO(&set);
+		CPU_SET(cpus[(pos + 1 + i) % cnt], &set);
+		if (pthread_setaffinity_np(smr_async.threads[i], sizeof(set),
+					   &set))
+			FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+				"unable to bind async copy thread\n");
+	}
+	free(cpus);
+}
+
+static void smr_async_stop(void)
+{
+	size_t i;
+
+	pthread_mutex_lock(&smr_async.lock);
+	smr_async.running = false;
+	pthread_cond_broadcast(&smr_async.cond);
+	pthread_mutex_unlock(&smr_async.lock);
+
+	for (i = 0; i < smr_async.thread_cnt; i++)
+		pthread_join(smr_async.threads[i], NULL);
+
+	free(smr_async.threads);
+	smr_async.threads = NULL;
+	smr_async.thread_cnt = 0;
+}
+
+static int smr_async_start(void)
+{
+	size_t i;
+	int ret;
+
+	smr_async.threads = calloc(smr_env.async_copy_threads,
+				   sizeof(*smr_async.threads));
+	if (!smr_async.threads)
+		return -FI_ENOMEM;
+
+	ofi_atomic_initialize32(&smr_async.queued, 0);
+	smr_async.running = true;
+	for (i = 0; i < smr_env.async_copy_threads; i++) {
+		ret = pthread_create(&smr_async.threads[i], NULL,
+				     smr_async_worker, NULL);
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"unable to create async copy thread: %s\n",
+				strerror(ret));
+			smr_async_stop();
+			return -ret;
+		}
+		smr_async.thread_cnt++;
+	}
+
+	smr_async_bind_threads();
+	return 0;
+}
+
+static void smr_async_copy_sar(struct smr_freestack *sar_pool,
+			       struct smr_async_cmd *async_cmd,
+			       struct smr_cmd *cmd, const struct iovec *iov,
+			       size_t count, size_t bytes_done, int *chunk_cnt)
+{
+	struct smr_sar_buf *smr_sar_buf;
+	struct smr_async_chunk *chunk;
+	size_t remaining_sar_size;
+	size_t remaining_iov_size;
+	size_t iov_index, iov_offset = bytes_done;
+	size_t sar_offset = 0;
+	size_t cmd_size;
+	int sar_index = 0;
+	char *iov_buf, *sar_buf;
+
+	for (iov_index = 0; iov_index < count; iov_index++) {
+		if (iov_offset < iov[iov_index].iov_len)
+			break;
+		iov_offset -= iov[iov_index].iov_len;
+	}
+
+	*chunk_cnt = 0;
+	async_cmd->bytes_in_progress = 0;
+	while ((iov_index < count) &&
+	       (sar_index < cmd->msg.data.buf_batch_size) &&
+	       (*chunk_cnt < SMR_ASYNC_MAX_CHUNKS)) {
+		smr_sar_buf = smr_freestack_get_entry_from_index(
+		    sar_pool, cmd->msg.data.sar[sar_index]);
+
+		iov_buf = (char *) iov[iov_index].iov_base + iov_offset;
+		sar_buf = (char *) smr_sar_buf->buf + sar_offset;
+
+		remaining_sar_size = SMR_SAR_SIZE - sar_offset;
+		remaining_iov_size = iov[iov_index].iov_len - iov_offset;
+		cmd_size = MIN(remaining_iov_size, remaining_sar_size);
+		assert(cmd_size > 0);
+
+		chunk = &async_cmd->chunk[(*chunk_cnt)++];
+		chunk->cmd = async_cmd;
+		chunk->len = cmd_size;
+		if (async_cmd->dir == OFI_COPY_BUF_TO_IOV) {
+			chunk->src = sar_buf;
+			chunk->dst = iov_buf;
+		} else {
+			chunk->src = iov_buf;
+			chunk->dst = sar_buf;
+		}
+		async_cmd->bytes_in_progress += cmd_size;
+
+		if (remaining_sar_size > remaining_iov_size) {
+			iov_index++;
+			iov_offset = 0;
+			sar_offset += cmd_size;
+		} else if (remaining_sar_size < remaining_iov_size) {
+			sar_index++;
+			sar_offset = 0;
+			iov_offset += cmd_size;
+		} else {
+			iov_index++;
+			iov_offset = 0;
+			sar_index++;
+			sar_offset = 0;
+		}
+	}
+	assert(async_cmd->bytes_in_progress > 0);
+}
+
+static size_t smr_async_copy(struct smr_ep *ep, struct smr_freestack *sar_pool,
+			     struct smr_resp *resp, struct smr_cmd *cmd,
+			     const struct iovec *iov, size_t count,
+			     size_t bytes_done, void *entry_ptr, int dir)
+{
+	struct smr_async_context *context = ep->async_context;
+	struct smr_async_cmd *async_cmd = NULL;
+	int i, chunk_cnt;
+
+	for (i = 0; i < SMR_ASYNC_CMD_COUNT; i++) {
+		if (!context->cmd[i].in_use) {
+			async_cmd = &context->cmd[i];
+			break;
+		}
+	}
+	if (!async_cmd)
+		return -FI_ENOMEM;
+
+	async_cmd->dir = dir;
+	async_cmd->op = cmd->msg.hdr.op;
+	async_cmd->entry_ptr = entry_ptr;
+	smr_async_copy_sar(sar_pool, async_cmd, cmd, iov, count, bytes_done,
+			   &chunk_cnt);
+
+	if (smr_async_submit(async_cmd, chunk_cnt))
+		return -FI_EAGAIN;
+
+	async_cmd->in_use = true;
+	context->in_use++;
+	context->copy_type_stats[dir]++;
+	resp->status = SMR_STATUS_BUSY;
+	return FI_SUCCESS;
+}
+
+size_t smr_async_copy_to_sar(struct smr_ep *ep, struct smr_freestack *sar_pool,
+		struct smr_resp *resp, struct smr_cmd *cmd,
+		const struct iovec *iov, size_t count, size_t *bytes_done,
+		void *entry_ptr)
+{
+	if (resp->status != SMR_STATUS_SAR_EMPTY)
+		return -FI_EAGAIN;
+
+	return smr_async_copy(ep, sar_pool, resp, cmd, iov, count,
+			      *bytes_done, entry_ptr, OFI_COPY_IOV_TO_BUF);
+}
+
+size_t smr_async_copy_from_sar(struct smr_ep *ep,
+		struct smr_freestack *sar_pool, struct smr_resp *resp,
+		struct smr_cmd *cmd, const struct iovec *iov, size_t count,
+		size_t *bytes_done, void *entry_ptr)
+{
+	if (resp->status != SMR_STATUS_SAR_FULL)
+		return -FI_EAGAIN;
+
+	return smr_async_copy(ep, sar_pool, resp, cmd, iov, count,
+			      *bytes_done, entry_ptr, OFI_COPY_BUF_TO_IOV);
+}
+
+static void smr_async_update_tx_entry(struct smr_region *smr,
+				      struct smr_async_cmd *async_cmd)
+{
+	struct smr_tx_entry *tx_entry = async_cmd->entry_ptr;
+	struct smr_resp *resp;
+
+	tx_entry->bytes_done += async_cmd->bytes_in_progress;
+	resp = smr_get_ptr(smr, tx_entry->cmd.msg.hdr.src_data);
+
+	assert(resp->status == SMR_STATUS_BUSY);
+	ofi_wmb();
+	resp->status = (async_cmd->dir == OFI_COPY_IOV_TO_BUF ?
+			SMR_STATUS_SAR_FULL : SMR_STATUS_SAR_EMPTY);
+}
+
+static void smr_async_update_sar_entry(struct smr_region *smr,
+				       struct smr_async_cmd *async_cmd)
+{
+	struct smr_pend_entry *sar_entry = async_cmd->entry_ptr;
+	struct smr_region *peer_smr;
+	struct smr_resp *resp;
+
+	sar_entry->bytes_done += async_cmd->bytes_in_progress;
+	peer_smr = smr_peer_region(smr, sar_entry->cmd.msg.hdr.id);
+	resp = smr_get_ptr(peer_smr, sar_entry->cmd.msg.hdr.src_data);
+
+	assert(resp->status == SMR_STATUS_BUSY);
+	ofi_wmb();
+	resp->status = (async_cmd->dir == OFI_COPY_IOV_TO_BUF ?
+			SMR_STATUS_SAR_FULL : SMR_STATUS_SAR_EMPTY);
+}
+
+void smr_async_progress(struct smr_ep *ep)
+{
+	struct smr_async_context *context = ep->async_context;
+	struct smr_async_cmd *async_cmd;
+	bool tx;
+	int i;
+
+	if (!context->in_use)
+		return;
+
+	pthread_spin_lock(&ep->region->lock);
+	for (i = 0; i < SMR_ASYNC_CMD_COUNT; i++) {
+		async_cmd = &context->cmd[i];
+		if (!async_cmd->in_use || ofi_atomic_get32(&async_cmd->pending))
+			continue;
+
+		/* The tx entry belongs to the side that owns the user buffer
+		 * of a send, or the target buffer of a read.
+		 */
+		tx = (async_cmd->op == ofi_op_read_req) ?
+		     (async_cmd->dir == OFI_COPY_BUF_TO_IOV) :
+		     (async_cmd->dir == OFI_COPY_IOV_TO_BUF);
+		if (tx)
+			smr_async_update_tx_entry(ep->region, async_cmd);
+		else
+			smr_async_update_sar_entry(ep->region, async_cmd);
+
+		async_cmd->in_use = false;
+		context->in_use--;
+	}
+	pthread_spin_unlock(&ep->region->lock);
+}
+
+void smr_async_context_init(struct smr_ep *ep)
+{
+	struct smr_async_context *context;
+	int i;
+
+	pthread_mutex_lock(&ep_list_lock);
+	if (!smr_async.started) {
+		if (smr_async_start()) {
+			smr_env.async_copy_threads = 0;
+			pthread_mutex_unlock(&ep_list_lock);
+			return;
+		}
+		smr_async.started = true;
+	}
+	pthread_mutex_unlock(&ep_list_lock);
+
+	context = calloc(1, sizeof(*context));
+	if (!context) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unable to allocate async copy context\n");
+		return;
+	}
+
+	for (i = 0; i < SMR_ASYNC_CMD_COUNT; i++)
+		ofi_atomic_initialize32(&context->cmd[i].pending, 0);
+
+	ep->async_context = context;
+}
+
+void smr_async_context_cleanup(struct smr_ep *ep)
+{
+	struct smr_async_context *context = ep->async_context;
+	int i;
+
+	if (!context)
+		return;
+
+	/* Copies reference the context and user buffers, so wait for them
+	 * to finish before releasing either.
+	 */
+	for (i = 0; i < SMR_ASYNC_CMD_COUNT; i++) {
+		while (context->cmd[i].in_use &&
+		       ofi_atomic_get32(&context->cmd[i].pending))
+			sched_yield();
+	}
+
+	FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+		"async copies: user to SAR buffer %lu, SAR buffer to user %lu\n",
+		context->copy_type_stats[OFI_COPY_IOV_TO_BUF],
+		context->copy_type_stats[OFI_COPY_BUF_TO_IOV]);
+
+	free(context);
+	ep->async_context = NULL;
+}
+
+void smr_async_cleanup(void)
+{
+	if (smr_async.started)
+		smr_async_stop();
+	smr_async.started = false;
+}
@@ -204,11 +204,14 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 	if (smr_peer_data(ep->region)[id].sar_status)
 		return -FI_EAGAIN;
 
+	ofi_genlock_lock(&ep->util_ep.lock);
+	smr_flush_cmd_batch(ep);
 	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
-		return -FI_EAGAIN;
+	if (ret == -FI_ENOENT) {
+		ret = -FI_EAGAIN;
+		goto unlock;
+	}
 
-	ofi_genlock_lock(&ep->util_ep.lock);
 	total_len = ofi_datatype_size(datatype) * ofi_total_ioc_cnt(ioc, count);
 
 	switch (op) {
@@ -268,6 +271,7 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 
 	smr_format_rma_ioc(&ce->rma_cmd, rma_ioc, rma_count);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 unlock:
 	ofi_genlock_unlock(&ep->util_ep.lock);
 	return ret;
@@ -357,6 +361,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 		goto out;
 	}
 
+	smr_ep_flush_cmds(ep);
 	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
 	if (ret == -FI_ENOENT)
 		return -FI_EAGAIN;
@@ -388,6 +393,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 
 	smr_format_rma_ioc(&ce->rma_cmd, &rma_ioc, 1);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, ofi_op_atomic);
 out:
 	return ret;
@@ -103,7 +103,7 @@ struct fi_domain_attr smr_domain_attr = {
 	.mr_key_size = sizeof_field(struct fi_rma_iov, key),
 	.cq_data_size = sizeof_field(struct smr_msg_hdr, data),
 	.cq_cnt = (1 << 10),
-	.ep_cnt = SMR_MAX_PEERS,
+	.ep_cnt = SMR_PEER_ID_MAX,
 	.tx_ctx_cnt = (1 << 10),
 	.rx_ctx_cnt = (1 << 10),
 	.max_ep_tx_ctx = 1,
@@ -123,7 +123,7 @@ struct fi_domain_attr smr_hmem_domain_attr = {
 	.mr_key_size = sizeof_field(struct fi_rma_iov, key),
 	.cq_data_size = sizeof_field(struct smr_msg_hdr, data),
 	.cq_cnt = (1 << 10),
-	.ep_cnt = SMR_MAX_PEERS,
+	.ep_cnt = SMR_PEER_ID_MAX,
 	.tx_ctx_cnt = (1 << 10),
 	.rx_ctx_cnt = (1 << 10),
 	.max_ep_tx_ctx = 1,
@@ -32,32 +32,23 @@
 
 #include "smr.h"
 
-static void smr_peer_addr_init(struct smr_addr *peer)
-{
-	memset(peer->name, 0, SMR_NAME_MAX);
-	peer->id = -1;
-}
-
 static int smr_name_compare(struct ofi_rbmap *map, void *key, void *data)
 {
 	struct smr_map *smr_map;
 
 	smr_map = container_of(map, struct smr_map, rbmap);
 
-	return strncmp(smr_map->peers[(uintptr_t) data].peer.name,
+	return strncmp(smr_map_peer(smr_map, (uintptr_t) data)->peer.name,
 		       (char *) key, SMR_NAME_MAX);
 }
 
 static int smr_map_init(const struct fi_provider *prov, struct smr_map *map,
-		 int peer_count, uint16_t flags)
+		 int64_t peer_count, size_t max_mapped, uint16_t flags)
 {
-	int i;
-
-	for (i = 0; i < peer_count; i++) {
-		smr_peer_addr_init(&map->peers[i].peer);
-		map->peers[i].fiaddr = FI_ADDR_NOTAVAIL;
-	}
+	map->max_peers = peer_count;
+	map->max_mapped = max_mapped;
 	map->flags = flags;
+	dlist_init(&map->mapped_list);
 
 	ofi_rbmap_init(&map->rbmap, smr_name_compare);
 	ofi_spin_init(&map->lock);
@@ -69,13 +60,16 @@ static void smr_map_cleanup(struct smr_map *map)
 {
 	int64_t i;
 
-	for (i = 0; i < SMR_MAX_PEERS; i++) {
-		if (map->peers[i].peer.id < 0)
+	for (i = 0; i < map->max_peers; i++) {
+		if (smr_map_peer_free(map, i))
 			continue;
 
 		smr_map_del(map, i);
 	}
 	ofi_rbmap_cleanup(&map->rbmap);
+
+	for (i = 0; i < SMR_PEER_BLOCK_MAX; i++)
+		free(map->peers[i]);
 }
 
 static int smr_av_close(struct fid *fid)
@@ -101,7 +95,8 @@ static fi_addr_t smr_get_addr(struct fi_peer_rx_entry *rx_entry)
 {
 	struct smr_cmd_ctx *cmd_ctx = rx_entry->peer_context;
 
-	return cmd_ctx->ep->region->map->peers[cmd_ctx->cmd.msg.hdr.id].fiaddr;
+	return smr_map_peer(cmd_ctx->ep->region->map,
+			    cmd_ctx->cmd.msg.hdr.id)->fiaddr;
 }
 
 
@@ -129,7 +124,7 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 		FI_INFO(&smr_prov, FI_LOG_AV, "%s\n", (const char *) addr);
 
 		util_addr = FI_ADDR_NOTAVAIL;
-		if (smr_av->used < SMR_MAX_PEERS) {
+		if (smr_av->used < smr_av->smr_map.max_peers) {
 			ret = smr_map_add(&smr_prov, &smr_av->smr_map,
 					  addr, &shm_id);
 			if (!ret) {
@@ -155,12 +150,14 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			continue;
 		}
 
-		assert(shm_id >= 0 && shm_id < SMR_MAX_PEERS);
+		assert(shm_id >= 0 && shm_id < smr_av->smr_map.max_peers);
 		if (flags & FI_AV_USER_ID) {
 			assert(fi_addr);
-			smr_av->smr_map.peers[shm_id].fiaddr = fi_addr[i];
+			smr_map_peer(&smr_av->smr_map, shm_id)->fiaddr =
+				fi_addr[i];
 		} else {
-			smr_av->smr_map.peers[shm_id].fiaddr = util_addr;
+			smr_map_peer(&smr_av->smr_map, shm_id)->fiaddr =
+				util_addr;
 		}
 		succ_count++;
 		smr_av->used++;
@@ -174,7 +171,7 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 					       av_entry);
         		smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			smr_ep->region->max_sar_buf_per_peer =
-				SMR_MAX_PEERS / smr_av->smr_map.num_peers;
+				smr_sar_bufs_per_peer(smr_av->smr_map.num_peers);
 			smr_ep->srx->owner_ops->foreach_unspec_addr(smr_ep->srx,
 								&smr_get_addr);
 		}
@@ -215,8 +212,8 @@ static int smr_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count
 			smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			if (smr_av->smr_map.num_peers > 0)
 				smr_ep->region->max_sar_buf_per_peer =
-					SMR_MAX_PEERS /
-					smr_av->smr_map.num_peers;
+					smr_sar_bufs_per_peer(
+						smr_av->smr_map.num_peers);
 			else
 				smr_ep->region->max_sar_buf_per_peer =
 					SMR_BUF_BATCH_MAX;
@@ -240,7 +237,7 @@ static int smr_av_lookup(struct fid_av *av, fi_addr_t fi_addr, void *addr,
 	smr_av = container_of(util_av, struct smr_av, util_av);
 
 	id = smr_addr_lookup(util_av, fi_addr);
-	name = smr_av->smr_map.peers[id].peer.name;
+	name = smr_map_peer(&smr_av->smr_map, id)->peer.name;
 
 	strncpy((char *) addr, name, *addrlen);
 
@@ -284,6 +281,7 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	struct util_domain *util_domain;
 	struct util_av_attr util_attr;
 	struct smr_av *smr_av;
+	size_t max_mapped;
 	int ret;
 
 	if (!attr) {
@@ -308,7 +306,7 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	util_attr.addrlen = sizeof(int64_t);
 	util_attr.context_len = 0;
 	util_attr.flags = 0;
-	if (attr->count > SMR_MAX_PEERS) {
+	if (attr->count > SMR_PEER_ID_MAX) {
 		FI_INFO(&smr_prov, FI_LOG_AV,
 			"count %d exceeds max peers\n", (int) attr->count);
 		ret = -FI_ENOSYS;
@@ -324,7 +322,18 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	(*av)->fid.ops = &smr_av_fi_ops;
 	(*av)->ops = &smr_av_ops;
 
-	ret = smr_map_init(&smr_prov, &smr_av->smr_map, SMR_MAX_PEERS,
+	/* Peer regions can only be unmapped behind the application's back
+	 * if it does not progress the endpoint while posting to it.
+	 */
+	max_mapped = smr_env.max_mapped_peers;
+	if (max_mapped && util_domain->threading == FI_THREAD_SAFE) {
+		FI_INFO(&smr_prov, FI_LOG_AV, "peer eviction disabled "
+			"with FI_THREAD_SAFE\n");
+		max_mapped = 0;
+	}
+
+	ret = smr_map_init(&smr_prov, &smr_av->smr_map,
+			   MAX(attr->count, SMR_MAX_PEERS), max_mapped,
 			   util_domain->info_domain_caps & FI_HMEM ?
 			   SMR_FLAG_HMEM_ENABLED : 0);
 	if (ret)
@@ -76,5 +76,6 @@ int smr_complete_rx(struct smr_ep *ep, void *context, uint32_t op,
 	flags &= ~FI_COMPLETION;
 
 	return ofi_peer_cq_write(ep->util_ep.rx_cq, context, flags, len, buf,
-				 data, tag, ep->region->map->peers[id].fiaddr);
+				 data, tag,
+				 smr_map_peer(ep->region->map, id)->fiaddr);
 }
\ No newline at end of file
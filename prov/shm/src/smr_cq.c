@@ -35,14 +35,162 @@
 
 #include "smr.h"
 
+/* Upper bound on a single doorbell sleep.  Peers only ring the doorbell when
+ * they queue a new command, so completions that arrive by other means, such
+ * as a peer updating the status of an outstanding send or another thread
+ * writing to the CQ directly, are picked up on the next timeout.
+ */
+#define SMR_DOORBELL_SLEEP_MS	10
+
+static struct fi_ops_cq smr_cq_doorbell_ops;
+
+bool smr_cq_has_doorbell(struct util_cq *cq)
+{
+	return cq && cq->cq_fid.ops == &smr_cq_doorbell_ops;
+}
+
+static bool smr_ep_idle(struct smr_ep *ep)
+{
+	return ofi_cirque_isempty(smr_resp_queue(ep->region)) &&
+	       dlist_empty(&ep->sar_list) &&
+	       dlist_empty(&ep->ipc_cpy_pend_list);
+}
+
+/* Returns the region of the only endpoint bound to the CQ, provided that
+ * endpoint has no outstanding transfers.  The caller is registered as a
+ * sleeper on the region before the endpoint is checked.
+ */
+static struct smr_region *smr_cq_sleep_region(struct util_cq *cq,
+					      uint32_t *seq)
+{
+	struct fid_list_entry *entry;
+	struct smr_region *region = NULL;
+	struct smr_ep *ep;
+
+	ofi_genlock_lock(&cq->ep_list_lock);
+	if (dlist_empty(&cq->ep_list) || cq->ep_list.next->next != &cq->ep_list)
+		goto out;
+
+	entry = container_of(cq->ep_list.next, struct fid_list_entry, entry);
+	ep = container_of(entry->fid, struct smr_ep, util_ep.ep_fid.fid);
+	if (!ep->region)
+		goto out;
+
+	*seq = (uint32_t) ofi_atomic_get32(&ep->region->doorbell);
+	ofi_atomic_inc32(&ep->region->sleepers);
+	ofi_mb();
+	if (smr_ep_idle(ep))
+		region = ep->region;
+	else
+		ofi_atomic_dec32(&ep->region->sleepers);
+out:
+	ofi_genlock_unlock(&cq->ep_list_lock);
+	return region;
+}
+
+static ssize_t smr_cq_sreadfrom(struct fid_cq *cq_fid, void *buf,
+				size_t count, fi_addr_t *src_addr,
+				const void *cond, int timeout)
+{
+	struct smr_region *region;
+	struct util_cq *cq;
+	uint64_t endtime;
+	uint32_t seq;
+	ssize_t ret;
+
+	cq = container_of(cq_fid, struct util_cq, cq_fid);
+	endtime = ofi_timeout_time(timeout);
+
+	do {
+		/* Register as a sleeper before the final check for work, so
+		 * that a command queued after the check rings the doorbell.
+		 */
+		region = smr_cq_sleep_region(cq, &seq);
+		ret = fi_cq_readfrom(cq_fid, buf, count, src_addr);
+		if (ret != -FI_EAGAIN)
+			break;
+
+		if (ofi_adjust_timeout(endtime, &timeout))
+			break;
+
+		if (ofi_atomic_get32(&cq->wakeup)) {
+			ofi_atomic_set32(&cq->wakeup, 0);
+			break;
+		}
+
+		if (!region) {
+			sched_yield();
+			ret = 0;
+			continue;
+		}
+
+		ret = ofi_futex_wait_shared((uint32_t *)
+				ofi_atomic_ptr(&region->doorbell), seq,
+				(timeout < 0 || timeout > SMR_DOORBELL_SLEEP_MS) ?
+				SMR_DOORBELL_SLEEP_MS : timeout);
+		ofi_atomic_dec32(&region->sleepers);
+		region = NULL;
+		if (ret == -FI_ETIMEDOUT)
+			ret = 0;
+	} while (!ret);
+
+	if (region)
+		ofi_atomic_dec32(&region->sleepers);
+	return ret;
+}
+
+static ssize_t smr_cq_sread(struct fid_cq *cq_fid, void *buf, size_t count,
+			    const void *cond, int timeout)
+{
+	return smr_cq_sreadfrom(cq_fid, buf, count, NULL, cond, timeout);
+}
+
+static int smr_cq_signal(struct fid_cq *cq_fid)
+{
+	struct fid_list_entry *entry;
+	struct util_cq *cq;
+	struct smr_ep *ep;
+
+	cq = container_of(cq_fid, struct util_cq, cq_fid);
+	ofi_atomic_set32(&cq->wakeup, 1);
+
+	ofi_genlock_lock(&cq->ep_list_lock);
+	dlist_foreach_container(&cq->ep_list, struct fid_list_entry,
+				entry, entry) {
+		ep = container_of(entry->fid, struct smr_ep,
+				  util_ep.ep_fid.fid);
+		if (ep->region)
+			smr_ring_doorbell(ep->region);
+	}
+	ofi_genlock_unlock(&cq->ep_list_lock);
+	return 0;
+}
+
+static struct fi_ops_cq smr_cq_doorbell_ops = {
+	.size = sizeof(struct fi_ops_cq),
+	.read = ofi_cq_read,
+	.readfrom = ofi_cq_readfrom,
+	.readerr = ofi_cq_readerr,
+	.sread = smr_cq_sread,
+	.sreadfrom = smr_cq_sreadfrom,
+	.signal = smr_cq_signal,
+	.strerror = ofi_cq_strerror,
+};
+
 int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		struct fid_cq **cq_fid, void *context)
 {
 	struct util_cq *cq;
+	bool doorbell = false;
 	int ret;
 
 	switch (attr->wait_obj) {
 	case FI_WAIT_UNSPEC:
+		if (smr_env.cq_doorbell) {
+			attr->wait_obj = FI_WAIT_NONE;
+			doorbell = true;
+			break;
+		}
 		attr->wait_obj = FI_WAIT_YIELD;
 		/* fall through */
 	case FI_WAIT_NONE:
@@ -62,6 +210,11 @@ int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		return ret;
 
+	if (doorbell) {
+		attr->wait_obj = FI_WAIT_UNSPEC;
+		cq->cq_fid.ops = &smr_cq_doorbell_ops;
+	}
+
 	(*cq_fid) = &cq->cq_fid;
 
 	return FI_SUCCESS;
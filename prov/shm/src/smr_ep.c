@@ -42,6 +42,7 @@
 #include "smr_signal.h"
 #include "smr.h"
 #include "smr_dsa.h"
+#include "smr_async.h"
 #include "ofi_xpmem.h"
 
 extern struct fi_ops_msg smr_msg_ops, smr_no_recv_msg_ops;
@@ -171,6 +172,82 @@ static struct fi_ops_ep smr_ep_ops = {
 	.tx_size_left = fi_no_tx_size_left,
 };
 
+void smr_flush_cmd_batch(struct smr_ep *ep)
+{
+	struct smr_cmd_batch *batch = &ep->cmd_batch;
+	struct smr_cmd_queue *queue;
+	size_t cnt = smr_cmd_batch_cnt(batch);
+	int64_t pos;
+
+	if (!cnt)
+		return;
+
+	queue = smr_cmd_queue(batch->peer_smr);
+	for (pos = batch->pos + batch->used; pos < batch->pos + cnt; pos++)
+		smr_cmd_queue_discard(smr_cmd_queue_buf(queue, pos), pos);
+
+	smr_cmd_queue_commit_n(queue, batch->pos, batch->used);
+	ofi_atomic_store_explicit64(&batch->cnt, 0, memory_order_relaxed);
+	if (batch->used)
+		smr_ring_doorbell(batch->peer_smr);
+}
+
+/* Returns a command slot in the peer's command queue.  Called with the ep
+ * lock held.  Sends posted with FI_MORE take their slot from a batch that
+ * is reserved with a single atomic update and published by smr_put_cmd()
+ * once a send without FI_MORE is posted or the batch fills up.
+ */
+int smr_get_cmd(struct smr_ep *ep, struct smr_region *peer_smr,
+		uint64_t op_flags, struct smr_cmd_entry **ce, int64_t *pos)
+{
+	struct smr_cmd_batch *batch = &ep->cmd_batch;
+	struct smr_cmd_queue *queue = smr_cmd_queue(peer_smr);
+
+	if (smr_cmd_batch_cnt(batch) && batch->peer_smr != peer_smr)
+		smr_flush_cmd_batch(ep);
+
+	if (!smr_cmd_batch_cnt(batch) && (op_flags & FI_MORE) &&
+	    !smr_cmd_queue_next_n(queue, SMR_CMD_BATCH_SIZE, &batch->pos)) {
+		batch->peer_smr = peer_smr;
+		batch->used = 0;
+		ofi_atomic_store_explicit64(&batch->cnt, SMR_CMD_BATCH_SIZE,
+					    memory_order_relaxed);
+	}
+
+	if (!smr_cmd_batch_cnt(batch))
+		return smr_cmd_queue_next(queue, ce, pos);
+
+	*pos = batch->pos + batch->used++;
+	*ce = smr_cmd_queue_buf(queue, *pos);
+	return FI_SUCCESS;
+}
+
+void smr_put_cmd(struct smr_ep *ep, struct smr_region *peer_smr,
+		 struct smr_cmd_entry *ce, int64_t pos, uint64_t op_flags,
+		 bool success)
+{
+	struct smr_cmd_batch *batch = &ep->cmd_batch;
+	size_t cnt = smr_cmd_batch_cnt(batch);
+
+	if (!cnt) {
+		if (success) {
+			smr_cmd_queue_commit(ce, pos);
+			smr_ring_doorbell(peer_smr);
+		} else {
+			smr_cmd_queue_discard(ce, pos);
+		}
+		return;
+	}
+
+	/* a failed command gives its slot back to the batch */
+	assert(pos == batch->pos + batch->used - 1);
+	if (!success)
+		batch->used--;
+
+	if (!(op_flags & FI_MORE) || batch->used == cnt)
+		smr_flush_cmd_batch(ep);
+}
+
 static void smr_send_name(struct smr_ep *ep, int64_t id)
 {
 	struct smr_region *peer_smr;
@@ -205,6 +282,7 @@ static void smr_send_name(struct smr_ep *ep, int64_t id)
 
 	smr_peer_data(ep->region)[id].name_sent = 1;
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 }
 
 int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
@@ -213,21 +291,19 @@ int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
 	int ret;
 
 	id = smr_addr_lookup(ep->util_ep.av, fi_addr);
-	assert(id < SMR_MAX_PEERS);
+	assert(id < ep->region->map->max_peers);
 	if (id < 0)
 		return -1;
 
-	if (smr_peer_data(ep->region)[id].addr.id >= 0)
+	if (smr_peer_data(ep->region)[id].addr.id >= 0) {
+		smr_map_peer(ep->region->map, id)->referenced = true;
 		return id;
-
-	if (!ep->region->map->peers[id].region) {
-		ofi_spin_lock(&ep->region->map->lock);
-		ret = smr_map_to_region(&smr_prov, ep->region->map, id);
-		ofi_spin_unlock(&ep->region->map->lock);
-		if (ret)
-			return -1;
 	}
 
+	ret = smr_use_peer(ep, id);
+	if (ret)
+		return -1;
+
 	smr_send_name(ep, id);
 
 	return -1;
@@ -532,6 +608,19 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 				}
 				return -FI_EAGAIN;
 			}
+		} else if (smr_async_sar(ep, cmd, mr, count)) {
+			ret = smr_async_copy_to_sar(ep, smr_sar_pool(peer_smr),
+					resp, cmd, iov, count,
+					&pending->bytes_done, pending);
+			if (ret != FI_SUCCESS) {
+				for (i = cmd->msg.data.buf_batch_size - 1;
+				     i >= 0; i--) {
+					smr_freestack_push_by_index(
+					    smr_sar_pool(peer_smr),
+					    cmd->msg.data.sar[i]);
+				}
+				return -FI_EAGAIN;
+			}
 		} else {
 			smr_copy_to_sar(smr_sar_pool(peer_smr), resp, cmd,
 					mr, iov, count, &pending->bytes_done);
@@ -793,8 +882,11 @@ static int smr_ep_close(struct fid *fid)
 
 	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
 
+	smr_ep_flush_cmds(ep);
+
 	if (smr_env.use_dsa_sar)
 		smr_dsa_context_cleanup(ep);
+	smr_async_context_cleanup(ep);
 
 	if (ep->sock_info) {
 		fd_signal_set(&ep->sock_info->signal);
@@ -1034,6 +1126,10 @@ static int smr_discard(struct fi_peer_rx_entry *rx_entry)
 	struct smr_region *peer_smr;
 	struct smr_resp *resp;
 
+	if (smr_cmd_refs_peer(&cmd_ctx->cmd))
+		smr_map_peer(cmd_ctx->ep->region->map,
+			     cmd_ctx->cmd.msg.hdr.id)->unexp_cnt--;
+
 	if (cmd_ctx->cmd.msg.hdr.src_data >= smr_src_iov) {
 		peer_smr = smr_peer_region(cmd_ctx->ep->region,
 					   cmd_ctx->cmd.msg.hdr.id);
@@ -1123,6 +1219,9 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 		attr.tx_count = ep->tx_size;
 		attr.flags = ep->util_ep.caps & FI_HMEM ?
 				SMR_FLAG_HMEM_ENABLED : 0;
+		if (smr_cq_has_doorbell(ep->util_ep.rx_cq) ||
+		    smr_cq_has_doorbell(ep->util_ep.tx_cq))
+			attr.flags |= SMR_FLAG_DOORBELL;
 
 		ret = smr_create(&smr_prov, &av->smr_map, &attr, &ep->region);
 		if (ret)
@@ -1166,6 +1265,8 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 
 		if (smr_env.use_dsa_sar)
 			smr_dsa_context_init(ep);
+		else if (smr_env.async_copy_threads)
+			smr_async_context_init(ep);
 
 		/* if XPMEM is on after exchanging peer info, then set the
 		 * endpoint p2p to XPMEM so it can be used on the fast
@@ -1289,6 +1390,7 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	ep->rx_size = info->rx_attr->size;
 	ep->tx_size = info->tx_attr->size;
+	ofi_atomic_initialize64(&ep->cmd_batch.cnt, 0);
 	ret = ofi_endpoint_init(domain, &smr_util_prov, info, &ep->util_ep, context,
 				smr_ep_progress);
 	if (ret)
@@ -36,6 +36,7 @@
 #include "smr.h"
 #include "smr_signal.h"
 #include "smr_dsa.h"
+#include "smr_async.h"
 #include <ofi_hmem.h>
 
 struct sigaction *old_action = NULL;
@@ -46,6 +47,9 @@ struct smr_env smr_env = {
 	.use_dsa_sar = false,
 	.max_gdrcopy_size = 3072,
 	.use_xpmem = false,
+	.async_copy_threads = 0,
+	.cq_doorbell = false,
+	.max_mapped_peers = 0,
 };
 
 static void smr_init_env(void)
@@ -56,6 +60,11 @@ static void smr_init_env(void)
 	fi_param_get_bool(&smr_prov, "disable_cma", &smr_env.disable_cma);
 	fi_param_get_bool(&smr_prov, "use_dsa_sar", &smr_env.use_dsa_sar);
 	fi_param_get_bool(&smr_prov, "use_xpmem", &smr_env.use_xpmem);
+	fi_param_get_size_t(&smr_prov, "async_copy_threads",
+			    &smr_env.async_copy_threads);
+	fi_param_get_bool(&smr_prov, "cq_doorbell", &smr_env.cq_doorbell);
+	fi_param_get_size_t(&smr_prov, "max_mapped_peers",
+			    &smr_env.max_mapped_peers);
 }
 
 static void smr_resolve_addr(const char *node, const char *service,
@@ -107,6 +116,7 @@ static int smr_shm_space_check(size_t tx_count, size_t rx_count)
 	}
 	shm_size_needed = num_of_core *
 			  smr_calculate_size_offsets(tx_count, rx_count,
+						     SMR_MAX_PEERS,
 						     NULL, NULL, NULL,
 						     NULL, NULL, NULL,
 						     NULL);
@@ -181,6 +191,7 @@ static void smr_fini(void)
 	ofi_hmem_cleanup();
 #endif
 	smr_dsa_cleanup();
+	smr_async_cleanup();
 	smr_cleanup();
 	free(old_action);
 }
@@ -222,6 +233,22 @@ SHM_INI
 	fi_param_define(&smr_prov, "use_xpmem", FI_PARAM_BOOL,
 			"Enable XPMEM over CMA when possible "
 			"(default: false)");
+	fi_param_define(&smr_prov, "async_copy_threads", FI_PARAM_SIZE_T,
+			"Number of threads used to copy data into and out of "
+			"SAR buffers asynchronously when DSA is not in use. "
+			"The threads are bound to the NUMA node of the thread "
+			"that enables the first endpoint. Default: 0 (disabled)");
+	fi_param_define(&smr_prov, "cq_doorbell", FI_PARAM_BOOL,
+			"Block in fi_cq_sread on a shared memory futex that "
+			"peers ring when they queue a command, instead of "
+			"spinning with sched_yield.  Applies to CQs opened "
+			"with FI_WAIT_UNSPEC. Default: false");
+	fi_param_define(&smr_prov, "max_mapped_peers", FI_PARAM_SIZE_T,
+			"Maximum number of peer regions to keep mapped per "
+			"AV.  Regions of idle peers are unmapped, least "
+			"recently used first, and mapped again on the next "
+			"transfer.  Not applied with FI_THREAD_SAFE. "
+			"Default: 0 (no limit)");
 
 	smr_init_env();
 
@@ -102,11 +102,12 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 	if (smr_peer_data(ep->region)[id].sar_status)
 		return -FI_EAGAIN;
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
-		return -FI_EAGAIN;
-
 	ofi_genlock_lock(&ep->util_ep.lock);
+	ret = smr_get_cmd(ep, peer_smr, op_flags, &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ret = -FI_EAGAIN;
+		goto unlock;
+	}
 
 	total_len = ofi_total_iov_len(iov, iov_count);
 	assert(!(op_flags & FI_INJECT) || total_len <= SMR_INJECT_SIZE);
@@ -118,11 +119,9 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, tag, data, op_flags,
 				   (struct ofi_mr **)desc, iov, iov_count, total_len,
 				   context, &ce->cmd);
-	if (ret) {
-		smr_cmd_queue_discard(ce, pos);
+	smr_put_cmd(ep, peer_smr, ce, pos, op_flags, !ret);
+	if (ret)
 		goto unlock;
-	}
-	smr_cmd_queue_commit(ce, pos);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -207,6 +206,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 	if (smr_peer_data(ep->region)[id].sar_status)
 		return -FI_EAGAIN;
 
+	smr_ep_flush_cmds(ep);
 	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
 	if (ret == -FI_ENOENT)
 		return -FI_EAGAIN;
@@ -219,6 +219,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 		return -FI_EAGAIN;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
 	return FI_SUCCESS;
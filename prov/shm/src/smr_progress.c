@@ -42,6 +42,7 @@
 #include "ofi_shm_p2p.h"
 #include "smr.h"
 #include "smr_dsa.h"
+#include "smr_async.h"
 
 static inline void
 smr_try_progress_to_sar(struct smr_ep *ep, struct smr_region *smr,
@@ -55,6 +56,9 @@ smr_try_progress_to_sar(struct smr_ep *ep, struct smr_region *smr,
 			(void) smr_dsa_copy_to_sar(ep, sar_pool, resp, cmd, iov,
 					    iov_count, bytes_done, entry_ptr);
 			return;
+		} else if (smr_async_sar(ep, cmd, mr, iov_count)) {
+			(void) smr_async_copy_to_sar(ep, sar_pool, resp, cmd,
+					iov, iov_count, bytes_done, entry_ptr);
 		} else {
 			smr_copy_to_sar(sar_pool, resp, cmd, mr, iov, iov_count,
 					bytes_done);
@@ -74,6 +78,9 @@ smr_try_progress_from_sar(struct smr_ep *ep, struct smr_region *smr,
 			(void) smr_dsa_copy_from_sar(ep, sar_pool, resp, cmd,
 					iov, iov_count, bytes_done, entry_ptr);
 			return;
+		} else if (smr_async_sar(ep, cmd, mr, iov_count)) {
+			(void) smr_async_copy_from_sar(ep, sar_pool, resp, cmd,
+					iov, iov_count, bytes_done, entry_ptr);
 		} else {
 			smr_copy_from_sar(sar_pool, resp, cmd, mr,
 					  iov, iov_count, bytes_done);
@@ -335,14 +342,14 @@ static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 			      size_t iov_count, size_t *total_len)
 {
 	char shm_name[SMR_NAME_MAX];
+	struct smr_peer *peer;
 	void *mapped_ptr;
 	int fd, num;
 	int ret = 0;
 	ssize_t hmem_copy_ret;
 
-	num = smr_mmap_name(shm_name,
-			ep->region->map->peers[cmd->msg.hdr.id].peer.name,
-			cmd->msg.hdr.msg_id);
+	peer = smr_map_peer(ep->region->map, cmd->msg.hdr.id);
+	num = smr_mmap_name(shm_name, peer->peer.name, cmd->msg.hdr.msg_id);
 	if (num < 0) {
 		FI_WARN(&smr_prov, FI_LOG_AV, "generating shm file name failed\n");
 		return -errno;
@@ -542,7 +549,8 @@ static struct smr_pend_entry *smr_progress_ipc(struct smr_cmd *cmd,
 
 	if (cmd->msg.data.ipc_info.iface == FI_HMEM_ZE)
 		ze_set_pid_fd((void **) &cmd->msg.data.ipc_info.ipc_handle,
-			      ep->region->map->peers[cmd->msg.hdr.id].pid_fd);
+			      smr_map_peer(ep->region->map,
+					   cmd->msg.hdr.id)->pid_fd);
 
 	//TODO disable IPC if more than 1 interface is initialized
 	ret = ofi_ipc_cache_search(domain->ipc_cache, cmd->msg.hdr.id,
@@ -846,6 +854,10 @@ int smr_unexp_start(struct fi_peer_rx_entry *rx_entry)
 	struct smr_cmd_ctx *cmd_ctx = rx_entry->peer_context;
 	int ret;
 
+	if (smr_cmd_refs_peer(&cmd_ctx->cmd))
+		smr_map_peer(cmd_ctx->ep->region->map,
+			     cmd_ctx->cmd.msg.hdr.id)->unexp_cnt--;
+
 	if (cmd_ctx->cmd.msg.hdr.op_src == smr_src_sar ||
 	    cmd_ctx->cmd.msg.hdr.op_src == smr_src_inject)
 		ret = smr_copy_saved(cmd_ctx, rx_entry);
@@ -907,8 +919,8 @@ static void smr_progress_connreq(struct smr_ep *ep, struct smr_cmd *cmd)
 
 	smr_release_txbuf(ep->region, tx_buf);
 	assert(ep->region->map->num_peers > 0);
-	ep->region->max_sar_buf_per_peer = SMR_MAX_PEERS /
-		ep->region->map->num_peers;
+	ep->region->max_sar_buf_per_peer =
+		smr_sar_bufs_per_peer(ep->region->map->num_peers);
 }
 
 static int smr_alloc_cmd_ctx(struct smr_ep *ep,
@@ -976,6 +988,9 @@ static int smr_alloc_cmd_ctx(struct smr_ep *ep,
 		memcpy(&cmd_ctx->cmd, cmd, sizeof(*cmd));
 	}
 
+	if (smr_cmd_refs_peer(cmd))
+		smr_map_peer(ep->region->map, cmd->msg.hdr.id)->unexp_cnt++;
+
 	rx_entry->peer_context = cmd_ctx;
 	return FI_SUCCESS;
 }
@@ -986,7 +1001,7 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 	struct fi_peer_rx_entry *rx_entry;
 	int ret;
 
-	attr.addr = ep->region->map->peers[cmd->msg.hdr.id].fiaddr;
+	attr.addr = smr_map_peer(ep->region->map, cmd->msg.hdr.id)->fiaddr;
 	attr.msg_size = cmd->msg.hdr.size;
 	attr.tag = cmd->msg.hdr.tag;
 	if (cmd->msg.hdr.op == ofi_op_tagged) {
@@ -1232,6 +1247,16 @@ static void smr_progress_cmd(struct smr_ep *ep)
 		ret = smr_cmd_queue_head(smr_cmd_queue(ep->region), &ce, &pos);
 		if (ret == -FI_ENOENT)
 			break;
+		if (ce->cmd.msg.hdr.op < SMR_OP_MAX) {
+			ret = smr_use_peer(ep, ce->cmd.msg.hdr.id);
+			if (ret) {
+				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+					"Could not map peer region\n");
+				smr_cmd_queue_release(smr_cmd_queue(ep->region),
+						      ce, pos);
+				break;
+			}
+		}
 		switch (ce->cmd.msg.hdr.op) {
 		case ofi_op_msg:
 		case ofi_op_tagged:
@@ -1454,12 +1479,24 @@ void smr_ep_progress(struct util_ep *util_ep)
 
 	ep = container_of(util_ep, struct smr_ep, util_ep);
 
+	/* don't hold batched commands if the app stops posting */
+	smr_ep_flush_cmds(ep);
+
 	if (smr_env.use_dsa_sar)
 		smr_dsa_progress(ep);
+	else if (ep->async_context)
+		smr_async_progress(ep);
 	smr_progress_resp(ep);
 	smr_progress_sar_list(ep);
 	smr_progress_cmd(ep);
 
+	if (ep->region->map->max_mapped &&
+	    ep->region->map->num_mapped > ep->region->map->max_mapped) {
+		ofi_genlock_lock(&ep->util_ep.lock);
+		smr_map_evict(ep);
+		ofi_genlock_unlock(&ep->util_ep.lock);
+	}
+
 	/* always drive forward the ipc list since the completion is
 	 * independent of any action by the provider */
 	ep->smr_progress_ipc_list(ep);
@@ -95,6 +95,7 @@ static ssize_t smr_rma_fast(struct smr_ep *ep, struct smr_region *peer_smr,
 			    (op == ofi_op_write) ? ofi_op_write_async :
 			    ofi_op_read_async, op_flags);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 	return FI_SUCCESS;
 }
 
@@ -134,6 +135,7 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 		return -FI_EAGAIN;
 
 	ofi_genlock_lock(&ep->util_ep.lock);
+	smr_flush_cmd_batch(ep);
 
 	if (cmds == 1) {
 		err = smr_rma_fast(ep, peer_smr, iov, iov_count, rma_iov,
@@ -184,6 +186,7 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 
 	smr_add_rma_cmd(peer_smr, rma_iov, rma_count, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -344,6 +347,7 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	rma_iov.len = len;
 	rma_iov.key = key;
 
+	smr_ep_flush_cmds(ep);
 	if (cmds == 1) {
 		ret = smr_rma_fast(ep, peer_smr, &iov, 1, &rma_iov, 1, NULL,
 				   peer_id, id, NULL, ofi_op_write, flags);
@@ -363,6 +367,7 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	}
 	smr_add_rma_cmd(peer_smr, &rma_iov, 1, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 
 out:
 	if (!ret)
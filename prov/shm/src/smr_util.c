@@ -90,7 +90,7 @@ void smr_cma_check(struct smr_region *smr, struct smr_region *peer_smr)
 }
 
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
-				  size_t *cmd_offset, size_t *resp_offset,
+				  size_t max_peers, size_t *cmd_offset, size_t *resp_offset,
 				  size_t *inject_offset, size_t *sar_offset,
 				  size_t *peer_offset, size_t *name_offset,
 				  size_t *sock_offset)
@@ -113,7 +113,7 @@ size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
 	peer_data_offset = sar_pool_offset +
 		freestack_size(sizeof(struct smr_sar_buf), SMR_MAX_PEERS);
 	ep_name_offset = peer_data_offset + sizeof(struct smr_peer_data) *
-		SMR_MAX_PEERS;
+		max_peers;
 
 	sock_name_offset = ep_name_offset + SMR_NAME_MAX;
 
@@ -201,7 +201,8 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 
 	tx_size = roundup_power_of_two(attr->tx_count);
 	rx_size = roundup_power_of_two(attr->rx_count);
-	total_size = smr_calculate_size_offsets(tx_size, rx_size, &cmd_queue_offset,
+	total_size = smr_calculate_size_offsets(tx_size, rx_size,
+					map->max_peers, &cmd_queue_offset,
 					&resp_queue_offset, &inject_pool_offset,
 					&sar_pool_offset, &peer_data_offset,
 					&name_offset, &sock_name_offset);
@@ -298,6 +299,8 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	(*smr)->name_offset = name_offset;
 	(*smr)->sock_name_offset = sock_name_offset;
 	(*smr)->max_sar_buf_per_peer = SMR_BUF_BATCH_MAX;
+	ofi_atomic_initialize32(&(*smr)->doorbell, 0);
+	ofi_atomic_initialize32(&(*smr)->sleepers, 0);
 
 	smr_cmd_queue_init(smr_cmd_queue(*smr), rx_size);
 	smr_resp_queue_init(smr_resp_queue(*smr), tx_size);
@@ -305,7 +308,7 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 			sizeof(struct smr_inject_buf));
 	smr_freestack_init(smr_sar_pool(*smr), SMR_MAX_PEERS,
 			sizeof(struct smr_sar_buf));
-	for (i = 0; i < SMR_MAX_PEERS; i++) {
+	for (i = 0; i < map->max_peers; i++) {
 		smr_peer_data(*smr)[i].addr.id = -1;
 		smr_peer_data(*smr)[i].sar_status = 0;
 		smr_peer_data(*smr)[i].name_sent = 0;
@@ -345,7 +348,7 @@ static int smr_match_name(struct dlist_entry *item, const void *args)
 int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 		      int64_t id)
 {
-	struct smr_peer *peer_buf = &map->peers[id];
+	struct smr_peer *peer_buf = smr_map_peer(map, id);
 	struct smr_region *peer;
 	struct util_ep *util_ep;
 	struct smr_ep *smr_ep;
@@ -409,7 +412,15 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 	munmap(peer, sizeof(*peer));
 
 	peer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (peer == MAP_FAILED) {
+		FI_WARN(prov, FI_LOG_AV, "mmap error\n");
+		ret = -errno;
+		goto out;
+	}
 	peer_buf->region = peer;
+	peer_buf->referenced = true;
+	dlist_insert_tail(&peer_buf->mapped_entry, &map->mapped_list);
+	map->num_mapped++;
 
 	if (map->flags & SMR_FLAG_HMEM_ENABLED) {
 		ret = ofi_hmem_host_register(peer, peer->total_size);
@@ -447,7 +458,7 @@ void smr_map_to_endpoint(struct smr_region *region, int64_t id)
 
 	assert(ofi_spin_held(&region->map->lock));
 	peer_smr = smr_peer_region(region, id);
-	if (region->map->peers[id].peer.id < 0 || !peer_smr)
+	if (smr_map_peer(region->map, id)->peer.id < 0 || !peer_smr)
 	    return;
 
 	local_peers = smr_peer_data(region);
@@ -477,6 +488,29 @@ void smr_map_to_endpoint(struct smr_region *region, int64_t id)
 	return;
 }
 
+static void smr_release_region(const struct fi_provider *prov,
+			       struct smr_map *map, struct smr_peer *peer)
+{
+	int ret;
+
+	if (map->flags & SMR_FLAG_HMEM_ENABLED) {
+		ret = ofi_hmem_host_unregister(peer->region);
+		if (ret)
+			FI_WARN(prov, FI_LOG_EP_CTRL,
+				"unable to unregister shm with iface\n");
+
+		if (peer->pid_fd != -1) {
+			close(peer->pid_fd);
+			peer->pid_fd = -1;
+		}
+	}
+
+	munmap(peer->region, peer->region->total_size);
+	peer->region = NULL;
+	dlist_remove_init(&peer->mapped_entry);
+	map->num_mapped--;
+}
+
 void smr_unmap_region(const struct fi_provider *prov, struct smr_map *map,
 		     int64_t peer_id, bool local)
 {
@@ -485,14 +519,13 @@ void smr_unmap_region(const struct fi_provider *prov, struct smr_map *map,
 	struct util_ep *util_ep;
 	struct smr_ep *smr_ep;
 	struct smr_av *av;
-	int ret = 0;
 
 	assert(ofi_spin_held(&map->lock));
-	peer_region = map->peers[peer_id].region;
+	peer = smr_map_peer(map, peer_id);
+	peer_region = peer->region;
 	if (!peer_region)
 		return;
 
-	peer = &map->peers[peer_id];
 	av = container_of(map, struct smr_av, smr_map);
 	dlist_foreach_container(&av->util_av.ep_list, struct util_ep, util_ep,
 				av_entry) {
@@ -506,20 +539,70 @@ void smr_unmap_region(const struct fi_provider *prov, struct smr_map *map,
 	if (local)
 		return;
 
-	if (map->flags & SMR_FLAG_HMEM_ENABLED) {
-		ret = ofi_hmem_host_unregister(peer_region);
-		if (ret)
-			FI_WARN(prov, FI_LOG_EP_CTRL,
-				"unable to unregister shm with iface\n");
+	smr_release_region(prov, map, peer);
+}
 
-		if (peer->pid_fd != -1) {
-			close(peer->pid_fd);
-			peer->pid_fd = -1;
+static bool smr_peer_busy(struct smr_ep *ep, struct smr_peer *peer)
+{
+	return peer->unexp_cnt ||
+	       smr_peer_data(ep->region)[peer->peer.id].sar_status ||
+	       (smr_cmd_batch_cnt(&ep->cmd_batch) &&
+		ep->cmd_batch.peer_smr == peer->region);
+}
+
+/*
+ * Unmap peer regions that have not been used since the last sweep until no
+ * more than max_mapped remain (a CLOCK approximation of LRU).  A peer is
+ * only evicted while the endpoint has nothing in flight that points into
+ * the peer region, including unexpected messages that have not been
+ * matched yet.  The handshake is reset so the next send remaps the
+ * peer through smr_verify_peer(), and commands received from the peer in
+ * the meantime remap it in smr_progress_cmd().  The peer keeps its view of
+ * this endpoint, so traffic from it is not disturbed.
+ */
+void smr_map_evict(struct smr_ep *ep)
+{
+	struct smr_map *map = ep->region->map;
+	struct smr_peer_data *peer_data;
+	struct smr_peer *peer;
+	struct smr_av *av;
+	size_t scan;
+
+	/* other endpoints on the AV may have transfers to the peer in flight */
+	av = container_of(map, struct smr_av, smr_map);
+	if (av->util_av.ep_list.next->next != &av->util_av.ep_list)
+		return;
+
+	if (!ofi_cirque_isempty(smr_resp_queue(ep->region)) ||
+	    !dlist_empty(&ep->sar_list) ||
+	    !dlist_empty(&ep->ipc_cpy_pend_list))
+		return;
+
+	peer_data = smr_peer_data(ep->region);
+	ofi_spin_lock(&map->lock);
+	for (scan = 2 * map->num_mapped;
+	     scan && map->num_mapped > map->max_mapped; scan--) {
+		peer = container_of(map->mapped_list.next, struct smr_peer,
+				    mapped_entry);
+		if (peer->referenced || smr_peer_busy(ep, peer)) {
+			peer->referenced = false;
+			dlist_remove(&peer->mapped_entry);
+			dlist_insert_tail(&peer->mapped_entry,
+					  &map->mapped_list);
+			continue;
 		}
-	}
 
-	munmap(peer_region, peer_region->total_size);
-	peer->region = NULL;
+		FI_DBG(&smr_prov, FI_LOG_EP_CTRL, "evicting peer %s\n",
+		       peer->peer.name);
+		if (peer_data[peer->peer.id].xpmem.cap == SMR_VMA_CAP_ON) {
+			ofi_xpmem_release(&peer_data[peer->peer.id].xpmem);
+			peer_data[peer->peer.id].xpmem.cap = SMR_VMA_CAP_OFF;
+		}
+		peer_data[peer->peer.id].addr.id = -1;
+		peer_data[peer->peer.id].name_sent = 0;
+		smr_release_region(&smr_prov, map, peer);
+	}
+	ofi_spin_unlock(&map->lock);
 }
 
 void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
@@ -528,7 +611,7 @@ void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
 	struct smr_peer_data *local_peers, *peer_peers;
 	int64_t peer_id;
 
-	if (region->map->peers[id].peer.id < 0)
+	if (smr_map_peer(region->map, id)->peer.id < 0)
 		return;
 
 	peer_smr = smr_peer_region(region, id);
@@ -548,17 +631,39 @@ void smr_exchange_all_peers(struct smr_region *region)
 	int64_t i;
 
 	ofi_spin_lock(&region->map->lock);
-	for (i = 0; i < SMR_MAX_PEERS; i++)
+	for (i = 0; i < region->map->max_peers; i++) {
+		if (smr_map_peer_free(region->map, i))
+			continue;
 		smr_map_to_endpoint(region, i);
+	}
 
 	ofi_spin_unlock(&region->map->lock);
 }
 
+static int smr_map_alloc_block(struct smr_map *map, int64_t id)
+{
+	struct smr_peer *block;
+	int i;
+
+	block = calloc(SMR_PEER_BLOCK_SIZE, sizeof(*block));
+	if (!block)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < SMR_PEER_BLOCK_SIZE; i++) {
+		block[i].peer.id = -1;
+		block[i].fiaddr = FI_ADDR_NOTAVAIL;
+		dlist_init(&block[i].mapped_entry);
+	}
+	map->peers[id >> SMR_PEER_BLOCK_SHIFT] = block;
+	return FI_SUCCESS;
+}
+
 int smr_map_add(const struct fi_provider *prov, struct smr_map *map,
 		const char *name, int64_t *id)
 {
 	struct ofi_rbnode *node;
 	const char *shm_name = smr_no_prefix(name);
+	struct smr_peer *peer;
 	int tries = 0, ret = 0;
 
 	ofi_spin_lock(&map->lock);
@@ -567,40 +672,52 @@ int smr_map_add(const struct fi_provider *prov, struct smr_map *map,
 	if (ret) {
 		assert(ret == -FI_EALREADY);
 		*id = (intptr_t) node->data;
+		ret = FI_SUCCESS;
 		goto out;
 	}
 
-	while (map->peers[map->cur_id].peer.id != -1 && tries < SMR_MAX_PEERS) {
-		if (++map->cur_id == SMR_MAX_PEERS)
+	while (!smr_map_peer_free(map, map->cur_id) &&
+	       tries < map->max_peers) {
+		if (++map->cur_id == map->max_peers)
 			map->cur_id = 0;
 		tries++;
 	}
 
-	assert(map->cur_id < SMR_MAX_PEERS && tries < SMR_MAX_PEERS);
+	if (tries == map->max_peers ||
+	    (!map->peers[map->cur_id >> SMR_PEER_BLOCK_SHIFT] &&
+	     smr_map_alloc_block(map, map->cur_id))) {
+		ofi_rbmap_delete(&map->rbmap, node);
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
 	*id = map->cur_id;
-	if (++map->cur_id == SMR_MAX_PEERS)
+	if (++map->cur_id == map->max_peers)
 		map->cur_id = 0;
 	node->data = (void *) (intptr_t) *id;
-	strncpy(map->peers[*id].peer.name, shm_name, SMR_NAME_MAX);
-	map->peers[*id].peer.name[SMR_NAME_MAX - 1] = '\0';
-	map->peers[*id].region = NULL;
+	peer = smr_map_peer(map, *id);
+	strncpy(peer->peer.name, shm_name, SMR_NAME_MAX);
+	peer->peer.name[SMR_NAME_MAX - 1] = '\0';
+	peer->region = NULL;
 	map->num_peers++;
-	map->peers[*id].peer.id = *id;
+	peer->peer.id = *id;
 
 out:
 	ofi_spin_unlock(&map->lock);
-	return FI_SUCCESS;
+	return ret;
 }
 
 void smr_map_del(struct smr_map *map, int64_t id)
 {
 	struct smr_ep_name *name;
+	struct smr_peer *peer;
 	bool local = false;
 
-	assert(id >= 0 && id < SMR_MAX_PEERS);
+	assert(id >= 0 && id < map->max_peers);
+	peer = smr_map_peer(map, id);
 	pthread_mutex_lock(&ep_list_lock);
 	dlist_foreach_container(&ep_name_list, struct smr_ep_name, name, entry) {
-		if (!strcmp(name->name, map->peers[id].peer.name)) {
+		if (!strcmp(name->name, peer->peer.name)) {
 			local = true;
 			break;
 		}
@@ -608,17 +725,17 @@ void smr_map_del(struct smr_map *map, int64_t id)
 	pthread_mutex_unlock(&ep_list_lock);
 	ofi_spin_lock(&map->lock);
 	smr_unmap_region(&smr_prov, map, id, local);
-	map->peers[id].fiaddr = FI_ADDR_NOTAVAIL;
-	map->peers[id].peer.id = -1;
+	peer->fiaddr = FI_ADDR_NOTAVAIL;
+	peer->peer.id = -1;
 	map->num_peers--;
-	ofi_rbmap_find_delete(&map->rbmap, map->peers[id].peer.name);
+	ofi_rbmap_find_delete(&map->rbmap, peer->peer.name);
 	ofi_spin_unlock(&map->lock);
 }
 
 struct smr_region *smr_map_get(struct smr_map *map, int64_t id)
 {
-	if (id < 0 || id >= SMR_MAX_PEERS)
+	if (id < 0 || id >= map->max_peers || smr_map_peer_free(map, id))
 		return NULL;
 
-	return map->peers[id].region;
+	return smr_map_peer(map, id)->region;
 }
@@ -47,6 +47,7 @@
 #include <ofi_tree.h>
 #include <ofi_hmem.h>
 #include <ofi_atomic_queue.h>
+#include <ofi_mb.h>
 
 #include <rdma/providers/fi_prov.h>
 
@@ -54,12 +55,13 @@
 extern "C" {
 #endif
 
-#define SMR_VERSION	8
+#define SMR_VERSION	9
 
 #define SMR_FLAG_ATOMIC	(1 << 0)
 #define SMR_FLAG_DEBUG	(1 << 1)
 #define SMR_FLAG_IPC_SOCK (1 << 2)
 #define SMR_FLAG_HMEM_ENABLED (1 << 3)
+#define SMR_FLAG_DOORBELL (1 << 4)
 
 #define SMR_CMD_SIZE		256	/* align with 64-byte cache line */
 
@@ -210,19 +212,52 @@ struct smr_peer {
 	fi_addr_t		fiaddr;
 	struct smr_region	*region;
 	int			pid_fd;
+	/* set on use, cleared by the eviction sweep in smr_map_evict() */
+	bool			referenced;
+	/* unexpected commands still referencing the peer region */
+	int			unexp_cnt;
+	struct dlist_entry	mapped_entry;
 };
 
-#define SMR_MAX_PEERS	256
+/*
+ * Default number of peers an AV can address.  The map is sized from the AV
+ * count when that is larger, up to SMR_PEER_ID_MAX.  Peer entries are
+ * allocated in blocks of SMR_PEER_BLOCK_SIZE the first time an id in the
+ * block is handed out, so a large map only pays for the peers it holds.
+ */
+#define SMR_MAX_PEERS		256
+#define SMR_PEER_BLOCK_SHIFT	6
+#define SMR_PEER_BLOCK_SIZE	(1 << SMR_PEER_BLOCK_SHIFT)
+#define SMR_PEER_BLOCK_MAX	1024
+#define SMR_PEER_ID_MAX		(SMR_PEER_BLOCK_SIZE * SMR_PEER_BLOCK_MAX)
 
 struct smr_map {
 	ofi_spin_t		lock;
 	int64_t			cur_id;
 	int 			num_peers;
+	int64_t			max_peers;
 	uint16_t		flags;
 	struct ofi_rbmap	rbmap;
-	struct smr_peer		peers[SMR_MAX_PEERS];
+	struct smr_peer		*peers[SMR_PEER_BLOCK_MAX];
+
+	/* peer regions mmapped by this process, oldest first */
+	struct dlist_entry	mapped_list;
+	size_t			num_mapped;
+	size_t			max_mapped;
 };
 
+static inline struct smr_peer *smr_map_peer(struct smr_map *map, int64_t id)
+{
+	return &map->peers[id >> SMR_PEER_BLOCK_SHIFT]
+			  [id & (SMR_PEER_BLOCK_SIZE - 1)];
+}
+
+static inline bool smr_map_peer_free(struct smr_map *map, int64_t id)
+{
+	return !map->peers[id >> SMR_PEER_BLOCK_SHIFT] ||
+	       smr_map_peer(map, id)->peer.id < 0;
+}
+
 struct smr_region {
 	uint8_t		version;
 	uint8_t		resv;
@@ -234,6 +269,9 @@ struct smr_region {
 	uint8_t		resv2;
 
 	uint32_t	max_sar_buf_per_peer;
+	/* Futex word the owner sleeps on, see smr_ring_doorbell() */
+	ofi_atomic32_t	doorbell;
+	ofi_atomic32_t	sleepers;
 	struct ofi_xpmem_pinfo	xpmem_self;
 	struct ofi_xpmem_pinfo	xpmem_peer;
 	void		*base_addr;
@@ -302,7 +340,7 @@ OFI_DECLARE_ATOMIC_Q(struct smr_cmd_entry, smr_cmd_queue);
 
 static inline struct smr_region *smr_peer_region(struct smr_region *smr, int i)
 {
-	return smr->map->peers[i].region;
+	return smr_map_peer(smr->map, i)->region;
 }
 static inline struct smr_cmd_queue *smr_cmd_queue(struct smr_region *smr)
 {
@@ -316,6 +354,23 @@ static inline struct smr_freestack *smr_inject_pool(struct smr_region *smr)
 {
 	return (struct smr_freestack *) ((char *) smr + smr->inject_pool_offset);
 }
+/* Wakes the owner of a region if it is blocked waiting for commands.  Only
+ * regions created with SMR_FLAG_DOORBELL pay for the fence, which orders
+ * the command queue update ahead of the check for sleepers.
+ */
+static inline void smr_ring_doorbell(struct smr_region *smr)
+{
+	if (!(smr->flags & SMR_FLAG_DOORBELL))
+		return;
+
+	ofi_mb();
+	if (ofi_atomic_get32(&smr->sleepers)) {
+		ofi_atomic_inc32(&smr->doorbell);
+		ofi_futex_wake_shared((uint32_t *)
+				      ofi_atomic_ptr(&smr->doorbell), INT_MAX);
+	}
+}
+
 static inline struct smr_peer_data *smr_peer_data(struct smr_region *smr)
 {
 	return (struct smr_peer_data *) ((char *) smr + smr->peer_data_offset);
@@ -347,7 +402,7 @@ struct smr_attr {
 };
 
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
-				  size_t *cmd_offset, size_t *resp_offset,
+				  size_t max_peers, size_t *cmd_offset, size_t *resp_offset,
 				  size_t *inject_offset, size_t *sar_offset,
 				  size_t *peer_offset, size_t *name_offset,
 				  size_t *sock_offset);
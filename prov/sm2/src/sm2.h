@@ -75,7 +75,7 @@
 #define SM2_IOV_LIMIT		4
 #define SM2_PREFIX		"fi_sm2://"
 #define SM2_PREFIX_NS		"fi_ns://"
-#define SM2_VERSION		1
+#define SM2_VERSION		2
 #define SM2_IOV_LIMIT		4
 #define SM2_INJECT_SIZE		(SM2_XFER_ENTRY_SIZE - sizeof(struct sm2_xfer_hdr))
 
@@ -140,6 +140,8 @@ completions instead of waiting for the application to post the receive buffer.
  * 	op_flags - flags associated with op,
  * 		   NOTE: Only grabbing the bottom 32 bits
  * 	proto - sm2 operation
+ * 	xfer_class - size class of the xfer_entry, set when it is
+ * 		     initialized and preserved across copies
  * 	proto_flags - Flags used by the sm2 protocol
  * 	sender_gid - id of msg sender
  * 	user_data - Protocol dependent data. For inject, it's the message.
@@ -153,7 +155,8 @@ struct sm2_xfer_hdr {
 	uint64_t context;
 	uint32_t op;
 	uint32_t op_flags;
-	uint16_t proto;
+	uint8_t proto;
+	uint8_t xfer_class;
 	uint16_t proto_flags;
 	sm2_gid_t sender_gid;
 };
@@ -207,9 +210,22 @@ static inline struct sm2_fifo *sm2_recv_queue(struct sm2_region *smr)
 	return (struct sm2_fifo *) ((char *) smr + smr->recv_queue_offset);
 }
 
-static inline struct smr_freestack *sm2_freestack(struct sm2_region *smr)
+static inline struct smr_freestack *sm2_freestack(struct sm2_region *smr,
+						  int xfer_class)
 {
-	return (struct smr_freestack *) ((char *) smr + smr->freestack_offset);
+	return (struct smr_freestack *) ((char *) smr +
+					 smr->freestack_offset[xfer_class]);
+}
+
+static inline bool sm2_freestacks_full(struct sm2_region *smr)
+{
+	int i;
+
+	for (i = 0; i < SM2_XFER_CLASS_MAX; i++) {
+		if (!smr_freestack_isfull(sm2_freestack(smr, i)))
+			return false;
+	}
+	return true;
 }
 
 int sm2_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
@@ -326,14 +342,59 @@ static inline struct sm2_region *sm2_peer_region(struct sm2_ep *ep, int id)
 	return sm2_mmap_ep_region(ep->mmap, id);
 }
 
-static inline size_t sm2_pop_xfer_entry(struct sm2_ep *ep,
+/* Pops an xfer_entry with room for len bytes of user_data from the smallest
+ * size class that has one free.
+ */
+static inline size_t sm2_pop_xfer_entry(struct sm2_ep *ep, size_t len,
 					struct sm2_xfer_entry **xfer_entry)
 {
-	if (smr_freestack_isempty(sm2_freestack(ep->self_region)))
-		return -FI_EAGAIN;
+	struct smr_freestack *fs;
+	int i;
+
+	for (i = 0; i < SM2_XFER_CLASS_MAX; i++) {
+		if (sizeof(struct sm2_xfer_hdr) + len > sm2_xfer_class_size(i))
+			continue;
+
+		fs = sm2_freestack(ep->self_region, i);
+		if (smr_freestack_isempty(fs))
+			continue;
+
+		*xfer_entry = smr_freestack_pop(fs);
+		(*xfer_entry)->hdr.xfer_class = i;
+		return FI_SUCCESS;
+	}
+	return -FI_EAGAIN;
+}
+
+static inline void sm2_push_xfer_entry(struct sm2_ep *ep,
+				       struct sm2_xfer_entry *xfer_entry)
+{
+	smr_freestack_push(sm2_freestack(ep->self_region,
+					 xfer_entry->hdr.xfer_class),
+			   xfer_entry);
+}
+
+static inline size_t sm2_xfer_entry_size(struct sm2_xfer_entry *xfer_entry)
+{
+	return sm2_xfer_class_size(xfer_entry->hdr.xfer_class);
+}
+
+static inline size_t sm2_xfer_inject_size(struct sm2_xfer_entry *xfer_entry)
+{
+	return sm2_xfer_entry_size(xfer_entry) - sizeof(struct sm2_xfer_hdr);
+}
+
+/* Copies the header and the first len bytes of user_data, keeping the
+ * size class of the destination.
+ */
+static inline void sm2_copy_xfer_entry(struct sm2_xfer_entry *dst,
+				       struct sm2_xfer_entry *src, size_t len)
+{
+	uint8_t xfer_class = dst->hdr.xfer_class;
 
-	*xfer_entry = smr_freestack_pop(sm2_freestack(ep->self_region));
-	return FI_SUCCESS;
+	assert(sizeof(struct sm2_xfer_hdr) + len <= sm2_xfer_entry_size(dst));
+	memcpy(dst, src, sizeof(struct sm2_xfer_hdr) + len);
+	dst->hdr.xfer_class = xfer_class;
 }
 
 static inline bool sm2_proto_imm_send_comp(uint16_t proto)
@@ -104,9 +104,13 @@ sm2_do_atomic_inject(struct sm2_ep *ep, int64_t peer_gid, uint32_t op,
 		     size_t total_len, void *context, uint16_t proto_flags)
 {
 	struct sm2_xfer_entry *xfer_entry;
-	size_t ret;
+	size_t ret, len;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	/* compare data sits at a fixed offset in the atomic entry */
+	len = op == ofi_op_atomic_compare ?
+		sizeof(struct sm2_atomic_entry) :
+		sizeof(struct sm2_atomic_hdr) + total_len;
+	ret = sm2_pop_xfer_entry(ep, len, &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -359,7 +359,7 @@ retry_lookup:
 		/* Check if it is dirty */
 		if (entries[item].pid && !pid_lives(abs(entries[item].pid))) {
 			peer_region = sm2_mmap_ep_region(map, item);
-			if (!smr_freestack_isfull(sm2_freestack(peer_region))) {
+			if (!sm2_freestacks_full(peer_region)) {
 				/* Region did not shut down properly, but other
 				 * processes might be using it, make it a zombie
 				 * region - never use this region for as long as
@@ -439,7 +439,7 @@ retry_lookup:
 				sm2_mmap_ep_region(map, item);
 
 			if (entries[item].startup_ready &&
-			    smr_freestack_isfull(sm2_freestack(peer_region))) {
+			    sm2_freestacks_full(peer_region)) {
 				/* we found a slot with a dead PID and
 				 * the freestack is full */
 				entries[item].pid = 0;
@@ -55,6 +55,31 @@
 /* TODO: Make the number of XFER ENTRY's configurable */
 #define SM2_NUM_XFER_ENTRY_PER_PEER 1024
 
+/*
+ * xfer_entries come in size classes, each with its own freestack, so that
+ * small messages are sent in cache-line dense entries instead of occupying
+ * a full SM2_XFER_ENTRY_SIZE entry.  Class c holds entries of
+ * SM2_XFER_ENTRY_SIZE >> 2 * (SM2_XFER_CLASS_MAX - 1 - c) bytes (256 B,
+ * 1 KiB and 4 KiB), and SM2_NUM_XFER_ENTRY_PER_PEER >> c of them.
+ */
+enum {
+	SM2_XFER_CLASS_SMALL,
+	SM2_XFER_CLASS_MEDIUM,
+	SM2_XFER_CLASS_LARGE,
+	SM2_XFER_CLASS_MAX,
+};
+
+static inline size_t sm2_xfer_class_size(int xfer_class)
+{
+	return SM2_XFER_ENTRY_SIZE >>
+	       (2 * (SM2_XFER_CLASS_MAX - 1 - xfer_class));
+}
+
+static inline size_t sm2_xfer_class_count(int xfer_class)
+{
+	return SM2_NUM_XFER_ENTRY_PER_PEER >> xfer_class;
+}
+
 typedef unsigned int sm2_gid_t;
 
 struct sm2_mmap {
@@ -91,7 +116,7 @@ struct sm2_region {
 
 	/* offsets from start of sm2_region */
 	ptrdiff_t recv_queue_offset;
-	ptrdiff_t freestack_offset;
+	ptrdiff_t freestack_offset[SM2_XFER_CLASS_MAX];
 };
 
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset);
@@ -188,7 +188,8 @@ static void sm2_format_inject(struct sm2_xfer_entry *xfer_entry,
 {
 	xfer_entry->hdr.proto = sm2_proto_inject;
 	xfer_entry->hdr.size = ofi_copy_from_mr_iov(
-		xfer_entry->user_data, SM2_INJECT_SIZE, mr, iov, count, 0);
+		xfer_entry->user_data, sm2_xfer_inject_size(xfer_entry), mr,
+		iov, count, 0);
 }
 
 static ssize_t sm2_do_inject(struct sm2_ep *ep, struct sm2_region *peer_smr,
@@ -202,7 +203,7 @@ static ssize_t sm2_do_inject(struct sm2_ep *ep, struct sm2_region *peer_smr,
 
 	assert(total_len <= SM2_INJECT_SIZE);
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, total_len, &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -235,7 +236,7 @@ static ssize_t sm2_do_cma(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	ssize_t ret;
 	struct sm2_xfer_entry *xfer_entry;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, sizeof(struct sm2_cma_data), &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -285,7 +286,7 @@ static ssize_t sm2_do_ipc(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	struct sm2_xfer_entry *xfer_entry;
 	ssize_t ret;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, sizeof(struct ipc_info), &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -297,7 +298,7 @@ static ssize_t sm2_do_ipc(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	if (ret) {
 		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 			"Error generating IPC header information\n");
-		smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+		sm2_push_xfer_entry(ep, xfer_entry);
 		return ret;
 	}
 
@@ -314,8 +315,7 @@ static void cleanup_shm_resources(struct sm2_ep *ep)
 return_incoming:
 	while (NULL != (xfer_entry = sm2_fifo_read(ep))) {
 		if (xfer_entry->hdr.proto_flags & SM2_RETURN) {
-			smr_freestack_push(sm2_freestack(ep->self_region),
-					   xfer_entry);
+			sm2_push_xfer_entry(ep, xfer_entry);
 		} else {
 			/* TODO Tell other side that we haven't processed their
 			 * message, just returned xfer_entry */
@@ -324,7 +324,7 @@ return_incoming:
 		}
 	}
 
-	if (smr_freestack_isfull(sm2_freestack(ep->self_region))) {
+	if (sm2_freestacks_full(ep->self_region)) {
 		/* TODO Set head/tail of FIFO queue to show peers we aren't
 		   accepting new entires */
 		FI_INFO(&sm2_prov, FI_LOG_EP_CTRL,
@@ -363,7 +363,7 @@ static int sm2_ep_close(struct fid *fid)
 	 */
 	/* TODO Do we want to mark our entry as zombie now if we don't have all
 	   our xfer_entry? */
-	if (smr_freestack_isfull(sm2_freestack(ep->self_region))) {
+	if (sm2_freestacks_full(ep->self_region)) {
 		sm2_file_lock(ep->mmap);
 		sm2_entry_free(ep->mmap, ep->gid);
 		sm2_file_unlock(ep->mmap);
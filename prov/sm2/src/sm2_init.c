@@ -41,6 +41,7 @@
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 {
 	size_t total_size;
+	int i;
 
 	total_size = sizeof(struct sm2_region);
 
@@ -48,10 +49,12 @@ size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 		*rq_offset = total_size;
 	total_size += sizeof(struct sm2_fifo);
 
-	if (fs_offset)
-		*fs_offset = total_size;
-	total_size += freestack_size(sizeof(struct sm2_xfer_entry),
-				     SM2_NUM_XFER_ENTRY_PER_PEER);
+	for (i = 0; i < SM2_XFER_CLASS_MAX; i++) {
+		if (fs_offset)
+			fs_offset[i] = total_size;
+		total_size += freestack_size(sm2_xfer_class_size(i),
+					     sm2_xfer_class_count(i));
+	}
 
 	return total_size;
 }
@@ -59,12 +62,12 @@ size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	       struct sm2_mmap *sm2_mmap, sm2_gid_t *gid)
 {
-	ptrdiff_t recv_queue_offset, freestack_offset;
-	int ret;
+	ptrdiff_t recv_queue_offset, freestack_offset[SM2_XFER_CLASS_MAX];
+	int ret, i;
 	void *mapped_addr;
 	struct sm2_region *smr;
 
-	sm2_calculate_size_offsets(&recv_queue_offset, &freestack_offset);
+	sm2_calculate_size_offsets(&recv_queue_offset, freestack_offset);
 
 	FI_INFO(prov, FI_LOG_EP_CTRL, "Claiming an entry for (%s)\n",
 		attr->name);
@@ -92,11 +95,14 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	smr->version = SM2_VERSION;
 	smr->flags = attr->flags;
 	smr->recv_queue_offset = recv_queue_offset;
-	smr->freestack_offset = freestack_offset;
+	memcpy(smr->freestack_offset, freestack_offset,
+	       sizeof(smr->freestack_offset));
 
 	sm2_fifo_init(sm2_recv_queue(smr));
-	smr_freestack_init(sm2_freestack(smr), SM2_NUM_XFER_ENTRY_PER_PEER,
-			   sizeof(struct sm2_xfer_entry));
+	for (i = 0; i < SM2_XFER_CLASS_MAX; i++)
+		smr_freestack_init(sm2_freestack(smr, i),
+				   sm2_xfer_class_count(i),
+				   sm2_xfer_class_size(i));
 
 	/*
 	 * Need to set PID in header here...
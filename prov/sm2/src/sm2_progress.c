@@ -102,12 +102,13 @@ static int sm2_cma_send_ipc_handle(struct sm2_ep *ep,
 		 * ofi_bufpool entry in the receiver memory which the sender
 		 * can't read. So we create a new xfer_entry and send it instead
 		 */
-		ret = sm2_pop_xfer_entry(ep, &new_xfer_entry);
+		ret = sm2_pop_xfer_entry(ep, sizeof(struct sm2_cma_data),
+					 &new_xfer_entry);
 		if (ret)
 			return ret;
 
-		memcpy(new_xfer_entry, xfer_entry,
-		       sizeof(struct sm2_xfer_entry));
+		sm2_copy_xfer_entry(new_xfer_entry, xfer_entry,
+				    sizeof(struct sm2_cma_data));
 		sm2_fifo_write(ep, sender_gid, new_xfer_entry);
 	} else {
 		sm2_fifo_write(ep, sender_gid, xfer_entry);
@@ -382,7 +383,8 @@ static int sm2_start_common(struct sm2_ep *ep,
 		 * if the receiver is sending many messages and is out of
 		 * xfer_entries
 		 * */
-		ret = sm2_pop_xfer_entry(ep, &new_xfer_entry);
+		ret = sm2_pop_xfer_entry(ep, sizeof(struct sm2_cma_data),
+					 &new_xfer_entry);
 		if (ret) {
 			FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 				"Unable to send xfer_entry back to "
@@ -393,8 +395,8 @@ static int sm2_start_common(struct sm2_ep *ep,
 			return ret;
 		}
 
-		memcpy(new_xfer_entry, xfer_entry,
-		       sizeof(struct sm2_xfer_entry));
+		sm2_copy_xfer_entry(new_xfer_entry, xfer_entry,
+				    sizeof(struct sm2_cma_data));
 		new_xfer_entry->hdr.proto_flags |= SM2_RETURN;
 		new_xfer_entry->hdr.sender_gid = ep->gid;
 		sm2_fifo_write(ep, xfer_entry->hdr.sender_gid, new_xfer_entry);
@@ -427,7 +429,8 @@ static int sm2_alloc_xfer_entry_ctx(struct sm2_ep *ep,
 		return -FI_ENOMEM;
 	}
 
-	memcpy(&xfer_ctx->xfer_entry, xfer_entry, sizeof(*xfer_entry));
+	memcpy(&xfer_ctx->xfer_entry, xfer_entry,
+	       sm2_xfer_entry_size(xfer_entry));
 	xfer_ctx->ep = ep;
 
 	rx_entry->msg_size = xfer_entry->hdr.size;
@@ -456,8 +459,7 @@ sm2_progress_cma_host_to_dev(struct sm2_ep *ep,
 			xfer_entry->hdr.proto_flags &= ~SM2_GENERATE_COMPLETION;
 			sm2_fifo_write_back(ep, xfer_entry);
 		} else {
-			smr_freestack_push(sm2_freestack(ep->self_region),
-					   xfer_entry);
+			sm2_push_xfer_entry(ep, xfer_entry);
 		}
 		return;
 	}
@@ -505,7 +507,7 @@ sm2_progress_cma_host_to_dev_ack(struct sm2_ep *ep,
 	if (xfer_entry->hdr.proto_flags & SM2_UNEXP) {
 		/* The xfer_entry was actually allocated on the
 		 * receiver side, so we just push it back */
-		smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+		sm2_push_xfer_entry(ep, xfer_entry);
 	} else {
 		/* Unset the delivery complete flag so that we
 		 * don't write another completion entry on the
@@ -757,7 +759,7 @@ static inline void sm2_progress_return(struct sm2_ep *ep,
 		}
 	}
 
-	smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+	sm2_push_xfer_entry(ep, xfer_entry);
 }
 
 void sm2_progress_recv(struct sm2_ep *ep)
@@ -95,6 +95,7 @@ typedef void  xnet_profile_t;
 #define XNET_DEF_INJECT		128
 #define XNET_DEF_BUF_SIZE	16384
 #define XNET_MAX_EVENTS		128
+#define XNET_XFER_CACHE_SIZE	64
 #define XNET_MIN_MULTI_RECV	16384
 #define XNET_PORT_MAX_RANGE	(USHRT_MAX)
 
@@ -115,10 +116,18 @@ extern size_t xnet_zerocopy_size;
 extern int xnet_trace_msg;
 extern int xnet_disable_autoprog;
 extern int xnet_io_uring;
+extern int xnet_io_uring_mshot;
 extern int xnet_max_saved;
 extern size_t xnet_max_saved_size;
 extern size_t xnet_max_inject;
 extern size_t xnet_buf_size;
+extern size_t xnet_progress_shards;
+extern size_t xnet_rdm_stripes;
+extern size_t xnet_stripe_size;
+extern size_t xnet_max_conns;
+extern int xnet_conn_idle_timeout;
+extern int *xnet_progress_cpus;
+extern size_t xnet_progress_cpu_cnt;
 struct xnet_xfer_entry;
 struct xnet_ep;
 struct xnet_rdm;
@@ -180,6 +189,7 @@ union xnet_hdrs {
 	struct xnet_tag_hdr	tag_hdr;
 	struct xnet_tag_rts_hdr	tag_rts_hdr;
 	struct xnet_tag_rts_data_hdr tag_rts_data_hdr;
+	struct xnet_data_part_hdr data_part_hdr;
 	uint8_t			max_hdr[XNET_MAX_HDR];
 };
 
@@ -233,6 +243,8 @@ int xnet_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 
 /* xnet_ep::util_ep::flags */
 #define XNET_EP_RENDEZVOUS (1 << 0)
+#define XNET_EP_STRIPE (1 << 1)
+#define XNET_EP_CLOSE (1 << 2)
 
 struct xnet_ep {
 	struct util_ep		util_ep;
@@ -249,6 +261,11 @@ struct xnet_ep {
 	struct slist		need_ack_queue;
 	struct slist		async_queue;
 	struct slist		rma_read_queue;
+	/* multishot receive buffers not yet copied into bsock.rq */
+	struct slist		rbuf_list;
+	bool			rbuf_exhausted;
+	/* socket error or EOF, reported once rbuf_list is consumed */
+	int			rbuf_err;
 	struct ofi_byte_idx	rts_queue;
 	struct ofi_byte_idx	cts_queue;
 	struct xnet_saved_msg	*saved_msg;
@@ -264,6 +281,8 @@ struct xnet_ep {
 	void (*hdr_bswap)(struct xnet_ep *ep, struct xnet_base_hdr *hdr);
 
 	short			pollflags;
+	/* Set when used by an rdm endpoint, cleared by idle conn reaping */
+	bool			referenced;
 
 	xnet_profile_t *profile;
 };
@@ -279,14 +298,32 @@ enum {
 	XNET_CONN_INDEXED = BIT(0),
 	XNET_CONN_TX_LOOPBACK = BIT(1),
 	XNET_CONN_RX_LOOPBACK = BIT(2),
+	XNET_CONN_ACTIVE = BIT(3),
+	XNET_CONN_CLOSING = BIT(4),
+	XNET_CONN_EVICTED = BIT(5),
 };
 
+#define XNET_MAX_STRIPES	8
+
 struct xnet_conn {
 	struct xnet_ep		*ep;
 	struct xnet_rdm		*rdm;
 	struct util_peer_addr	*peer;
 	uint32_t		remote_pid;
 	int			flags;
+	/* Additional connections to the peer, used to stripe large
+	 * rendezvous data.  Lane i is identified as i + 1 on the wire.
+	 */
+	struct xnet_ep		*lanes[XNET_MAX_STRIPES - 1];
+	struct dlist_entry	lru_entry;
+};
+
+struct xnet_conn_stats {
+	uint64_t		open;
+	uint64_t		connect;
+	uint64_t		accept;
+	uint64_t		evict;
+	uint64_t		reconnect;
 };
 
 struct xnet_rdm {
@@ -299,6 +336,11 @@ struct xnet_rdm {
 	struct xnet_conn	*rx_loopback;
 	union ofi_sock_ip	addr;
 
+	/* Connections with an open ep, least recently used first */
+	struct dlist_entry	conn_lru;
+	uint64_t		reap_time;
+	struct xnet_conn_stats	conn_stats;
+
 	xnet_profile_t *profile;
 };
 
@@ -308,6 +350,9 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t dest_addr,
 		      struct xnet_conn **conn);
 struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr);
 void xnet_freeall_conns(struct xnet_rdm *rdm);
+int xnet_handle_close_msg(struct xnet_ep *ep, uint8_t type);
+bool xnet_ep_idle(struct xnet_ep *ep);
+int xnet_queue_close(struct xnet_ep *ep, uint8_t type);
 
 struct xnet_uring {
 	struct fid fid;
@@ -315,6 +360,18 @@ struct xnet_uring {
 	struct ofi_sockapi_uring *sockapi;
 };
 
+#define XNET_URING_RBUF_CNT	1024
+#define XNET_URING_RBUF_SIZE	8192
+#define XNET_URING_MAX_FILES	4096
+
+/* Received data held in a provided buffer, see xnet_uring_fill_rq() */
+struct xnet_rbuf {
+	struct slist_entry	entry;
+	uint32_t		bid;
+	uint32_t		offset;
+	uint32_t		len;
+};
+
 /* Serialization is handled at the progress instance level, using the
  * progress locks.  A progress instance has 2 locks, only one of which is
  * enabled.  The other lock will be set to NONE, meaning it is fully disabled.
@@ -357,11 +414,25 @@ struct xnet_progress {
 	struct fd_signal	signal;
 
 	struct slist		event_list;
+	/* Transfers are allocated through xfer_cache, either from xfer_pool
+	 * or from a pool shared by all subdomains of a multiplexed domain,
+	 * in which case xfer_pool is NULL.
+	 */
 	struct ofi_bufpool	*xfer_pool;
+	struct ofi_bufpool_cache *xfer_cache;
 
 	struct xnet_uring	tx_uring;
 	struct xnet_uring	rx_uring;
-	ofi_io_uring_cqe_t	**cqes;
+
+	/* Multishot receives select from rx_bufs.  Sockets are registered
+	 * with both rings using a slot from free_files when available.
+	 */
+	bool			uring_mshot;
+	struct ofi_uring_bufs	rx_bufs;
+	unsigned int		rx_bufs_held;
+	struct ofi_bufpool	*rbuf_pool;
+	int			*free_files;
+	int			free_file_cnt;
 
 	struct ofi_sockapi	sockapi;
 
@@ -370,9 +441,13 @@ struct xnet_progress {
 
 	bool			auto_progress;
 	pthread_t		thread;
+	/* CPU the auto progress thread is bound to, or -1 if unbound */
+	int			cpu;
 };
 
-int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info);
+int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info,
+		       struct ofi_bufpool *xfer_pool);
+int xnet_create_xfer_pool(struct ofi_bufpool **xfer_pool);
 void xnet_close_progress(struct xnet_progress *progress);
 int xnet_start_progress(struct xnet_progress *progress);
 void xnet_stop_progress(struct xnet_progress *progress);
@@ -398,6 +473,8 @@ int xnet_uring_cancel(struct xnet_progress *progress,
 int xnet_uring_pollin_add(struct xnet_progress *progress,
 			  int fd, bool multishot,
 			  struct ofi_sockctx *pollin_ctx);
+int xnet_uring_start_rx(struct xnet_progress *progress, struct xnet_ep *ep);
+void xnet_uring_stop_rx(struct xnet_progress *progress, struct xnet_ep *ep);
 
 static inline int xnet_progress_locked(struct xnet_progress *progress)
 {
@@ -408,6 +485,8 @@ static inline int xnet_progress_locked(struct xnet_progress *progress)
 struct xnet_fabric {
 	struct util_fabric	util_fabric;
 	struct dlist_entry	eq_list;
+	/* Next entry of xnet_progress_cpus, protected by util_fabric.lock */
+	size_t			next_cpu;
 };
 
 static inline void xnet_signal_progress(struct xnet_progress *progress)
@@ -428,6 +507,7 @@ static inline void xnet_signal_progress(struct xnet_progress *progress)
 #define XNET_COPY_RECV		BIT(9)
 #define XNET_CLAIM_RECV		BIT(10)
 #define XNET_NEED_CTS		BIT(11)
+#define XNET_STRIPE_PART	BIT(12)
 #define XNET_MULTI_RECV		FI_MULTI_RECV /* BIT(16) */
 
 struct xnet_mrecv {
@@ -455,10 +535,19 @@ struct xnet_xfer_entry {
 	OFI_DBG_VAR(bool,	inuse)
 	uint32_t		async_index;
 	void			*context;
-	/* For RMA read requests, we track the request response so that
-	 * we don't generate multiple completions for the same operation.
-	 */
-	struct xnet_xfer_entry  *resp_entry;
+	union {
+		/* For RMA read requests, we track the request response so
+		 * that we don't generate multiple completions for the same
+		 * operation.
+		 */
+		struct xnet_xfer_entry  *resp_entry;
+		/* Striped rendezvous parts complete their parent transfer */
+		struct xnet_xfer_entry	*stripe_parent;
+	};
+	/* Bytes of a striped transfer not yet started or completed */
+	uint64_t		stripe_pending;
+	uint64_t		stripe_left;
+	int			stripe_err;
 
 	/* hdr must be second to last, followed by msg_data.  msg_data
 	 * is sized dynamically based on the max_inject size
@@ -491,10 +580,22 @@ struct xnet_domain {
 	 * progress an ep per thread, can have it's own
 	 * progress engine and avoid having a single
 	 * synchronization point among all eps.
+	 *
+	 * The same mechanism is used to shard an rdm domain
+	 * across FI_TCP_PROGRESS_SHARDS progress engines.  Once
+	 * that many subdomains exist, eps whose CQs and counters
+	 * are not yet bound to a subdomain are assigned to one
+	 * round-robin.  CQs and counters are never split across
+	 * subdomains, so completions are always written under
+	 * a single progress lock.
 	 */
 	 struct fi_info		*subdomain_info;
+	 /* xfer entries for all subdomains, see xnet_progress */
+	 struct ofi_bufpool	*xfer_pool;
 	 struct ofi_genlock	subdomain_list_lock;
 	 struct dlist_entry	subdomain_list;
+	 size_t			subdomain_cnt;
+	 size_t			next_subdomain;
 };
 
 static inline struct xnet_progress *xnet_ep2_progress(struct xnet_ep *ep)
@@ -590,6 +691,8 @@ static inline struct xnet_cq *xnet_ep_tx_cq(struct xnet_ep *ep)
 int xnet_mplex_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		       struct fid_av **fid_av, void *context);
 int xnet_domain_multiplexed(struct fid_domain *domain_fid);
+int xnet_open_subdomain(struct xnet_domain *domain,
+			struct fid_domain **subdomain_fid);
 int xnet_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		     struct fid_domain **domain, void *context);
 int xnet_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
@@ -598,9 +701,15 @@ int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		 struct fid_cq **cq_fid, void *context);
 void xnet_report_success(struct xnet_xfer_entry *xfer_entry);
 void xnet_report_error(struct xnet_xfer_entry *xfer_entry, int err);
+void xnet_stripe_done(struct xnet_xfer_entry *part, int err);
+void xnet_stripe_flush(struct xnet_progress *progress,
+		       struct ofi_byte_idx *cts_queue);
+bool xnet_stripe_busy(struct xnet_ep *ep);
 int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 		   struct fid_cntr **cntr_fid, void *context);
 void xnet_cntr_incerr(struct xnet_xfer_entry *xfer_entry);
+int xnet_cq_add_progress(struct xnet_cq *cq);
+int xnet_cntr_add_progress(struct util_cntr *cntr);
 
 void xnet_reset_rx(struct xnet_ep *ep);
 
@@ -670,7 +779,7 @@ xnet_alloc_xfer(struct xnet_progress *progress)
 	struct xnet_xfer_entry *xfer;
 
 	assert(xnet_progress_locked(progress));
-	xfer = ofi_buf_alloc(progress->xfer_pool);
+	xfer = ofi_buf_cache_alloc(progress->xfer_cache);
 	if (!xfer)
 		return NULL;
 
@@ -696,7 +805,7 @@ xnet_free_xfer(struct xnet_progress *progress, struct xnet_xfer_entry *xfer)
 
 	assert(xfer->inuse);
 	OFI_DBG_SET(xfer->inuse, false);
-	ofi_buf_free(xfer);
+	ofi_buf_cache_free(progress->xfer_cache, xfer);
 }
 
 static inline struct xnet_xfer_entry *
@@ -130,6 +130,11 @@ void xnet_report_success(struct xnet_xfer_entry *xfer_entry)
 	uint64_t flags, data, tag;
 	size_t len;
 
+	if (xfer_entry->ctrl_flags & XNET_STRIPE_PART) {
+		xnet_stripe_done(xfer_entry, 0);
+		return;
+	}
+
 	if (xfer_entry->ctrl_flags & (XNET_INTERNAL_XFER | XNET_SAVED_XFER))
 		return;
 
@@ -187,6 +192,11 @@ void xnet_report_error(struct xnet_xfer_entry *xfer_entry, int err)
 {
 	struct fi_cq_err_entry err_entry;
 
+	if (xfer_entry->ctrl_flags & XNET_STRIPE_PART) {
+		xnet_stripe_done(xfer_entry, err);
+		return;
+	}
+
 	if (xfer_entry->ctrl_flags &
 	    (XNET_INTERNAL_XFER | XNET_SAVED_XFER | XNET_INJECT_OP)) {
 		if (xfer_entry->ctrl_flags &
@@ -271,6 +281,20 @@ static int xnet_cq_wait_try_func(void *arg)
 	return FI_SUCCESS;
 }
 
+/* CQs and counters opened on a multiplexed domain are attached to the
+ * progress engine of a subdomain when bound to an enabled rdm endpoint.
+ */
+int xnet_cq_add_progress(struct xnet_cq *cq)
+{
+	if (!cq->util_cq.wait || !ofi_have_epoll)
+		return 0;
+
+	return ofi_wait_add_fd(cq->util_cq.wait,
+			ofi_dynpoll_get_fd(&xnet_cq2_progress(cq)->epoll_fd),
+			POLLIN, xnet_cq_wait_try_func, cq,
+			&cq->util_cq.cq_fid);
+}
+
 int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		 struct fid_cq **cq_fid, void *context)
 {
@@ -296,11 +320,9 @@ int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		goto free_cq;
 
-	if (cq->util_cq.wait && ofi_have_epoll) {
-		ret = ofi_wait_add_fd(cq->util_cq.wait,
-			       ofi_dynpoll_get_fd(&xnet_cq2_progress(cq)->epoll_fd),
-			       POLLIN, xnet_cq_wait_try_func, cq,
-			       &cq->util_cq.cq_fid);
+	/* A multiplexed domain has no progress engine of its own */
+	if (!xnet_domain_multiplexed(domain)) {
+		ret = xnet_cq_add_progress(cq);
 		if (ret)
 			goto cleanup;
 	}
@@ -444,10 +466,27 @@ static int xnet_cntr_wait_try_func(void *arg)
 	return FI_SUCCESS;
 }
 
+int xnet_cntr_add_progress(struct util_cntr *cntr)
+{
+	struct xnet_progress *progress;
+
+	if (!cntr->wait)
+		return 0;
+
+	progress = xnet_cntr2_progress(cntr);
+	if (cntr->wait->wait_obj == FI_WAIT_FD && ofi_have_epoll) {
+		return ofi_wait_add_fd(cntr->wait,
+				ofi_dynpoll_get_fd(&progress->epoll_fd),
+				POLLIN, xnet_cntr_wait_try_func, NULL,
+				&cntr->cntr_fid);
+	}
+
+	return xnet_start_progress(progress);
+}
+
 int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 		   struct fid_cntr **cntr_fid, void *context)
 {
-	struct xnet_progress *progress;
 	struct xnet_domain *domain;
 	struct util_cntr *cntr;
 	struct fi_cntr_attr cntr_attr;
@@ -478,16 +517,8 @@ int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 
 	if (attr->wait_obj == FI_WAIT_NONE) {
 		cntr->cntr_fid.ops = &xnet_cntr_ops;
-	} else {
-		progress = xnet_cntr2_progress(cntr);
-		if (attr->wait_obj == FI_WAIT_FD && ofi_have_epoll) {
-			ret = ofi_wait_add_fd(cntr->wait,
-					ofi_dynpoll_get_fd(&progress->epoll_fd),
-					POLLIN, xnet_cntr_wait_try_func, NULL,
-					&cntr->cntr_fid);
-		} else {
-			ret = xnet_start_progress(progress);
-		}
+	} else if (!xnet_domain_multiplexed(fid_domain)) {
+		ret = xnet_cntr_add_progress(cntr);
 		if (ret)
 			goto cleanup;
 	}
@@ -310,6 +310,7 @@ static int xnet_mplex_domain_close(fid_t fid)
 	ofi_genlock_unlock(&domain->subdomain_list_lock);
 
 	ofi_genlock_destroy(&domain->subdomain_list_lock);
+	ofi_bufpool_destroy(domain->xfer_pool);
 	ofi_domain_close(&domain->util_domain);
 	free(domain);
 	return FI_SUCCESS;
@@ -376,7 +377,15 @@ static int xnet_domain_mplex_open(struct fid_fabric *fabric_fid, struct fi_info
 		goto free_lock;
 	}
 
-	domain->subdomain_info->domain_attr->threading = FI_THREAD_DOMAIN;
+	if (info->domain_attr->threading == FI_THREAD_COMPLETION)
+		domain->subdomain_info->domain_attr->threading = FI_THREAD_DOMAIN;
+
+	/* Each subdomain caches xfer entries from a single pool, rather
+	 * than growing a pool of its own.
+	 */
+	ret = xnet_create_xfer_pool(&domain->xfer_pool);
+	if (ret)
+		goto free_info;
 
 	dlist_init(&domain->subdomain_list);
 	domain->ep_type = info->ep_attr->type;
@@ -386,6 +395,8 @@ static int xnet_domain_mplex_open(struct fid_fabric *fabric_fid, struct fi_info
 	*domain_fid = &domain->util_domain.domain_fid;
 	return FI_SUCCESS;
 
+free_info:
+	fi_freeinfo(domain->subdomain_info);
 free_lock:
 	ofi_genlock_destroy(&domain->subdomain_list_lock);
 close:
@@ -426,20 +437,15 @@ static struct fi_ops_mr xnet_domain_fi_ops_mr = {
 	.regattr = xnet_mr_regattr,
 };
 
-int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
-		     struct fid_domain **domain_fid, void *context)
+static int xnet_domain_open_one(struct fid_fabric *fabric_fid,
+				struct fi_info *info,
+				struct ofi_bufpool *xfer_pool,
+				struct fid_domain **domain_fid, void *context)
 {
+	struct xnet_fabric *fabric;
 	struct xnet_domain *domain;
 	int ret;
 
-	ret = ofi_prov_check_info(&xnet_util_prov, fabric_fid->api_version, info);
-	if (ret)
-		return ret;
-
-	if (info->ep_attr->type == FI_EP_RDM &&
-	    info->domain_attr->threading == FI_THREAD_COMPLETION)
-		return xnet_domain_mplex_open(fabric_fid, info, domain_fid, context);
-
 	domain = calloc(1, sizeof(*domain));
 	if (!domain)
 		return -FI_ENOMEM;
@@ -449,10 +455,19 @@ int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
 	if (ret)
 		goto free;
 
-	ret = xnet_init_progress(&domain->progress, info);
+	ret = xnet_init_progress(&domain->progress, info, xfer_pool);
 	if (ret)
 		goto close;
 
+	if (xnet_progress_cpu_cnt) {
+		fabric = container_of(fabric_fid, struct xnet_fabric,
+				      util_fabric.fabric_fid);
+		ofi_mutex_lock(&fabric->util_fabric.lock);
+		domain->progress.cpu = xnet_progress_cpus[fabric->next_cpu++ %
+							  xnet_progress_cpu_cnt];
+		ofi_mutex_unlock(&fabric->util_fabric.lock);
+	}
+
 	domain->ep_type = info->ep_attr->type;
 	domain->util_domain.domain_fid.fid.ops = &xnet_domain_fi_ops;
 	domain->util_domain.domain_fid.ops = &xnet_domain_ops;
@@ -467,3 +482,29 @@ free:
 	free(domain);
 	return ret;
 }
+
+int xnet_open_subdomain(struct xnet_domain *domain,
+			struct fid_domain **subdomain_fid)
+{
+	assert(xnet_domain_multiplexed(&domain->util_domain.domain_fid));
+	return xnet_domain_open_one(&domain->util_domain.fabric->fabric_fid,
+				    domain->subdomain_info, domain->xfer_pool,
+				    subdomain_fid, NULL);
+}
+
+int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
+		     struct fid_domain **domain_fid, void *context)
+{
+	int ret;
+
+	ret = ofi_prov_check_info(&xnet_util_prov, fabric_fid->api_version, info);
+	if (ret)
+		return ret;
+
+	if (info->ep_attr->type == FI_EP_RDM &&
+	    (info->domain_attr->threading == FI_THREAD_COMPLETION ||
+	     xnet_progress_shards > 1))
+		return xnet_domain_mplex_open(fabric_fid, info, domain_fid, context);
+
+	return xnet_domain_open_one(fabric_fid, info, NULL, domain_fid, context);
+}
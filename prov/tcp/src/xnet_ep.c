@@ -53,6 +53,8 @@ static const char *const xnet_opstr[] = {
 	[xnet_op_tag_rts] = "tag rts",
 	[xnet_op_cts] = "cts",
 	[xnet_op_data] = "rndv data",
+	[xnet_op_data_part] = "rndv data part",
+	[xnet_op_close] = "close",
 };
 
 static const char *xnet_op_str(uint8_t op)
@@ -197,6 +199,8 @@ static int xnet_monitor_ep(struct xnet_progress *progress, struct xnet_ep *ep)
 {
 	if (xnet_io_uring) {
 		assert(!(ep->pollflags & POLLOUT));
+		if (ep->state == XNET_CONNECTED)
+			return xnet_uring_start_rx(progress, ep);
 		return xnet_uring_pollin_add(progress, ep->bsock.sock,
 					     false, &ep->bsock.pollin_sockctx);
 	}
@@ -346,8 +350,12 @@ xnet_flush_xfer_queue(struct xnet_progress *progress, struct slist *queue,
 	}
 }
 
+/* The queues of a disabled ep are flushed again when it is closed, so
+ * remove the entries as they are freed.
+ */
 static void
-xnet_flush_byte_idx(struct xnet_progress *progress, struct ofi_byte_idx *idx)
+xnet_flush_byte_idx(struct xnet_progress *progress, struct ofi_byte_idx *idx,
+		    bool map)
 {
 	struct xnet_xfer_entry *xfer_entry;
 	uint8_t i;
@@ -356,11 +364,13 @@ xnet_flush_byte_idx(struct xnet_progress *progress, struct ofi_byte_idx *idx)
 		return;
 
 	for (i = 1; i < UINT8_MAX; i++) {
-		xfer_entry = ofi_byte_idx_lookup(idx, i);
-		if (xfer_entry) {
-			xnet_report_error(xfer_entry, FI_ECANCELED);
-			xnet_free_xfer(progress, xfer_entry);
-		}
+		if (!ofi_byte_idx_lookup(idx, i))
+			continue;
+
+		xfer_entry = map ? ofi_byte_idx_clear(idx, i) :
+			     ofi_byte_idx_remove(idx, i);
+		xnet_report_error(xfer_entry, FI_ECANCELED);
+		xnet_free_xfer(progress, xfer_entry);
 	}
 }
 
@@ -390,6 +400,8 @@ static void xnet_ep_flush_all_queues(struct xnet_ep *ep)
 	if (ret)
 		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Failed to cancel POLLIN uring\n");
 
+	xnet_uring_stop_rx(progress, ep);
+
 	if (ep->cur_tx.entry) {
 		ep->hdr_bswap(ep, &ep->cur_tx.entry->hdr.base_hdr);
 		if (ep->cur_tx.entry->ctrl_flags & XNET_NEED_CTS) {
@@ -407,8 +419,9 @@ static void xnet_ep_flush_all_queues(struct xnet_ep *ep)
 	xnet_flush_xfer_queue(progress, &ep->rma_read_queue, NULL);
 	xnet_flush_xfer_queue(progress, &ep->need_ack_queue, NULL);
 	xnet_flush_xfer_queue(progress, &ep->async_queue, NULL);
-	xnet_flush_byte_idx(progress, &ep->rts_queue);
-	xnet_flush_byte_idx(progress, &ep->cts_queue);
+	xnet_flush_byte_idx(progress, &ep->rts_queue, false);
+	xnet_stripe_flush(progress, &ep->cts_queue);
+	xnet_flush_byte_idx(progress, &ep->cts_queue, true);
 
 	/* Saved messages are on the saved_msg queue and flushed by the srx */
 	if (ep->cur_rx.entry &&
@@ -813,6 +826,7 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 	slist_init(&ep->rma_read_queue);
 	slist_init(&ep->need_ack_queue);
 	slist_init(&ep->async_queue);
+	slist_init(&ep->rbuf_list);
 
 	if (info->ep_attr->rx_ctx_cnt != FI_SHARED_CONTEXT)
 		ep->rx_avail = (int) info->rx_attr->size;
@@ -67,11 +67,57 @@ size_t xnet_zerocopy_size = SIZE_MAX;
 int xnet_trace_msg;
 int xnet_disable_autoprog;
 int xnet_io_uring;
+int xnet_io_uring_mshot = 1;
 int xnet_max_saved = 64;
 size_t xnet_max_inject = XNET_DEF_INJECT;
 size_t xnet_buf_size = XNET_DEF_BUF_SIZE;
 size_t xnet_max_saved_size = SIZE_MAX;
+size_t xnet_progress_shards;
+size_t xnet_rdm_stripes = 1;
+size_t xnet_stripe_size = 262144;
+size_t xnet_max_conns;
+int xnet_conn_idle_timeout;
+int *xnet_progress_cpus;
+size_t xnet_progress_cpu_cnt;
 
+/* Expand a cpu list of the form "0-3,8,16-30:2" into xnet_progress_cpus. */
+static int xnet_parse_cpus(const char *str)
+{
+	char *dup_str, *range, *saveptr = NULL;
+	int first, last, stride, cpu, *cpus;
+	size_t cnt = 0;
+
+	dup_str = strdup(str);
+	if (!dup_str)
+		return -FI_ENOMEM;
+
+	for (range = strtok_r(dup_str, ",", &saveptr); range;
+	     range = strtok_r(NULL, ",", &saveptr)) {
+		stride = 1;
+		if (sscanf(range, "%d-%d:%d", &first, &last, &stride) < 2)
+			last = first;
+		if (first < 0 || last < first || stride <= 0)
+			goto err;
+
+		for (cpu = first; cpu <= last; cpu += stride) {
+			cpus = realloc(xnet_progress_cpus,
+				       sizeof(*cpus) * (cnt + 1));
+			if (!cpus)
+				goto err;
+			xnet_progress_cpus = cpus;
+			xnet_progress_cpus[cnt++] = cpu;
+		}
+	}
+
+	free(dup_str);
+	xnet_progress_cpu_cnt = cnt;
+	return 0;
+err:
+	free(dup_str);
+	free(xnet_progress_cpus);
+	xnet_progress_cpus = NULL;
+	return -FI_EINVAL;
+}
 
 static void xnet_init_env(void)
 {
@@ -186,11 +232,74 @@ static void xnet_init_env(void)
 			"Enable io_uring support if available (default: %d)", xnet_io_uring);
 	fi_param_get_bool(&xnet_prov, "io_uring",
 			 &xnet_io_uring);
+	fi_param_define(&xnet_prov, "io_uring_multishot", FI_PARAM_BOOL,
+			"Use multishot receives into provided buffers and "
+			"registered sockets when io_uring is enabled "
+			"(default: %d)", xnet_io_uring_mshot);
+	fi_param_get_bool(&xnet_prov, "io_uring_multishot",
+			 &xnet_io_uring_mshot);
+
+	fi_param_define(&xnet_prov, "progress_shards", FI_PARAM_SIZE_T,
+			"Spread the endpoints of an rdm domain across up to "
+			"this many progress engines, each with its own "
+			"sockets, lock, and progress thread.  Endpoints that "
+			"share a CQ or counter share a progress engine.  "
+			"Set to 0 to disable (default: %zu)",
+			xnet_progress_shards);
+	fi_param_get_size_t(&xnet_prov, "progress_shards",
+			    &xnet_progress_shards);
+
+	fi_param_define(&xnet_prov, "rdm_stripes", FI_PARAM_SIZE_T,
+			"Number of connections opened to each peer of an rdm "
+			"endpoint.  Rendezvous data is striped across all "
+			"connections, while other messages use the first.  "
+			"Maximum %d (default: %zu)", XNET_MAX_STRIPES,
+			xnet_rdm_stripes);
+	fi_param_get_size_t(&xnet_prov, "rdm_stripes", &xnet_rdm_stripes);
+	if (xnet_rdm_stripes > XNET_MAX_STRIPES)
+		xnet_rdm_stripes = XNET_MAX_STRIPES;
+
+	fi_param_define(&xnet_prov, "stripe_size", FI_PARAM_SIZE_T,
+			"Minimum amount of rendezvous data sent over each "
+			"connection when striping (default: %zu)",
+			xnet_stripe_size);
+	fi_param_get_size_t(&xnet_prov, "stripe_size", &xnet_stripe_size);
+	if (!xnet_stripe_size)
+		xnet_stripe_size = 1;
+
+	fi_param_define(&xnet_prov, "max_conns", FI_PARAM_SIZE_T,
+			"Number of peers an rdm endpoint keeps connected "
+			"before closing the least recently used idle "
+			"connection.  Closed connections are re-established "
+			"on next use.  Set to 0 for no limit (default: %zu)",
+			xnet_max_conns);
+	fi_param_get_size_t(&xnet_prov, "max_conns", &xnet_max_conns);
+
+	fi_param_define(&xnet_prov, "conn_idle_timeout", FI_PARAM_INT,
+			"Time in milliseconds after which an rdm connection "
+			"that has not been used is closed.  Set to 0 to "
+			"disable (default: %d)", xnet_conn_idle_timeout);
+	fi_param_get_int(&xnet_prov, "conn_idle_timeout",
+			 &xnet_conn_idle_timeout);
+	if (xnet_conn_idle_timeout < 0)
+		xnet_conn_idle_timeout = 0;
+
+	param = NULL;
+	fi_param_define(&xnet_prov, "progress_affinity", FI_PARAM_STRING,
+			"List of cpus (e.g. 0-3,8) that domain progress "
+			"threads are bound to.  Each progress thread is "
+			"assigned one cpu from the list in round-robin order "
+			"(default: unbound)");
+	fi_param_get_str(&xnet_prov, "progress_affinity", &param);
+	if (param && strlen(param) && xnet_parse_cpus(param)) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"Invalid progress_affinity %s. Ignoring.\n", param);
+	}
 }
 
 static void xnet_fini(void)
 {
-	/* empty as of now */
+	free(xnet_progress_cpus);
 }
 
 struct fi_provider xnet_prov = {
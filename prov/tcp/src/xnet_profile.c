@@ -39,6 +39,47 @@
 #ifdef HAVE_FABRIC_PROFILE
 #include <ofi_profile.h>
 
+enum {
+	XNET_VAR_CONN_EVICT = -FI_PROV_SPECIFIC_TCP,
+	XNET_VAR_CONN_RECONNECT,
+};
+
+static struct fi_profile_desc xnet_conn_vars[] = {
+	{
+	 .id = XNET_VAR_CONN_EVICT,
+	 .datatype_sel = fi_primitive_type,
+	 .datatype.primitive = FI_UINT64,
+	 .flags = 0,
+	 .size = 8,
+	 .name = "pvar_tcp_conn_evict",
+	 .desc = "Number of idle connections closed"
+	},
+	{
+	 .id = XNET_VAR_CONN_RECONNECT,
+	 .datatype_sel = fi_primitive_type,
+	 .datatype.primitive = FI_UINT64,
+	 .flags = 0,
+	 .size = 8,
+	 .name = "pvar_tcp_conn_reconnect",
+	 .desc = "Number of connections re-established after closing"
+	},
+};
+
+static void
+xnet_prof_add_conn_vars(struct util_profile *prof, struct xnet_rdm *rdm)
+{
+	(void) ofi_prof_add_var(prof, FI_VAR_CONNECTION_CNT, NULL,
+				&rdm->conn_stats.open);
+	(void) ofi_prof_add_var(prof, FI_VAR_CONN_REQUEST, NULL,
+				&rdm->conn_stats.connect);
+	(void) ofi_prof_add_var(prof, FI_VAR_CONN_ACCEPT, NULL,
+				&rdm->conn_stats.accept);
+	(void) ofi_prof_add_var(prof, XNET_VAR_CONN_EVICT, &xnet_conn_vars[0],
+				&rdm->conn_stats.evict);
+	(void) ofi_prof_add_var(prof, XNET_VAR_CONN_RECONNECT,
+				&xnet_conn_vars[1], &rdm->conn_stats.reconnect);
+}
+
 static int
 xnet_prof_init(struct fid *fid, uint64_t flags, void *context,
 	       struct fi_profile_ops *ops, struct xnet_profile **xnet_prof)
@@ -234,6 +275,7 @@ int xnet_rdm_ops_open(struct fid *fid, const char *name,
 			rdm = container_of(fid, struct xnet_rdm,
 					   util_ep.ep_fid.fid);
 			rdm->profile = xnet_prof;
+			xnet_prof_add_conn_vars(&xnet_prof->util_prof, rdm);
 			if (rdm->srx)
 				rdm->srx->profile = xnet_prof;
 			*ops = &(xnet_prof->util_prof.prof_fid.ops);
@@ -186,7 +186,7 @@ static int xnet_queue_ack(struct xnet_ep *ep, uint8_t op, uint8_t op_data)
 	struct xnet_xfer_entry *resp;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
-	assert(op == xnet_op_msg || op == xnet_op_cts);
+	assert(op == xnet_op_msg || op == xnet_op_cts || op == xnet_op_close);
 	resp = xnet_alloc_xfer(xnet_ep2_progress(ep));
 	if (!resp)
 		return -FI_ENOMEM;
@@ -208,6 +208,46 @@ static int xnet_queue_ack(struct xnet_ep *ep, uint8_t op, uint8_t op_data)
 	return FI_SUCCESS;
 }
 
+int xnet_queue_close(struct xnet_ep *ep, uint8_t type)
+{
+	assert(ep->util_ep.flags & XNET_EP_CLOSE);
+	return xnet_queue_ack(ep, xnet_op_close, type);
+}
+
+static bool xnet_byte_idx_empty(struct ofi_byte_idx *idx)
+{
+	int i;
+
+	if (!idx->data)
+		return true;
+
+	for (i = 1; i <= UINT8_MAX; i++) {
+		if (ofi_byte_idx_lookup(idx, (uint8_t) i))
+			return false;
+	}
+	return true;
+}
+
+/* An ep is idle if closing it cannot affect any transfer, including
+ * rendezvous and RMA operations waiting on a response from the peer.
+ */
+bool xnet_ep_idle(struct xnet_ep *ep)
+{
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	return ep->state == XNET_CONNECTED && !ep->cur_tx.entry &&
+	       !ep->cur_rx.handler && slist_empty(&ep->tx_queue) &&
+	       slist_empty(&ep->priority_queue) &&
+	       slist_empty(&ep->need_ack_queue) &&
+	       slist_empty(&ep->async_queue) &&
+	       slist_empty(&ep->rma_read_queue) &&
+	       slist_empty(&ep->rbuf_list) &&
+	       !ofi_bsock_tosend(&ep->bsock) &&
+	       !ofi_bsock_readable(&ep->bsock) &&
+	       (!ep->saved_msg || slist_empty(&ep->saved_msg->queue)) &&
+	       xnet_byte_idx_empty(&ep->rts_queue) &&
+	       xnet_byte_idx_empty(&ep->cts_queue);
+}
+
 static int
 xnet_rts_matched(struct xnet_rdm *rdm, struct xnet_ep *ep,
 		 struct xnet_xfer_entry *rx_entry)
@@ -226,6 +266,10 @@ xnet_rts_matched(struct xnet_rdm *rdm, struct xnet_ep *ep,
 		}
 	}
 
+	rx_entry->stripe_pending = xnet_msg_len(&rx_entry->hdr);
+	rx_entry->stripe_left = rx_entry->stripe_pending;
+	rx_entry->stripe_err = 0;
+
 	cts_ctx = ofi_byte_idx_set(&ep->cts_queue,
 				   rx_entry->hdr.base_hdr.op_data, rx_entry);
 	assert(cts_ctx == rx_entry->hdr.base_hdr.op_data);
@@ -377,6 +421,160 @@ int xnet_uring_pollin_add(struct xnet_progress *progress, int fd,
 	return 0;
 }
 
+static void xnet_uring_set_file(struct xnet_ep *ep, int index)
+{
+	ep->bsock.tx_sockctx.uring_fixed_file = index;
+	ep->bsock.rx_sockctx.uring_fixed_file = index;
+	ep->bsock.pollin_sockctx.uring_fixed_file = index;
+}
+
+/* Registering the socket is an optimization only, failures are ignored */
+static void xnet_uring_add_file(struct xnet_progress *progress,
+				struct xnet_ep *ep)
+{
+	int index;
+
+	if (!progress->free_file_cnt ||
+	    ep->bsock.rx_sockctx.uring_fixed_file >= 0)
+		return;
+
+	index = progress->free_files[--progress->free_file_cnt];
+	if (ofi_uring_file_set(&progress->tx_uring.ring, index,
+			       ep->bsock.sock))
+		goto err;
+
+	if (ofi_uring_file_set(&progress->rx_uring.ring, index,
+			       ep->bsock.sock)) {
+		(void) ofi_uring_file_set(&progress->tx_uring.ring, index, -1);
+		goto err;
+	}
+
+	xnet_uring_set_file(ep, index);
+	return;
+err:
+	progress->free_files[progress->free_file_cnt++] = index;
+}
+
+static void xnet_uring_put_rbuf(struct xnet_progress *progress,
+				unsigned int bid)
+{
+	assert(progress->rx_bufs_held);
+	progress->rx_bufs_held--;
+	ofi_uring_buf_put(&progress->rx_bufs, bid);
+}
+
+/* After running out of provided buffers, an ep receives with single shot
+ * requests.  Switch it back to multishot between requests, once at least
+ * half of the buffers have been returned to the kernel.
+ */
+static void xnet_uring_resume_mshot(struct xnet_progress *progress,
+				    struct xnet_ep *ep)
+{
+	if (ep->bsock.rx_sockctx.uring_sqe_inuse || ep->bsock.async_prefetch ||
+	    ep->bsock.pollin_sockctx.uring_sqe_inuse ||
+	    (ep->pollflags & POLLIN) ||
+	    progress->rx_bufs_held > progress->rx_bufs.cnt / 2)
+		return;
+
+	FI_DBG(&xnet_prov, FI_LOG_EP_DATA,
+	       "provided buffers available, resuming multishot receives\n");
+	ep->rbuf_exhausted = false;
+	ep->bsock.mshot = true;
+}
+
+static int xnet_uring_arm_rx(struct xnet_progress *progress,
+			     struct xnet_ep *ep)
+{
+	int ret;
+
+	if (ep->bsock.rx_sockctx.uring_sqe_inuse || ep->rbuf_exhausted ||
+	    ep->rbuf_err)
+		return 0;
+
+	ret = ofi_sockapi_recv_mshot_uring(progress->rx_uring.sockapi,
+					   ep->bsock.sock, &progress->rx_bufs,
+					   &ep->bsock.rx_sockctx);
+	return ret == -OFI_EINPROGRESS_URING ? 0 : ret;
+}
+
+int xnet_uring_start_rx(struct xnet_progress *progress, struct xnet_ep *ep)
+{
+	assert(xnet_progress_locked(progress));
+	if (!progress->uring_mshot)
+		return xnet_uring_pollin_add(progress, ep->bsock.sock, false,
+					     &ep->bsock.pollin_sockctx);
+
+	xnet_uring_add_file(progress, ep);
+
+	/* Received data is always staged through rq */
+	if (!ep->bsock.rq.size)
+		ep->bsock.rq.size = OFI_BYTEQ_SIZE;
+	ep->bsock.mshot = true;
+	return xnet_uring_arm_rx(progress, ep);
+}
+
+/* Called once all receive and poll requests for the ep have completed */
+void xnet_uring_stop_rx(struct xnet_progress *progress, struct xnet_ep *ep)
+{
+	struct xnet_rbuf *rbuf;
+	struct slist_entry *entry;
+	int index;
+
+	assert(xnet_progress_locked(progress));
+	while (!slist_empty(&ep->rbuf_list)) {
+		entry = slist_remove_head(&ep->rbuf_list);
+		rbuf = container_of(entry, struct xnet_rbuf, entry);
+		xnet_uring_put_rbuf(progress, rbuf->bid);
+		ofi_buf_free(rbuf);
+	}
+
+	index = ep->bsock.rx_sockctx.uring_fixed_file;
+	if (index < 0)
+		return;
+
+	(void) ofi_uring_file_set(&progress->tx_uring.ring, index, -1);
+	(void) ofi_uring_file_set(&progress->rx_uring.ring, index, -1);
+	progress->free_files[progress->free_file_cnt++] = index;
+	xnet_uring_set_file(ep, -1);
+}
+
+/* Copy queued multishot data into rq, returning buffers to the kernel.
+ * Once the kernel ran out of buffers for this ep, we revert to single
+ * shot receives after the queued data has been consumed, until
+ * xnet_uring_resume_mshot() finds enough buffers again.
+ */
+static void xnet_uring_fill_rq(struct xnet_progress *progress,
+			       struct xnet_ep *ep)
+{
+	struct xnet_rbuf *rbuf;
+	size_t len;
+
+	while (!slist_empty(&ep->rbuf_list)) {
+		len = ofi_byteq_writeable(&ep->bsock.rq);
+		if (!len)
+			return;
+
+		rbuf = container_of(ep->rbuf_list.head, struct xnet_rbuf,
+				    entry);
+		len = MIN(len, rbuf->len);
+		ofi_byteq_write(&ep->bsock.rq,
+				(char *) ofi_uring_buf(&progress->rx_bufs,
+						       rbuf->bid) + rbuf->offset,
+				len);
+		rbuf->offset += (uint32_t) len;
+		rbuf->len -= (uint32_t) len;
+		if (rbuf->len)
+			return;
+
+		(void) slist_remove_head(&ep->rbuf_list);
+		xnet_uring_put_rbuf(progress, rbuf->bid);
+		ofi_buf_free(rbuf);
+	}
+
+	if (ep->rbuf_exhausted && !ep->bsock.rx_sockctx.uring_sqe_inuse)
+		ep->bsock.mshot = false;
+}
+
 static int xnet_update_pollflag(struct xnet_ep *ep, short pollflag, bool set)
 {
 	struct xnet_progress *progress;
@@ -521,6 +719,9 @@ static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 
 	if (ret) {
 		FI_WARN(&xnet_prov, FI_LOG_DOMAIN, "msg send failed\n");
+		if (tx_entry->ctrl_flags & XNET_NEED_CTS)
+			ofi_byte_idx_remove(&ep->rts_queue,
+					    tx_entry->hdr.base_hdr.op_data);
 		xnet_cntr_incerr(tx_entry);
 		xnet_report_error(tx_entry, -ret);
 		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
@@ -832,6 +1033,167 @@ static int xnet_handle_tag(struct xnet_ep *ep)
 	return -FI_EAGAIN;
 }
 
+/* Completion of a striped part, called through the report functions.
+ * The parent transfer completes once all of its data has been handled.
+ */
+void xnet_stripe_done(struct xnet_xfer_entry *part, int err)
+{
+	struct xnet_xfer_entry *parent;
+
+	parent = part->stripe_parent;
+	assert(parent->stripe_left >= part->stripe_left);
+	parent->stripe_left -= part->stripe_left;
+	part->stripe_left = 0;
+	if (err && !parent->stripe_err)
+		parent->stripe_err = err;
+
+	if (parent->stripe_left)
+		return;
+
+	if (parent->stripe_err) {
+		xnet_cntr_incerr(parent);
+		xnet_report_error(parent, parent->stripe_err);
+	} else {
+		xnet_report_success(parent);
+	}
+	xnet_free_xfer(xnet_cq2_progress(parent->cq), parent);
+}
+
+/* Receives with parts in flight on other connections are completed by
+ * those parts.  Detach them from the cts queue being flushed.
+ */
+void xnet_stripe_flush(struct xnet_progress *progress,
+		       struct ofi_byte_idx *cts_queue)
+{
+	struct xnet_xfer_entry *rx_entry;
+	uint8_t i;
+
+	assert(xnet_progress_locked(progress));
+	if (!cts_queue->data)
+		return;
+
+	for (i = 1; i < UINT8_MAX; i++) {
+		rx_entry = ofi_byte_idx_lookup(cts_queue, i);
+		if (!rx_entry || rx_entry->stripe_pending == rx_entry->stripe_left)
+			continue;
+
+		ofi_byte_idx_clear(cts_queue, i);
+		rx_entry->stripe_left -= rx_entry->stripe_pending;
+		rx_entry->stripe_pending = 0;
+		if (!rx_entry->stripe_err)
+			rx_entry->stripe_err = FI_ECANCELED;
+	}
+}
+
+/* Returns true if a rendezvous receive is waiting for data.  The data
+ * may have been striped over any of the lanes to the peer.
+ */
+bool xnet_stripe_busy(struct xnet_ep *ep)
+{
+	uint8_t i;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (!(ep->util_ep.flags & XNET_EP_STRIPE) || !ep->cts_queue.data)
+		return false;
+
+	for (i = 1; i < UINT8_MAX; i++) {
+		if (ofi_byte_idx_lookup(&ep->cts_queue, i))
+			return true;
+	}
+	return false;
+}
+
+static struct xnet_xfer_entry *
+xnet_alloc_part(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry,
+		uint64_t offset, uint64_t len)
+{
+	struct xnet_xfer_entry *part;
+	size_t cnt;
+
+	part = xnet_alloc_tx(ep);
+	if (!part)
+		return NULL;
+
+	part->ctrl_flags = XNET_STRIPE_PART;
+	part->stripe_parent = tx_entry;
+	part->stripe_left = len;
+	part->cq = NULL;
+
+	part->hdr.base_hdr.op = xnet_op_data_part;
+	part->hdr.base_hdr.op_data = tx_entry->hdr.base_hdr.op_data;
+	part->hdr.base_hdr.rma_iov_cnt = 0;
+	part->hdr.base_hdr.hdr_size = sizeof(part->hdr.data_part_hdr);
+	part->hdr.base_hdr.size = part->hdr.base_hdr.hdr_size + len;
+	part->hdr.data_part_hdr.offset = offset;
+
+	/* User data is iov[1+] */
+	cnt = tx_entry->iov_cnt - 1;
+	memcpy(&part->iov[1], &tx_entry->iov[1], sizeof(*part->iov) * cnt);
+	ofi_consume_iov(&part->iov[1], &cnt, offset);
+	(void) ofi_truncate_iov(&part->iov[1], &cnt, len);
+
+	part->iov[0].iov_base = &part->hdr;
+	part->iov[0].iov_len = part->hdr.base_hdr.hdr_size;
+	part->iov_cnt = cnt + 1;
+	return part;
+}
+
+/* Split rendezvous data across the connected lanes of an rdm peer.
+ * Returns false if the transfer should be sent as a single message.
+ */
+static bool xnet_stripe_data(struct xnet_ep *ep,
+			     struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_xfer_entry *parts[XNET_MAX_STRIPES];
+	struct xnet_ep *lanes[XNET_MAX_STRIPES];
+	struct xnet_conn *conn;
+	uint64_t msg_len, part_len, offset;
+	size_t i, cnt;
+
+	if (!(ep->util_ep.flags & XNET_EP_STRIPE) ||
+	    (tx_entry->ctrl_flags & XNET_NEED_ACK) ||
+	    (tx_entry->hdr.base_hdr.flags &
+	     (XNET_DELIVERY_COMPLETE | XNET_COMMIT_COMPLETE)))
+		return false;
+
+	msg_len = xnet_msg_len(&tx_entry->hdr);
+	if (msg_len < xnet_stripe_size * 2)
+		return false;
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	assert(conn->ep == ep);
+	lanes[0] = ep;
+	for (i = 0, cnt = 1; i < ARRAY_SIZE(conn->lanes); i++) {
+		if (conn->lanes[i] && conn->lanes[i]->state == XNET_CONNECTED &&
+		    (conn->lanes[i]->util_ep.flags & XNET_EP_STRIPE))
+			lanes[cnt++] = conn->lanes[i];
+	}
+
+	cnt = MIN(cnt, msg_len / xnet_stripe_size);
+	if (cnt < 2)
+		return false;
+
+	part_len = msg_len / cnt;
+	for (i = 0, offset = 0; i < cnt; i++, offset += part_len) {
+		parts[i] = xnet_alloc_part(lanes[i], tx_entry, offset,
+					   i < cnt - 1 ? part_len :
+					   msg_len - offset);
+		if (!parts[i])
+			goto free;
+	}
+
+	tx_entry->stripe_left = msg_len;
+	tx_entry->stripe_err = 0;
+	for (i = 0; i < cnt; i++)
+		xnet_tx_queue_insert(lanes[i], parts[i]);
+	return true;
+
+free:
+	while (i--)
+		xnet_free_xfer(xnet_ep2_progress(ep), parts[i]);
+	return false;
+}
+
 static int xnet_handle_cts(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *tx_entry;
@@ -846,8 +1208,9 @@ static int xnet_handle_cts(struct xnet_ep *ep)
 
 	assert(tx_entry->ctrl_flags & XNET_NEED_CTS);
 	tx_entry->ctrl_flags &= ~XNET_NEED_CTS;
-	xnet_tx_queue_insert(ep, tx_entry);
 	xnet_reset_rx(ep);
+	if (!xnet_stripe_data(ep, tx_entry))
+		xnet_tx_queue_insert(ep, tx_entry);
 	return 0;
 }
 
@@ -881,6 +1244,91 @@ static int xnet_handle_data(struct xnet_ep *ep)
 	return xnet_recv_msg_data(ep);
 }
 
+/* Data for a striped rendezvous transfer may arrive on any connection
+ * to the peer, but the receive is tracked by the primary connection.
+ */
+static int xnet_handle_data_part(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *rx_entry, *part;
+	struct xnet_active_rx *msg = &ep->cur_rx;
+	struct xnet_conn *conn;
+	uint64_t offset, len;
+	uint8_t cts_ctx;
+	size_t cnt;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (!(ep->util_ep.flags & XNET_EP_STRIPE)) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+			"Unexpected rndv data part\n");
+		return -FI_EIO;
+	}
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	cts_ctx = msg->hdr.base_hdr.op_data;
+	rx_entry = conn->ep ? ofi_byte_idx_lookup(&conn->ep->cts_queue,
+						 cts_ctx) : NULL;
+	if (!rx_entry) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Invalid cts index\n");
+		return -FI_EINVAL;
+	}
+
+	offset = msg->hdr.data_part_hdr.offset;
+	len = msg->hdr.base_hdr.size - msg->hdr.base_hdr.hdr_size;
+	if (len > rx_entry->stripe_pending ||
+	    offset + len > xnet_msg_len(&rx_entry->hdr)) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "rts - data size mismatch\n");
+		return -FI_EIO;
+	}
+
+	part = xnet_alloc_xfer(xnet_ep2_progress(ep));
+	if (!part)
+		return -FI_ENOMEM;
+
+	part->ctrl_flags = XNET_STRIPE_PART;
+	part->stripe_parent = rx_entry;
+	part->stripe_left = len;
+
+	rx_entry->stripe_pending -= len;
+	if (!rx_entry->stripe_pending)
+		ofi_byte_idx_clear(&conn->ep->cts_queue, cts_ctx);
+
+	cnt = rx_entry->iov_cnt;
+	memcpy(part->iov, rx_entry->iov, sizeof(*part->iov) * cnt);
+	if (offset < ofi_total_iov_len(part->iov, cnt)) {
+		ofi_consume_iov(part->iov, &cnt, offset);
+		(void) ofi_truncate_iov(part->iov, &cnt, len);
+	} else {
+		cnt = 0;
+	}
+	part->iov_cnt = cnt;
+
+	ep->cur_rx.entry = part;
+	ep->cur_rx.handler = xnet_recv_msg_data;
+	if (!part->iov_cnt && len) {
+		int ret = xnet_handle_truncate(ep);
+		if (ret)
+			return ret;
+	}
+	return xnet_recv_msg_data(ep);
+}
+
+static int xnet_handle_close(struct xnet_ep *ep)
+{
+	uint8_t type;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (!(ep->util_ep.flags & XNET_EP_CLOSE) ||
+	    ep->cur_rx.hdr.base_hdr.size != ep->cur_rx.hdr.base_hdr.hdr_size) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Unexpected close msg\n");
+		return -FI_EIO;
+	}
+
+	type = ep->cur_rx.hdr.base_hdr.op_data;
+	xnet_reset_rx(ep);
+	/* An error return disables the ep */
+	return xnet_handle_close_msg(ep, type);
+}
+
 static int xnet_handle_read_req(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *resp;
@@ -1126,8 +1574,15 @@ void xnet_progress_rx(struct xnet_ep *ep)
 	int ret;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	ep->referenced = true;
+	if (ep->rbuf_exhausted && !ep->bsock.mshot)
+		xnet_uring_resume_mshot(xnet_ep2_progress(ep), ep);
+
 	do {
 		assert(ep->state == XNET_CONNECTED);
+		if (ep->bsock.mshot)
+			xnet_uring_fill_rq(xnet_ep2_progress(ep), ep);
+
 		if (ep->cur_rx.hdr_done < ep->cur_rx.hdr_len) {
 			ret = xnet_recv_hdr(ep);
 		} else {
@@ -1135,18 +1590,35 @@ void xnet_progress_rx(struct xnet_ep *ep)
 		}
 
 		if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret) ||
-		    ret == -OFI_EINPROGRESS_URING)
-			break;
+		    ret == -OFI_EINPROGRESS_URING) {
+			/* rq was drained, but more multishot data is queued */
+			if (ep->bsock.mshot && !ofi_bsock_readable(&ep->bsock) &&
+			    !slist_empty(&ep->rbuf_list)) {
+				ret = 0;
+				continue;
+			}
+
+			/* all data received before the error was consumed */
+			if (!ep->bsock.mshot || !ep->rbuf_err ||
+			    ofi_bsock_readable(&ep->bsock) ||
+			    !slist_empty(&ep->rbuf_list))
+				break;
+			ret = ep->rbuf_err;
+		}
 
 		if (ep->cur_rx.entry)
 			xnet_complete_rx(ep, ret);
 		else if (ret)
 			xnet_ep_disable(ep, 0, NULL, 0);
 
-	} while (!ret && ofi_bsock_readable(&ep->bsock));
+	} while (!ret && (ofi_bsock_readable(&ep->bsock) ||
+			  !slist_empty(&ep->rbuf_list)));
 
 	if (xnet_io_uring) {
-		if (ret == -OFI_EINPROGRESS_URING)
+		if (ep->bsock.mshot)
+			ret = ep->state == XNET_CONNECTED ?
+			      xnet_uring_arm_rx(xnet_ep2_progress(ep), ep) : 0;
+		else if (ret == -OFI_EINPROGRESS_URING)
 			ret = xnet_update_pollflag(ep, POLLIN, false);
 		else if (!ret || OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
 			ret = xnet_update_pollflag(ep, POLLIN, true);
@@ -1188,7 +1660,7 @@ static void xnet_uring_tx_done(struct xnet_ep *ep, int res)
 	assert(tx_entry);
 
 	if (res < 0) {
-		if (!OFI_SOCK_TRY_SND_RCV_AGAIN(-res))
+		if (res != -ECANCELED && !OFI_SOCK_TRY_SND_RCV_AGAIN(-res))
 			xnet_complete_tx(ep, res);
 	} else {
 		assert(res <= ep->cur_tx.data_left);
@@ -1207,7 +1679,10 @@ static void xnet_uring_rx_done(struct xnet_ep *ep, int res)
 	struct xnet_xfer_entry *rx_entry;
 	int ret;
 
-	if (ep->bsock.async_prefetch) {
+	if (res == -ECANCELED) {
+		/* Nothing was received, post the request again */
+		ep->bsock.async_prefetch = false;
+	} else if (ep->bsock.async_prefetch) {
 		if (res > 0)
 			ofi_bsock_prefetch_done(&ep->bsock, res);
 		else {
@@ -1243,6 +1718,49 @@ disable_ep:
 	xnet_ep_disable(ep, 0, NULL, 0);
 }
 
+static void xnet_uring_mshot_done(struct xnet_ep *ep, int res, uint32_t flags)
+{
+	struct xnet_progress *progress;
+	struct xnet_rbuf *rbuf;
+	uint32_t bid;
+
+	progress = xnet_ep2_progress(ep);
+	if (flags & IORING_CQE_F_BUFFER) {
+		bid = flags >> IORING_CQE_BUFFER_SHIFT;
+		progress->rx_bufs_held++;
+		if (ep->state != XNET_CONNECTED || res <= 0)
+			goto put;
+
+		rbuf = ofi_buf_alloc(progress->rbuf_pool);
+		if (!rbuf) {
+			FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+				"unable to queue received data\n");
+			xnet_uring_put_rbuf(progress, bid);
+			xnet_ep_disable(ep, 0, NULL, 0);
+			return;
+		}
+
+		rbuf->bid = bid;
+		rbuf->offset = 0;
+		rbuf->len = (uint32_t) res;
+		slist_insert_tail(&rbuf->entry, &ep->rbuf_list);
+	} else if (ep->state != XNET_CONNECTED) {
+		return;
+	} else if (res == -ENOBUFS) {
+		FI_DBG(&xnet_prov, FI_LOG_EP_DATA,
+		       "out of provided buffers, using single shot receives\n");
+		ep->rbuf_exhausted = true;
+	} else if (res <= 0 && res != -ECANCELED) {
+		/* Data queued ahead of the error is still delivered */
+		ep->rbuf_err = res ? res : -FI_ENOTCONN;
+	}
+
+	xnet_progress_rx(ep);
+	return;
+put:
+	xnet_uring_put_rbuf(progress, bid);
+}
+
 static void xnet_uring_connect_done(struct xnet_ep *ep, int res)
 {
 	struct xnet_progress *progress;
@@ -1276,9 +1794,20 @@ disable:
 	xnet_ep_disable(ep, -ret, NULL, 0);
 }
 
+/* The provider only cancels requests after an ep leaves the connected
+ * state.  The kernel also cancels a request when the thread that submitted
+ * it exits, so a connected ep that sees -ECANCELED submits the request
+ * again from the thread now driving progress.
+ */
 static void xnet_uring_run_ep(struct xnet_ep *ep, struct ofi_sockctx *sockctx,
-			      int res)
+			      int res, uint32_t flags)
 {
+	/* Multishot completions must return their buffer in any state */
+	if (sockctx == &ep->bsock.rx_sockctx && ep->bsock.mshot) {
+		xnet_uring_mshot_done(ep, res, flags);
+		return;
+	}
+
 	switch (ep->state) {
 	case XNET_CONNECTED:
 		if (sockctx == &ep->bsock.tx_sockctx) {
@@ -1286,10 +1815,10 @@ static void xnet_uring_run_ep(struct xnet_ep *ep, struct ofi_sockctx *sockctx,
 		} else if (sockctx == &ep->bsock.rx_sockctx) {
 			xnet_uring_rx_done(ep, res);
 		} else if (sockctx == &ep->bsock.pollin_sockctx) {
-			if (res < 0) {
+			if (res < 0 && res != -ECANCELED) {
 				xnet_ep_disable(ep, -res, NULL, 0);
 			} else {
-				assert(res & POLLIN);
+				assert(res == -ECANCELED || (res & POLLIN));
 				xnet_progress_rx(ep);
 			}
 		}
@@ -1328,30 +1857,40 @@ static void xnet_progress_cqe(struct xnet_progress *progress,
 	struct xnet_ep *ep;
 	struct xnet_conn_handle *conn;
 	struct xnet_pep *pep;
+	int res;
 
 	assert(xnet_io_uring);
 	sockctx = (struct ofi_sockctx *) cqe->user_data;
 	assert(sockctx);
 	assert(sockctx->uring_sqe_inuse);
-	if (!(cqe ->flags & IORING_CQE_F_MORE))
+	if (!(cqe ->flags & IORING_CQE_F_MORE)) {
 		sockctx->uring_sqe_inuse = false;
-	uring->sockapi->credits++;
+		uring->sockapi->credits++;
+	}
+
+	res = cqe->res;
 
 	fid = sockctx->context;
 	switch (fid->fclass) {
 	case FI_CLASS_EP:
 		ep = container_of(fid, struct xnet_ep, util_ep.ep_fid.fid);
-		xnet_uring_run_ep(ep, sockctx, cqe->res);
+		xnet_uring_run_ep(ep, sockctx, res, cqe->flags);
 		break;
 	case FI_CLASS_CONNREQ:
 		conn = container_of(fid, struct xnet_conn_handle, fid);
-		xnet_uring_run_conn(conn, cqe->res);
+		xnet_uring_run_conn(conn, res);
 		break;
 	case FI_CLASS_PEP:
 		pep = container_of(fid, struct xnet_pep, util_pep.pep_fid.fid);
 		if (sockctx == &pep->pollin_sockctx) {
-			if (cqe->res >= 0)
+			if (res >= 0)
 				xnet_accept_sock(pep);
+			else if (res == -ECANCELED &&
+				 pep->state == XNET_LISTENING &&
+				 xnet_uring_pollin_add(progress, pep->sock, true,
+						       &pep->pollin_sockctx))
+				FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+					"unable to monitor listening socket\n");
 		}
 		/* Must be a cancelation otherwise */
 		break;
@@ -1360,25 +1899,26 @@ static void xnet_progress_cqe(struct xnet_progress *progress,
 	}
 }
 
+/* Each CQE is released before it is handled.  A handler may progress
+ * the ring again, for example to cancel requests when it disables an ep,
+ * and must only see the CQEs that follow.
+ */
 static void xnet_progress_uring(struct xnet_progress *progress,
 				struct xnet_uring *uring)
 {
-	int nready;
+	ofi_io_uring_cqe_t *cqe, cqe_copy;
 	int i;
 
 	assert(xnet_io_uring);
 
-	nready = ofi_uring_peek_batch_cqe(&uring->ring, progress->cqes,
-					  XNET_MAX_EVENTS);
-	if (!nready)
-		return;
+	for (i = 0; i < XNET_MAX_EVENTS; i++) {
+		if (!ofi_uring_peek_batch_cqe(&uring->ring, &cqe, 1))
+			break;
 
-	assert(nready <= XNET_MAX_EVENTS);
-	for (i = 0; i < nready; i++) {
-		xnet_progress_cqe(progress, uring, progress->cqes[i]);
+		cqe_copy = *cqe;
+		ofi_uring_cq_advance(&uring->ring, 1);
+		xnet_progress_cqe(progress, uring, &cqe_copy);
 	}
-
-	ofi_uring_cq_advance(&uring->ring, nready);
 }
 
 int xnet_uring_cancel(struct xnet_progress *progress,
@@ -1447,6 +1987,8 @@ static int (*xnet_start_op[xnet_op_max])(struct xnet_ep *ep) = {
 	[xnet_op_tag_rts] = xnet_handle_tag,
 	[xnet_op_cts] = xnet_handle_cts,
 	[xnet_op_data] = xnet_handle_data,
+	[xnet_op_data_part] = xnet_handle_data_part,
+	[xnet_op_close] = xnet_handle_close,
 };
 
 static void xnet_run_ep(struct xnet_ep *ep, bool pin, bool pout, bool perr)
@@ -1626,7 +2168,7 @@ int xnet_trywait(struct fid_fabric *fabric_fid, struct fid **fid, int count)
 			cq = container_of(fid[i], struct xnet_cq,
 					  util_cq.cq_fid.fid);
 			ofi_genlock_lock(xnet_cq2_progress(cq)->active_lock);
-			if (ofi_cirque_isempty(cq->util_cq.cirq))
+			if (ofi_cq_isempty(&cq->util_cq))
 				xnet_reset_wait(cq->util_cq.wait);
 			else
 				ret = -FI_EAGAIN;
@@ -1692,9 +2234,20 @@ int xnet_progress_wait(struct xnet_progress *progress, int timeout)
 static void *xnet_auto_progress(void *arg)
 {
 	struct xnet_progress *progress = arg;
-	int nfds;
+	char cpu_str[16];
+	int nfds, ret;
 
 	FI_INFO(&xnet_prov, FI_LOG_DOMAIN, "progress thread starting\n");
+	if (progress->cpu >= 0) {
+		snprintf(cpu_str, sizeof(cpu_str), "%d", progress->cpu);
+		ret = ofi_set_thread_affinity(cpu_str);
+		if (ret) {
+			FI_WARN(&xnet_prov, FI_LOG_DOMAIN,
+				"unable to bind progress thread to cpu %d\n",
+				progress->cpu);
+		}
+	}
+
 	ofi_genlock_lock(progress->active_lock);
 	while (progress->auto_progress) {
 		ofi_genlock_unlock(progress->active_lock);
@@ -1849,12 +2402,82 @@ static void xnet_destroy_uring(struct xnet_uring *uring,
 	}
 }
 
-int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
+/* Multishot receives are optional, fall back to poll + recv on failure */
+static void xnet_init_mshot(struct xnet_progress *progress)
+{
+	int i, ret;
+
+	if (!xnet_io_uring_mshot)
+		return;
+
+	ret = ofi_uring_bufs_init(&progress->rx_bufs, &progress->rx_uring.ring,
+				  XNET_URING_RBUF_CNT, XNET_URING_RBUF_SIZE, 0);
+	if (ret)
+		goto warn;
+
+	ret = ofi_bufpool_create(&progress->rbuf_pool, sizeof(struct xnet_rbuf),
+				 16, 0, XNET_URING_RBUF_CNT,
+				 OFI_BUFPOOL_NO_TRACK);
+	if (ret)
+		goto free_bufs;
+
+	progress->uring_mshot = true;
+
+	if (ofi_uring_files_init(&progress->tx_uring.ring,
+				 XNET_URING_MAX_FILES) ||
+	    ofi_uring_files_init(&progress->rx_uring.ring,
+				 XNET_URING_MAX_FILES))
+		return;
+
+	progress->free_files = calloc(XNET_URING_MAX_FILES,
+				      sizeof(*progress->free_files));
+	if (!progress->free_files)
+		return;
+
+	for (i = 0; i < XNET_URING_MAX_FILES; i++)
+		progress->free_files[i] = XNET_URING_MAX_FILES - i - 1;
+	progress->free_file_cnt = XNET_URING_MAX_FILES;
+	return;
+
+free_bufs:
+	ofi_uring_bufs_free(&progress->rx_bufs);
+warn:
+	FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+		"io_uring multishot receive unavailable: %s\n",
+		fi_strerror(-ret));
+}
+
+static void xnet_close_mshot(struct xnet_progress *progress)
+{
+	if (!progress->uring_mshot)
+		return;
+
+	free(progress->free_files);
+	ofi_bufpool_destroy(progress->rbuf_pool);
+	ofi_uring_bufs_free(&progress->rx_bufs);
+}
+
+/* Regions are bound to the NUMA node of the thread that grows the pool,
+ * normally a thread posting to or progressing the eps that use it.
+ */
+int xnet_create_xfer_pool(struct ofi_bufpool **xfer_pool)
+{
+	return ofi_bufpool_create(xfer_pool,
+			sizeof(struct xnet_xfer_entry) + xnet_buf_size,
+			16, 0, 1024, OFI_BUFPOOL_NUMA_LOCAL);
+}
+
+int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info,
+		       struct ofi_bufpool *xfer_pool)
 {
 	int ret;
 
 	progress->fid.fclass = XNET_CLASS_PROGRESS;
 	progress->auto_progress = false;
+	progress->cpu = -1;
+	progress->uring_mshot = false;
+	progress->free_files = NULL;
+	progress->free_file_cnt = 0;
 	dlist_init(&progress->unexp_msg_list);
 	dlist_init(&progress->unexp_tag_list);
 	dlist_init(&progress->saved_tag_list);
@@ -1874,22 +2497,25 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 	if (ret)
 		goto err2;
 
-	ret = ofi_bufpool_create(&progress->xfer_pool,
-			sizeof(struct xnet_xfer_entry) + xnet_buf_size,
-			16, 0, 1024, 0);
+	progress->xfer_pool = NULL;
+	if (!xfer_pool) {
+		ret = xnet_create_xfer_pool(&progress->xfer_pool);
+		if (ret)
+			goto err3;
+		xfer_pool = progress->xfer_pool;
+	}
+
+	ret = ofi_bufpool_cache_create(xfer_pool, XNET_XFER_CACHE_SIZE,
+				       &progress->xfer_cache);
 	if (ret)
-		goto err3;
+		goto err4;
 
 	ret = ofi_dynpoll_add(&progress->epoll_fd, progress->signal.fd[FI_READ_FD],
 			      POLLIN, &progress->fid);
 	if (ret)
-		goto err4;
+		goto err5;
 
 	if (xnet_io_uring) {
-		progress->cqes = calloc(XNET_MAX_EVENTS, sizeof(*progress->cqes));
-		if (!progress->cqes)
-			goto err5;
-
 		progress->sockapi = xnet_sockapi_uring;
 
 		ret = xnet_init_uring(&progress->tx_uring,
@@ -1907,6 +2533,8 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 				      &progress->epoll_fd);
 		if (ret)
 			goto err7;
+
+		xnet_init_mshot(progress);
 	} else {
 		progress->sockapi = xnet_sockapi_socket;
 	}
@@ -1917,9 +2545,10 @@ err7:
 err6:
 	ofi_dynpoll_del(&progress->epoll_fd, progress->signal.fd[FI_READ_FD]);
 err5:
-	free(progress->cqes);
+	ofi_bufpool_cache_destroy(progress->xfer_cache);
 err4:
-	ofi_bufpool_destroy(progress->xfer_pool);
+	if (progress->xfer_pool)
+		ofi_bufpool_destroy(progress->xfer_pool);
 err3:
 	ofi_dynpoll_close(&progress->epoll_fd);
 err2:
@@ -1938,12 +2567,14 @@ void xnet_close_progress(struct xnet_progress *progress)
 	assert(slist_empty(&progress->event_list));
 	xnet_stop_progress(progress);
 	if (xnet_io_uring) {
-		free(progress->cqes);
+		xnet_close_mshot(progress);
 		xnet_destroy_uring(&progress->rx_uring, &progress->epoll_fd);
 		xnet_destroy_uring(&progress->tx_uring, &progress->epoll_fd);
 	}
 	ofi_dynpoll_close(&progress->epoll_fd);
-	ofi_bufpool_destroy(progress->xfer_pool);
+	ofi_bufpool_cache_destroy(progress->xfer_cache);
+	if (progress->xfer_pool)
+		ofi_bufpool_destroy(progress->xfer_pool);
 	ofi_genlock_destroy(&progress->ep_lock);
 	ofi_genlock_destroy(&progress->rdm_lock);
 	fd_signal_free(&progress->signal);
@@ -57,15 +57,21 @@ enum {
 	xnet_op_tag_rts,
 	xnet_op_cts,
 	xnet_op_data,
+	xnet_op_data_part,
+	xnet_op_close,
 	xnet_op_max
 };
 
 /* Version 1 adds support for tagged rendezvous transfers.
  * ops: tag_rts, cts, data
+ * Version 2 adds striping of rendezvous data across connections.
+ * ops: data_part
+ * Version 3 adds a handshake to close idle connections without losing data.
+ * ops: close
  * VERSION_FLAG set in a response indicates the peer checks the version
  */
 #define XNET_RDM_VERSION_FLAG	(1 << 7)
-#define XNET_RDM_VERSION	1
+#define XNET_RDM_VERSION	3
 
 #define XNET_CTRL_HDR_VERSION	3
 
@@ -90,6 +96,13 @@ enum {
 	XNET_OP_ACK = 2, /* indicates ack message - should be a flag */
 };
 
+/* base_hdr::op_data for xnet_op_close */
+enum {
+	XNET_CLOSE_REQ = 1,
+	XNET_CLOSE_ACK,
+	XNET_CLOSE_NACK,
+};
+
 /* Flags */
 #define XNET_REMOTE_CQ_DATA	(1 << 0)
 /* not used XNET_TRANSMIT_COMPLETE (1 << 1) */
@@ -146,6 +159,14 @@ struct xnet_tag_rts_data_hdr {
 	uint64_t		size;
 };
 
+/* RDM protocol version 2
+ * base_hdr.op_data carries the cts index from the primary connection
+ */
+struct xnet_data_part_hdr {
+	struct xnet_base_hdr	base_hdr;
+	uint64_t		offset;
+};
+
 /* Maximum header is scatter RMA with CQ data */
 #define XNET_MAX_HDR (sizeof(struct xnet_cq_data_hdr) + \
 		     sizeof(struct ofi_rma_iov) * XNET_IOV_LIMIT)
@@ -811,11 +811,32 @@ static struct xnet_domain *xnet_find_subdomain(struct xnet_rdm *rdm)
 	return NULL;
 }
 
-static void xnet_set_subdomain(struct xnet_rdm *rdm, struct xnet_domain *domain,
-			  struct xnet_domain *subdomain)
+static struct xnet_domain *xnet_next_subdomain(struct xnet_domain *domain)
 {
-	int i;
+	struct fid_list_entry *item;
+	struct xnet_domain *subdomain = NULL;
+	size_t i = 0;
+
+	ofi_genlock_lock(&domain->subdomain_list_lock);
+	dlist_foreach_container(&domain->subdomain_list, struct fid_list_entry,
+				item, entry) {
+		if (i++ == domain->next_subdomain % domain->subdomain_cnt) {
+			subdomain = container_of(item->fid, struct xnet_domain,
+						 util_domain.domain_fid.fid);
+			break;
+		}
+	}
+	domain->next_subdomain++;
+	ofi_genlock_unlock(&domain->subdomain_list_lock);
+	return subdomain;
+}
+
+static int xnet_set_subdomain(struct xnet_rdm *rdm, struct xnet_domain *domain,
+			      struct xnet_domain *subdomain)
+{
+	int i, ret;
 	struct util_cntr *cntr;
+	struct xnet_cq *cq;
 
 	assert(ofi_genlock_held(&domain->util_domain.lock));
 
@@ -823,6 +844,10 @@ static void xnet_set_subdomain(struct xnet_rdm *rdm, struct xnet_domain *domain,
 		ofi_atomic_dec32(&rdm->util_ep.rx_cq->domain->ref);
 		ofi_atomic_inc32(&subdomain->util_domain.ref);
 		rdm->util_ep.rx_cq->domain = &subdomain->util_domain;
+		cq = container_of(rdm->util_ep.rx_cq, struct xnet_cq, util_cq);
+		ret = xnet_cq_add_progress(cq);
+		if (ret)
+			return ret;
 	}
 	assert(rdm->util_ep.rx_cq->domain == &subdomain->util_domain);
 
@@ -830,6 +855,10 @@ static void xnet_set_subdomain(struct xnet_rdm *rdm, struct xnet_domain *domain,
 		ofi_atomic_dec32(&rdm->util_ep.tx_cq->domain->ref);
 		ofi_atomic_inc32(&subdomain->util_domain.ref);
 		rdm->util_ep.tx_cq->domain = &subdomain->util_domain;
+		cq = container_of(rdm->util_ep.tx_cq, struct xnet_cq, util_cq);
+		ret = xnet_cq_add_progress(cq);
+		if (ret)
+			return ret;
 	}
 	assert(rdm->util_ep.tx_cq->domain == &subdomain->util_domain);
 
@@ -842,9 +871,13 @@ static void xnet_set_subdomain(struct xnet_rdm *rdm, struct xnet_domain *domain,
 			ofi_atomic_dec32(&cntr->domain->ref);
 			ofi_atomic_inc32(&subdomain->util_domain.ref);
 			cntr->domain = &subdomain->util_domain;
+			ret = xnet_cntr_add_progress(cntr);
+			if (ret)
+				return ret;
 		}
 		assert(cntr->domain == &subdomain->util_domain);
 	}
+	return FI_SUCCESS;
 }
 
 int xnet_rdm_resolve_domains(struct xnet_rdm *rdm)
@@ -857,10 +890,12 @@ int xnet_rdm_resolve_domains(struct xnet_rdm *rdm)
 	domain = container_of(rdm->util_ep.domain, struct xnet_domain, util_domain);
 	ofi_genlock_lock(&domain->util_domain.lock);
 	subdomain = xnet_find_subdomain(rdm);
+	if (!subdomain && xnet_progress_shards &&
+	    domain->subdomain_cnt >= xnet_progress_shards)
+		subdomain = xnet_next_subdomain(domain);
+
 	if (!subdomain) {
-		ret = fi_domain(&domain->util_domain.fabric->fabric_fid,
-				domain->subdomain_info,
-				&subdomain_fid, NULL);
+		ret = xnet_open_subdomain(domain, &subdomain_fid);
 		if (ret)
 			goto out;
 
@@ -873,6 +908,7 @@ int xnet_rdm_resolve_domains(struct xnet_rdm *rdm)
 			fi_close(&subdomain_fid->fid);
 			goto out;
 		}
+		domain->subdomain_cnt++;
 
 		ret = ofi_rbmap_foreach(domain->util_domain.mr_map.rbtree,
 					domain->util_domain.mr_map.rbtree->root,
@@ -881,7 +917,10 @@ int xnet_rdm_resolve_domains(struct xnet_rdm *rdm)
 			goto out;
 	}
 
-	xnet_set_subdomain(rdm, domain, subdomain);
+	ret = xnet_set_subdomain(rdm, domain, subdomain);
+	if (ret)
+		goto out;
+
 	ret = xnet_set_subav(&rdm->util_ep, subdomain);
 	if (ret)
 		goto out;
@@ -993,6 +1032,10 @@ static int xnet_rdm_close(struct fid *fid)
 		return ret;
 	}
 
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "conns: connect %" PRIu64
+		" accept %" PRIu64 " evict %" PRIu64 " reconnect %" PRIu64 "\n",
+		rdm->conn_stats.connect, rdm->conn_stats.accept,
+		rdm->conn_stats.evict, rdm->conn_stats.reconnect);
 	xnet_freeall_conns(rdm);
 	ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
 
@@ -1083,6 +1126,8 @@ int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
 	if (!rdm)
 		return -FI_ENOMEM;
 
+	dlist_init(&rdm->conn_lru);
+
 	ret = ofi_endpoint_init(domain, &xnet_util_prov, info, &rdm->util_ep,
 				context, NULL);
 	if (ret)
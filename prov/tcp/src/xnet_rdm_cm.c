@@ -42,11 +42,12 @@
 /* Include cm_msg with connect() data.  If the connection is accepted,
  * return the version.  The returned version must be <= the requested
  * version, and is used by the active side to fallback to an older
- * protocol version.
+ * protocol version.  A non-zero lane identifies an additional
+ * connection to an already connected peer, used for striping.
  */
 struct xnet_rdm_cm {
 	uint8_t version;
-	uint8_t resv;
+	uint8_t lane;
 	uint16_t port;
 	uint32_t pid;
 };
@@ -62,11 +63,58 @@ static int xnet_match_event(struct slist_entry *item, const void *arg)
 	return event->cm_entry.fid == &ep->util_ep.ep_fid.fid;
 }
 
-static void xnet_close_conn(struct xnet_conn *conn)
+static void xnet_close_ep(struct xnet_rdm *rdm, struct xnet_ep *ep)
 {
 	struct xnet_event *event;
 	struct slist_entry *item;
 
+	do {
+		item = slist_remove_first_match(
+			&xnet_rdm2_progress(rdm)->event_list,
+			xnet_match_event, ep);
+		if (!item)
+			break;
+
+		event = container_of(item, struct xnet_event, list_entry);
+		free(event);
+	} while (item);
+
+	if (ep->peer)
+		util_put_peer(ep->peer);
+
+	fi_close(&ep->util_ep.ep_fid.fid);
+}
+
+static void xnet_close_lane(struct xnet_conn *conn, struct fid *fid)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(conn->lanes); i++) {
+		if (conn->lanes[i] &&
+		    &conn->lanes[i]->util_ep.ep_fid.fid == fid) {
+			FI_DBG(&xnet_prov, FI_LOG_EP_CTRL,
+			       "closing lane %d of conn %p\n", i + 1, conn);
+			xnet_close_ep(conn->rdm, conn->lanes[i]);
+			conn->lanes[i] = NULL;
+			return;
+		}
+	}
+}
+
+static void xnet_close_lanes(struct xnet_conn *conn)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(conn->lanes); i++) {
+		if (conn->lanes[i]) {
+			xnet_close_ep(conn->rdm, conn->lanes[i]);
+			conn->lanes[i] = NULL;
+		}
+	}
+}
+
+static void xnet_close_conn(struct xnet_conn *conn)
+{
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
@@ -76,25 +124,174 @@ static void xnet_close_conn(struct xnet_conn *conn)
 		conn->flags &= ~XNET_CONN_RX_LOOPBACK;
 	}
 
-	if (!conn->ep)
+	if (!conn->ep) {
+		conn->flags &= ~(XNET_CONN_ACTIVE | XNET_CONN_CLOSING);
 		return;
+	}
 
-	do {
-		item = slist_remove_first_match(
-			&xnet_rdm2_progress(conn->rdm)->event_list,
-			xnet_match_event, conn->ep);
-		if (!item)
-			break;
+	if (conn->flags & XNET_CONN_CLOSING) {
+		conn->flags |= XNET_CONN_EVICTED;
+		conn->rdm->conn_stats.evict++;
+	}
+	conn->flags &= ~(XNET_CONN_ACTIVE | XNET_CONN_CLOSING);
+	dlist_remove(&conn->lru_entry);
+	conn->rdm->conn_stats.open--;
 
-		event = container_of(item, struct xnet_event, list_entry);
-		free(event);
-	} while (item);
+	/* Lanes may reference receives tracked by the primary ep */
+	xnet_close_lanes(conn);
+	xnet_close_ep(conn->rdm, conn->ep);
+	conn->ep = NULL;
+}
 
-	if (conn->ep->peer)
-		util_put_peer(conn->ep->peer);
+static void xnet_add_lru(struct xnet_conn *conn)
+{
+	struct xnet_rdm *rdm = conn->rdm;
+
+	conn->ep->referenced = true;
+	dlist_insert_tail(&conn->lru_entry, &rdm->conn_lru);
+	rdm->conn_stats.open++;
+	if (conn->flags & XNET_CONN_EVICTED) {
+		conn->flags &= ~XNET_CONN_EVICTED;
+		rdm->conn_stats.reconnect++;
+	}
+}
 
-	fi_close(&conn->ep->util_ep.ep_fid.fid);
-	conn->ep = NULL;
+static bool xnet_conn_idle(struct xnet_conn *conn)
+{
+	size_t i;
+
+	if (!xnet_ep_idle(conn->ep))
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(conn->lanes); i++) {
+		if (conn->lanes[i] && !xnet_ep_idle(conn->lanes[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool xnet_can_evict(struct xnet_conn *conn)
+{
+	return !(conn->flags & (XNET_CONN_CLOSING | XNET_CONN_TX_LOOPBACK |
+				XNET_CONN_RX_LOOPBACK)) &&
+	       (conn->ep->util_ep.flags & XNET_EP_CLOSE);
+}
+
+/* Ask the peer to close an idle connection.  The connection is closed
+ * once the peer acks, which guarantees that it has nothing in flight.
+ */
+static int xnet_start_evict(struct xnet_conn *conn)
+{
+	int ret;
+
+	if (!xnet_conn_idle(conn))
+		return -FI_EBUSY;
+
+	ret = xnet_queue_close(conn->ep, XNET_CLOSE_REQ);
+	if (ret)
+		return ret;
+
+	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "evicting conn %p\n", conn);
+	conn->flags |= XNET_CONN_CLOSING;
+	return 0;
+}
+
+/* Second chance replacement.  Recently used connections are skipped once,
+ * so that two passes over the list will find an idle connection if any.
+ */
+static void xnet_evict_lru(struct xnet_rdm *rdm)
+{
+	struct xnet_conn *conn;
+	size_t cnt;
+
+	for (cnt = rdm->conn_stats.open * 2; cnt; cnt--) {
+		conn = container_of(rdm->conn_lru.next, struct xnet_conn,
+				    lru_entry);
+		dlist_remove(&conn->lru_entry);
+		dlist_insert_tail(&conn->lru_entry, &rdm->conn_lru);
+
+		if (!xnet_can_evict(conn))
+			continue;
+
+		if (conn->ep->referenced)
+			conn->ep->referenced = false;
+		else if (!xnet_start_evict(conn))
+			return;
+	}
+}
+
+static void xnet_limit_conns(struct xnet_rdm *rdm)
+{
+	if (xnet_max_conns && rdm->conn_stats.open >= xnet_max_conns)
+		xnet_evict_lru(rdm);
+}
+
+/* Connections not used since the last pass are closed. */
+static void xnet_reap_conns(struct xnet_rdm *rdm)
+{
+	struct xnet_conn *conn;
+	uint64_t now;
+
+	now = ofi_gettime_ms();
+	if (now < rdm->reap_time)
+		return;
+
+	rdm->reap_time = now + xnet_conn_idle_timeout;
+	dlist_foreach_container(&rdm->conn_lru, struct xnet_conn,
+				conn, lru_entry) {
+		if (!xnet_can_evict(conn))
+			continue;
+
+		if (conn->ep->referenced)
+			conn->ep->referenced = false;
+		else
+			(void) xnet_start_evict(conn);
+	}
+}
+
+int xnet_handle_close_msg(struct xnet_ep *ep, uint8_t type)
+{
+	struct xnet_conn *conn;
+	int ret;
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
+	if (conn->ep != ep)
+		return -FI_EIO;
+
+	switch (type) {
+	case XNET_CLOSE_REQ:
+		/* If both sides requested a close, both back off.  An ack
+		 * is only sent by a side that has no request outstanding,
+		 * so it can never receive a nack afterwards.
+		 */
+		if ((conn->flags & XNET_CONN_CLOSING) ||
+		    !xnet_conn_idle(conn)) {
+			FI_DBG(&xnet_prov, FI_LOG_EP_CTRL,
+			       "refusing close of conn %p\n", conn);
+			return xnet_queue_close(ep, XNET_CLOSE_NACK);
+		}
+
+		ret = xnet_queue_close(ep, XNET_CLOSE_ACK);
+		if (ret)
+			return ret;
+
+		/* Wait for the peer to shutdown the connection */
+		conn->flags |= XNET_CONN_CLOSING;
+		return 0;
+	case XNET_CLOSE_ACK:
+		if (!(conn->flags & XNET_CONN_CLOSING))
+			return -FI_EIO;
+
+		/* The peer will not send anything else, disable the ep */
+		return -FI_ENOTCONN;
+	case XNET_CLOSE_NACK:
+		conn->flags &= ~XNET_CONN_CLOSING;
+		ep->referenced = true;
+		return 0;
+	default:
+		return -FI_EIO;
+	}
 }
 
 /* MSG EPs under an RDM EP do not write events to the EQ. */
@@ -170,7 +367,8 @@ static int xnet_bind_conn(struct xnet_rdm *rdm, struct xnet_ep *ep)
 	return 0;
 }
 
-static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
+static int xnet_open_ep(struct xnet_conn *conn, struct fi_info *info,
+			struct xnet_ep **ep)
 {
 	struct fid_ep *ep_fid;
 	int ret;
@@ -183,14 +381,14 @@ static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
 		return ret;
 	}
 
-	conn->ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
-	ret = xnet_bind_conn(conn->rdm, conn->ep);
+	*ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
+	ret = xnet_bind_conn(conn->rdm, *ep);
 	if (ret)
 		goto err;
 
-	conn->ep->peer = conn->peer;
+	(*ep)->peer = conn->peer;
 	rxm_ref_peer(conn->peer);
-	ret = fi_enable(&conn->ep->util_ep.ep_fid);
+	ret = fi_enable(&(*ep)->util_ep.ep_fid);
 	if (ret) {
 		XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_enable", ret);
 		goto err;
@@ -199,11 +397,79 @@ static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
 	return 0;
 
 err:
-	fi_close(&conn->ep->util_ep.ep_fid.fid);
-	conn->ep = NULL;
+	fi_close(&(*ep)->util_ep.ep_fid.fid);
+	*ep = NULL;
 	return ret;
 }
 
+static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
+{
+	return xnet_open_ep(conn, info, &conn->ep);
+}
+
+static struct fi_info *xnet_conn_info(struct xnet_conn *conn)
+{
+	struct fi_info *info;
+
+	info = conn->rdm->pep->info;
+	info->dest_addrlen = info->src_addrlen;
+
+	free(info->dest_addr);
+	info->dest_addr = mem_dup(&conn->peer->addr, info->dest_addrlen);
+	return info->dest_addr ? info : NULL;
+}
+
+static void xnet_init_cm_msg(struct xnet_conn *conn, struct xnet_rdm_cm *msg,
+			     uint8_t lane)
+{
+	msg->version = XNET_RDM_VERSION;
+	msg->pid = htonl((uint32_t) getpid());
+	msg->lane = lane;
+	msg->port = htons(ofi_addr_get_port(&conn->rdm->addr.sa));
+}
+
+/* Lanes are opened by the side that initiated the primary connection,
+ * once the peer has agreed to a protocol version that supports them.
+ * Failures are not fatal; transfers use whichever lanes connect.
+ */
+static void xnet_open_lanes(struct xnet_conn *conn)
+{
+	struct xnet_rdm_cm msg;
+	struct fi_info *info;
+	size_t i;
+	int ret;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
+	if (xnet_rdm_stripes < 2 || (conn->flags & XNET_CONN_TX_LOOPBACK) ||
+	    !(conn->ep->util_ep.flags & XNET_EP_STRIPE))
+		return;
+
+	for (i = 0; i < xnet_rdm_stripes - 1; i++) {
+		if (conn->lanes[i])
+			continue;
+
+		info = xnet_conn_info(conn);
+		if (!info)
+			return;
+
+		ret = xnet_open_ep(conn, info, &conn->lanes[i]);
+		if (ret)
+			return;
+
+		xnet_init_cm_msg(conn, &msg, (uint8_t) (i + 1));
+		ret = fi_connect(&conn->lanes[i]->util_ep.ep_fid,
+				 info->dest_addr, &msg, sizeof msg);
+		if (ret) {
+			XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_connect", ret);
+			xnet_close_ep(conn->rdm, conn->lanes[i]);
+			conn->lanes[i] = NULL;
+			return;
+		}
+		FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "connecting lane %zu of %p\n",
+		       i + 1, conn);
+	}
+}
+
 static int xnet_rdm_connect(struct xnet_conn *conn)
 {
 	struct xnet_rdm_cm msg;
@@ -213,22 +479,18 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "connecting %p\n", conn);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
-	info = conn->rdm->pep->info;
-	info->dest_addrlen = info->src_addrlen;
-
-	free(info->dest_addr);
-	info->dest_addr = mem_dup(&conn->peer->addr, info->dest_addrlen);
-	if (!info->dest_addr)
+	info = xnet_conn_info(conn);
+	if (!info)
 		return -FI_ENOMEM;
 
+	xnet_limit_conns(conn->rdm);
 	ret = xnet_open_conn(conn, info);
 	if (ret)
 		return ret;
 
-	msg.version = XNET_RDM_VERSION;
-	msg.pid = htonl((uint32_t) getpid());
-	msg.resv = 0;
-	msg.port = htons(ofi_addr_get_port(&conn->rdm->addr.sa));
+	xnet_add_lru(conn);
+	conn->rdm->conn_stats.connect++;
+	xnet_init_cm_msg(conn, &msg, 0);
 
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "rdm addr", &conn->rdm->addr);
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "src addr", info->src_addr);
@@ -239,6 +501,7 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 		XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_connect", ret);
 		goto err;
 	}
+	conn->flags |= XNET_CONN_ACTIVE;
 	return 0;
 
 err:
@@ -311,6 +574,8 @@ xnet_alloc_conn(struct xnet_rdm *rdm, struct util_peer_addr *peer)
 	conn->rdm = rdm;
 	conn->flags = 0;
 	conn->peer = peer;
+	memset(conn->lanes, 0, sizeof(conn->lanes));
+	dlist_init(&conn->lru_entry);
 	rxm_ref_peer(peer);
 
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "allocated conn %p\n", conn);
@@ -352,6 +617,9 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 	ssize_t ret;
 
 	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	if (xnet_conn_idle_timeout)
+		xnet_reap_conns(rdm);
+
 	peer = ofi_av_addr_context(rdm->util_ep.av, addr);
 	*conn = xnet_add_conn(rdm, *peer);
 	if (!*conn)
@@ -363,7 +631,8 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 			return ret;
 	}
 
-	if ((*conn)->ep->state != XNET_CONNECTED) {
+	if ((*conn)->ep->state != XNET_CONNECTED ||
+	    ((*conn)->flags & XNET_CONN_CLOSING)) {
 		/* Force progress for apps that simply retry sending without
 		 * trying to drive progress in between.
 		 */
@@ -371,6 +640,7 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 		return -FI_EAGAIN;
 	}
 
+	(*conn)->ep->referenced = true;
 	return 0;
 }
 
@@ -400,6 +670,12 @@ static void xnet_set_protocol(struct xnet_ep *ep, struct xnet_rdm_cm *msg)
 		return;
 
 	switch (msg->version & ~XNET_RDM_VERSION_FLAG) {
+	case 3:
+		ep->util_ep.flags |= XNET_EP_CLOSE;
+		/* fall through */
+	case 2:
+		ep->util_ep.flags |= XNET_EP_STRIPE;
+		/* fall through */
 	case 1:
 		ep->util_ep.flags |= XNET_EP_RENDEZVOUS;
 		/* fall through */
@@ -418,6 +694,56 @@ static void xnet_set_rdm_version(struct xnet_rdm_cm *msg)
 	msg->version |= XNET_RDM_VERSION_FLAG;
 }
 
+/* A lane request is only accepted for a connected peer that negotiated
+ * striping.  The connection must come from the same peer process.
+ */
+static void xnet_accept_lane(struct xnet_rdm *rdm,
+			     struct fi_eq_cm_entry *cm_entry,
+			     struct util_peer_addr *peer)
+{
+	struct xnet_rdm_cm *msg;
+	struct xnet_conn *conn;
+	struct xnet_ep **lane;
+	int ret;
+
+	msg = (struct xnet_rdm_cm *) cm_entry->data;
+	conn = ofi_idm_lookup(&rdm->conn_idx_map, peer->index);
+	if (!conn || !conn->ep || !(conn->ep->util_ep.flags & XNET_EP_STRIPE) ||
+	    (conn->flags & XNET_CONN_ACTIVE) ||
+	    conn->remote_pid != ntohl(msg->pid) ||
+	    msg->lane > ARRAY_SIZE(conn->lanes) || conn->lanes[msg->lane - 1]) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "reject lane %d for %p\n",
+			msg->lane, conn);
+		goto reject;
+	}
+
+	lane = &conn->lanes[msg->lane - 1];
+	ret = xnet_open_ep(conn, cm_entry->info, lane);
+	if (ret)
+		goto reject;
+
+	msg->pid = htonl((uint32_t) getpid());
+	xnet_set_rdm_version(msg);
+	xnet_set_protocol(*lane, msg);
+
+	ret = fi_accept(&(*lane)->util_ep.ep_fid, msg, sizeof(*msg));
+	if (ret) {
+		xnet_close_ep(rdm, *lane);
+		*lane = NULL;
+		goto reject;
+	}
+
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "accepted lane %d for %p\n",
+		msg->lane, conn);
+	fi_freeinfo(cm_entry->info);
+	return;
+
+reject:
+	(void) fi_reject(&rdm->pep->util_pep.pep_fid, cm_entry->info->handle,
+			 msg, sizeof(*msg));
+	fi_freeinfo(cm_entry->info);
+}
+
 static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 {
 	struct xnet_rdm *rdm;
@@ -444,6 +770,12 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 		goto reject;
 	}
 
+	if (msg->lane) {
+		xnet_accept_lane(rdm, cm_entry, peer);
+		util_put_peer(peer);
+		return;
+	}
+
 	conn = xnet_add_conn(rdm, peer);
 	if (!conn)
 		goto put;
@@ -452,6 +784,14 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 	if (!conn->ep)
 		goto accept;
 
+	if (conn->flags & XNET_CONN_CLOSING) {
+		/* The peer finished closing the old connection */
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"closing connection exists, replacing %p\n", conn);
+		xnet_close_conn(conn);
+		goto accept;
+	}
+
 	switch (conn->ep->state) {
 	case XNET_CONNECTING:
 	case XNET_REQ_SENT:
@@ -508,10 +848,14 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 
 accept:
 	conn->remote_pid = ntohl(msg->pid);
+	xnet_limit_conns(rdm);
 	ret = xnet_open_conn(conn, cm_entry->info);
 	if (ret)
 		goto free;
 
+	xnet_add_lru(conn);
+	rdm->conn_stats.accept++;
+
 	msg->pid = htonl((uint32_t) getpid());
 	xnet_set_rdm_version(msg);
 	xnet_set_protocol(conn->ep, msg);
@@ -555,13 +899,43 @@ void xnet_handle_event_list(struct xnet_progress *progress)
 			xnet_process_connreq(&event->cm_entry);
 			break;
 		case FI_CONNECTED:
+			/* Only the active side receives the peer's cm data */
 			conn = event->cm_entry.fid->context;
+			if (!(conn->flags & XNET_CONN_ACTIVE))
+				break;
+
 			msg = (struct xnet_rdm_cm *) event->cm_entry.data;
+			if (event->cm_entry.fid != &conn->ep->util_ep.ep_fid.fid) {
+				xnet_set_protocol(container_of(event->cm_entry.fid,
+						  struct xnet_ep, util_ep.ep_fid.fid),
+						  msg);
+				break;
+			}
+
 			conn->remote_pid = ntohl(msg->pid);
 			xnet_set_protocol(conn->ep, msg);
+			xnet_open_lanes(conn);
 			break;
 		case FI_SHUTDOWN:
 			conn = event->cm_entry.fid->context;
+			if (conn->ep &&
+			    event->cm_entry.fid != &conn->ep->util_ep.ep_fid.fid) {
+				xnet_close_lane(conn, event->cm_entry.fid);
+				/* Stripes sent over the lost lane are never
+				 * resent, so receives waiting for them could
+				 * not complete.  Fail the whole connection.
+				 */
+				if (!xnet_stripe_busy(conn->ep))
+					break;
+				FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+					"lane lost with striped receives "
+					"pending, closing conn %p\n", conn);
+			}
+			if (conn->flags & XNET_CONN_CLOSING) {
+				/* Keep evicted conns to track reconnects */
+				xnet_close_conn(conn);
+				break;
+			}
 			xnet_close_conn(conn);
 			xnet_free_conn(conn);
 			break;
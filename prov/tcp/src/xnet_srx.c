@@ -860,12 +860,19 @@ static int xnet_srx_close(struct fid *fid)
 
 	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
 
-	ofi_genlock_lock(xnet_srx2_progress(srx)->active_lock);
-	xnet_srx_cleanup(srx, &srx->rx_queue);
-	xnet_srx_cleanup(srx, &srx->tag_queue);
-	ofi_array_iter(&srx->src_tag_queues, srx, xnet_srx_cleanup_queues);
-	ofi_array_iter(&srx->saved_msgs, srx, xnet_srx_cleanup_saved);
-	ofi_genlock_unlock(xnet_srx2_progress(srx)->active_lock);
+	/* An srx opened on a multiplexed domain only moves to a subdomain,
+	 * which has a progress engine, when its rdm endpoint is enabled.
+	 * Nothing can have been queued on it before that.
+	 */
+	if (!xnet_domain_multiplexed(&srx->domain->util_domain.domain_fid)) {
+		ofi_genlock_lock(xnet_srx2_progress(srx)->active_lock);
+		xnet_srx_cleanup(srx, &srx->rx_queue);
+		xnet_srx_cleanup(srx, &srx->tag_queue);
+		ofi_array_iter(&srx->src_tag_queues, srx,
+			       xnet_srx_cleanup_queues);
+		ofi_array_iter(&srx->saved_msgs, srx, xnet_srx_cleanup_saved);
+		ofi_genlock_unlock(xnet_srx2_progress(srx)->active_lock);
+	}
 
 	ofi_array_destroy(&srx->src_tag_queues);
 	ofi_array_destroy(&srx->saved_msgs);
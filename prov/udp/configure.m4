@@ -15,5 +15,8 @@ AC_DEFUN([FI_UDP_CONFIGURE],[
 	                       [udp_h_happy=0])
 	      ])
 
+	AS_IF([test $udp_h_happy -eq 1],
+	      [AC_CHECK_FUNCS([recvmmsg sendmmsg])])
+
 	AS_IF([test $udp_h_happy -eq 1], [$1], [$2])
 ])
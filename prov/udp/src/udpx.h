@@ -67,6 +67,7 @@
 extern struct fi_provider udpx_prov;
 extern struct util_prov udpx_util_prov;
 extern struct fi_info udpx_info;
+extern size_t udpx_batch_size;
 
 
 int udpx_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
@@ -79,6 +80,13 @@ int udpx_eq_open(struct fid_fabric *fabric, struct fi_eq_attr *attr,
 
 #define UDPX_FLAG_MULTI_RECV	1
 #define UDPX_IOV_LIMIT		4
+#define UDPX_DEF_BATCH		16
+
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+#define UDPX_HAVE_MMSG		1
+#else
+#define UDPX_HAVE_MMSG		0
+#endif
 
 struct udpx_ep_entry {
 	void			*context;
@@ -90,6 +98,13 @@ struct udpx_ep_entry {
 
 OFI_DECLARE_CIRQUE(struct udpx_ep_entry, udpx_rx_cirq);
 
+/* Send queued with FI_MORE, waiting to be flushed with sendmmsg */
+struct udpx_tx_entry {
+	void			*context;
+	struct iovec		iov[UDPX_IOV_LIMIT];
+	union ofi_sock_ip	addr;
+};
+
 struct udpx_ep;
 typedef void (*udpx_rx_comp_func)(struct udpx_ep *ep, void *context,
 		uint64_t flags, size_t len, void *buf, void *addr);
@@ -103,6 +118,14 @@ struct udpx_ep {
 	SOCKET			sock;
 	int			is_bound;
 	ofi_atomic32_t		ref;
+#if UDPX_HAVE_MMSG
+	struct mmsghdr		*rx_msgs;	/* protected by rx_cq lock */
+	union ofi_sock_ip	*rx_addrs;
+	struct mmsghdr		*tx_msgs;	/* protected by tx_cq lock */
+	struct udpx_tx_entry	*tx_entries;
+	size_t			tx_head;
+	size_t			tx_cnt;
+#endif
 };
 
 int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
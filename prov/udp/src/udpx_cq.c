@@ -73,6 +73,15 @@ int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		return ret;
 	}
 
+	/* Completions are written straight into the circular queue under
+	 * cq_lock, whose free space also throttles new operations.  Nothing
+	 * here goes through the lock-free ring, so don't keep one.
+	 */
+	if (cq->lfq) {
+		util_cq_lfq_free(cq->lfq);
+		cq->lfq = NULL;
+	}
+
 	*cq_fid = &cq->cq_fid;
 	(*cq_fid)->fid.ops = &udpx_cq_fi_ops;
 	return 0;
@@ -270,6 +270,178 @@ static void udpx_rx_src_comp_signal(struct udpx_ep *ep, void *context,
 	ep->util_ep.rx_cq->wait->signal(ep->util_ep.rx_cq->wait);
 }
 
+static void udpx_tx_error(struct udpx_ep *ep, void *context, int err)
+{
+	struct fi_cq_err_entry err_entry = {
+		.op_context	= context,
+		.flags		= FI_SEND | FI_MSG,
+		.err		= -err,
+		.prov_errno	= -err,
+	};
+
+	(void) ofi_cq_write_error(ep->util_ep.tx_cq, &err_entry);
+}
+
+#if UDPX_HAVE_MMSG
+static void udpx_progress_rx(struct udpx_ep *ep)
+{
+	struct udpx_ep_entry *entry;
+	struct msghdr *hdr;
+	size_t cnt, i;
+	int ret;
+
+	assert(ofi_genlock_held(&ep->util_ep.rx_cq->cq_lock));
+	cnt = MIN(ofi_cirque_usedcnt(ep->rxq), udpx_batch_size);
+	cnt = MIN(cnt, ofi_cq_freecnt(ep->util_ep.rx_cq));
+	if (!cnt)
+		return;
+
+	for (i = 0; i < cnt; i++) {
+		entry = &ep->rxq->buf[(ep->rxq->rcnt + i) & ep->rxq->size_mask];
+		hdr = &ep->rx_msgs[i].msg_hdr;
+		hdr->msg_namelen = sizeof(ep->rx_addrs[i]);
+		hdr->msg_iov = entry->iov;
+		hdr->msg_iovlen = entry->iov_count;
+		hdr->msg_flags = 0;
+	}
+
+	ret = recvmmsg(ep->sock, ep->rx_msgs, (unsigned int) cnt, 0, NULL);
+	for (i = 0; ret > 0 && i < (size_t) ret; i++) {
+		entry = ofi_cirque_head(ep->rxq);
+		ep->rx_comp(ep, entry->context, 0, ep->rx_msgs[i].msg_len,
+			    NULL, &ep->rx_addrs[i]);
+		ofi_cirque_discard(ep->rxq);
+	}
+}
+
+/* Sends as many queued datagrams as the socket and tx CQ will take.  On
+ * failure, the first unsent datagram is dropped and its context returned
+ * so that the caller can report the error after releasing the CQ lock.
+ */
+static int udpx_flush_tx(struct udpx_ep *ep, void **err_context)
+{
+	size_t cnt, i;
+	int ret;
+
+	assert(ofi_genlock_held(&ep->util_ep.tx_cq->cq_lock));
+	while (ep->tx_head < ep->tx_cnt) {
+		cnt = MIN(ep->tx_cnt - ep->tx_head,
+			  ofi_cq_freecnt(ep->util_ep.tx_cq));
+		if (!cnt)
+			return 0;
+
+		ret = sendmmsg(ep->sock, &ep->tx_msgs[ep->tx_head],
+			       (unsigned int) cnt, 0);
+		if (ret < 0) {
+			if (OFI_SOCK_TRY_SND_RCV_AGAIN(errno))
+				return 0;
+
+			ret = -errno;
+			*err_context = ep->tx_entries[ep->tx_head++].context;
+			goto out;
+		}
+
+		for (i = 0; i < (size_t) ret; i++) {
+			ep->tx_comp(ep,
+				    ep->tx_entries[ep->tx_head++].context);
+		}
+	}
+	ret = 0;
+out:
+	if (ep->tx_head == ep->tx_cnt)
+		ep->tx_head = ep->tx_cnt = 0;
+	return ret;
+}
+
+static ssize_t udpx_queue_tx(struct udpx_ep *ep, const struct fi_msg *msg,
+			     const void *addr, size_t addrlen,
+			     void **err_context, int *err)
+{
+	struct udpx_tx_entry *entry;
+	struct msghdr *hdr;
+	size_t i;
+
+	if (ep->tx_cnt == udpx_batch_size) {
+		*err = udpx_flush_tx(ep, err_context);
+		if (ep->tx_cnt == udpx_batch_size)
+			return -FI_EAGAIN;
+	}
+
+	entry = &ep->tx_entries[ep->tx_cnt];
+	entry->context = msg->context;
+	for (i = 0; i < msg->iov_count; i++)
+		entry->iov[i] = msg->msg_iov[i];
+	memcpy(&entry->addr, addr, addrlen);
+
+	hdr = &ep->tx_msgs[ep->tx_cnt++].msg_hdr;
+	hdr->msg_name = &entry->addr;
+	hdr->msg_namelen = (socklen_t) addrlen;
+	hdr->msg_iov = entry->iov;
+	hdr->msg_iovlen = msg->iov_count;
+	hdr->msg_flags = 0;
+	return 0;
+}
+
+/* A datagram sent directly must not overtake those queued with FI_MORE.
+ * Flush the queue first and ask the caller to retry if it isn't empty.
+ */
+static ssize_t udpx_flush_ahead(struct udpx_ep *ep, void **err_context,
+				int *err)
+{
+	assert(ofi_genlock_held(&ep->util_ep.tx_cq->cq_lock));
+	if (!ep->tx_cnt)
+		return 0;
+
+	*err = udpx_flush_tx(ep, err_context);
+	return ep->tx_cnt ? -FI_EAGAIN : 0;
+}
+
+/* Makes a last attempt to send the datagrams queued with FI_MORE and
+ * reports the ones left over as canceled.  Called once the endpoint is
+ * off the tx CQ's progress list, so nothing else touches the queue.
+ */
+static void udpx_cancel_tx(struct udpx_ep *ep)
+{
+	void *err_context = NULL;
+	int ret;
+
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+	ret = udpx_flush_tx(ep, &err_context);
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	if (ret)
+		udpx_tx_error(ep, err_context, ret);
+
+	while (ep->tx_head < ep->tx_cnt) {
+		udpx_tx_error(ep, ep->tx_entries[ep->tx_head++].context,
+			      -FI_ECANCELED);
+	}
+	ep->tx_head = ep->tx_cnt = 0;
+}
+
+static void udpx_ep_progress(struct util_ep *util_ep)
+{
+	struct udpx_ep *ep;
+	void *err_context = NULL;
+	int ret = 0;
+
+	ep = container_of(util_ep, struct udpx_ep, util_ep);
+	if (ep->util_ep.rx_cq) {
+		ofi_genlock_lock(&ep->util_ep.rx_cq->cq_lock);
+		udpx_progress_rx(ep);
+		ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
+	}
+
+	/* Unlocked check, sends are flushed when the next one is posted */
+	if (!ep->util_ep.tx_cq || !ep->tx_cnt)
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+	ret = udpx_flush_tx(ep, &err_context);
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	if (ret)
+		udpx_tx_error(ep, err_context, ret);
+}
+#else
 static void udpx_ep_progress(struct util_ep *util_ep)
 {
 	struct udpx_ep *ep;
@@ -279,6 +451,9 @@ static void udpx_ep_progress(struct util_ep *util_ep)
 	ssize_t ret;
 
 	ep = container_of(util_ep, struct udpx_ep, util_ep);
+	if (!ep->util_ep.rx_cq)
+		return;
+
 	hdr.msg_name = &addr;
 	hdr.msg_namelen = sizeof(addr);
 	hdr.msg_control = NULL;
@@ -301,6 +476,7 @@ static void udpx_ep_progress(struct util_ep *util_ep)
 out:
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
 }
+#endif
 
 static ssize_t udpx_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 			    uint64_t flags)
@@ -390,10 +566,17 @@ udpx_dest_addrlen(struct udpx_ep *ep, fi_addr_t addr, uint64_t flags)
 static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 			   const void *addr, size_t addrlen, void *context)
 {
+	void *err_context = NULL;
+	int err = 0;
 	ssize_t ret;
 
 	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
-	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+#if UDPX_HAVE_MMSG
+	ret = udpx_flush_ahead(ep, &err_context, &err);
+	if (ret)
+		goto out;
+#endif
+	if (ofi_cq_isfull(ep->util_ep.tx_cq)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -408,6 +591,8 @@ static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 	}
 out:
 	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	if (err_context)
+		udpx_tx_error(ep, err_context, err);
 	return ret;
 }
 
@@ -437,6 +622,8 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 {
 	struct udpx_ep *ep;
 	struct msghdr hdr;
+	void *err_context = NULL;
+	int err = 0;
 	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
@@ -449,10 +636,34 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	hdr.msg_flags = 0;
 
 	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
-	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+	if (ofi_cq_isfull(ep->util_ep.tx_cq)) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+#if UDPX_HAVE_MMSG
+	/* Queue sends marked FI_MORE, then flush the batch with the last.
+	 * Only the iovecs are queued, so injected data is always sent before
+	 * returning.
+	 */
+	if (((flags & FI_MORE) || ep->tx_cnt) && !(flags & FI_INJECT) &&
+	    msg->iov_count <= UDPX_IOV_LIMIT) {
+		ret = udpx_queue_tx(ep, msg, hdr.msg_name, hdr.msg_namelen,
+				    &err_context, &err);
+		if (!ret && !(flags & FI_MORE) && !err_context)
+			err = udpx_flush_tx(ep, &err_context);
+		goto out;
+	}
+
+	ret = udpx_flush_ahead(ep, &err_context, &err);
+	if (ret)
+		goto out;
+
+	if (ofi_cq_isfull(ep->util_ep.tx_cq)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
+#endif
 
 	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
 	if (ret >= 0) {
@@ -463,6 +674,8 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	}
 out:
 	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	if (err_context)
+		udpx_tx_error(ep, err_context, err);
 	return ret;
 }
 
@@ -494,30 +707,50 @@ static ssize_t udpx_sendv_mc(struct fid_ep *ep_fid, const struct iovec *iov,
 	return udpx_sendmsg(ep_fid, &msg, FI_MULTICAST);
 }
 
+static ssize_t udpx_injectto(struct udpx_ep *ep, const void *buf, size_t len,
+			     const void *addr, size_t addrlen)
+{
+	ssize_t ret;
+#if UDPX_HAVE_MMSG
+	void *err_context = NULL;
+	int err = 0;
+
+	/* Unlocked check, the queue only holds sends posted with FI_MORE */
+	if (ep->tx_cnt) {
+		ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+		ret = udpx_flush_ahead(ep, &err_context, &err);
+		ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+		if (err_context)
+			udpx_tx_error(ep, err_context, err);
+		if (ret)
+			return ret;
+	}
+#endif
+
+	ret = ofi_sendto_socket(ep->sock, buf, len, 0, addr,
+				(socklen_t)addrlen);
+	return ret == (ssize_t)len ? 0 : -errno;
+}
+
 static ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 			   fi_addr_t dest_addr)
 {
 	struct udpx_ep *ep;
-	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
-	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
-				ofi_ip_av_get_addr(ep->util_ep.av, (int)dest_addr),
-				(socklen_t)ep->util_ep.av->addrlen);
-	return ret == (ssize_t)len ? 0 : -errno;
+	return udpx_injectto(ep, buf, len,
+			     ofi_ip_av_get_addr(ep->util_ep.av, (int)dest_addr),
+			     ep->util_ep.av->addrlen);
 }
 
 static ssize_t udpx_inject_mc(struct fid_ep *ep_fid, const void *buf,
 			      size_t len, fi_addr_t dest_addr)
 {
 	struct udpx_ep *ep;
-	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
-	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
-				(const void *)(uintptr_t)dest_addr,
-				(socklen_t)ofi_sizeofaddr((const void *)(uintptr_t)dest_addr));
-	return ret == (ssize_t)len ? 0 : -errno;
+	return udpx_injectto(ep, buf, len, (const void *)(uintptr_t)dest_addr,
+			     ofi_sizeofaddr((const void *)(uintptr_t)dest_addr));
 }
 
 static struct fi_ops_msg udpx_msg_ops = {
@@ -546,6 +779,41 @@ static struct fi_ops_msg udpx_msg_mcast_ops = {
 	.injectdata = fi_no_msg_injectdata,
 };
 
+#if UDPX_HAVE_MMSG
+static int udpx_alloc_batch(struct udpx_ep *ep)
+{
+	size_t i;
+
+	ep->rx_msgs = calloc(udpx_batch_size, sizeof(*ep->rx_msgs));
+	ep->rx_addrs = calloc(udpx_batch_size, sizeof(*ep->rx_addrs));
+	ep->tx_msgs = calloc(udpx_batch_size, sizeof(*ep->tx_msgs));
+	ep->tx_entries = calloc(udpx_batch_size, sizeof(*ep->tx_entries));
+	if (!ep->rx_msgs || !ep->rx_addrs || !ep->tx_msgs || !ep->tx_entries)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < udpx_batch_size; i++)
+		ep->rx_msgs[i].msg_hdr.msg_name = &ep->rx_addrs[i];
+	return 0;
+}
+
+static void udpx_free_batch(struct udpx_ep *ep)
+{
+	free(ep->rx_msgs);
+	free(ep->rx_addrs);
+	free(ep->tx_msgs);
+	free(ep->tx_entries);
+}
+#else
+static int udpx_alloc_batch(struct udpx_ep *ep)
+{
+	return 0;
+}
+
+static void udpx_free_batch(struct udpx_ep *ep)
+{
+}
+#endif
+
 static int udpx_ep_close(struct fid *fid)
 {
 	struct udpx_ep *ep;
@@ -568,8 +836,18 @@ static int udpx_ep_close(struct fid *fid)
 				&ep->util_ep.ep_fid.fid);
 	}
 
+	if (ep->util_ep.tx_cq) {
+		fid_list_remove2(&ep->util_ep.tx_cq->ep_list,
+				 &ep->util_ep.tx_cq->ep_list_lock,
+				 &ep->util_ep.ep_fid.fid);
+#if UDPX_HAVE_MMSG
+		udpx_cancel_tx(ep);
+#endif
+	}
+
 	udpx_rx_cirq_free(ep->rxq);
 	ofi_close_socket(ep->sock);
+	udpx_free_batch(ep);
 	ofi_endpoint_close(&ep->util_ep);
 	free(ep);
 	return 0;
@@ -590,6 +868,13 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq,
 		ofi_atomic_inc32(&cq->ref);
 		ep->tx_comp = cq->wait ? udpx_tx_comp_signal :
 					 udpx_tx_comp;
+
+		/* Progress flushes sends queued with FI_MORE */
+		ret = fid_list_insert2(&cq->ep_list,
+				       &cq->ep_list_lock,
+				       &ep->util_ep.ep_fid.fid);
+		if (ret)
+			return ret;
 	}
 
 	if (flags & FI_RECV) {
@@ -727,10 +1012,14 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 	int ret;
 
 	ofi_atomic_initialize32(&ep->ref, 0);
+	ret = udpx_alloc_batch(ep);
+	if (ret)
+		goto err0;
+
 	ep->rxq = udpx_rx_cirq_create(info->rx_attr->size);
 	if (!ep->rxq) {
 		ret = -FI_ENOMEM;
-		return ret;
+		goto err0;
 	}
 
 	family = info->src_addr ?
@@ -757,6 +1046,8 @@ err2:
 	ofi_close_socket(ep->sock);
 err1:
 	udpx_rx_cirq_free(ep->rxq);
+err0:
+	udpx_free_batch(ep);
 	return ret;
 }
 
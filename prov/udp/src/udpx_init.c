@@ -38,6 +38,8 @@
 #include <sys/types.h>
 
 
+size_t udpx_batch_size = UDPX_DEF_BATCH;
+
 static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
@@ -64,6 +66,13 @@ UDP_INI
 {
 	fi_param_define(&udpx_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
+	fi_param_define(&udpx_prov, "batch_size", FI_PARAM_SIZE_T,
+			"Maximum number of datagrams received or sent per "
+			"system call, if recvmmsg and sendmmsg are supported "
+			"(default: %d)", UDPX_DEF_BATCH);
+	fi_param_get_size_t(&udpx_prov, "batch_size", &udpx_batch_size);
+	if (!udpx_batch_size)
+		udpx_batch_size = 1;
 
 	return &udpx_prov;
 }
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <ofi_atomic.h>
+#include <ofi_osd.h>
+
+/*
+ * Reduction handlers.  These match the atomic write handlers, but do not
+ * perform each element update atomically, which allows the common
+ * operations to be vectorized.  The SIMD variants are selected once at
+ * initialization based on the CPU features of the host.
+ */
+
+#define OFI_OP_MIN(type,dst,src)   if ((dst) > (src)) (dst) = (src)
+#define OFI_OP_MAX(type,dst,src)   if ((dst) < (src)) (dst) = (src)
+#define OFI_OP_SUM(type,dst,src)   (dst) += (src)
+#define OFI_OP_PROD(type,dst,src)  (dst) *= (src)
+#define OFI_OP_LOR(type,dst,src)   (dst) = (dst) || (src)
+#define OFI_OP_LAND(type,dst,src)  (dst) = (dst) && (src)
+#define OFI_OP_BOR(type,dst,src)   (dst) |= (src)
+#define OFI_OP_BAND(type,dst,src)  (dst) &= (src)
+#define OFI_OP_LXOR(type,dst,src)  (dst) = ((dst) && !(src)) || (!(dst) && (src))
+#define OFI_OP_BXOR(type,dst,src)  (dst) ^= (src)
+#define OFI_OP_WRITE(type,dst,src) (dst) = (src)
+
+#define OFI_OP_SUM_COMPLEX(type,dst,src)  (dst) = ofi_complex_sum_##type(dst,src)
+#define OFI_OP_PROD_COMPLEX(type,dst,src) (dst) = ofi_complex_prod_##type(dst,src)
+#define OFI_OP_LOR_COMPLEX(type,dst,src)  (dst) = ofi_complex_lor_##type(dst,src)
+#define OFI_OP_LAND_COMPLEX(type,dst,src) (dst) = ofi_complex_land_##type(dst,src)
+#define OFI_OP_LXOR_COMPLEX(type,dst,src) (dst) = ofi_complex_lxor_##type(dst,src)
+#define OFI_OP_WRITE_COMPLEX		OFI_OP_WRITE
+
+#define OFI_DEF_NOOP_NAME NULL,
+#define OFI_DEF_NOOP_FUNC
+
+#define OFI_DEF_REDUCE_NAME(op, type) ofi_reduce_## op ##_## type,
+#define OFI_DEF_REDUCE_FUNC(op, type)					\
+	static void ofi_reduce_## op ##_## type				\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		size_t i;						\
+		type *d = (dst);					\
+		const type *s = (src);					\
+		for (i = 0; i < cnt; i++) {				\
+			op(type, d[i], s[i]);				\
+		}							\
+	}
+
+#define OFI_DEF_REDUCE_COMPLEX_NAME(op, type) ofi_reduce_## op ##_## type,
+#define OFI_DEF_REDUCE_COMPLEX_FUNC(op, type)				\
+	static void ofi_reduce_## op ##_## type				\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		size_t i;						\
+		ofi_complex_##type *d = (dst);				\
+		const ofi_complex_##type *s = (src);			\
+		for (i = 0; i < cnt; i++) {				\
+			op(type, d[i], s[i]);				\
+		}							\
+	}
+
+#ifdef HAVE___INT128
+#define OFI_DEF_REDUCE_INT128_NAME(op, type)	OFI_DEF_REDUCE_NAME(op, type)
+#define OFI_DEF_REDUCE_INT128_FUNC(op, type)	OFI_DEF_REDUCE_FUNC(op, type)
+#else
+#define OFI_DEF_REDUCE_INT128_NAME(op, type)	NULL,
+#define OFI_DEF_REDUCE_INT128_FUNC(op, type)
+#endif
+
+#define OFI_DEFINE_INT_HANDLERS(FUNCNAME, op)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int64_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint64_t)				\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_int128_t)		\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_uint128_t)
+
+#define OFI_DEFINE_REALNO_HANDLERS(FUNCNAME, op)			\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int64_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint64_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, float)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, double)				\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_REDUCE_##FUNCNAME(op, long_double)			\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_int128_t)		\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_uint128_t)
+
+#define OFI_DEFINE_ALL_HANDLERS(FUNCNAME, op)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint8_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint16_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint32_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, int64_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, uint64_t)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, float)				\
+	OFI_DEF_REDUCE_##FUNCNAME(op, double)				\
+	OFI_DEF_REDUCE_COMPLEX_##FUNCNAME(op ##_COMPLEX, float)		\
+	OFI_DEF_REDUCE_COMPLEX_##FUNCNAME(op ##_COMPLEX, double)	\
+	OFI_DEF_REDUCE_##FUNCNAME(op, long_double)			\
+	OFI_DEF_REDUCE_COMPLEX_##FUNCNAME(op ##_COMPLEX, long_double)	\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_int128_t)		\
+	OFI_DEF_REDUCE_INT128_##FUNCNAME(op, ofi_uint128_t)
+
+/* 5 per line to be easily counted by inspection. */
+#define OFI_OP_NOT_SUPPORTED(op)		\
+	NULL, NULL, NULL, NULL, NULL,		\
+	NULL, NULL, NULL, NULL, NULL,		\
+	NULL, NULL, NULL, NULL, NULL,		\
+	NULL
+
+OFI_DEFINE_REALNO_HANDLERS(FUNC, OFI_OP_MIN)
+OFI_DEFINE_REALNO_HANDLERS(FUNC, OFI_OP_MAX)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_SUM)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_PROD)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_LOR)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_LAND)
+OFI_DEFINE_INT_HANDLERS(FUNC, OFI_OP_BOR)
+OFI_DEFINE_INT_HANDLERS(FUNC, OFI_OP_BAND)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_LXOR)
+OFI_DEFINE_INT_HANDLERS(FUNC, OFI_OP_BXOR)
+OFI_DEFINE_ALL_HANDLERS(FUNC, OFI_OP_WRITE)
+
+void (*ofi_atomic_reduce_handlers[OFI_WRITE_OP_CNT][OFI_DATATYPE_CNT])
+	(void *dst, const void *src, size_t cnt) =
+{
+	{ OFI_DEFINE_REALNO_HANDLERS(NAME, OFI_OP_MIN) },
+	{ OFI_DEFINE_REALNO_HANDLERS(NAME, OFI_OP_MAX) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_SUM) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_PROD) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_LOR) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_LAND) },
+	{ OFI_DEFINE_INT_HANDLERS(NAME, OFI_OP_BOR) },
+	{ OFI_DEFINE_INT_HANDLERS(NAME, OFI_OP_BAND) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_LXOR) },
+	{ OFI_DEFINE_INT_HANDLERS(NAME, OFI_OP_BXOR) },
+	{ OFI_OP_NOT_SUPPORTED(FI_ATOMIC_READ) },
+	{ OFI_DEFINE_ALL_HANDLERS(NAME, OFI_OP_WRITE) },
+};
+
+
+/*
+ * SIMD handlers are written using the compiler's generic vector types, so
+ * that the same source produces SSE2/NEON (16 byte), AVX2 (32 byte), and
+ * AVX-512 (64 byte) kernels.  Any trailing elements that do not fill a
+ * vector are handled by the scalar operation.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+
+#define OFI_VEC_MIN(d, s)						\
+	do {								\
+		__typeof__((d) > (s)) m_ = (d) > (s);			\
+		(d) = (__typeof__(d)) (((__typeof__(m_)) (s) & m_) |	\
+				       ((__typeof__(m_)) (d) & ~m_));	\
+	} while (0)
+#define OFI_VEC_MAX(d, s)						\
+	do {								\
+		__typeof__((d) < (s)) m_ = (d) < (s);			\
+		(d) = (__typeof__(d)) (((__typeof__(m_)) (s) & m_) |	\
+				       ((__typeof__(m_)) (d) & ~m_));	\
+	} while (0)
+#define OFI_VEC_SUM(d, s)	(d) += (s)
+#define OFI_VEC_PROD(d, s)	(d) *= (s)
+#define OFI_VEC_BOR(d, s)	(d) |= (s)
+#define OFI_VEC_BAND(d, s)	(d) &= (s)
+#define OFI_VEC_BXOR(d, s)	(d) ^= (s)
+
+#define OFI_DEF_VEC_FUNC(isa, attr, width, op, type, datatype)		\
+	static attr void ofi_reduce_##isa##_##op##_##type		\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		typedef type vec_t __attribute__((vector_size(width),	\
+						  aligned(1), may_alias)); \
+		type *d = (dst);					\
+		const type *s = (src);					\
+		size_t i = 0;						\
+		vec_t vd;						\
+									\
+		for (; i + width / sizeof(type) <= cnt;			\
+		     i += width / sizeof(type)) {			\
+			vd = *(vec_t *) &d[i];				\
+			OFI_VEC_##op(vd, *(const vec_t *) &s[i]);	\
+			*(vec_t *) &d[i] = vd;				\
+		}							\
+		for (; i < cnt; i++) {					\
+			OFI_OP_##op(type, d[i], s[i]);			\
+		}							\
+	}
+
+#define OFI_SET_VEC_FUNC(isa, attr, width, op, type, datatype)		\
+	ofi_atomic_reduce_handlers[FI_##op][datatype] =			\
+		ofi_reduce_##isa##_##op##_##type;
+
+#define OFI_VEC_INT_HANDLERS(M, isa, attr, width, op)			\
+	M(isa, attr, width, op, int8_t, FI_INT8)			\
+	M(isa, attr, width, op, uint8_t, FI_UINT8)			\
+	M(isa, attr, width, op, int16_t, FI_INT16)			\
+	M(isa, attr, width, op, uint16_t, FI_UINT16)			\
+	M(isa, attr, width, op, int32_t, FI_INT32)			\
+	M(isa, attr, width, op, uint32_t, FI_UINT32)			\
+	M(isa, attr, width, op, int64_t, FI_INT64)			\
+	M(isa, attr, width, op, uint64_t, FI_UINT64)
+
+#define OFI_VEC_REALNO_HANDLERS(M, isa, attr, width, op)		\
+	OFI_VEC_INT_HANDLERS(M, isa, attr, width, op)			\
+	M(isa, attr, width, op, float, FI_FLOAT)			\
+	M(isa, attr, width, op, double, FI_DOUBLE)
+
+#define OFI_VEC_HANDLERS(M, isa, attr, width)				\
+	OFI_VEC_REALNO_HANDLERS(M, isa, attr, width, MIN)		\
+	OFI_VEC_REALNO_HANDLERS(M, isa, attr, width, MAX)		\
+	OFI_VEC_REALNO_HANDLERS(M, isa, attr, width, SUM)		\
+	OFI_VEC_REALNO_HANDLERS(M, isa, attr, width, PROD)		\
+	OFI_VEC_INT_HANDLERS(M, isa, attr, width, BOR)			\
+	OFI_VEC_INT_HANDLERS(M, isa, attr, width, BAND)			\
+	OFI_VEC_INT_HANDLERS(M, isa, attr, width, BXOR)
+
+#define OFI_DEFINE_VEC_ISA(isa, attr, width)				\
+	OFI_VEC_HANDLERS(OFI_DEF_VEC_FUNC, isa, attr, width)		\
+	static void ofi_reduce_use_##isa(void)				\
+	{								\
+		OFI_VEC_HANDLERS(OFI_SET_VEC_FUNC, isa, attr, width)	\
+	}
+
+/* SSE2 and NEON are part of the base x86_64 and aarch64 ISAs. */
+OFI_DEFINE_VEC_ISA(vec128, , 16)
+
+#ifdef __x86_64__
+#define OFI_VEC128_NAME "sse2"
+#else
+#define OFI_VEC128_NAME "neon"
+#endif
+
+#if defined(__x86_64__) && defined(HAVE_CPUID) && defined(HAVE_X86_SIMD_TARGET)
+
+OFI_DEFINE_VEC_ISA(avx2, __attribute__((target("avx2"))), 32)
+OFI_DEFINE_VEC_ISA(avx512,
+		   __attribute__((target("avx512f,avx512bw,avx512dq"))), 64)
+
+/* The OS must save the extended register state for these to be usable */
+static uint64_t ofi_xgetbv(void)
+{
+	uint32_t eax, edx;
+
+	__asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return ((uint64_t) edx << 32) | eax;
+}
+
+static const char *ofi_reduce_select(void)
+{
+	uint64_t xcr0;
+
+	if (!ofi_cpu_supports(0x1, OFI_OSXSAVE_REG, OFI_OSXSAVE_BIT))
+		return NULL;
+
+	xcr0 = ofi_xgetbv();
+	if ((xcr0 & OFI_XCR0_AVX512) == OFI_XCR0_AVX512 &&
+	    ofi_cpu_supports(0x7, OFI_AVX512F_REG, OFI_AVX512F_BIT) &&
+	    ofi_cpu_supports(0x7, OFI_AVX512BW_REG, OFI_AVX512BW_BIT) &&
+	    ofi_cpu_supports(0x7, OFI_AVX512DQ_REG, OFI_AVX512DQ_BIT)) {
+		ofi_reduce_use_avx512();
+		return "avx512";
+	}
+
+	if ((xcr0 & OFI_XCR0_AVX) == OFI_XCR0_AVX &&
+	    ofi_cpu_supports(0x7, OFI_AVX2_REG, OFI_AVX2_BIT)) {
+		ofi_reduce_use_avx2();
+		return "avx2";
+	}
+
+	return NULL;
+}
+
+#else
+
+static const char *ofi_reduce_select(void)
+{
+	return NULL;
+}
+
+#endif
+
+void ofi_atomic_reduce_init(void)
+{
+	const char *isa;
+
+	ofi_reduce_use_vec128();
+	isa = ofi_reduce_select();
+	FI_INFO(&core_prov, FI_LOG_CORE, "Using %s reduction handlers\n",
+		isa ? isa : OFI_VEC128_NAME);
+}
+
+#else /* __GNUC__ && (__x86_64__ || __aarch64__) */
+
+void ofi_atomic_reduce_init(void)
+{
+}
+
+#endif
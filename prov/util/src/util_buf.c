@@ -59,6 +59,26 @@ enum {
 };
 
 
+/* The region is zeroed by the growing thread right after it is mapped, so
+ * first touch normally places it locally.  Binding makes the placement
+ * explicit in case the thread migrates or the memory is touched elsewhere.
+ */
+static void ofi_bufpool_region_bind(struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool *pool = buf_region->pool;
+	int ret;
+
+	if (!(pool->attr.flags & OFI_BUFPOOL_NUMA_LOCAL))
+		return;
+
+	ret = ofi_mbind_local(buf_region->alloc_region, pool->alloc_size);
+	if (ret) {
+		FI_DBG(&core_prov, FI_LOG_CORE,
+		       "unable to bind region to local node: %s\n",
+		       fi_strerror(-ret));
+	}
+}
+
 static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 {
 	int ret;
@@ -76,6 +96,7 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 				buf_region->flags = OFI_BUFPOOL_HUGEPAGES | OFI_BUFPOOL_NONSHARED;
 				pool->alloc_size = alloc_size;
 				pool->region_size = pool->alloc_size - pool->entry_size;
+				ofi_bufpool_region_bind(buf_region);
 				return 0;
 			}
 		}
@@ -97,6 +118,7 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 		if (!ret) {
 			buf_region->flags = OFI_BUFPOOL_NONSHARED;
 			pool->region_size = pool->alloc_size - pool->entry_size;
+			ofi_bufpool_region_bind(buf_region);
 			return 0;
 		} else if (ret != -FI_ENOSYS) {
 			return ret;
@@ -248,6 +270,10 @@ int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 		return -FI_ENOMEM;
 
 	pool->attr = *attr;
+	/* node placement requires regions to be mapped directly */
+	if (pool->attr.flags & OFI_BUFPOOL_NUMA_LOCAL)
+		pool->attr.flags |= OFI_BUFPOOL_NONSHARED;
+	ofi_mutex_init(&pool->lock);
 
 	entry_sz = (attr->size + sizeof(struct ofi_bufpool_hdr));
 	OFI_DBG_ADD(entry_sz, sizeof(struct ofi_bufpool_ftr));
@@ -295,9 +321,83 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 		free(buf_region);
 	}
 	free(pool->region_table);
+	ofi_mutex_destroy(&pool->lock);
 	free(pool);
 }
 
+int ofi_bufpool_cache_create(struct ofi_bufpool *pool, size_t size,
+			     struct ofi_bufpool_cache **cache)
+{
+	struct ofi_bufpool_cache *new_cache;
+
+	assert(!(pool->attr.flags & OFI_BUFPOOL_INDEXED));
+	if (size < 2)
+		return -FI_EINVAL;
+
+	new_cache = calloc(1, sizeof(*new_cache) +
+			   size * sizeof(*new_cache->bufs));
+	if (!new_cache)
+		return -FI_ENOMEM;
+
+	new_cache->pool = pool;
+	new_cache->size = size;
+	*cache = new_cache;
+	return FI_SUCCESS;
+}
+
+void ofi_bufpool_cache_destroy(struct ofi_bufpool_cache *cache)
+{
+	ofi_bufpool_cache_flush(cache, cache->cnt);
+	free(cache);
+}
+
+/* Moves up to half of the cache's capacity from the pool into the cache.
+ * Fails only if the pool is empty and cannot grow.
+ */
+int ofi_bufpool_cache_refill(struct ofi_bufpool_cache *cache)
+{
+	struct ofi_bufpool *pool = cache->pool;
+	struct ofi_bufpool_hdr *buf_hdr;
+	int ret = 0;
+
+	assert(!cache->cnt);
+	ofi_mutex_lock(&pool->lock);
+	while (cache->cnt < cache->size / 2) {
+		if (ofi_bufpool_empty(pool)) {
+			ret = ofi_bufpool_grow(pool);
+			if (ret)
+				break;
+		}
+
+		slist_remove_head_container(&pool->free_list.entries,
+				struct ofi_bufpool_hdr, buf_hdr, entry.slist);
+		buf_hdr->entry.slist.next = NULL;
+		cache->bufs[cache->cnt++] = ofi_buf_data(buf_hdr);
+	}
+	ofi_mutex_unlock(&pool->lock);
+
+	return cache->cnt ? 0 : ret;
+}
+
+/* Returns the cnt oldest buffers in the cache to the pool. */
+void ofi_bufpool_cache_flush(struct ofi_bufpool_cache *cache, size_t cnt)
+{
+	struct ofi_bufpool *pool = cache->pool;
+	size_t i;
+
+	assert(cnt <= cache->cnt);
+	ofi_mutex_lock(&pool->lock);
+	for (i = 0; i < cnt; i++) {
+		slist_insert_head(&ofi_buf_hdr(cache->bufs[i])->entry.slist,
+				  &pool->free_list.entries);
+	}
+	ofi_mutex_unlock(&pool->lock);
+
+	cache->cnt -= cnt;
+	memmove(cache->bufs, &cache->bufs[cnt],
+		cache->cnt * sizeof(*cache->bufs));
+}
+
 int ofi_ibuf_is_lower(struct dlist_entry *item, const void *arg)
 {
 	struct ofi_bufpool_hdr *hdr1, *hdr2;
@@ -140,10 +140,25 @@ int ofi_cntr_seterr(struct fid_cntr *cntr_fid, uint64_t value)
 	return FI_SUCCESS;
 }
 
+/*
+ * Counters updated by endpoints that rely on manual progress, or by a
+ * provider-specific progress routine, only advance when cntr->progress
+ * runs, which waiters must keep calling.
+ */
+static bool util_cntr_needs_progress(struct util_cntr *cntr)
+{
+	if (cntr->progress != &ofi_cntr_progress)
+		return true;
+
+	return cntr->domain->data_progress != FI_PROGRESS_AUTO &&
+	       !dlist_empty(&cntr->ep_list);
+}
+
 int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 {
 	struct util_cntr *cntr;
 	uint64_t endtime, errcnt;
+	uint32_t seq;
 	int ret, timeout_quantum;
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
@@ -151,7 +166,8 @@ int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 	errcnt = ofi_atomic_get64(&cntr->err);
 	endtime = ofi_timeout_time(timeout);
 
-	do {
+	for (;;) {
+		seq = ofi_wait_seq(cntr->wait);
 		cntr->progress(cntr);
 		if (threshold <= (uint64_t)ofi_atomic_get64(&cntr->cnt))
 			return FI_SUCCESS;
@@ -162,24 +178,34 @@ int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 		if (ofi_adjust_timeout(endtime, &timeout))
 			return -FI_ETIMEDOUT;
 
-		/*
-		 * Temporary work-around to avoid a thread hanging in underlying
-		 * epoll_wait called from fi_wait. This can happen if one thread
-		 * updates the counter, another thread reads it (thereby resetting
-		 * cntr signal fd) and the current thread is about to wait. The
-		 * current thread would never wake up and doesn't know the counter
-		 * has been updated. Fix it by checking counter state every now
-		 * and then instead of waiting for a longer period. This does
-		 * have the overhead of threads waking up unnecessarily.
-		 */
 		timeout_quantum = (timeout < 0 ? OFI_TIMEOUT_QUANTUM_MS :
 				   MIN(OFI_TIMEOUT_QUANTUM_MS, timeout));
 
-		ret = ofi_wait(&cntr->wait->wait_fid, timeout_quantum);
-	} while (!ret || (ret == -FI_ETIMEDOUT &&
-			  (timeout < 0 || timeout_quantum < timeout)));
+		/*
+		 * Only wake up every quantum when cntr->progress has work to
+		 * drive.  Otherwise the counter is updated by someone who
+		 * signals the wait object, and the futex sleep cannot miss it.
+		 */
+		ret = ofi_wait_seq_wait(cntr->wait, seq,
+					util_cntr_needs_progress(cntr) ?
+					timeout_quantum : timeout);
+		if (ret == -FI_ENOSYS) {
+			/*
+			 * The wait object also drives provider progress, so
+			 * ofi_wait() must be used.  Another thread can reset
+			 * the counter signal fd after this thread checked the
+			 * counter, which the quantum also covers.
+			 */
+			ret = ofi_wait(&cntr->wait->wait_fid, timeout_quantum);
+		}
 
-	return ret;
+		if (ret == -FI_ETIMEDOUT &&
+		    (timeout < 0 || timeout_quantum < timeout))
+			ret = 0;
+
+		if (ret)
+			return ret;
+	}
 }
 
 static struct fi_ops_cntr util_cntr_ops = {
@@ -37,6 +37,7 @@
 #include <ofi_util.h>
 
 #define UTIL_DEF_CQ_SIZE (1024)
+#define UTIL_DEF_CQ_AUX_CNT (64)
 
 
 /* While the CQ is full, we continue to add new entries to the auxiliary
@@ -64,10 +65,11 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 	FI_DBG(cq->domain->prov, FI_LOG_CQ, "writing to CQ overflow list\n");
 	assert(ofi_cirque_freecnt(cq->cirq) <= 1);
 
-	entry = calloc(1, sizeof(*entry));
+	entry = ofi_buf_alloc(cq->aux_pool);
 	if (!entry)
 		return -FI_ENOMEM;
 
+	memset(entry, 0, sizeof(*entry));
 	entry->comp.op_context = context;
 	entry->comp.flags = flags;
 	entry->comp.len = len;
@@ -81,15 +83,102 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 	return 0;
 }
 
+/* Moves completions written without the lock to the CQ, in order.  Once
+ * the CQ is full, the rest go to the overflow list, so that anything
+ * written under the lock after this call lands behind them.
+ */
+int ofi_cq_drain_lfq(struct util_cq *cq)
+{
+	struct util_cq_lf_entry *entry;
+	int64_t pos;
+	int ret;
+
+	assert(ofi_genlock_held(&cq->cq_lock));
+	while (!util_cq_lfq_head(cq->lfq, &entry, &pos)) {
+		if (ofi_cirque_freecnt(cq->cirq) > 1) {
+			if (cq->src)
+				cq->src[ofi_cirque_windex(cq->cirq)] =
+					entry->src;
+			*ofi_cirque_next(cq->cirq) = entry->comp;
+			ofi_cirque_commit(cq->cirq);
+		} else {
+			ret = ofi_cq_write_overflow(cq, entry->comp.op_context,
+					entry->comp.flags, entry->comp.len,
+					entry->comp.buf, entry->comp.data,
+					entry->comp.tag, entry->src);
+			if (ret)
+				return ret;
+		}
+		util_cq_lfq_release(cq->lfq, entry, pos);
+	}
+	return 0;
+}
+
+/* Writes count completions, reserving space for all of them with a single
+ * atomic update of the lock-free ring when one is available.  If the ring
+ * is full, falls back to the locked CQ and its overflow list.
+ */
+int ofi_cq_write_batch(struct util_cq *cq,
+		       const struct fi_cq_tagged_entry *comp,
+		       const fi_addr_t *src, size_t count)
+{
+	struct util_cq_lf_entry *entry;
+	int64_t pos;
+	size_t i;
+	int ret = 0;
+
+	if (cq->lfq && count <= (size_t) cq->lfq->size &&
+	    !util_cq_lfq_next_n(cq->lfq, count, &pos)) {
+		for (i = 0; i < count; i++) {
+			entry = util_cq_lfq_buf(cq->lfq, pos + i);
+			entry->comp = comp[i];
+			entry->src = src ? src[i] : FI_ADDR_NOTAVAIL;
+		}
+		util_cq_lfq_commit_n(cq->lfq, pos, count);
+		return 0;
+	}
+
+	ofi_genlock_lock(&cq->cq_lock);
+	/* keep earlier lock-free writes ahead of these */
+	if (cq->lfq)
+		ret = ofi_cq_drain_lfq(cq);
+
+	for (i = 0; i < count && !ret; i++) {
+		if (ofi_cirque_freecnt(cq->cirq) > 1) {
+			if (cq->src)
+				cq->src[ofi_cirque_windex(cq->cirq)] =
+					src ? src[i] : FI_ADDR_NOTAVAIL;
+			*ofi_cirque_next(cq->cirq) = comp[i];
+			ofi_cirque_commit(cq->cirq);
+		} else {
+			ret = ofi_cq_write_overflow(cq, comp[i].op_context,
+					comp[i].flags, comp[i].len,
+					comp[i].buf, comp[i].data,
+					comp[i].tag,
+					src ? src[i] : FI_ADDR_NOTAVAIL);
+		}
+	}
+	ofi_genlock_unlock(&cq->cq_lock);
+	return ret;
+}
+
 static int util_cq_insert_error(struct util_cq *cq,
 				const struct fi_cq_err_entry *err_entry)
 {
 	struct util_cq_aux_entry *entry;
 	void *err_data;
+	int ret;
 
 	assert(ofi_genlock_held(&cq->cq_lock));
 	assert(err_entry->err);
-	entry = calloc(1, sizeof(*entry));
+	/* the error must be reported after completions already written */
+	if (cq->lfq) {
+		ret = ofi_cq_drain_lfq(cq);
+		if (ret)
+			return ret;
+	}
+
+	entry = ofi_buf_alloc(cq->aux_pool);
 	if (!entry)
 		return -FI_ENOMEM;
 
@@ -99,7 +188,7 @@ static int util_cq_insert_error(struct util_cq *cq,
 		err_data = mem_dup(err_entry->err_data,
 				   err_entry->err_data_size);
 		if (!err_data) {
-			free(entry);
+			ofi_buf_free(entry);
 			return -FI_ENOMEM;
 		}
 
@@ -333,7 +422,7 @@ ssize_t ofi_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf,
 	slist_remove_head(&cq->aux_queue);
 	if (aux_entry->comp.err_data_size)
 		free(aux_entry->comp.err_data);
-	free(aux_entry);
+	ofi_buf_free(aux_entry);
 	if (slist_empty(&cq->aux_queue)) {
 		ofi_cirque_discard(cq->cirq);
 	} else {
@@ -354,6 +443,7 @@ ssize_t ofi_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 {
 	struct util_cq *cq;
 	uint64_t endtime;
+	uint32_t seq;
 	ssize_t ret;
 
 	cq = container_of(cq_fid, struct util_cq, cq_fid);
@@ -361,6 +451,7 @@ ssize_t ofi_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 	endtime = ofi_timeout_time(timeout);
 
 	do {
+		seq = ofi_wait_seq(cq->wait);
 		ret = fi_cq_readfrom(cq_fid, buf, count, src_addr);
 		if (ret != -FI_EAGAIN)
 			break;
@@ -373,7 +464,9 @@ ssize_t ofi_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 			return -FI_EAGAIN;
 		}
 
-		ret = ofi_wait(&cq->wait->wait_fid, timeout);
+		ret = ofi_wait_seq_wait(cq->wait, seq, timeout);
+		if (ret == -FI_ENOSYS)
+			ret = ofi_wait(&cq->wait->wait_fid, timeout);
 	} while (!ret);
 
 	return ret == -FI_ETIMEDOUT ? -FI_EAGAIN : ret;
@@ -420,9 +513,12 @@ static void util_peer_cq_cleanup(struct util_cq *cq)
 	while (!slist_empty(&cq->aux_queue)) {
 		entry = slist_remove_head(&cq->aux_queue);
 		err = container_of(entry, struct util_cq_aux_entry, list_entry);
-		free(err);
+		ofi_buf_free(err);
 	}
 
+	if (cq->lfq)
+		util_cq_lfq_free(cq->lfq);
+	ofi_bufpool_destroy(cq->aux_pool);
 	util_comp_cirq_free(cq->cirq);
 	free(cq->src);
 	fi_close(&cq->peer_cq->fid);
@@ -538,16 +634,7 @@ static ssize_t util_peer_cq_write(struct fid_peer_cq *cq, void *context,
 
 	util_cq = cq->fid.context;
 
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_entry(util_cq, context, flags, len, buf, data,
-				     tag);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, FI_ADDR_NOTAVAIL);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write(util_cq, context, flags, len, buf, data, tag);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -562,16 +649,8 @@ static ssize_t util_peer_cq_write_src(struct fid_peer_cq *cq, void *context,
 	struct util_cq *util_cq = cq->fid.context;
 	int ret;
 
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_src_entry(util_cq, context, flags, len, buf, data,
-				       tag, src);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, src);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write_src(util_cq, context, flags, len, buf, data, tag,
+			       src);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -683,20 +762,50 @@ static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 	if (cq->domain->info_domain_caps & FI_SOURCE) {
 		cq->src = calloc(cq->cirq->size, sizeof(*cq->src));
 		if (!cq->src) {
-			util_comp_cirq_free(cq->cirq);
 			ret = -FI_ENOMEM;
-			goto free;
+			goto free_cirq;
 		}
 		cq->peer_cq->owner_ops = &util_peer_cq_src_owner_ops;
 	} else {
 		cq->peer_cq->owner_ops = &util_peer_cq_owner_ops;
 	}
 
+	/* Preallocate overflow entries so that a full CQ doesn't need to
+	 * allocate memory while writing completions.  The pool is left
+	 * unbounded on purpose: it replaces the per-entry calloc() the
+	 * overflow list used before, and providers have no way to recover a
+	 * completion that cannot be queued.  Growth only happens while the
+	 * application lets the CQ overrun.
+	 */
+	ret = ofi_bufpool_create(&cq->aux_pool,
+				 sizeof(struct util_cq_aux_entry), 16, 0,
+				 UTIL_DEF_CQ_AUX_CNT, OFI_BUFPOOL_NO_TRACK);
+	if (ret)
+		goto free_src;
+
+	ret = ofi_bufpool_grow(cq->aux_pool);
+	if (ret)
+		goto free_pool;
+
+	if (ofi_cq_lockfree_size && cq->cq_lock.lock_type != OFI_LOCK_NOOP) {
+		cq->lfq = util_cq_lfq_create(ofi_cq_lockfree_size);
+		if (!cq->lfq) {
+			ret = -FI_ENOMEM;
+			goto free_pool;
+		}
+	}
+
 	cq->peer_cq->fid.fclass = FI_CLASS_PEER_CQ;
 	cq->peer_cq->fid.context = cq;
 	cq->peer_cq->fid.ops = &util_peer_cq_fi_ops;
 
 	return FI_SUCCESS;
+free_pool:
+	ofi_bufpool_destroy(cq->aux_pool);
+free_src:
+	free(cq->src);
+free_cirq:
+	util_comp_cirq_free(cq->cirq);
 free:
 	free(cq->peer_cq);
 	return ret;
@@ -101,6 +101,8 @@ int ofi_ep_bind_av(struct util_ep *util_ep, struct util_av *av)
 
 int ofi_ep_bind_cntr(struct util_ep *ep, struct util_cntr *cntr, uint64_t flags)
 {
+	int ret;
+
 	if (flags & ~(FI_TRANSMIT | FI_RECV | FI_READ  | FI_WRITE |
 		      FI_REMOTE_READ | FI_REMOTE_WRITE)) {
 		FI_WARN(ep->domain->fabric->prov, FI_LOG_EP_CTRL,
@@ -157,8 +159,12 @@ int ofi_ep_bind_cntr(struct util_ep *ep, struct util_cntr *cntr, uint64_t flags)
 
 	ep->flags |= OFI_CNTR_ENABLED;
 
-	return fid_list_insert2(&cntr->ep_list, &cntr->ep_list_lock,
+	ret = fid_list_insert2(&cntr->ep_list, &cntr->ep_list_lock,
 			       &ep->ep_fid.fid);
+	/* waiters sleeping without a quantum must start driving progress */
+	if (!ret && cntr->wait)
+		cntr->wait->signal(cntr->wait);
+	return ret;
 }
 
 int ofi_ep_bind(struct util_ep *util_ep, struct fid *fid, uint64_t flags)
@@ -51,6 +51,73 @@ struct ofi_mr_cache_params cache_params = {
 	.ze_monitor_enabled = true,
 };
 
+/* A cache hit on an entry that is already in use only needs to take another
+ * reference, which can be done under tree_lock held for read instead of
+ * mm_lock.  A use_cnt transition to or from zero moves the entry on or off
+ * the LRU list and still requires mm_lock, so all updates of use_cnt must be
+ * atomic.  Without builtin atomics every search takes the locked path.
+ */
+#ifdef HAVE_BUILTIN_ATOMICS
+static inline int util_mr_entry_inc(struct ofi_mr_entry *entry)
+{
+	return ofi_atomic_add_and_fetch(32, &entry->use_cnt, 1);
+}
+
+static inline int util_mr_entry_dec(struct ofi_mr_entry *entry)
+{
+	return ofi_atomic_sub_and_fetch(32, &entry->use_cnt, 1);
+}
+
+static inline int util_mr_entry_use_cnt(struct ofi_mr_entry *entry)
+{
+	return ofi_atomic_load_explicit(32, &entry->use_cnt,
+					memory_order_acquire);
+}
+
+/* Take a reference only if the entry is not on the LRU list. */
+static inline bool util_mr_entry_get(struct ofi_mr_entry *entry)
+{
+	int cnt;
+
+	for (cnt = util_mr_entry_use_cnt(entry); cnt > 0;
+	     cnt = util_mr_entry_use_cnt(entry)) {
+		if (ofi_atomic_cas_bool(32, &entry->use_cnt, cnt, cnt + 1))
+			return true;
+	}
+	return false;
+}
+
+static inline void util_mr_cache_stat_inc(size_t *stat)
+{
+	(void) ofi_atomic_add_and_fetch(64, stat, 1);
+}
+#else
+static inline int util_mr_entry_inc(struct ofi_mr_entry *entry)
+{
+	return ++entry->use_cnt;
+}
+
+static inline int util_mr_entry_dec(struct ofi_mr_entry *entry)
+{
+	return --entry->use_cnt;
+}
+
+static inline int util_mr_entry_use_cnt(struct ofi_mr_entry *entry)
+{
+	return entry->use_cnt;
+}
+
+static inline bool util_mr_entry_get(struct ofi_mr_entry *entry)
+{
+	return false;
+}
+
+static inline void util_mr_cache_stat_inc(size_t *stat)
+{
+	(*stat)++;
+}
+#endif /* HAVE_BUILTIN_ATOMICS */
+
 static int util_mr_find_within(struct ofi_rbmap *map, void *key, void *data)
 {
 	struct ofi_mr_entry *entry = data;
@@ -128,8 +195,10 @@ static void util_mr_uncache_entry_storage(struct ofi_mr_cache *cache,
 	enum fi_hmem_iface iface = entry->info.iface;
 	struct ofi_mem_monitor *monitor = cache->monitors[iface];
 
+	pthread_rwlock_wrlock(&cache->tree_lock);
 	ofi_rbmap_delete(&cache->tree, entry->node);
 	entry->node = NULL;
+	pthread_rwlock_unlock(&cache->tree_lock);
 
 	/* Some memory monitors have a subscription context per MR. These
 	 * memory monitors require ofi_monitor_unsubscribe() to be called.
@@ -146,7 +215,7 @@ static void util_mr_uncache_entry(struct ofi_mr_cache *cache,
 {
 	util_mr_uncache_entry_storage(cache, entry);
 
-	if (entry->use_cnt == 0) {
+	if (util_mr_entry_use_cnt(entry) == 0) {
 		dlist_remove(&entry->list_entry);
 		dlist_insert_tail(&entry->list_entry, &cache->dead_region_list);
 	} else {
@@ -246,7 +315,7 @@ void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 	pthread_mutex_lock(&mm_lock);
 	cache->delete_cnt++;
 
-	if (--entry->use_cnt == 0) {
+	if (util_mr_entry_dec(entry) == 0) {
 		if (!entry->node) {
 			cache->uncached_cnt--;
 			cache->uncached_size -= entry->info.iov.iov_len;
@@ -311,8 +380,11 @@ util_mr_cache_create(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 		cache->uncached_cnt++;
 		cache->uncached_size += info->iov.iov_len;
 	} else {
-		if (ofi_rbmap_insert(&cache->tree, (void *) &(*entry)->info,
-				     (void *) *entry, &(*entry)->node)) {
+		pthread_rwlock_wrlock(&cache->tree_lock);
+		ret = ofi_rbmap_insert(&cache->tree, (void *) &(*entry)->info,
+				       (void *) *entry, &(*entry)->node);
+		pthread_rwlock_unlock(&cache->tree_lock);
+		if (ret) {
 			ret = -FI_ENOMEM;
 			goto unlock;
 		}
@@ -338,6 +410,27 @@ free:
 	return ret;
 }
 
+static bool util_mr_cache_search_shared(struct ofi_mr_cache *cache,
+					struct ofi_mem_monitor *monitor,
+					struct ofi_mr_info *info,
+					struct ofi_mr_entry **entry)
+{
+	bool hit;
+
+	pthread_rwlock_rdlock(&cache->tree_lock);
+	*entry = ofi_mr_rbt_find(&cache->tree, info);
+	hit = *entry && ofi_iov_within(&info->iov, &(*entry)->info.iov) &&
+	      monitor->valid(monitor, info, *entry) &&
+	      util_mr_entry_get(*entry);
+	pthread_rwlock_unlock(&cache->tree_lock);
+
+	if (hit) {
+		util_mr_cache_stat_inc(&cache->search_cnt);
+		util_mr_cache_stat_inc(&cache->hit_cnt);
+	}
+	return hit;
+}
+
 int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 			struct ofi_mr_entry **entry)
 {
@@ -356,6 +449,9 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 	FI_DBG(cache->prov, FI_LOG_MR, "search %p (len: %zu)\n",
 	       info->iov.iov_base, info->iov.iov_len);
 
+	if (util_mr_cache_search_shared(cache, monitor, info, entry))
+		return 0;
+
 	do {
 		pthread_mutex_lock(&mm_lock);
 		flush_lru = ofi_mr_cache_full(cache);
@@ -365,7 +461,7 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 			pthread_mutex_lock(&mm_lock);
 		}
 
-		cache->search_cnt++;
+		util_mr_cache_stat_inc(&cache->search_cnt);
 		*entry = ofi_mr_rbt_find(&cache->tree, info);
 
 		if (*entry &&
@@ -390,8 +486,8 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 	return ret;
 
 hit:
-	cache->hit_cnt++;
-	if ((*entry)->use_cnt++ == 0)
+	util_mr_cache_stat_inc(&cache->hit_cnt);
+	if (util_mr_entry_inc(*entry) == 1)
 		dlist_remove_init(&(*entry)->list_entry);
 	pthread_mutex_unlock(&mm_lock);
 	return 0;
@@ -417,7 +513,7 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 		pthread_mutex_lock(&mm_lock);
 	}
 
-	cache->search_cnt++;
+	util_mr_cache_stat_inc(&cache->search_cnt);
 
 	info.peer_id = 0;
 	ofi_mr_info_get_iov_from_mr_attr(&info, attr, flags);
@@ -430,8 +526,8 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 
 	if (ofi_iov_within(attr->mr_iov, &entry->info.iov) &&
 	    monitor->valid(monitor, entry->info.iov.iov_base, entry)) {
-		cache->hit_cnt++;
-		if ((entry)->use_cnt++ == 0)
+		util_mr_cache_stat_inc(&cache->hit_cnt);
+		if (util_mr_entry_inc(entry) == 1)
 			dlist_remove_init(&(entry)->list_entry);
 	} else {
 		while (entry) {
@@ -499,6 +595,7 @@ void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 	pthread_mutex_destroy(&cache->lock);
 	ofi_monitors_del_cache(cache);
 	ofi_rbmap_cleanup(&cache->tree);
+	pthread_rwlock_destroy(&cache->tree_lock);
 	if (cache->domain)
 		ofi_atomic_dec32(&cache->domain->ref);
 	ofi_bufpool_destroy(cache->entry_pool);
@@ -520,6 +617,7 @@ int ofi_mr_cache_init(struct util_domain *domain,
 		return -FI_ENOSPC;
 
 	pthread_mutex_init(&cache->lock, NULL);
+	pthread_rwlock_init(&cache->tree_lock, NULL);
 	dlist_init(&cache->lru_list);
 	dlist_init(&cache->dead_region_list);
 	cache->cached_cnt = 0;
@@ -561,6 +659,7 @@ destroy:
 		ofi_atomic_dec32(&cache->domain->ref);
 		cache->domain = NULL;
 	}
+	pthread_rwlock_destroy(&cache->tree_lock);
 	pthread_mutex_destroy(&cache->lock);
 	cache->prov = NULL;
 	return ret;
@@ -36,6 +36,8 @@
 #include "ofi_iov.h"
 #include "ofi_util.h"
 
+#define UTIL_SRX_MIN_HASH_SIZE	64
+
 static struct util_rx_entry *util_alloc_rx_entry(struct util_srx_ctx *srx)
 {
 	return (struct util_rx_entry *) ofi_buf_alloc(srx->rx_pool);
@@ -243,38 +245,84 @@ static int util_get_msg(struct fid_peer_srx *srx,
 	return FI_SUCCESS;
 }
 
-static int util_match_tag(struct fid_peer_srx *srx,
-			  struct fi_peer_match_attr *attr,
-			  struct fi_peer_rx_entry **rx_entry)
+static inline size_t util_srx_hash(struct util_srx_ctx *srx, fi_addr_t addr,
+				   uint64_t tag)
 {
-	struct util_srx_ctx *srx_ctx;
-	struct util_rx_entry *util_entry;
-	struct slist_entry *item, *prev;
-	int ret = FI_SUCCESS;
+	uint64_t key = tag ^ (addr * 0x9e3779b97f4a7c15ULL);
 
-	srx_ctx = srx->ep_fid.fid.context;
-	slist_foreach(&srx_ctx->tag_queue, item, prev) {
-		util_entry = container_of(item, struct util_rx_entry,
-					  peer_entry);
-		if (ofi_match_tag(util_entry->peer_entry.tag,
-				  util_entry->ignore, attr->tag)) {
-			util_entry->peer_entry.srx = srx;
-			srx_ctx->update_func(srx_ctx, util_entry);
-			slist_remove(&srx_ctx->tag_queue, item, prev);
-			goto out;
-		}
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (size_t) key & srx->tag_hash_mask;
+}
+
+static inline struct dlist_entry *
+util_srx_tag_bucket(struct util_srx_ctx *srx, fi_addr_t addr, uint64_t tag)
+{
+	return &srx->tag_hash[util_srx_hash(srx, addr, tag)];
+}
+
+static inline struct dlist_entry *
+util_srx_unexp_bucket(struct util_srx_ctx *srx, uint64_t tag)
+{
+	return &srx->unexp_tag_hash[util_srx_hash(srx, FI_ADDR_UNSPEC, tag)];
+}
+
+static void util_insert_posted_tag(struct util_srx_ctx *srx,
+				   struct util_rx_entry *rx_entry)
+{
+	struct dlist_entry *queue;
+
+	if (!rx_entry->ignore)
+		queue = util_srx_tag_bucket(srx, rx_entry->peer_entry.addr,
+					    rx_entry->peer_entry.tag);
+	else if (rx_entry->peer_entry.addr == FI_ADDR_UNSPEC)
+		queue = &srx->tag_queue;
+	else
+		queue = ofi_array_at(&srx->src_trecv_queues,
+				     rx_entry->peer_entry.addr);
+	assert(queue);
+	dlist_insert_tail((struct dlist_entry *) &rx_entry->peer_entry, queue);
+}
+
+/* Return the older of best and the first exact (addr, tag) receive posted
+ * to the matching hash bucket.
+ */
+static struct util_rx_entry *util_search_exact_tag(struct util_srx_ctx *srx,
+		fi_addr_t addr, uint64_t tag, struct util_rx_entry *best)
+{
+	struct util_rx_entry *rx_entry;
+	struct dlist_entry *item;
+
+	dlist_foreach(util_srx_tag_bucket(srx, addr, tag), item) {
+		rx_entry = container_of(item, struct util_rx_entry, peer_entry);
+		if (rx_entry->peer_entry.addr != addr ||
+		    rx_entry->peer_entry.tag != tag)
+			continue;
+
+		return (!best || rx_entry->seq_no < best->seq_no) ?
+			rx_entry : best;
 	}
+	return best;
+}
 
-	util_entry = util_init_unexp(srx_ctx, attr, FI_TAGGED | FI_RECV);
-	if (!util_entry)
-		return -FI_ENOMEM;
-	ret = -FI_ENOENT;
-	util_entry->peer_entry.srx = srx;
-out:
-	util_entry->peer_entry.msg_size = MIN(util_entry->peer_entry.msg_size,
-					      attr->msg_size);
-	*rx_entry = &util_entry->peer_entry;
-	return ret;
+/* Wildcard lists are in posting order, so stop once past best. */
+static struct util_rx_entry *util_search_wild_tag(struct dlist_entry *queue,
+		uint64_t tag, struct util_rx_entry *best)
+{
+	struct util_rx_entry *rx_entry;
+	struct dlist_entry *item;
+
+	dlist_foreach(queue, item) {
+		rx_entry = container_of(item, struct util_rx_entry, peer_entry);
+		if (best && rx_entry->seq_no > best->seq_no)
+			break;
+
+		if (ofi_match_tag(rx_entry->peer_entry.tag, rx_entry->ignore,
+				  tag))
+			return rx_entry;
+	}
+	return best;
 }
 
 static int util_get_tag(struct fid_peer_srx *srx,
@@ -282,50 +330,41 @@ static int util_get_tag(struct fid_peer_srx *srx,
 			struct fi_peer_rx_entry **rx_entry)
 {
 	struct util_srx_ctx *srx_ctx;
-	struct slist *queue;
-	struct slist_entry *any_item, *any_prev;
-	struct slist_entry *item, *prev;
-	struct util_rx_entry *util_entry, *any_entry;
+	struct util_rx_entry *util_entry = NULL;
+	struct dlist_entry *queue;
 	int ret = FI_SUCCESS;
 
 	srx_ctx = srx->ep_fid.fid.context;
 	assert(ofi_genlock_held(srx_ctx->lock));
 
-	queue = attr->addr == FI_ADDR_UNSPEC ? NULL:
-		ofi_array_at(&srx_ctx->src_trecv_queues, attr->addr);
-
-	if (!queue || slist_empty(queue))
-		return util_match_tag(srx, attr, rx_entry);
-
-	slist_foreach(queue, item, prev) {
-		util_entry = container_of(item, struct util_rx_entry,
-					  peer_entry);
-		if (ofi_match_tag(util_entry->peer_entry.tag,
-				  util_entry->ignore, attr->tag))
-			goto check_any;
+	if (srx_ctx->dir_recv && attr->addr != FI_ADDR_UNSPEC) {
+		util_entry = util_search_exact_tag(srx_ctx, attr->addr,
+						   attr->tag, NULL);
+		queue = ofi_array_at(&srx_ctx->src_trecv_queues, attr->addr);
+		if (queue)
+			util_entry = util_search_wild_tag(queue, attr->tag,
+							  util_entry);
 	}
-	return util_match_tag(srx, attr, rx_entry);
-
-check_any:
-	slist_foreach(&srx_ctx->tag_queue, any_item, any_prev) {
-		any_entry = container_of(any_item, struct util_rx_entry,
-					 peer_entry);
-		if (any_entry->seq_no > util_entry->seq_no)
-			break;
+	util_entry = util_search_exact_tag(srx_ctx, FI_ADDR_UNSPEC, attr->tag,
+					   util_entry);
+	util_entry = util_search_wild_tag(&srx_ctx->tag_queue, attr->tag,
+					  util_entry);
 
-		if (ofi_match_tag(any_entry->peer_entry.tag, any_entry->ignore,
-				  attr->tag)) {
-			queue = &srx_ctx->tag_queue;
-			util_entry = any_entry;
-			item = any_item;
-			prev = any_prev;
-			break;
-		}
+	if (util_entry) {
+		dlist_remove((struct dlist_entry *) &util_entry->peer_entry);
+		util_entry->peer_entry.srx = srx;
+		srx_ctx->update_func(srx_ctx, util_entry);
+	} else {
+		util_entry = util_init_unexp(srx_ctx, attr,
+					     FI_TAGGED | FI_RECV);
+		if (!util_entry)
+			return -FI_ENOMEM;
+		ret = -FI_ENOENT;
+		util_entry->peer_entry.srx = srx;
 	}
-	util_entry->peer_entry.srx = srx;
-	srx_ctx->update_func(srx_ctx, util_entry);
+	util_entry->peer_entry.msg_size = MIN(util_entry->peer_entry.msg_size,
+					      attr->msg_size);
 	*rx_entry = &util_entry->peer_entry;
-	slist_remove(queue, item, prev);
 	return ret;
 }
 
@@ -355,10 +394,12 @@ static int util_queue_msg(struct fi_peer_rx_entry *rx_entry)
 static int util_queue_tag(struct fi_peer_rx_entry *rx_entry)
 {
 	struct util_srx_ctx *srx_ctx = rx_entry->srx->ep_fid.fid.context;
+	struct util_rx_entry *util_entry;
 	struct util_unexp_peer *unexp_peer;
 
 	assert(ofi_genlock_held(srx_ctx->lock));
 
+	util_entry = container_of(rx_entry, struct util_rx_entry, peer_entry);
 	if (rx_entry->addr == FI_ADDR_UNSPEC) {
 		dlist_insert_tail((struct dlist_entry *) rx_entry,
 				  &srx_ctx->unspec_unexp_tag_queue);
@@ -366,13 +407,15 @@ static int util_queue_tag(struct fi_peer_rx_entry *rx_entry)
 		unexp_peer = ofi_array_at(&srx_ctx->src_unexp_peers,
 					  rx_entry->addr);
 		assert(unexp_peer);
-		slist_insert_tail((struct slist_entry *) rx_entry,
+		dlist_insert_tail((struct dlist_entry *) rx_entry,
 				  &unexp_peer->tag_queue);
 		if (!unexp_peer->cnt++)
 			dlist_insert_tail(&unexp_peer->entry,
 					  &srx_ctx->unexp_peers);
 
 	}
+	dlist_insert_tail(&util_entry->hash_entry,
+			  util_srx_unexp_bucket(srx_ctx, rx_entry->tag));
 	return FI_SUCCESS;
 }
 
@@ -440,7 +483,7 @@ static void util_foreach_unspec(struct fid_peer_srx *srx,
 		unexp_peer = ofi_array_at(&srx_ctx->src_unexp_peers,
 					  rx_entry->addr);
 		assert(unexp_peer);
-		slist_insert_tail((struct slist_entry *) rx_entry,
+		dlist_insert_tail((struct dlist_entry *) rx_entry,
 				  &unexp_peer->tag_queue);
 		if (!unexp_peer->cnt++)
 			dlist_insert_tail(&unexp_peer->entry,
@@ -574,29 +617,54 @@ out:
 	return ret;
 }
 
+static void util_remove_unexp_tag(struct util_srx_ctx *srx,
+				  struct util_rx_entry *rx_entry)
+{
+	struct util_unexp_peer *unexp_peer;
+
+	dlist_remove(&rx_entry->hash_entry);
+	dlist_remove((struct dlist_entry *) &rx_entry->peer_entry);
+	if (rx_entry->peer_entry.addr == FI_ADDR_UNSPEC)
+		return;
+
+	unexp_peer = ofi_array_at(&srx->src_unexp_peers,
+				  rx_entry->peer_entry.addr);
+	assert(unexp_peer);
+	if (!--unexp_peer->cnt) {
+		assert(dlist_empty(&unexp_peer->tag_queue));
+		dlist_remove(&unexp_peer->entry);
+	}
+}
+
 static struct util_rx_entry *util_search_peer_tag(struct util_unexp_peer *peer,
-				uint64_t tag, uint64_t ignore, bool remove)
+						  uint64_t tag, uint64_t ignore)
 {
 	struct util_rx_entry *rx_entry;
-	struct slist_entry *item, *prev;
+	struct dlist_entry *item;
 
 	assert(peer);
-	if (slist_empty(&peer->tag_queue))
-		return NULL;
+	dlist_foreach(&peer->tag_queue, item) {
+		rx_entry = container_of(item, struct util_rx_entry, peer_entry);
+		if (ofi_match_tag(tag, ignore, rx_entry->peer_entry.tag))
+			return rx_entry;
+	}
+	return NULL;
+}
 
-	slist_foreach(&peer->tag_queue, item, prev) {
-		rx_entry = (struct util_rx_entry *) item;
-		if (!ofi_match_tag(tag, ignore, rx_entry->peer_entry.tag))
-			continue;
+/* Messages in a bucket are in arrival order, so the first hit is the oldest
+ * message from addr (or from any source) carrying this exact tag.
+ */
+static struct util_rx_entry *util_search_unexp_bucket(struct util_srx_ctx *srx,
+						fi_addr_t addr, uint64_t tag)
+{
+	struct util_rx_entry *rx_entry;
 
-		if (remove) {
-			slist_remove(&peer->tag_queue, item, prev);
-			if (!--peer->cnt) {
-				assert(slist_empty(&peer->tag_queue));
-				dlist_remove(&peer->entry);
-			}
-		}
-		return rx_entry;
+	dlist_foreach_container(util_srx_unexp_bucket(srx, tag),
+				struct util_rx_entry, rx_entry, hash_entry) {
+		if (rx_entry->peer_entry.tag == tag &&
+		    (addr == FI_ADDR_UNSPEC ||
+		     rx_entry->peer_entry.addr == addr))
+			return rx_entry;
 	}
 	return NULL;
 }
@@ -604,36 +672,40 @@ static struct util_rx_entry *util_search_peer_tag(struct util_unexp_peer *peer,
 static struct util_rx_entry *util_search_unexp_tag(struct util_srx_ctx *srx,
 		fi_addr_t addr, uint64_t tag, uint64_t ignore, bool remove)
 {
-	struct util_rx_entry *rx_entry;
+	struct util_rx_entry *rx_entry = NULL;
 	struct util_unexp_peer *unexp_peer;
 	struct dlist_entry *entry;
 
-	if (addr == FI_ADDR_UNSPEC) {
-		dlist_foreach(&srx->unspec_unexp_tag_queue, entry) {
-			rx_entry = container_of(entry, struct util_rx_entry,
-						peer_entry);
-			if (!ofi_match_tag(tag, ignore,
-			    rx_entry->peer_entry.tag))
-				continue;
-
-			if (remove)
-				dlist_remove(entry);
+	if (!ignore) {
+		rx_entry = util_search_unexp_bucket(srx, addr, tag);
+		goto out;
+	}
 
-			return rx_entry;
-		}
+	if (addr != FI_ADDR_UNSPEC) {
+		rx_entry = util_search_peer_tag(
+				ofi_array_at(&srx->src_unexp_peers, addr),
+				tag, ignore);
+		goto out;
+	}
 
-		dlist_foreach_container(&srx->unexp_peers,
-				struct util_unexp_peer, unexp_peer, entry) {
-			rx_entry = util_search_peer_tag(unexp_peer, tag,
-							ignore, remove);
-			if (rx_entry)
-				return rx_entry;
-		}
-		return NULL;
+	dlist_foreach(&srx->unspec_unexp_tag_queue, entry) {
+		rx_entry = container_of(entry, struct util_rx_entry,
+					peer_entry);
+		if (ofi_match_tag(tag, ignore, rx_entry->peer_entry.tag))
+			goto out;
 	}
+	rx_entry = NULL;
 
-	return util_search_peer_tag(ofi_array_at(&srx->src_unexp_peers, addr),
-				    tag, ignore, remove);
+	dlist_foreach_container(&srx->unexp_peers, struct util_unexp_peer,
+				unexp_peer, entry) {
+		rx_entry = util_search_peer_tag(unexp_peer, tag, ignore);
+		if (rx_entry)
+			break;
+	}
+out:
+	if (rx_entry && remove)
+		util_remove_unexp_tag(srx, rx_entry);
+	return rx_entry;
 }
 
 static ssize_t util_srx_peek(struct util_srx_ctx *srx, const struct iovec *iov,
@@ -678,7 +750,6 @@ ssize_t util_srx_generic_trecv(struct fid_ep *ep_fid, const struct iovec *iov,
 {
 	struct util_srx_ctx *srx;
 	struct util_rx_entry *rx_entry;
-	struct slist *queue;
 	ssize_t ret = FI_SUCCESS;
 
 	srx = container_of(ep_fid, struct util_srx_ctx, peer_srx.ep_fid);
@@ -715,9 +786,6 @@ ssize_t util_srx_generic_trecv(struct fid_ep *ep_fid, const struct iovec *iov,
 	} else {
 		rx_entry = util_search_unexp_tag(srx, addr, tag, ignore, true);
 		if (!rx_entry) {
-			queue = addr == FI_ADDR_UNSPEC ? &srx->tag_queue:
-				ofi_array_at(&srx->src_trecv_queues, addr);
-			assert(queue);
 			rx_entry = util_get_recv_entry(srx, iov, desc,
 						iov_count, addr, context, tag,
 						ignore,
@@ -725,9 +793,7 @@ ssize_t util_srx_generic_trecv(struct fid_ep *ep_fid, const struct iovec *iov,
 			if (!rx_entry)
 				ret = -FI_ENOMEM;
 			else
-				slist_insert_tail((struct slist_entry *)
-						  (&rx_entry->peer_entry),
-						  queue);
+				util_insert_posted_tag(srx, rx_entry);
 			goto out;
 		}
 	}
@@ -943,12 +1009,31 @@ static int util_cleanup_queues(struct ofi_dyn_arr *arr, void *list,
 	return FI_SUCCESS;
 }
 
+static void util_cleanup_tag_queue(struct dlist_entry *queue)
+{
+	struct util_rx_entry *rx_entry;
+
+	while (!dlist_empty(queue)) {
+		dlist_pop_front(queue, struct util_rx_entry, rx_entry,
+				peer_entry);
+		ofi_buf_free(rx_entry);
+	}
+}
+
+static int util_cleanup_tag_queues(struct ofi_dyn_arr *arr, void *list,
+				   void *context)
+{
+	util_cleanup_tag_queue(list);
+	return FI_SUCCESS;
+}
+
 int util_srx_close(struct fid *fid)
 {
 	struct util_srx_ctx *srx;
 	struct util_unexp_peer *unexp_peer;
 	struct util_rx_entry *rx_entry;
 	struct slist_entry *entry;
+	size_t i;
 
 	srx = container_of(fid, struct util_srx_ctx, peer_srx.ep_fid.fid);
 	if (!srx)
@@ -956,7 +1041,8 @@ int util_srx_close(struct fid *fid)
 
 	ofi_genlock_lock(srx->lock);
 	(void)ofi_array_iter(&srx->src_recv_queues, srx, util_cleanup_queues);
-	(void)ofi_array_iter(&srx->src_trecv_queues, srx, util_cleanup_queues);
+	(void)ofi_array_iter(&srx->src_trecv_queues, srx,
+			     util_cleanup_tag_queues);
 	ofi_array_destroy(&srx->src_recv_queues);
 	ofi_array_destroy(&srx->src_trecv_queues);
 
@@ -966,11 +1052,9 @@ int util_srx_close(struct fid *fid)
 				          peer_entry));
 	}
 
-	while (!slist_empty(&srx->tag_queue)) {
-		entry = slist_remove_head(&srx->tag_queue);
-		ofi_buf_free(container_of(entry, struct util_rx_entry,
-				          peer_entry));
-	}
+	util_cleanup_tag_queue(&srx->tag_queue);
+	for (i = 0; i <= srx->tag_hash_mask; i++)
+		util_cleanup_tag_queue(&srx->tag_hash[i]);
 
 	while (!dlist_empty(&srx->unspec_unexp_msg_queue)) {
 		dlist_pop_front(&srx->unspec_unexp_msg_queue,
@@ -1000,10 +1084,10 @@ int util_srx_close(struct fid *fid)
 			ofi_buf_free(rx_entry);
 			unexp_peer->cnt--;
 		}
-		while (!slist_empty(&unexp_peer->tag_queue)) {
-			rx_entry = container_of(slist_remove_head(
-				&unexp_peer->tag_queue), struct util_rx_entry,
-				peer_entry);
+		while (!dlist_empty(&unexp_peer->tag_queue)) {
+			dlist_pop_front(&unexp_peer->tag_queue,
+					struct util_rx_entry, rx_entry,
+					peer_entry);
 			rx_entry->peer_entry.srx->peer_ops->discard_tag(
 							&rx_entry->peer_entry);
 			ofi_buf_free(rx_entry);
@@ -1018,6 +1102,8 @@ int util_srx_close(struct fid *fid)
 	ofi_bufpool_destroy(srx->rx_pool);
 
 	ofi_genlock_unlock(srx->lock);
+	free(srx->tag_hash);
+	free(srx->unexp_tag_hash);
 	free(srx);
 
 	return FI_SUCCESS;
@@ -1056,38 +1142,67 @@ static int util_cancel_recv(struct util_srx_ctx *srx, struct slist *queue,
 	return -FI_ENOENT;
 }
 
+static int util_cancel_tag_recv(struct util_srx_ctx *srx,
+				struct dlist_entry *queue, void *context)
+{
+	struct dlist_entry *item;
+	struct util_rx_entry *rx_entry;
+
+	assert(ofi_genlock_held(srx->lock));
+	dlist_foreach(queue, item) {
+		rx_entry = container_of(item, struct util_rx_entry, peer_entry);
+		if (rx_entry->peer_entry.context == context) {
+			dlist_remove(item);
+			util_cancel_entry(srx, FI_TAGGED | FI_RECV, rx_entry);
+			return FI_SUCCESS;
+		}
+	}
+	return -FI_ENOENT;
+}
+
 static int util_cancel_src(struct ofi_dyn_arr *arr, void *list, void *context)
 {
 	struct util_srx_ctx *srx;
-	struct slist *queue = list;
-	uint64_t flags;
 
-	srx = container_of(arr, struct util_srx_ctx, src_trecv_queues);
+	srx = container_of(arr, struct util_srx_ctx, src_recv_queues);
+	return (int) (util_cancel_recv(srx, list, FI_MSG | FI_RECV,
+				       context) == FI_SUCCESS);
+}
 
-	flags = arr == &srx->src_trecv_queues ?
-		FI_TAGGED | FI_RECV : FI_MSG | FI_RECV;
+static int util_cancel_src_tag(struct ofi_dyn_arr *arr, void *list,
+			       void *context)
+{
+	struct util_srx_ctx *srx;
 
-	return (int) (util_cancel_recv(srx, queue, flags, context) == FI_SUCCESS);
+	srx = container_of(arr, struct util_srx_ctx, src_trecv_queues);
+	return (int) (util_cancel_tag_recv(srx, list, context) == FI_SUCCESS);
 }
 
 static ssize_t util_srx_cancel(fid_t ep_fid, void *context)
 {
 	struct util_srx_ctx *srx;
 	ssize_t ret;
+	size_t i;
 
 	srx = container_of(ep_fid, struct util_srx_ctx, peer_srx.ep_fid);
 
 	ofi_genlock_lock(srx->lock);
-	ret = util_cancel_recv(srx, &srx->tag_queue, FI_TAGGED | FI_RECV,
-			       context);
+	ret = util_cancel_tag_recv(srx, &srx->tag_queue, context);
 	if (ret != -FI_ENOENT)
 		goto out;
 
+	for (i = 0; i <= srx->tag_hash_mask; i++) {
+		ret = util_cancel_tag_recv(srx, &srx->tag_hash[i], context);
+		if (ret != -FI_ENOENT)
+			goto out;
+	}
+
 	ret = util_cancel_recv(srx, &srx->msg_queue, FI_MSG | FI_RECV, context);
 	if (ret != -FI_ENOENT)
 		goto out;
 
-	if (ofi_array_iter(&srx->src_trecv_queues, context, util_cancel_src) ||
+	if (ofi_array_iter(&srx->src_trecv_queues, context,
+			   util_cancel_src_tag) ||
 	    ofi_array_iter(&srx->src_recv_queues, context, util_cancel_src)) {
 		/* nothing to do, always return success */
 	}
@@ -1154,12 +1269,17 @@ static void util_srx_init_slist(struct ofi_dyn_arr *arr, void *item)
 	slist_init((struct slist *) item);
 }
 
+static void util_srx_init_dlist(struct ofi_dyn_arr *arr, void *item)
+{
+	dlist_init((struct dlist_entry *) item);
+}
+
 static void util_srx_init_unexp_peer(struct ofi_dyn_arr *arr, void *item)
 {
 	struct util_unexp_peer *unexp_peer = item;
 
 	slist_init(&unexp_peer->msg_queue);
-	slist_init(&unexp_peer->tag_queue);
+	dlist_init(&unexp_peer->tag_queue);
 	unexp_peer->cnt = 0;
 }
 
@@ -1170,12 +1290,27 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 {
 	struct util_srx_ctx *srx;
 	struct ofi_bufpool_attr pool_attr = {0};
+	size_t i, hash_size;
 	int ret = FI_SUCCESS;
 
 	srx = calloc(1, sizeof(*srx));
 	if (!srx)
 		return -FI_ENOMEM;
 
+	hash_size = roundup_power_of_two(MAX(rx_size, UTIL_SRX_MIN_HASH_SIZE));
+	srx->tag_hash = calloc(hash_size, sizeof(*srx->tag_hash));
+	srx->unexp_tag_hash = calloc(hash_size, sizeof(*srx->unexp_tag_hash));
+	if (!srx->tag_hash || !srx->unexp_tag_hash) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < hash_size; i++) {
+		dlist_init(&srx->tag_hash[i]);
+		dlist_init(&srx->unexp_tag_hash[i]);
+	}
+	srx->tag_hash_mask = hash_size - 1;
+
 	ofi_array_init(&srx->src_unexp_peers, sizeof(struct util_unexp_peer),
 		       util_srx_init_unexp_peer);
 	dlist_init(&srx->unspec_unexp_msg_queue);
@@ -1184,11 +1319,11 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 
 	ofi_array_init(&srx->src_recv_queues, sizeof(struct slist),
 		       util_srx_init_slist);
-	ofi_array_init(&srx->src_trecv_queues, sizeof(struct slist),
-		       util_srx_init_slist);
+	ofi_array_init(&srx->src_trecv_queues, sizeof(struct dlist_entry),
+		       util_srx_init_dlist);
 
 	slist_init(&srx->msg_queue);
-	slist_init(&srx->tag_queue);
+	dlist_init(&srx->tag_queue);
 
 	//each entry has the iovs and descriptors stored at the end of the entry
 	//calculate how much space each entry needs based on provider iov limits
@@ -1201,10 +1336,8 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 	pool_attr.init_fn = util_rx_entry_init;
 	pool_attr.context = srx;
 	ret = ofi_bufpool_create_attr(&pool_attr, &srx->rx_pool);
-	if (ret) {
-		free(srx);
-		return ret;
-	}
+	if (ret)
+		goto err;
 
 	srx->min_multi_recv_size = default_min_multi_recv;
 	srx->iov_limit = iov_limit;
@@ -1226,4 +1359,10 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 
 	domain->srx = &srx->peer_srx;
 	return FI_SUCCESS;
+
+err:
+	free(srx->tag_hash);
+	free(srx->unexp_tag_hash);
+	free(srx);
+	return ret;
 }
@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sys/time.h>
 #include <sched.h>
 
@@ -157,11 +158,20 @@ int ofi_wait_init(struct util_fabric *fabric, struct fi_wait_attr *attr,
 	wait->pollset = container_of(poll_fid, struct util_poll, poll_fid);
 	ofi_mutex_init(&wait->lock);
 	dlist_init(&wait->fid_list);
+	ofi_atomic_initialize32(&wait->seq, 0);
+	ofi_atomic_initialize32(&wait->sleepers, 0);
 	wait->fabric = fabric;
 	ofi_atomic_inc32(&fabric->ref);
 	return 0;
 }
 
+static void ofi_wait_seq_signal(struct util_wait *wait)
+{
+	ofi_atomic_inc32(&wait->seq);
+	if (ofi_atomic_get32(&wait->sleepers))
+		ofi_futex_wake((uint32_t *) ofi_atomic_ptr(&wait->seq), INT_MAX);
+}
+
 static int ofi_wait_match_fd(struct dlist_entry *item, const void *arg)
 {
 	struct ofi_wait_fd_entry *fd_entry;
@@ -264,6 +274,7 @@ int ofi_wait_add_fd(struct util_wait *wait, int fd, uint32_t events,
 	ofi_atomic_initialize32(&fd_entry->ref, 1);
 
 	dlist_insert_tail(&fd_entry->entry, &wait_fd->fd_list);
+	ofi_wait_seq_signal(wait);
 out:
 	ofi_mutex_unlock(&wait->lock);
 	return ret;
@@ -274,6 +285,37 @@ static void util_wait_fd_signal(struct util_wait *util_wait)
 	struct util_wait_fd *wait;
 	wait = container_of(util_wait, struct util_wait_fd, util_wait);
 	fd_signal_set(&wait->signal);
+	ofi_wait_seq_signal(util_wait);
+}
+
+/*
+ * Sleep until the wait object is signaled after seq was read by the caller.
+ * Callers read seq before checking for events, so a signal that arrives in
+ * between is never lost, regardless of how many threads share the wait
+ * object.  This is only usable when the wait object has nothing to wait on
+ * other than its own signal, i.e. no provider fds or fids were added to it.
+ * Otherwise, -FI_ENOSYS is returned and the caller must use ofi_wait().
+ */
+int ofi_wait_seq_wait(struct util_wait *wait, uint32_t seq, int timeout)
+{
+	struct util_wait_fd *wait_fd;
+	int ret;
+
+	if (wait->wait_obj != FI_WAIT_FD && wait->wait_obj != FI_WAIT_POLLFD)
+		return -FI_ENOSYS;
+
+	wait_fd = container_of(wait, struct util_wait_fd, util_wait);
+	ofi_atomic_inc32(&wait->sleepers);
+	if (!dlist_empty(&wait->fid_list) || !dlist_empty(&wait_fd->fd_list)) {
+		ret = -FI_ENOSYS;
+		goto out;
+	}
+
+	ret = ofi_futex_wait((uint32_t *) ofi_atomic_ptr(&wait->seq), seq,
+			     timeout);
+out:
+	ofi_atomic_dec32(&wait->sleepers);
+	return ret;
 }
 
 static int util_wait_update_pollfd(struct util_wait_fd *wait_fd,
@@ -874,6 +916,7 @@ int ofi_wait_add_fid(struct util_wait *wait, fid_t fid, uint32_t events,
 		}
 	}
 	dlist_insert_tail(&fid_entry->entry, &wait->fid_list);
+	ofi_wait_seq_signal(wait);
 out:
 	ofi_mutex_unlock(&wait->lock);
 	return ret;
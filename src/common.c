@@ -86,6 +86,7 @@ struct ofi_common_locks common_locks = {
 
 size_t ofi_universe_size = 1024;
 int ofi_av_remove_cleanup;
+size_t ofi_cq_lockfree_size;
 char *ofi_offload_coll_prov_name = NULL;
 
 
@@ -1293,6 +1294,12 @@ int ofi_bsock_recv(struct ofi_bsock *bsock, void *buf, size_t *len)
 		*len -= bytes;
 	}
 
+	/* Data arrives through the owner's multishot receive into rq */
+	if (bsock->mshot) {
+		*len = bytes;
+		return bytes ? 0 : -FI_EAGAIN;
+	}
+
 	assert(!ofi_bsock_readable(bsock));
 	if (*len < (bsock->rq.size >> 1)) {
 		avail = ofi_byteq_writeable(&bsock->rq);
@@ -1352,6 +1359,12 @@ int ofi_bsock_recvv(struct ofi_bsock *bsock, struct iovec *iov, size_t cnt,
 		bytes = 0;
 	}
 
+	/* Data arrives through the owner's multishot receive into rq */
+	if (bsock->mshot) {
+		*len = bytes;
+		return bytes ? 0 : -FI_EAGAIN;
+	}
+
 	assert(!ofi_bsock_readable(bsock));
 	if (*len < (bsock->rq.size >> 1)) {
 		avail = ofi_byteq_writeable(&bsock->rq);
@@ -42,6 +42,7 @@
 #include <string.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include <rdma/fi_errno.h>
 #include "ofi_util.h"
@@ -51,8 +52,10 @@
 #include "ofi_perf.h"
 #include "ofi_hmem.h"
 #include "ofi_mr.h"
+#include "ofi_atomic.h"
 #include <ofi_shm_p2p.h>
 #include <rdma/fi_ext.h>
+#include "fasthash.h"
 
 #ifdef HAVE_LIBDL
 #include <dlfcn.h>
@@ -66,6 +69,15 @@ struct ofi_prov {
 	void			*dlhandle;
 	bool			hidden;
 	bool			preferred;
+	bool			probed;
+};
+
+/* Provider library found in the provider path that has not been opened */
+struct ofi_dl_lib {
+	struct ofi_dl_lib	*next;
+	char			*path;
+	char			*prov_name;
+	bool			known_to_exist;
 };
 
 enum ofi_prov_order {
@@ -81,6 +93,10 @@ struct ofi_info_match {
 static struct ofi_prov *prov_head, *prov_tail;
 static enum ofi_prov_order prov_order = OFI_PROV_ORDER_VERSION;
 static bool prov_preferred = false;
+static struct ofi_dl_lib *dl_lib_head, *dl_lib_tail;
+static int prov_lazy_load = 1;
+static char **hooks;
+static size_t hook_cnt;
 int ofi_init = 0;
 extern struct ofi_common_locks common_locks;
 
@@ -570,6 +586,14 @@ static void ofi_register_provider(struct fi_provider *provider, void *dlhandle)
 	    ofi_is_util_prov(provider))
 		ofi_prov_ctx(provider)->disable_layering = true;
 
+	/* These providers derive default addresses from the process id, so
+	 * their fi_getinfo() results cannot be shared between processes.
+	 */
+	if (!strcasecmp(provider->name, "shm") ||
+	    !strcasecmp(provider->name, "sm2") ||
+	    ofi_is_lnx_prov(provider))
+		ofi_prov_ctx(provider)->disable_info_cache = true;
+
 	prov = ofi_getprov(provider->name, strlen(provider->name));
 	if (prov && !prov->provider) {
 		ofi_init_prov(prov, provider, dlhandle);
@@ -686,6 +710,179 @@ static void ofi_reg_dl_prov(const char *lib, bool lib_known_to_exist)
 	}
 }
 
+static bool ofi_is_core_name(const char *name)
+{
+	return !ofi_has_util_prefix(name) && !ofi_has_offload_prefix(name) &&
+	       !ofi_is_linked(name);
+}
+
+/*
+ * Map a library file name, such as librxm-fi.so, to the name of the
+ * provider it is expected to contain, such as ofi_rxm.
+ */
+static char *ofi_dl_lib_prov_name(const char *lib)
+{
+	const char *base, *short_name;
+	struct ofi_prov *prov;
+	size_t len;
+
+	base = strrchr(lib, '/');
+	base = base ? base + 1 : lib;
+	if (!strncmp(base, "lib", 3))
+		base += 3;
+
+	len = strlen(base);
+	if (len > sizeof(FI_LIB_SUFFIX) - 1)
+		len -= sizeof(FI_LIB_SUFFIX) - 1;
+	if (len && base[len - 1] == '-')
+		len--;
+
+	for (prov = prov_head; prov; prov = prov->next) {
+		if (ofi_has_util_prefix(prov->prov_name))
+			short_name = prov->prov_name + strlen(OFI_UTIL_PREFIX);
+		else if (ofi_has_offload_prefix(prov->prov_name))
+			short_name = prov->prov_name + strlen(OFI_OFFLOAD_PREFIX);
+		else
+			short_name = prov->prov_name;
+
+		if (strlen(short_name) == len &&
+		    !strncasecmp(short_name, base, len))
+			return strdup(prov->prov_name);
+	}
+
+	return strndup(base, len);
+}
+
+static void ofi_add_dl_prov(const char *lib, const char *prov_name,
+			    bool lib_known_to_exist)
+{
+	struct ofi_dl_lib *dl_lib;
+
+	if (!prov_lazy_load)
+		goto load;
+
+	dl_lib = calloc(1, sizeof(*dl_lib));
+	if (!dl_lib)
+		goto load;
+
+	dl_lib->path = strdup(lib);
+	dl_lib->prov_name = prov_name ? strdup(prov_name) :
+			    ofi_dl_lib_prov_name(lib);
+	if (!dl_lib->path || !dl_lib->prov_name) {
+		free(dl_lib->path);
+		free(dl_lib->prov_name);
+		free(dl_lib);
+		goto load;
+	}
+
+	dl_lib->known_to_exist = lib_known_to_exist;
+	if (dl_lib_tail)
+		dl_lib_tail->next = dl_lib;
+	else
+		dl_lib_head = dl_lib;
+	dl_lib_tail = dl_lib;
+
+	FI_DBG(&core_prov, FI_LOG_CORE, "deferring load of provider %s: %s\n",
+	       dl_lib->prov_name, lib);
+	return;
+
+load:
+	ofi_reg_dl_prov(lib, lib_known_to_exist);
+}
+
+/*
+ * Decide if a deferred provider library may be needed to satisfy a call
+ * to fi_getinfo() that names the given providers.  Core providers that
+ * are excluded by FI_PROVIDER are only needed to report hidden providers.
+ * Otherwise, a library is needed if it is named, or if no other provider
+ * of the same kind (core versus utility) is named, since that allows any
+ * provider of that kind to be layered with the named ones.
+ */
+static bool ofi_dl_lib_needed(struct ofi_dl_lib *dl_lib, char **prov_vec,
+			      size_t count, uint64_t flags)
+{
+	bool core = ofi_is_core_name(dl_lib->prov_name);
+	bool kind_named = false;
+	size_t i;
+
+	if (core && !(flags & OFI_GETINFO_HIDDEN) &&
+	    ofi_apply_prov_init_filter(&prov_filter, dl_lib->prov_name))
+		return false;
+
+	for (i = 0; i < count; i++) {
+		if (prov_vec[i][0] == '^')
+			continue;
+
+		if (!strcasecmp(prov_vec[i], dl_lib->prov_name))
+			return true;
+
+		if (ofi_is_core_name(prov_vec[i]) == core)
+			kind_named = true;
+	}
+
+	return !kind_named;
+}
+
+static void ofi_load_dl_libs(char **prov_vec, size_t count, uint64_t flags)
+{
+	struct ofi_dl_lib *dl_lib, *prev, *next;
+
+	if (!dl_lib_head)
+		return;
+
+	pthread_mutex_lock(&common_locks.ini_lock);
+	for (prev = NULL, dl_lib = dl_lib_head; dl_lib; dl_lib = next) {
+		next = dl_lib->next;
+		if (!ofi_dl_lib_needed(dl_lib, prov_vec, count, flags)) {
+			prev = dl_lib;
+			continue;
+		}
+
+		if (prev)
+			prev->next = next;
+		else
+			dl_lib_head = next;
+		if (dl_lib_tail == dl_lib)
+			dl_lib_tail = prev;
+
+		ofi_reg_dl_prov(dl_lib->path, dl_lib->known_to_exist);
+		free(dl_lib->path);
+		free(dl_lib->prov_name);
+		free(dl_lib);
+	}
+	pthread_mutex_unlock(&common_locks.ini_lock);
+}
+
+static void ofi_free_dl_libs(void)
+{
+	struct ofi_dl_lib *dl_lib;
+
+	while (dl_lib_head) {
+		dl_lib = dl_lib_head;
+		dl_lib_head = dl_lib->next;
+		free(dl_lib->path);
+		free(dl_lib->prov_name);
+		free(dl_lib);
+	}
+	dl_lib_tail = NULL;
+}
+
+static uint64_t ofi_hash_dl_libs(uint64_t hash)
+{
+	struct ofi_dl_lib *dl_lib;
+	struct stat st;
+
+	for (dl_lib = dl_lib_head; dl_lib; dl_lib = dl_lib->next) {
+		hash = fasthash64(dl_lib->path, strlen(dl_lib->path), hash);
+		if (!stat(dl_lib->path, &st)) {
+			hash = fasthash64(&st.st_size, sizeof st.st_size, hash);
+			hash = fasthash64(&st.st_mtime, sizeof st.st_mtime,
+					  hash);
+		}
+	}
+	return hash;
+}
+
 static void ofi_ini_dir(const char *dir)
 {
 	int n;
@@ -702,7 +899,7 @@ static void ofi_ini_dir(const char *dir)
 			       "asprintf failed to allocate memory\n");
 			goto libdl_done;
 		}
-		ofi_reg_dl_prov(lib, true);
+		ofi_add_dl_prov(lib, NULL, true);
 
 		free(liblist[n]);
 		free(lib);
@@ -743,7 +940,7 @@ static void ofi_find_prov_libs(void)
 			continue;
 		}
 
-		ofi_reg_dl_prov(lib, false);
+		ofi_add_dl_prov(lib, prov->prov_name, false);
 		free(lib);
 	}
 }
@@ -802,6 +999,18 @@ static void ofi_load_dl_prov(void)
 
 	fi_param_get_str(NULL, "provider_path", &provdir);
 
+	fi_param_define(NULL, "provider_lazy_load", FI_PARAM_BOOL,
+			"Defer opening provider libraries until a call to "
+			"fi_getinfo() may need them.  Libraries of core "
+			"providers excluded by FI_PROVIDER, or of providers "
+			"other than those named in the hints, are not opened. "
+			"Lazy loading is disabled when FI_PROVIDER_PATH "
+			"requests discovery order or hooks are in use. "
+			"(default: true)");
+	fi_param_get_bool(NULL, "provider_lazy_load", &prov_lazy_load);
+	if (hook_cnt)
+		prov_lazy_load = 0;
+
 #if HAVE_RESTRICTED_DL
 	if (!provdir || !strlen(provdir)) {
 		FI_INFO(&core_prov, FI_LOG_CORE,
@@ -815,6 +1024,7 @@ static void ofi_load_dl_prov(void)
 		dirs = ofi_split_and_alloc(PROVDLDIR, ":", NULL);
 	} else if (provdir[0] == '@') {
 		prov_order = OFI_PROV_ORDER_REGISTER;
+		prov_lazy_load = 0;
 		if (strlen(provdir) == 1)
 			dirs = ofi_split_and_alloc(PROVDLDIR, ":", NULL);
 		else
@@ -859,10 +1069,25 @@ static void ofi_load_dl_prov(void)
 {
 }
 
+static void ofi_load_dl_libs(char **prov_vec, size_t count, uint64_t flags)
+{
+}
+
+static void ofi_free_dl_libs(void)
+{
+}
+
+static uint64_t ofi_hash_dl_libs(uint64_t hash)
+{
+	return hash;
+}
+
 #endif
 
-static char **hooks;
-static size_t hook_cnt;
+void ofi_load_lazy_provs(void)
+{
+	ofi_load_dl_libs(NULL, 0, OFI_GETINFO_HIDDEN);
+}
 
 /*
  * Call the fabric() interface of the hooking provider.  We pass in the
@@ -919,6 +1144,28 @@ static void ofi_hook_fini(void)
 		ofi_free_string_array(hooks);
 }
 
+/*
+ * Identify the set of available providers for the fi_getinfo() cache,
+ * including provider libraries that have not been opened yet.
+ */
+static uint64_t ofi_hash_provs(void)
+{
+	struct ofi_prov *prov;
+	uint64_t hash = 0;
+
+	for (prov = prov_head; prov; prov = prov->next) {
+		if (!prov->provider)
+			continue;
+
+		hash = fasthash64(prov->provider->name,
+				  strlen(prov->provider->name), hash);
+		hash = fasthash64(&prov->provider->version,
+				  sizeof(prov->provider->version), hash);
+	}
+
+	return ofi_hash_dl_libs(hash);
+}
+
 void fi_ini(void)
 {
 	char *param_val = NULL;
@@ -935,6 +1182,7 @@ void fi_ini(void)
 	ofi_osd_init();
 	ofi_mem_init();
 	ofi_pmem_init();
+	ofi_atomic_reduce_init();
 	ofi_perf_init();
 	ofi_hook_init();
 	ofi_hmem_init();
@@ -969,6 +1217,14 @@ void fi_ini(void)
 			"(default: false)");
 	fi_param_get_bool(NULL, "av_remove_cleanup", &ofi_av_remove_cleanup);
 
+	fi_param_define(NULL, "cq_lockfree_size", FI_PARAM_SIZE_T,
+			"Number of entries in a lock-free ring that threads "
+			"write completions to before they are moved to the "
+			"CQ by a reader.  Only used by CQs that are shared "
+			"between threads and are implemented with the "
+			"utility CQ.  (default: 0, disabled)");
+	fi_param_get_size_t(NULL, "cq_lockfree_size", &ofi_cq_lockfree_size);
+
 	fi_param_define(NULL, "offload_coll_provider", FI_PARAM_STRING,
 			"The name of a colective offload provider (default: \
 			empty - no provider)");
@@ -1006,6 +1262,8 @@ void fi_ini(void)
 
 	ofi_register_provider(COLL_INIT, NULL);
 
+	ofi_getinfo_cache_init(ofi_hash_provs());
+
 	pthread_atfork(NULL, NULL, ofi_memhooks_atfork_handler);
 
 	ofi_init = 1;
@@ -1029,6 +1287,7 @@ FI_DESTRUCTOR(fi_fini(void))
 		ofi_free_prov(prov);
 	}
 
+	ofi_free_dl_libs();
 	ofi_free_filter(&prov_filter);
 	ofi_shm_p2p_cleanup();
 	ofi_monitors_cleanup();
@@ -1325,6 +1584,7 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 	char **prov_vec = NULL;
 	size_t count = 0;
 	enum fi_log_level level;
+	bool cacheable = true;
 	int ret;
 
 	fi_ini();
@@ -1336,9 +1596,13 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 	}
 
 	if (flags == FI_PROV_ATTR_ONLY) {
+		ofi_load_lazy_provs();
 		return ofi_getprovinfo(info);
 	}
 
+	if (!ofi_getinfo_cache_get(version, node, service, flags, hints, info))
+		return 0;
+
 	if (hints && hints->fabric_attr && hints->fabric_attr->prov_name) {
 		prov_vec = ofi_split_and_alloc(hints->fabric_attr->prov_name,
 					       ";", &count);
@@ -1348,6 +1612,8 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 		       hints->fabric_attr->prov_name);
 	}
 
+	ofi_load_dl_libs(prov_vec, count, flags);
+
 	*info = tail = NULL;
 	for (prov = prov_head; prov; prov = prov->next) {
 		if (!prov->provider || !prov->provider->getinfo)
@@ -1376,6 +1642,7 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 		cur = NULL;
 		ret = prov->provider->getinfo(version, node, service, flags,
 					      hints, &cur);
+		prov->probed = true;
 		if (ret) {
 			level = ((hints && hints->fabric_attr &&
 				  hints->fabric_attr->prov_name &&
@@ -1398,6 +1665,9 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 		FI_DBG(&core_prov, FI_LOG_CORE, "fi_getinfo: provider %s "
 		       "returned success\n", prov->provider->name);
 
+		if (ofi_prov_ctx(prov->provider)->disable_info_cache)
+			cacheable = false;
+
 		if (!*info)
 			*info = cur;
 		else
@@ -1418,7 +1688,13 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 		ofi_reorder_info(info);
 	}
 
-	return *info ? 0 : -FI_ENODATA;
+	if (!*info)
+		return -FI_ENODATA;
+
+	if (cacheable)
+		ofi_getinfo_cache_put(version, node, service, flags, hints,
+				      *info);
+	return 0;
 }
 DEFAULT_SYMVER(fi_getinfo_, fi_getinfo, FABRIC_1.8);
 
@@ -1553,6 +1829,26 @@ fail:
 }
 DEFAULT_SYMVER(fi_dupinfo_, fi_dupinfo, FABRIC_1.8);
 
+/*
+ * Some core providers build the state needed to open a fabric when their
+ * getinfo() is called.  That call is skipped when fi_getinfo() results are
+ * read from the cache, so make it here, for the selected provider only.
+ */
+static void ofi_probe_prov(struct ofi_prov *prov, uint32_t version)
+{
+	struct fi_info *info = NULL;
+
+	if (prov->probed || !ofi_is_core_prov(prov->provider))
+		return;
+
+	if (!version)
+		version = prov->provider->fi_version;
+
+	if (!prov->provider->getinfo(version, NULL, NULL, 0, NULL, &info))
+		fi_freeinfo(info);
+	prov->probed = true;
+}
+
 __attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
 int DEFAULT_SYMVER_PRE(fi_fabric)(struct fi_fabric_attr *attr,
 		struct fid_fabric **fabric, void *context)
@@ -1581,9 +1877,18 @@ int DEFAULT_SYMVER_PRE(fi_fabric)(struct fi_fabric_attr *attr,
 		return -FI_EINVAL;
 
 	prov = ofi_getprov(top_name, strlen(top_name));
+	if (!prov || !prov->provider) {
+		/* The fabric attributes may come from the fi_getinfo cache,
+		 * in which case the provider may not have been loaded yet.
+		 */
+		ofi_load_dl_libs((char **) &top_name, 1, 0);
+		prov = ofi_getprov(top_name, strlen(top_name));
+	}
 	if (!prov || !prov->provider || !prov->provider->fabric)
 		return -FI_ENODEV;
 
+	ofi_probe_prov(prov, attr->api_version);
+
 	ret = prov->provider->fabric(attr, fabric, context);
 	if (!ret) {
 		if (FI_VERSION_GE(prov->provider->fi_version, FI_VERSION(1, 5)))
@@ -0,0 +1,747 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Persistent cache of fi_getinfo() results.
+ *
+ * When FI_GETINFO_CACHE_DIR is set, the fi_info list returned for a given
+ * set of fi_getinfo() arguments is written to a file in that directory.
+ * Later processes on the same host that make the same call read the list
+ * back rather than probing the providers.  Files are keyed by a hash of the
+ * arguments and a host fingerprint, which covers the library version, the
+ * set of providers, the host name, network interfaces, and FI_* variables.
+ * The arguments are also stored in the file and compared on lookup, so a
+ * hash collision results in a miss.  Attribute structures are stored as
+ * raw bytes, which is safe because the library version is part of the
+ * fingerprint.  Any pointer read back from a file is cleared before the
+ * structure is used or freed, since the file contents are not trusted.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <net/if.h>
+
+#include <rdma/fabric.h>
+#include <rdma/providers/fi_log.h>
+#include "ofi.h"
+#include "ofi_net.h"
+#include "fasthash.h"
+
+#ifndef _WIN32
+extern char **environ;
+#endif
+
+#define OFI_INFO_CACHE_MAGIC	0x4f464943
+#define OFI_INFO_CACHE_VERSION	2
+
+/* Flags that only change how fi_getinfo() interprets its arguments. */
+#define OFI_INFO_CACHE_FLAGS	(FI_SOURCE | FI_NUMERICHOST)
+
+struct ofi_cache_hdr {
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		key_len;
+	uint64_t		info_cnt;
+};
+
+/* The fi_info fields that are not pointers. */
+struct ofi_cache_info {
+	uint64_t		caps;
+	uint64_t		mode;
+	uint64_t		src_addrlen;
+	uint64_t		dest_addrlen;
+	uint32_t		addr_format;
+	uint32_t		pad;
+};
+
+struct ofi_cache_buf {
+	uint8_t			*data;
+	size_t			len;
+	size_t			size;
+	size_t			off;
+	int			err;
+};
+
+static char *cache_dir;
+static uint64_t cache_fingerprint;
+
+
+static void ofi_cache_put(struct ofi_cache_buf *buf, const void *data,
+			  size_t len)
+{
+	size_t size;
+	void *new_data;
+
+	if (buf->err)
+		return;
+
+	if (buf->len + len > buf->size) {
+		size = MAX(buf->size * 2, buf->len + len + 1024);
+		new_data = realloc(buf->data, size);
+		if (!new_data) {
+			buf->err = -FI_ENOMEM;
+			return;
+		}
+		buf->data = new_data;
+		buf->size = size;
+	}
+
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+/* A blob is stored as its length plus one, with 0 meaning NULL. */
+static void ofi_cache_put_blob(struct ofi_cache_buf *buf, const void *data,
+			       size_t len)
+{
+	uint64_t hdr = data ? len + 1 : 0;
+
+	ofi_cache_put(buf, &hdr, sizeof hdr);
+	if (data)
+		ofi_cache_put(buf, data, len);
+}
+
+static void ofi_cache_put_str(struct ofi_cache_buf *buf, const char *str)
+{
+	ofi_cache_put_blob(buf, str, str ? strlen(str) + 1 : 0);
+}
+
+static int ofi_cache_get(struct ofi_cache_buf *buf, void *data, size_t len)
+{
+	if (buf->len - buf->off < len)
+		return -FI_EINVAL;
+
+	memcpy(data, buf->data + buf->off, len);
+	buf->off += len;
+	return 0;
+}
+
+static int ofi_cache_get_blob(struct ofi_cache_buf *buf, void **data,
+			      size_t *len)
+{
+	uint64_t hdr;
+	int ret;
+
+	*data = NULL;
+	ret = ofi_cache_get(buf, &hdr, sizeof hdr);
+	if (ret || !hdr)
+		return ret;
+
+	if (buf->len - buf->off < hdr - 1)
+		return -FI_EINVAL;
+
+	/* Allocate at least one byte so that empty blobs are not NULL. */
+	*data = malloc(hdr);
+	if (!*data)
+		return -FI_ENOMEM;
+
+	if (len)
+		*len = hdr - 1;
+	return ofi_cache_get(buf, *data, hdr - 1);
+}
+
+static int ofi_cache_get_attr(struct ofi_cache_buf *buf, void **attr,
+			      size_t size)
+{
+	size_t len;
+	int ret;
+
+	ret = ofi_cache_get_blob(buf, attr, &len);
+	if (!ret && *attr && len != size) {
+		/* Never hand a mis-sized attribute to fi_freeinfo(). */
+		free(*attr);
+		*attr = NULL;
+		ret = -FI_EINVAL;
+	}
+	return ret;
+}
+
+static int ofi_cache_get_str(struct ofi_cache_buf *buf, char **str)
+{
+	size_t len;
+	int ret;
+
+	ret = ofi_cache_get_blob(buf, (void **) str, &len);
+	if (!ret && *str && (!len || (*str)[len - 1])) {
+		free(*str);
+		*str = NULL;
+		ret = -FI_EINVAL;
+	}
+	return ret;
+}
+
+static bool ofi_cache_valid_addr(uint32_t addr_format, const void *addr,
+				 size_t len)
+{
+	size_t addrlen;
+
+	if (!addr)
+		return true;
+
+	switch (addr_format) {
+	case FI_SOCKADDR:
+	case FI_SOCKADDR_IN:
+	case FI_SOCKADDR_IN6:
+	case FI_SOCKADDR_IB:
+		if (len < sizeof(struct sockaddr))
+			return false;
+		addrlen = ofi_sizeofaddr(addr);
+		return addrlen && addrlen <= len;
+	case FI_ADDR_STR:
+		return len && !((const char *) addr)[len - 1];
+	default:
+		return true;
+	}
+}
+
+static void ofi_cache_put_nic(struct ofi_cache_buf *buf,
+			      const struct fid_nic *nic)
+{
+	struct fi_device_attr *dev = nic->device_attr;
+	struct fi_link_attr link;
+	uint8_t present = dev != NULL;
+
+	ofi_cache_put(buf, &present, sizeof present);
+	if (dev) {
+		ofi_cache_put_str(buf, dev->name);
+		ofi_cache_put_str(buf, dev->device_id);
+		ofi_cache_put_str(buf, dev->device_version);
+		ofi_cache_put_str(buf, dev->vendor_id);
+		ofi_cache_put_str(buf, dev->driver);
+		ofi_cache_put_str(buf, dev->firmware);
+	}
+
+	ofi_cache_put_blob(buf, nic->bus_attr, sizeof(*nic->bus_attr));
+
+	if (nic->link_attr) {
+		link = *nic->link_attr;
+		link.address = NULL;
+		link.network_type = NULL;
+		ofi_cache_put_blob(buf, &link, sizeof link);
+		ofi_cache_put_str(buf, nic->link_attr->address);
+		ofi_cache_put_str(buf, nic->link_attr->network_type);
+	} else {
+		ofi_cache_put_blob(buf, NULL, 0);
+	}
+}
+
+static void ofi_cache_put_info(struct ofi_cache_buf *buf,
+			       const struct fi_info *info)
+{
+	struct ofi_cache_info scalars;
+	struct fi_ep_attr ep_attr;
+	struct fi_domain_attr domain_attr;
+	struct fi_fabric_attr fabric_attr;
+	uint8_t present;
+
+	memset(&scalars, 0, sizeof scalars);
+	scalars.caps = info->caps;
+	scalars.mode = info->mode;
+	scalars.addr_format = info->addr_format;
+	scalars.src_addrlen = info->src_addrlen;
+	scalars.dest_addrlen = info->dest_addrlen;
+	ofi_cache_put(buf, &scalars, sizeof scalars);
+
+	ofi_cache_put_blob(buf, info->src_addr, info->src_addrlen);
+	ofi_cache_put_blob(buf, info->dest_addr, info->dest_addrlen);
+	ofi_cache_put_blob(buf, info->tx_attr, sizeof(*info->tx_attr));
+	ofi_cache_put_blob(buf, info->rx_attr, sizeof(*info->rx_attr));
+
+	if (info->ep_attr) {
+		ep_attr = *info->ep_attr;
+		ep_attr.auth_key = NULL;
+		ofi_cache_put_blob(buf, &ep_attr, sizeof ep_attr);
+		ofi_cache_put_blob(buf, info->ep_attr->auth_key,
+				   info->ep_attr->auth_key_size);
+	} else {
+		ofi_cache_put_blob(buf, NULL, 0);
+	}
+
+	if (info->domain_attr) {
+		domain_attr = *info->domain_attr;
+		domain_attr.domain = NULL;
+		domain_attr.name = NULL;
+		domain_attr.auth_key = NULL;
+		ofi_cache_put_blob(buf, &domain_attr, sizeof domain_attr);
+		ofi_cache_put_str(buf, info->domain_attr->name);
+		ofi_cache_put_blob(buf, info->domain_attr->auth_key,
+				   info->domain_attr->auth_key_size);
+	} else {
+		ofi_cache_put_blob(buf, NULL, 0);
+	}
+
+	if (info->fabric_attr) {
+		fabric_attr = *info->fabric_attr;
+		fabric_attr.fabric = NULL;
+		fabric_attr.name = NULL;
+		fabric_attr.prov_name = NULL;
+		ofi_cache_put_blob(buf, &fabric_attr, sizeof fabric_attr);
+		ofi_cache_put_str(buf, info->fabric_attr->name);
+		ofi_cache_put_str(buf, info->fabric_attr->prov_name);
+	} else {
+		ofi_cache_put_blob(buf, NULL, 0);
+	}
+
+	present = info->nic != NULL;
+	ofi_cache_put(buf, &present, sizeof present);
+	if (info->nic)
+		ofi_cache_put_nic(buf, info->nic);
+}
+
+static int ofi_cache_get_nic(struct ofi_cache_buf *buf, struct fid_nic **nic)
+{
+	struct fi_device_attr *dev;
+	struct fi_link_attr *link;
+	uint8_t present;
+	int ret;
+
+	/* Provider specific attributes are not cached. */
+	*nic = ofi_nic_dup(NULL);
+	if (!*nic)
+		return -FI_ENOMEM;
+
+	free((*nic)->bus_attr);
+	free((*nic)->link_attr);
+	(*nic)->bus_attr = NULL;
+	(*nic)->link_attr = NULL;
+
+	ret = ofi_cache_get(buf, &present, sizeof present);
+	if (ret)
+		return ret;
+
+	dev = (*nic)->device_attr;
+	if (present) {
+		ret = ofi_cache_get_str(buf, &dev->name) ? :
+		      ofi_cache_get_str(buf, &dev->device_id) ? :
+		      ofi_cache_get_str(buf, &dev->device_version) ? :
+		      ofi_cache_get_str(buf, &dev->vendor_id) ? :
+		      ofi_cache_get_str(buf, &dev->driver) ? :
+		      ofi_cache_get_str(buf, &dev->firmware);
+		if (ret)
+			return ret;
+	} else {
+		free(dev);
+		(*nic)->device_attr = NULL;
+	}
+
+	ret = ofi_cache_get_attr(buf, (void **) &(*nic)->bus_attr,
+				 sizeof(*(*nic)->bus_attr));
+	if (ret)
+		return ret;
+
+	ret = ofi_cache_get_attr(buf, (void **) &(*nic)->link_attr,
+				 sizeof(*(*nic)->link_attr));
+	if (ret || !(*nic)->link_attr)
+		return ret;
+
+	link = (*nic)->link_attr;
+	link->address = NULL;
+	link->network_type = NULL;
+	return ofi_cache_get_str(buf, &link->address) ? :
+	       ofi_cache_get_str(buf, &link->network_type);
+}
+
+static int ofi_cache_get_info(struct ofi_cache_buf *buf, struct fi_info **info)
+{
+	struct ofi_cache_info scalars;
+	struct fi_info *cur;
+	uint8_t present;
+	int ret;
+
+	ret = ofi_cache_get(buf, &scalars, sizeof scalars);
+	if (ret)
+		return ret;
+
+	cur = calloc(1, sizeof(*cur));
+	if (!cur)
+		return -FI_ENOMEM;
+
+	cur->caps = scalars.caps;
+	cur->mode = scalars.mode;
+	cur->addr_format = scalars.addr_format;
+	cur->src_addrlen = scalars.src_addrlen;
+	cur->dest_addrlen = scalars.dest_addrlen;
+
+	ret = ofi_cache_get_attr(buf, &cur->src_addr, cur->src_addrlen) ? :
+	      ofi_cache_get_attr(buf, &cur->dest_addr, cur->dest_addrlen) ? :
+	      ofi_cache_get_attr(buf, (void **) &cur->tx_attr,
+				 sizeof(*cur->tx_attr)) ? :
+	      ofi_cache_get_attr(buf, (void **) &cur->rx_attr,
+				 sizeof(*cur->rx_attr)) ? :
+	      ofi_cache_get_attr(buf, (void **) &cur->ep_attr,
+				 sizeof(*cur->ep_attr));
+	if (ret)
+		goto err;
+
+	if (!ofi_cache_valid_addr(cur->addr_format, cur->src_addr,
+				  cur->src_addrlen) ||
+	    !ofi_cache_valid_addr(cur->addr_format, cur->dest_addr,
+				  cur->dest_addrlen)) {
+		ret = -FI_EINVAL;
+		goto err;
+	}
+
+	if (cur->ep_attr) {
+		cur->ep_attr->auth_key = NULL;
+		ret = ofi_cache_get_attr(buf, (void **) &cur->ep_attr->auth_key,
+					 cur->ep_attr->auth_key_size);
+		if (ret)
+			goto err;
+	}
+
+	ret = ofi_cache_get_attr(buf, (void **) &cur->domain_attr,
+				 sizeof(*cur->domain_attr));
+	if (ret)
+		goto err;
+
+	if (cur->domain_attr) {
+		cur->domain_attr->domain = NULL;
+		cur->domain_attr->name = NULL;
+		cur->domain_attr->auth_key = NULL;
+		ret = ofi_cache_get_str(buf, &cur->domain_attr->name) ? :
+		      ofi_cache_get_attr(buf,
+					 (void **) &cur->domain_attr->auth_key,
+					 cur->domain_attr->auth_key_size);
+		if (ret)
+			goto err;
+	}
+
+	ret = ofi_cache_get_attr(buf, (void **) &cur->fabric_attr,
+				 sizeof(*cur->fabric_attr));
+	if (ret)
+		goto err;
+
+	if (cur->fabric_attr) {
+		cur->fabric_attr->fabric = NULL;
+		cur->fabric_attr->name = NULL;
+		cur->fabric_attr->prov_name = NULL;
+		ret = ofi_cache_get_str(buf, &cur->fabric_attr->name) ? :
+		      ofi_cache_get_str(buf, &cur->fabric_attr->prov_name);
+		if (ret)
+			goto err;
+	}
+
+	ret = ofi_cache_get(buf, &present, sizeof present);
+	if (!ret && present)
+		ret = ofi_cache_get_nic(buf, &cur->nic);
+	if (ret)
+		goto err;
+
+	*info = cur;
+	return 0;
+err:
+	fi_freeinfo(cur);
+	return ret;
+}
+
+static bool ofi_cache_supported(uint64_t flags, const struct fi_info *hints)
+{
+	if (!cache_dir || (flags & ~OFI_INFO_CACHE_FLAGS))
+		return false;
+
+	if (!hints)
+		return true;
+
+	return !hints->handle &&
+	       (!hints->domain_attr || !hints->domain_attr->domain) &&
+	       (!hints->fabric_attr || !hints->fabric_attr->fabric);
+}
+
+static void ofi_cache_put_key(struct ofi_cache_buf *buf, uint32_t version,
+			      const char *node, const char *service,
+			      uint64_t flags, const struct fi_info *hints)
+{
+	uint8_t present = hints != NULL;
+
+	ofi_cache_put(buf, &version, sizeof version);
+	ofi_cache_put(buf, &flags, sizeof flags);
+	ofi_cache_put_str(buf, node);
+	ofi_cache_put_str(buf, service);
+	ofi_cache_put(buf, &present, sizeof present);
+	if (hints)
+		ofi_cache_put_info(buf, hints);
+}
+
+static char *ofi_cache_path(const struct ofi_cache_buf *key)
+{
+	char *path;
+
+	if (asprintf(&path, "%s/fi_info_%016" PRIx64 ".cache", cache_dir,
+		     fasthash64(key->data, key->len, cache_fingerprint)) < 0)
+		return NULL;
+	return path;
+}
+
+int ofi_getinfo_cache_get(uint32_t version, const char *node,
+			  const char *service, uint64_t flags,
+			  const struct fi_info *hints, struct fi_info **info)
+{
+	struct ofi_cache_buf key = {0}, buf = {0};
+	struct ofi_cache_hdr hdr;
+	struct fi_info *tail = NULL, *cur;
+	char *path = NULL;
+	FILE *file = NULL;
+	long size;
+	uint64_t i;
+	int ret = -FI_ENODATA;
+
+	if (!ofi_cache_supported(flags, hints))
+		return -FI_ENODATA;
+
+	ofi_cache_put_key(&key, version, node, service, flags, hints);
+	if (key.err)
+		goto out;
+
+	path = ofi_cache_path(&key);
+	if (!path)
+		goto out;
+
+	file = fopen(path, "rb");
+	if (!file)
+		goto out;
+
+	if (fseek(file, 0, SEEK_END) || (size = ftell(file)) <= 0 ||
+	    fseek(file, 0, SEEK_SET))
+		goto out;
+
+	buf.data = malloc(size);
+	if (!buf.data)
+		goto out;
+
+	buf.len = size;
+	if (fread(buf.data, 1, size, file) != (size_t) size)
+		goto out;
+
+	if (ofi_cache_get(&buf, &hdr, sizeof hdr) ||
+	    hdr.magic != OFI_INFO_CACHE_MAGIC ||
+	    hdr.version != OFI_INFO_CACHE_VERSION ||
+	    hdr.key_len != key.len || buf.len - buf.off < key.len ||
+	    memcmp(buf.data + buf.off, key.data, key.len))
+		goto out;
+
+	buf.off += key.len;
+	*info = NULL;
+	for (i = 0; i < hdr.info_cnt; i++) {
+		ret = ofi_cache_get_info(&buf, &cur);
+		if (ret) {
+			FI_WARN(&core_prov, FI_LOG_CORE,
+				"invalid fi_info cache file %s\n", path);
+			fi_freeinfo(*info);
+			*info = NULL;
+			ret = -FI_ENODATA;
+			goto out;
+		}
+
+		if (tail)
+			tail->next = cur;
+		else
+			*info = cur;
+		tail = cur;
+	}
+
+	ret = *info ? 0 : -FI_ENODATA;
+	if (!ret)
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"fi_getinfo results read from %s\n", path);
+out:
+	if (file)
+		fclose(file);
+	free(buf.data);
+	free(key.data);
+	free(path);
+	return ret;
+}
+
+void ofi_getinfo_cache_put(uint32_t version, const char *node,
+			   const char *service, uint64_t flags,
+			   const struct fi_info *hints, const struct fi_info *info)
+{
+	struct ofi_cache_buf key = {0}, buf = {0};
+	struct ofi_cache_hdr hdr = {0};
+	const struct fi_info *cur;
+	char *path = NULL, *tmp_path = NULL;
+	FILE *file;
+	size_t len;
+
+	if (!ofi_cache_supported(flags, hints))
+		return;
+
+	for (cur = info; cur; cur = cur->next) {
+		if (cur->handle ||
+		    (cur->domain_attr && cur->domain_attr->domain) ||
+		    (cur->fabric_attr && cur->fabric_attr->fabric))
+			return;
+		hdr.info_cnt++;
+	}
+
+	ofi_cache_put_key(&key, version, node, service, flags, hints);
+	if (key.err)
+		goto out;
+
+	hdr.magic = OFI_INFO_CACHE_MAGIC;
+	hdr.version = OFI_INFO_CACHE_VERSION;
+	hdr.key_len = key.len;
+	ofi_cache_put(&buf, &hdr, sizeof hdr);
+	ofi_cache_put(&buf, key.data, key.len);
+	for (cur = info; cur; cur = cur->next)
+		ofi_cache_put_info(&buf, cur);
+	if (buf.err)
+		goto out;
+
+	path = ofi_cache_path(&key);
+	if (!path)
+		goto out;
+
+	/* Write to a private file and rename it, so that readers racing
+	 * with us never observe a partial file.
+	 */
+	if (asprintf(&tmp_path, "%s.%d", path, getpid()) < 0) {
+		tmp_path = NULL;
+		goto out;
+	}
+
+	file = fopen(tmp_path, "wb");
+	if (!file) {
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"unable to create fi_info cache file %s\n", tmp_path);
+		goto out;
+	}
+
+	len = fwrite(buf.data, 1, buf.len, file);
+	if (fclose(file) || len != buf.len || rename(tmp_path, path))
+		remove(tmp_path);
+out:
+	free(buf.data);
+	free(key.data);
+	free(tmp_path);
+	free(path);
+}
+
+static uint64_t ofi_cache_hash_ifaddrs(uint64_t hash)
+{
+#if HAVE_GETIFADDRS
+	struct ifaddrs *ifaddrs, *ifa;
+	uint32_t up;
+
+	if (ofi_getifaddrs(&ifaddrs))
+		return hash;
+
+	for (ifa = ifaddrs; ifa; ifa = ifa->ifa_next) {
+		if (!ifa->ifa_addr || !ofi_sizeofaddr(ifa->ifa_addr))
+			continue;
+
+		up = (ifa->ifa_flags & IFF_UP) != 0;
+		hash = fasthash64(ifa->ifa_name, strlen(ifa->ifa_name), hash);
+		hash = fasthash64(&up, sizeof up, hash);
+		hash = fasthash64(ifa->ifa_addr, ofi_sizeofaddr(ifa->ifa_addr),
+				  hash);
+	}
+	freeifaddrs(ifaddrs);
+#endif
+	return hash;
+}
+
+static uint64_t ofi_cache_hash_dir(uint64_t hash, const char *path)
+{
+#ifndef _WIN32
+	struct dirent *entry;
+	uint64_t sum = 0;
+	DIR *dir;
+
+	dir = opendir(path);
+	if (!dir)
+		return hash;
+
+	/* Sum entries so that the result does not depend on the order. */
+	while ((entry = readdir(dir)))
+		sum += fasthash64(entry->d_name, strlen(entry->d_name), 0);
+	closedir(dir);
+
+	hash = fasthash64(&sum, sizeof sum, hash);
+#endif
+	return hash;
+}
+
+static uint64_t ofi_cache_hash_env(uint64_t hash)
+{
+	uint64_t sum = 0;
+	char **env;
+
+	for (env = environ; env && *env; env++) {
+		if (strncmp(*env, "FI_", 3) || !strncmp(*env, "FI_LOG_", 7))
+			continue;
+		sum += fasthash64(*env, strlen(*env), 0);
+	}
+
+	return fasthash64(&sum, sizeof sum, hash);
+}
+
+/*
+ * The seed identifies the set of providers that are available.  It is
+ * computed by the caller, since the provider list is private to fabric.c.
+ */
+void ofi_getinfo_cache_init(uint64_t seed)
+{
+	char hostname[256] = {0};
+	uint64_t hash;
+
+	fi_param_define(NULL, "getinfo_cache_dir", FI_PARAM_STRING,
+			"Directory used to store fi_getinfo() results, so "
+			"that later processes on the same host making the "
+			"same call can skip probing the providers.  The "
+			"directory must exist and be writable.  Remove its "
+			"contents after changing the network configuration. "
+			"(default: none, disabled)");
+	fi_param_get_str(NULL, "getinfo_cache_dir", &cache_dir);
+	if (!cache_dir || !*cache_dir) {
+		cache_dir = NULL;
+		return;
+	}
+
+	hash = fasthash64(PACKAGE_VERSION, strlen(PACKAGE_VERSION), seed);
+	if (!gethostname(hostname, sizeof(hostname) - 1))
+		hash = fasthash64(hostname, strlen(hostname), hash);
+	hash = ofi_cache_hash_ifaddrs(hash);
+	hash = ofi_cache_hash_dir(hash, "/sys/class/infiniband");
+	hash = ofi_cache_hash_env(hash);
+	cache_fingerprint = hash;
+
+	FI_INFO(&core_prov, FI_LOG_CORE,
+		"caching fi_getinfo results in %s, fingerprint %016" PRIx64
+		"\n", cache_dir, cache_fingerprint);
+}
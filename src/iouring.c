@@ -35,8 +35,20 @@
 
 #include <liburing.h>
 
+#include <ofi.h>
+#include <ofi_mem.h>
 #include <ofi_net.h>
 
+/* Sockets registered with the ring skip the per-request file lookup */
+static inline void
+ofi_uring_sqe_set_file(struct io_uring_sqe *sqe, struct ofi_sockctx *ctx)
+{
+	if (ctx->uring_fixed_file >= 0) {
+		sqe->fd = ctx->uring_fixed_file;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	}
+}
+
 int ofi_sockapi_connect_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 			      const struct sockaddr *addr, socklen_t addrlen,
 			      struct ofi_sockctx *ctx)
@@ -100,6 +112,7 @@ ssize_t ofi_sockapi_send_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 		return -FI_EOVERFLOW;
 
 	io_uring_prep_send(sqe, sock, buf, len, flags);
+	ofi_uring_sqe_set_file(sqe, ctx);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
 	uring->credits--;
@@ -125,6 +138,7 @@ ssize_t ofi_sockapi_sendv_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 		return -FI_EOVERFLOW;
 
 	io_uring_prep_writev(sqe, sock, iov, cnt, flags);
+	ofi_uring_sqe_set_file(sqe, ctx);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
 	uring->credits--;
@@ -147,6 +161,7 @@ ssize_t ofi_sockapi_recv_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 		return -FI_EOVERFLOW;
 
 	io_uring_prep_recv(sqe, sock, buf, len, flags);
+	ofi_uring_sqe_set_file(sqe, ctx);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
 	uring->credits--;
@@ -169,6 +184,7 @@ ssize_t ofi_sockapi_recvv_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 		return -FI_EOVERFLOW;
 
 	io_uring_prep_readv(sqe, sock, iov, cnt, flags);
+	ofi_uring_sqe_set_file(sqe, ctx);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
 	uring->credits--;
@@ -215,12 +231,98 @@ int ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 		io_uring_prep_poll_multishot(sqe, fd, poll_mask);
 	else
 		io_uring_prep_poll_add(sqe, fd, poll_mask);
+	ofi_uring_sqe_set_file(sqe, ctx);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
 	uring->credits--;
 	return -OFI_EINPROGRESS_URING;
 }
 
+#ifdef HAVE_LIBURING_MSHOT
+int ofi_sockapi_recv_mshot_uring(struct ofi_sockapi_uring *uring, SOCKET sock,
+				 struct ofi_uring_bufs *bufs,
+				 struct ofi_sockctx *ctx)
+{
+	struct io_uring_sqe *sqe;
+
+	if (ctx->uring_sqe_inuse || uring->credits == 0)
+		return -FI_EAGAIN;
+
+	sqe = io_uring_get_sqe(uring->io_uring);
+	if (!sqe)
+		return -FI_EOVERFLOW;
+
+	io_uring_prep_recv_multishot(sqe, sock, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = (uint16_t) bufs->bgid;
+	ofi_uring_sqe_set_file(sqe, ctx);
+	io_uring_sqe_set_data(sqe, ctx);
+	ctx->uring_sqe_inuse = true;
+	uring->credits--;
+	return -OFI_EINPROGRESS_URING;
+}
+
+int ofi_uring_files_init(ofi_io_uring_t *io_uring, unsigned int cnt)
+{
+	return io_uring_register_files_sparse(io_uring, cnt);
+}
+
+int ofi_uring_file_set(ofi_io_uring_t *io_uring, unsigned int index, int fd)
+{
+	int ret;
+
+	ret = io_uring_register_files_update(io_uring, index, &fd, 1);
+	return ret < 0 ? ret : 0;
+}
+
+int ofi_uring_bufs_init(struct ofi_uring_bufs *bufs, ofi_io_uring_t *io_uring,
+			unsigned int cnt, size_t size, int bgid)
+{
+	unsigned int i;
+	int ret;
+
+	/* The kernel requires a power of 2 ring size */
+	cnt = (unsigned int) roundup_power_of_two(cnt);
+	ret = ofi_memalign((void **) &bufs->data, ofi_get_page_size(),
+			   cnt * size);
+	if (ret)
+		return -FI_ENOMEM;
+
+	bufs->ring = io_uring_setup_buf_ring(io_uring, cnt, bgid, 0, &ret);
+	if (!bufs->ring) {
+		ofi_freealign(bufs->data);
+		return ret;
+	}
+
+	bufs->io_uring = io_uring;
+	bufs->size = size;
+	bufs->cnt = cnt;
+	bufs->bgid = bgid;
+	for (i = 0; i < cnt; i++) {
+		io_uring_buf_ring_add(bufs->ring, ofi_uring_buf(bufs, i),
+				      (unsigned int) size, (unsigned short) i,
+				      io_uring_buf_ring_mask(cnt), (int) i);
+	}
+	io_uring_buf_ring_advance(bufs->ring, (int) cnt);
+	return 0;
+}
+
+void ofi_uring_bufs_free(struct ofi_uring_bufs *bufs)
+{
+	io_uring_free_buf_ring(bufs->io_uring, bufs->ring, bufs->cnt,
+			       bufs->bgid);
+	ofi_freealign(bufs->data);
+}
+
+void ofi_uring_buf_put(struct ofi_uring_bufs *bufs, unsigned int bid)
+{
+	io_uring_buf_ring_add(bufs->ring, ofi_uring_buf(bufs, bid),
+			      (unsigned int) bufs->size, (unsigned short) bid,
+			      io_uring_buf_ring_mask(bufs->cnt), 0);
+	io_uring_buf_ring_advance(bufs->ring, 1);
+}
+#endif
+
 int ofi_uring_init(ofi_io_uring_t *io_uring, size_t entries)
 {
 	struct io_uring_params params;
@@ -46,6 +46,7 @@
 #include <linux/ethtool.h>
 #include <linux/sockios.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <inttypes.h>
 
 static size_t ofi_base_page_size;
@@ -146,6 +147,35 @@ ssize_t ofi_get_hugepage_size(void)
 	return val * 1024;
 }
 
+/*
+ * Prefer the NUMA node of the cpu that the caller is running on for the
+ * given range.  Called on freshly mapped memory before it is touched.
+ */
+int ofi_mbind_local(void *addr, size_t len)
+{
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+	/* MPOL_PREFERRED from numaif.h, which we don't depend on */
+	const int mpol_preferred = 1;
+	unsigned long nodemask[4] = { 0 };
+	unsigned int cpu, node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL))
+		return -ofi_syserr();
+
+	if (node >= sizeof(nodemask) * 8)
+		return -FI_ENOSYS;
+
+	nodemask[node / (sizeof(*nodemask) * 8)] |=
+		1UL << (node % (sizeof(*nodemask) * 8));
+	if (syscall(SYS_mbind, addr, len, mpol_preferred, nodemask,
+		    sizeof(nodemask) * 8, 0))
+		return -ofi_syserr();
+	return 0;
+#else
+	return -FI_ENOSYS;
+#endif
+}
+
 #ifdef HAVE_ETHTOOL
 
 #if HAVE_DECL_ETHTOOL_CMD_SPEED